@@ -0,0 +1,130 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "AlsaAudioDriver.h"
+
+
+// ----------------------------------------------------------------------------
+AlsaAudioDriver::AlsaAudioDriver(const char* deviceName, int periodSize, int periodCount)
+// ----------------------------------------------------------------------------
+{
+	mDeviceName = new char[strlen(deviceName) + 1];
+	strcpy(mDeviceName, deviceName);
+	mNumSamplesInBuffer = periodSize;
+	mPeriodCount = periodCount;
+	mPcm = NULL;
+}
+
+
+// ----------------------------------------------------------------------------
+AlsaAudioDriver::~AlsaAudioDriver()
+// ----------------------------------------------------------------------------
+{
+	deinitialize();
+	delete[] mDeviceName;
+}
+
+
+// ----------------------------------------------------------------------------
+bool AlsaAudioDriver::openStream()
+// ----------------------------------------------------------------------------
+{
+	int err = snd_pcm_open(&mPcm, mDeviceName, SND_PCM_STREAM_PLAYBACK, 0);
+	if (err < 0)
+	{
+		printf("snd_pcm_open(%s) failed: %s\n", mDeviceName, snd_strerror(err));
+		mPcm = NULL;
+		return false;
+	}
+
+	snd_pcm_hw_params_t* hwParams;
+	snd_pcm_hw_params_alloca(&hwParams);
+
+	unsigned int rate = mSampleRate;
+	snd_pcm_uframes_t periodSize = mNumSamplesInBuffer;
+	snd_pcm_uframes_t bufferSize = mNumSamplesInBuffer * mPeriodCount;
+
+	if ((err = snd_pcm_hw_params_any(mPcm, hwParams)) < 0 ||
+		(err = snd_pcm_hw_params_set_access(mPcm, hwParams, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0 ||
+		(err = snd_pcm_hw_params_set_format(mPcm, hwParams, SND_PCM_FORMAT_S16)) < 0 ||
+		(err = snd_pcm_hw_params_set_channels(mPcm, hwParams, 1)) < 0 ||
+		(err = snd_pcm_hw_params_set_rate_near(mPcm, hwParams, &rate, NULL)) < 0 ||
+		(err = snd_pcm_hw_params_set_period_size_near(mPcm, hwParams, &periodSize, NULL)) < 0 ||
+		(err = snd_pcm_hw_params_set_buffer_size_near(mPcm, hwParams, &bufferSize)) < 0 ||
+		(err = snd_pcm_hw_params(mPcm, hwParams)) < 0)
+	{
+		printf("AlsaAudioDriver: cannot configure %s: %s\n", mDeviceName, snd_strerror(err));
+		snd_pcm_close(mPcm);
+		mPcm = NULL;
+		return false;
+	}
+
+	// the device may round the request
+	snd_pcm_hw_params_get_period_size(hwParams, &periodSize, NULL);
+	snd_pcm_hw_params_get_buffer_size(hwParams, &bufferSize);
+
+	mSampleRate = rate;
+	mNumSamplesInBuffer = (int) periodSize;
+	mPeriodCount = (int) (bufferSize / periodSize);
+
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void AlsaAudioDriver::closeStream()
+// ----------------------------------------------------------------------------
+{
+	if (mPcm == NULL)
+		return;
+
+	snd_pcm_drain(mPcm);
+	snd_pcm_close(mPcm);
+	mPcm = NULL;
+}
+
+
+// ----------------------------------------------------------------------------
+bool AlsaAudioDriver::writeStream(const short* buffer, int numSamples)
+// ----------------------------------------------------------------------------
+{
+	while (numSamples > 0)
+	{
+		snd_pcm_sframes_t written = snd_pcm_writei(mPcm, buffer, numSamples);
+
+		if (written == -EPIPE)
+			bufferUnderrun();
+
+		if (written < 0)
+		{
+			written = snd_pcm_recover(mPcm, (int) written, 1);
+			if (written < 0)
+			{
+				printf("snd_pcm_writei failed: %s\n", snd_strerror((int) written));
+				return false;
+			}
+			continue;
+		}
+
+		buffer += written;
+		numSamples -= (int) written;
+	}
+
+	return true;
+}
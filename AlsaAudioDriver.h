@@ -0,0 +1,52 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _ALSAAUDIODRIVER_H_
+#define _ALSAAUDIODRIVER_H_
+
+#include <alsa/asoundlib.h>
+#include "AudioStreamDriver.h"
+
+
+// Plays through an ALSA PCM device.  The render thread is paced by the
+// blocking writes, one period (mNumSamplesInBuffer) at a time, so the
+// period size sets both the latency and the player's fillBuffer() size.
+class AlsaAudioDriver : public AudioStreamDriver
+{
+public:
+
+	AlsaAudioDriver(const char* deviceName = "default", int periodSize = 512, int periodCount = 4);
+	~AlsaAudioDriver();
+
+	inline int getPeriodSize()											{ return mNumSamplesInBuffer; }
+	inline int getPeriodCount()											{ return mPeriodCount; }
+
+protected:
+
+	bool openStream();
+	void closeStream();
+	bool writeStream(const short* buffer, int numSamples);
+
+private:
+
+	char*                       mDeviceName;
+	int                         mPeriodCount;
+	snd_pcm_t*                  mPcm;
+};
+
+
+#endif // _ALSAAUDIODRIVER_H_
@@ -36,6 +36,7 @@ AudioCoreDriver::AudioCoreDriver()
 // ----------------------------------------------------------------------------
 {
 	mIsInitialized = false;
+	mLookaheadRendering = false;
 	mInstanceId = sInstanceCount;
 	sInstanceCount++;
 }
@@ -180,8 +181,9 @@ void AudioCoreDriver::initialize(PlayerLibSidplay* player, int sampleRate, int b
 		memset(mSampleBuffer1, 0, sizeof(short) * mNumSamplesInBuffer);
 		mSampleBuffer2 = new short[mNumSamplesInBuffer];
 		memset(mSampleBuffer2, 0, sizeof(short) * mNumSamplesInBuffer);
-        mSpectrumBuffer = new float[mNumSamplesInBuffer/2];
-		memset(mSpectrumBuffer, 0, sizeof(float) * (mNumSamplesInBuffer/2));
+        mSpectrumBuffer = new float[sNumSamplesInFrame/2];
+		memset(mSpectrumBuffer, 0, sizeof(float) * (sNumSamplesInFrame/2));
+		mFrames.allocate(sNumSamplesInFrame);
 
         mSampleBuffer = mSampleBuffer1;
         mRetSampleBuffer = mSampleBuffer2;
@@ -216,6 +218,7 @@ void AudioCoreDriver::initialize(PlayerLibSidplay* player, int sampleRate, int b
             mRetSampleBuffer = NULL;
 			delete[] mSpectrumBuffer;
 			mSpectrumBuffer = NULL;
+			mFrames.release();
 			return;
 		}
 
@@ -229,6 +232,7 @@ void AudioCoreDriver::initialize(PlayerLibSidplay* player, int sampleRate, int b
             mRetSampleBuffer = NULL;
 			delete[] mSpectrumBuffer;
 			mSpectrumBuffer = NULL;
+			mFrames.release();
 			return;
 		}
 	}
@@ -291,18 +295,93 @@ void AudioCoreDriver::deinitialize()
     mRetSampleBuffer = NULL;
     delete[] mSpectrumBuffer;
 	mSpectrumBuffer = NULL;
+	mFrames.release();
 	mIsInitialized = false;
 }
 
 
 // ----------------------------------------------------------------------------
-void AudioCoreDriver::fillBuffer()
+void AudioCoreDriver::renderDeviceBuffer(float* buffer)
 // ----------------------------------------------------------------------------
 {
+	int numChannels = mStreamFormat.mChannelsPerFrame;
+	int numSamples = numChannels * mNumSamplesInBuffer;
+
 	if (!mIsPlaying)
+	{
+		memset(buffer, 0, sizeof(float) * numSamples);
 		return;
-	
-    mPlayer->fillBuffer(mSampleBuffer, mNumSamplesInBuffer * sizeof(short));
+	}
+
+	double renderStart = RenderLoadMonitor::now();
+
+	// straight into the device's float samples, with no 16 bit buffer between
+	mPlayer->fillBufferFloat(buffer, mNumSamplesInBuffer, numChannels);
+
+	// the display takes the first channel before the volume is applied
+	const float* samples = buffer;
+	int samplesLeft = mNumSamplesInBuffer;
+
+	while (samplesLeft > 0)
+	{
+		int taken = mFrames.append(samples, samplesLeft, numChannels);
+		samples += taken * numChannels;
+		samplesLeft -= taken;
+
+		if (mFrames.isBackFrameFull())
+			publishFrame(*mFrames.getBackFrame());
+	}
+
+	if (mVolume != 1.0f)
+	{
+		for (int i = 0; i < numSamples; i++)
+			buffer[i] *= mVolume;
+	}
+
+	mRenderLoad.record(renderStart, mNumSamplesInBuffer / mStreamFormat.mSampleRate);
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioCoreDriver::renderBlock(short* buffer, int numSamples)
+// ----------------------------------------------------------------------------
+{
+	double renderStart = RenderLoadMonitor::now();
+
+    mPlayer->fillBuffer(buffer, numSamples * sizeof(short));
+
+	// the display takes frames of its own size, whatever the buffer size
+	const short* samples = buffer;
+	int samplesLeft = numSamples;
+
+	while (samplesLeft > 0)
+	{
+		int taken = mFrames.append(samples, samplesLeft);
+		samples += taken;
+		samplesLeft -= taken;
+
+		if (mFrames.isBackFrameFull())
+			publishFrame(*mFrames.getBackFrame());
+	}
+
+	mRenderLoad.record(renderStart, numSamples / mStreamFormat.mSampleRate);
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioCoreDriver::lookaheadRenderProc(short* buffer, int numSamples, void* clientData)
+// ----------------------------------------------------------------------------
+{
+	AudioCoreDriver* driverInstance = reinterpret_cast<AudioCoreDriver*>(clientData);
+
+	driverInstance->renderBlock(buffer, numSamples);
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioCoreDriver::publishFrame(AudioFrame& frame)
+// ----------------------------------------------------------------------------
+{
 
 #if 1       //compute frequency spectrum
 	//discrete fourier transform
@@ -337,18 +416,18 @@ void AudioCoreDriver::fillBuffer()
 	}
 */
 	//specialized for forward transform, real input, and magnitude output
-	for(int k=0;k<mNumSamplesInBuffer/2;k++)
+	for(int k=0;k<frame.mNumSpectrumBins;k++)
 	{
 		float output_re = 0.0f;
 		float output_im = 0.0f;
 
-		for(int n=0;n<mNumSamplesInBuffer;n++)
+		for(int n=0;n<frame.mNumSamples;n++)
 		{
-			float t = -2.0f * 3.1415926535897932385f * k * n / mNumSamplesInBuffer;
+			float t = -2.0f * 3.1415926535897932385f * k * n / frame.mNumSamples;
 
 			float re = cosf(t);
 			float im = sinf(t);
-			float input_re = mSampleBuffer[n]/32768.0f;
+			float input_re = frame.mSamples[n]/32768.0f;
 
 			output_re += input_re * re;
 			output_im += input_re * im;
@@ -357,12 +436,14 @@ void AudioCoreDriver::fillBuffer()
 	}
 #endif
 
-    short* s = mSampleBuffer;
-    mSampleBuffer = mRetSampleBuffer;
-    mRetSampleBuffer = s;
+	// the smoothing goes on from the previous frame, kept here
+	memcpy(frame.mSpectrum, mSpectrumBuffer, sizeof(float) * frame.mNumSpectrumBins);
+
+	mFrames.publish();
 }
 
 
+
 // ----------------------------------------------------------------------------
 OSStatus AudioCoreDriver::emulationPlaybackProc(AudioDeviceID inDevice,
 												const AudioTimeStamp *inNow,
@@ -376,11 +457,25 @@ OSStatus AudioCoreDriver::emulationPlaybackProc(AudioDeviceID inDevice,
 	AudioCoreDriver* driverInstance = reinterpret_cast<AudioCoreDriver*>(inClientData);
 
 	register float* outBuffer	= (float*) outOutputData->mBuffers[0].mData;
-	register short* audioBuffer = (short*) driverInstance->getSampleBuffer();
+	register short* audioBuffer = driverInstance->mRetSampleBuffer;
 	register short* bufferEnd	= audioBuffer + driverInstance->getNumSamplesInBuffer();
 	register float scaleFactor  = driverInstance->getScaleFactor();
 
-	driverInstance->fillBuffer();
+	if (!driverInstance->mLookahead.getIsRunning())
+	{
+		driverInstance->renderDeviceBuffer(outBuffer);
+		return 0;
+	}
+
+	// rendered ahead, only copied here
+	int numUnderruns = driverInstance->mLookahead.getNumUnderruns();
+	driverInstance->mLookahead.read(audioBuffer, driverInstance->getNumSamplesInBuffer());
+	if (driverInstance->mLookahead.getNumUnderruns() != numUnderruns)
+	{
+		driverInstance->mBufferUnderrunCount++;
+		if (driverInstance->mBufferUnderrunCount >= sBufferUnderrunLimit)
+			driverInstance->setBufferUnderrunDetected(true);
+	}
 
     if (driverInstance->mStreamFormat.mChannelsPerFrame == 1)
     {
@@ -583,6 +678,9 @@ OSStatus AudioCoreDriver::overloadDetected(AudioObjectID                    inOb
     if (driverInstance->mBufferUnderrunCount >= sBufferUnderrunLimit)
         driverInstance->setBufferUnderrunDetected(true);
 
+    printf("overload: ");
+    driverInstance->mRenderLoad.print(stdout);
+
 	return kAudioHardwareNoError;
 }
 #else
@@ -602,6 +700,9 @@ OSStatus AudioCoreDriver::overloadDetected(AudioDeviceID inDevice,
         
         if (driverInstance->mBufferUnderrunCount > sBufferUnderrunLimit)
             driverInstance->setBufferUnderrunDetected(true);
+
+        printf("overload: ");
+        driverInstance->mRenderLoad.print(stdout);
 	}
 	
 	return kAudioHardwareNoError;
@@ -623,6 +724,10 @@ bool AudioCoreDriver::startPlayback()
 	mIsPlaying = true;
 	
 	memset(mSampleBuffer, 0, sizeof(short) * mNumSamplesInBuffer);
+
+	if (mLookaheadRendering && !mLookahead.start(lookaheadRenderProc, (void*) this, (int)mStreamFormat.mSampleRate, sLookaheadBlockSize, mNumSamplesInBuffer))
+		printf("AudioCoreDriver: lookahead rendering failed to start, rendering in the callback\n");
+
 	AudioDeviceStart(mDeviceID, mEmulationPlaybackProcID);
 
 	return true;
@@ -637,6 +742,7 @@ void AudioCoreDriver::stopPlayback()
 		return;
 
 	AudioDeviceStop(mDeviceID, mEmulationPlaybackProcID);
+	mLookahead.stop();
 
 	mIsPlaying = false;
 }
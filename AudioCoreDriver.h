@@ -38,6 +38,9 @@
 
 #include <CoreAudio/AudioHardware.h>
 #include "AudioDriver.h"
+#include "AudioFrameExchange.h"
+#include "LookaheadRenderer.h"
+#include "RenderLoadMonitor.h"
 
 #define USE_NEW_API         1
 
@@ -63,17 +66,32 @@ public:
 	
 	inline bool getIsInitialized()										{ return mIsInitialized; }
 	inline int getSampleRate()											{ return (int)mStreamFormat.mSampleRate; }
-	inline short* getSampleBuffer()										{ return mRetSampleBuffer; }
 	inline int getNumSamplesInBuffer()									{ return mNumSamplesInBuffer; }
-	inline float* getSpectrumBuffer()									{ return mSpectrumBuffer; }
-	inline int getNumSamplesInSpectrum()								{ return mNumSamplesInBuffer/2; }
+
+	// For display, from one thread: the newest frame of samples and their
+	// spectrum, which stays as it is until the next call.  The audio
+	// thread never waits for it (AudioFrameExchange).
+	inline const AudioFrame* acquireFrame()								{ return mFrames.acquire(); }
+	inline unsigned int getFrameGeneration()							{ return mFrames.getGeneration(); }
+	// the samples of the frame acquired last, does not acquire
+	inline short* getSampleBuffer()										{ const AudioFrame* frame = mFrames.getFrontFrame(); return frame ? frame->mSamples : NULL; }
 
 	inline void setBufferUnderrunDetected(bool flag)					{ mBufferUnderrunDetected = flag; if (!flag) mBufferUnderrunCount = 0; }
 	inline bool getBufferUnderrunDetected()								{ return mBufferUnderrunDetected; };
 	inline int getBufferUnderrunCount()                                 { return mBufferUnderrunCount; };
 
+	// time taken by every buffer rendered against the time it plays
+	inline RenderLoadMonitor& getRenderLoad()							{ return mRenderLoad; }
+
     inline void setSpectrumTemporalSmoothing(float s)                   { assert(s >= 0.0f && s < 1.0f); mSpectrumTemporalSmoothing = s; };
 
+	// Render on a thread of its own ahead of the device, in blocks of
+	// sLookaheadBlockSize, with the callback only copying and converting
+	// (LookaheadRenderer).  Takes effect when playback starts.
+	inline void setLookaheadRendering(bool enabled)						{ mLookaheadRendering = enabled; }
+	inline bool getLookaheadRendering()									{ return mLookaheadRendering; }
+	inline LookaheadRenderer& getLookaheadRenderer()					{ return mLookahead; }
+
 	inline bool getIsPlaying()											{ return mIsPlaying; }
 	inline float getVolume()											{ return mVolume; }
 	void setVolume(float volume);
@@ -90,7 +108,11 @@ private:
 	inline float getScaleFactor()										{ return mScaleFactor; }
 	inline float getPreRenderedBufferScaleFactor()						{ return mPreRenderedBufferScaleFactor; }
 
-	void fillBuffer();
+	void renderDeviceBuffer(float* buffer);
+	void renderBlock(short* buffer, int numSamples);
+	void publishFrame(AudioFrame& frame);
+
+	static void lookaheadRenderProc(short* buffer, int numSamples, void* clientData);
 
 	static OSStatus emulationPlaybackProc(AudioDeviceID inDevice,
 										  const AudioTimeStamp *inNow,
@@ -149,10 +171,13 @@ private:
 	short*                      mRetSampleBuffer;
 	short*                      mSampleBuffer1;
 	short*                      mSampleBuffer2;
-	float*                      mSpectrumBuffer;
+	float*                      mSpectrumBuffer;            // smoothed over the frames
+	AudioFrameExchange          mFrames;
     float                       mSpectrumTemporalSmoothing;
 
 	bool                        mFastForward;
+	bool                        mLookaheadRendering;
+	LookaheadRenderer           mLookahead;
 
 	bool                        mIsPlaying;
 	float                       mScaleFactor;
@@ -167,9 +192,12 @@ private:
 	
 	bool						mBufferUnderrunDetected;
     int                         mBufferUnderrunCount;
+	RenderLoadMonitor           mRenderLoad;
 	int                         mInstanceId;
     
     static const int            sBufferUnderrunLimit = 1;
+	static const int            sNumSamplesInFrame = 512;
+	static const int            sLookaheadBlockSize = 256;
 };
 
 
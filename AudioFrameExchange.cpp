@@ -0,0 +1,162 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <string.h>
+#include "AudioFrameExchange.h"
+
+
+// ----------------------------------------------------------------------------
+AudioFrameExchange::AudioFrameExchange()
+// ----------------------------------------------------------------------------
+{
+	mFrames = NULL;
+	mNumSamples = 0;
+	release();
+}
+
+
+// ----------------------------------------------------------------------------
+AudioFrameExchange::~AudioFrameExchange()
+// ----------------------------------------------------------------------------
+{
+	release();
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioFrameExchange::allocate(int numSamples)
+// ----------------------------------------------------------------------------
+{
+	release();
+
+	mFrames = new AudioFrame[3];
+	mNumSamples = numSamples;
+
+	for (int i = 0; i < 3; i++)
+	{
+		AudioFrame& frame = mFrames[i];
+		frame.mNumSamples = numSamples;
+		frame.mNumSpectrumBins = numSamples / 2;
+		frame.mSamples = new short[frame.mNumSamples];
+		frame.mSpectrum = new float[frame.mNumSpectrumBins];
+		frame.mGeneration = 0;
+		memset(frame.mSamples, 0, sizeof(short) * frame.mNumSamples);
+		memset(frame.mSpectrum, 0, sizeof(float) * frame.mNumSpectrumBins);
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioFrameExchange::release()
+// ----------------------------------------------------------------------------
+{
+	if (mFrames)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			delete[] mFrames[i].mSamples;
+			delete[] mFrames[i].mSpectrum;
+		}
+		delete[] mFrames;
+	}
+
+	mFrames = NULL;
+	mNumSamples = 0;
+	mFront = 0;
+	mMiddle = 1;
+	mBack = 2;
+	mWritePosition = 0;
+	mGeneration = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+int AudioFrameExchange::append(const short* samples, int numSamples)
+// ----------------------------------------------------------------------------
+{
+	if (mFrames == NULL)
+		return numSamples;
+
+	int room = mNumSamples - mWritePosition;
+	if (numSamples > room)
+		numSamples = room;
+
+	memcpy(mFrames[mBack].mSamples + mWritePosition, samples, sizeof(short) * numSamples);
+	mWritePosition += numSamples;
+
+	return numSamples;
+}
+
+
+// ----------------------------------------------------------------------------
+int AudioFrameExchange::append(const float* samples, int numSamples, int stride)
+// ----------------------------------------------------------------------------
+{
+	if (mFrames == NULL)
+		return numSamples;
+
+	int room = mNumSamples - mWritePosition;
+	if (numSamples > room)
+		numSamples = room;
+
+	short* out = mFrames[mBack].mSamples + mWritePosition;
+	for (int i = 0; i < numSamples; i++, samples += stride)
+	{
+		float sample = *samples * 32768.0f;
+		out[i] = sample >= 32767.0f ? 32767 : sample <= -32768.0f ? -32768 : (short) sample;
+	}
+	mWritePosition += numSamples;
+
+	return numSamples;
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioFrameExchange::publish()
+// ----------------------------------------------------------------------------
+{
+	if (mFrames == NULL)
+		return;
+
+	unsigned int generation = mGeneration + 1;
+	mFrames[mBack].mGeneration = generation;
+
+	// the release makes the frame's contents visible before its index
+	int previous = __atomic_exchange_n(&mMiddle, mBack | FRESH, __ATOMIC_ACQ_REL);
+	mBack = previous & INDEX_MASK;
+	mWritePosition = 0;
+
+	__atomic_store_n(&mGeneration, generation, __ATOMIC_RELEASE);
+}
+
+
+// ----------------------------------------------------------------------------
+const AudioFrame* AudioFrameExchange::acquire()
+// ----------------------------------------------------------------------------
+{
+	if (mFrames == NULL)
+		return NULL;
+
+	if (__atomic_load_n(&mMiddle, __ATOMIC_ACQUIRE) & FRESH)
+	{
+		int previous = __atomic_exchange_n(&mMiddle, mFront, __ATOMIC_ACQ_REL);
+		mFront = previous & INDEX_MASK;
+	}
+
+	return &mFrames[mFront];
+}
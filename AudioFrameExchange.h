@@ -0,0 +1,87 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef _AUDIOFRAMEEXCHANGE_H_
+#define _AUDIOFRAMEEXCHANGE_H_
+
+
+// A block of the output for display: samples and their spectrum, always
+// from the same samples.  The generation counts the frames published.
+struct AudioFrame
+{
+	short*				mSamples;
+	float*				mSpectrum;
+	int					mNumSamples;
+	int					mNumSpectrumBins;	// mNumSamples / 2
+	unsigned int		mGeneration;		// 0 until the first one is published
+};
+
+
+// Passes frames from the audio thread to one reader without locking, as a
+// triple buffer: the writer fills the back frame and swaps it with the
+// middle one, the reader swaps the middle one with its front frame when a
+// newer one was published since.  Neither ever waits for the other, and
+// the front frame stays as it is until the reader acquires again, so the
+// reader never sees a frame being written.  The writer appends samples in
+// blocks of any size, a frame is complete once it holds its own count.
+class AudioFrameExchange
+{
+public:
+
+	AudioFrameExchange();
+	~AudioFrameExchange();
+
+	// not while the writer or the reader use the frames
+	void allocate(int numSamples);
+	void release();
+
+	// writer (audio thread): appends samples to the back frame and returns
+	// how many it took, up to the room left in it
+	int append(const short* samples, int numSamples);
+	// as above from float samples, 1.0 full scale, stride floats apart
+	int append(const float* samples, int numSamples, int stride);
+	inline bool isBackFrameFull() const									{ return mNumSamples > 0 && mWritePosition == mNumSamples; }
+	inline AudioFrame* getBackFrame()									{ return mFrames ? &mFrames[mBack] : NULL; }
+	void publish();
+
+	// reader: the newest frame published, NULL before allocate()
+	const AudioFrame* acquire();
+	// reader: the frame acquired last, without acquiring a newer one
+	inline const AudioFrame* getFrontFrame() const						{ return mFrames ? &mFrames[mFront] : NULL; }
+	inline unsigned int getGeneration() const							{ return __atomic_load_n(&mGeneration, __ATOMIC_ACQUIRE); }
+
+private:
+
+	static const int	INDEX_MASK = 3;
+	static const int	FRESH = 4;			// the middle frame is newer than the front one
+
+	AudioFrame*			mFrames;			// 3 of them
+	int					mNumSamples;
+	int					mMiddle;			// index, or'ed with FRESH, swapped by both
+	unsigned int		mGeneration;
+
+	// writer state
+	int					mBack;
+	int					mWritePosition;
+
+	// reader state
+	int					mFront;
+};
+
+
+#endif // _AUDIOFRAMEEXCHANGE_H_
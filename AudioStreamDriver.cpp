@@ -0,0 +1,430 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "PlayerLibSidplay.h"
+#include "AudioStreamDriver.h"
+
+
+#define MIN(A,B)	((A) < (B) ? (A) : (B))
+
+
+// ----------------------------------------------------------------------------
+AudioStreamDriver::AudioStreamDriver()
+// ----------------------------------------------------------------------------
+{
+	mIsInitialized = false;
+	mPlayer = NULL;
+	mSampleRate = 44100;
+	mNumSamplesInBuffer = 512;
+	mNumSamplesWritten = 0;
+	mIsPlaying = false;
+	mIsPlayingPreRenderedBuffer = false;
+	mBusy = false;
+	mQuit = false;
+	mSampleBuffer1 = NULL;
+	mSampleBuffer2 = NULL;
+	mOutputBuffer = NULL;
+	mVolume = 1.0f;
+	mPreRenderedBufferVolume = 1.0f;
+	mNumUnloggedUnderruns = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+AudioStreamDriver::~AudioStreamDriver()
+// ----------------------------------------------------------------------------
+{
+	// the stream is closed by deinitialize() in the derived destructor,
+	// the sink is gone by the time we get here
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioStreamDriver::initialize(PlayerLibSidplay* player, int sampleRate, int bitsPerSample)
+// ----------------------------------------------------------------------------
+{
+	if (mIsInitialized)
+		return;
+
+	mPlayer = player;
+	mSampleRate = sampleRate;
+	mNumSamplesWritten = 0;
+	mIsPlaying = false;
+	mIsPlayingPreRenderedBuffer = false;
+	mBufferUnderrunDetected = false;
+    mBufferUnderrunCount = 0;
+	mNumUnloggedUnderruns = 0;
+
+	mPreRenderedBuffer = NULL;
+	mPreRenderedBufferSampleCount = 0;
+	mPreRenderedBufferPlaybackPosition = 0;
+
+	if (bitsPerSample != 16)
+	{
+		printf("AudioStreamDriver: only 16 bit output is supported\n");
+		return;
+	}
+
+	if (!openStream())
+		return;
+
+	mSampleBuffer1 = new short[mNumSamplesInBuffer];
+	mSampleBuffer2 = new short[mNumSamplesInBuffer];
+	mOutputBuffer = new short[mNumSamplesInBuffer];
+	memset(mSampleBuffer1, 0, sizeof(short) * mNumSamplesInBuffer);
+	memset(mSampleBuffer2, 0, sizeof(short) * mNumSamplesInBuffer);
+	mSampleBuffer = mSampleBuffer1;
+	mRetSampleBuffer = mSampleBuffer2;
+
+	mBusy = false;
+	mQuit = false;
+	pthread_mutex_init(&mMutex, NULL);
+	pthread_cond_init(&mCondition, NULL);
+
+	if (pthread_create(&mThread, NULL, renderThread, (void*)this) != 0)
+	{
+		printf("AudioStreamDriver: pthread_create failed\n");
+		pthread_cond_destroy(&mCondition);
+		pthread_mutex_destroy(&mMutex);
+		closeStream();
+		delete[] mSampleBuffer1;
+		delete[] mSampleBuffer2;
+		delete[] mOutputBuffer;
+		mSampleBuffer1 = mSampleBuffer2 = mOutputBuffer = NULL;
+		return;
+	}
+
+	mIsInitialized = true;
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioStreamDriver::deinitialize()
+// ----------------------------------------------------------------------------
+{
+	if (!mIsInitialized)
+		return;
+
+	pthread_mutex_lock(&mMutex);
+	mQuit = true;
+	pthread_cond_broadcast(&mCondition);
+	pthread_mutex_unlock(&mMutex);
+	pthread_join(mThread, NULL);
+
+	pthread_cond_destroy(&mCondition);
+	pthread_mutex_destroy(&mMutex);
+
+	closeStream();
+
+	delete[] mSampleBuffer1;
+	delete[] mSampleBuffer2;
+	delete[] mOutputBuffer;
+	mSampleBuffer1 = mSampleBuffer2 = mOutputBuffer = NULL;
+
+	mIsPlaying = false;
+	mIsPlayingPreRenderedBuffer = false;
+	mIsInitialized = false;
+}
+
+
+// ----------------------------------------------------------------------------
+void* AudioStreamDriver::renderThread(void* inClientData)
+// ----------------------------------------------------------------------------
+{
+	AudioStreamDriver* driverInstance = reinterpret_cast<AudioStreamDriver*>(inClientData);
+
+	pthread_mutex_lock(&driverInstance->mMutex);
+
+	while (!driverInstance->mQuit)
+	{
+		if (!driverInstance->mIsPlaying && !driverInstance->mIsPlayingPreRenderedBuffer)
+		{
+			pthread_cond_wait(&driverInstance->mCondition, &driverInstance->mMutex);
+			continue;
+		}
+
+		// render and write without holding the lock, stopPlayback()
+		// waits for the buffer in flight to be done with the player
+		bool emulation = driverInstance->mIsPlaying;
+		driverInstance->mBusy = true;
+		pthread_mutex_unlock(&driverInstance->mMutex);
+
+		double renderStart = RenderLoadMonitor::now();
+		int numSamples = driverInstance->renderBuffer(emulation, driverInstance->mNumSamplesInBuffer);
+		if (emulation)
+			driverInstance->mRenderLoad.record(renderStart, (double) numSamples / driverInstance->mSampleRate);
+
+		bool success = numSamples == 0 || driverInstance->writeStream(driverInstance->mOutputBuffer, numSamples);
+
+		pthread_mutex_lock(&driverInstance->mMutex);
+		driverInstance->mBusy = false;
+
+		if (success)
+			driverInstance->mNumSamplesWritten += numSamples;
+
+		if (!success || (!emulation && numSamples == 0))
+		{
+			if (emulation)
+				driverInstance->mIsPlaying = false;
+			else
+				driverInstance->mIsPlayingPreRenderedBuffer = false;
+		}
+
+		pthread_cond_broadcast(&driverInstance->mCondition);
+	}
+
+	pthread_mutex_unlock(&driverInstance->mMutex);
+
+	return NULL;
+}
+
+
+// ----------------------------------------------------------------------------
+int AudioStreamDriver::renderBuffer(bool emulation, int numSamples)
+// ----------------------------------------------------------------------------
+{
+	short* audioBuffer;
+	float volume;
+
+	if (emulation)
+	{
+		mPlayer->fillBuffer(mSampleBuffer, numSamples * sizeof(short));
+
+		audioBuffer = mSampleBuffer;
+		mSampleBuffer = mRetSampleBuffer;
+		mRetSampleBuffer = audioBuffer;
+
+		volume = mVolume;
+	}
+	else
+	{
+		int samplesLeft = mPreRenderedBufferSampleCount - mPreRenderedBufferPlaybackPosition;
+		if (samplesLeft <= 0)
+			return 0;
+
+		numSamples = MIN(samplesLeft, numSamples);
+		audioBuffer = &mPreRenderedBuffer[mPreRenderedBufferPlaybackPosition];
+		mPreRenderedBufferPlaybackPosition += numSamples;
+		volume = mPreRenderedBufferVolume;
+	}
+
+	if (volume == 1.0f)
+	{
+		memcpy(mOutputBuffer, audioBuffer, numSamples * sizeof(short));
+		return numSamples;
+	}
+
+	short* outBuffer = mOutputBuffer;
+	short* bufferEnd = audioBuffer + numSamples;
+
+	while (audioBuffer < bufferEnd)
+	{
+		int sample = (int) (*audioBuffer++ * volume);
+
+		if (sample > 32767)
+			sample = 32767;
+		else if (sample < -32768)
+			sample = -32768;
+
+		*outBuffer++ = (short) sample;
+	}
+
+	return numSamples;
+}
+
+
+// ----------------------------------------------------------------------------
+long long AudioStreamDriver::render(long long numSamples)
+// ----------------------------------------------------------------------------
+{
+	if (!mIsInitialized)
+		return 0;
+
+	stopPlayback();
+	stopPreRenderedBufferPlayback();
+
+	long long samplesLeft = numSamples;
+
+	while (samplesLeft > 0)
+	{
+		int samplesThisBuffer = (int) MIN(samplesLeft, (long long) mNumSamplesInBuffer);
+
+		renderBuffer(true, samplesThisBuffer);
+		if (!writeStream(mOutputBuffer, samplesThisBuffer))
+			break;
+
+		mNumSamplesWritten += samplesThisBuffer;
+		samplesLeft -= samplesThisBuffer;
+	}
+
+	return numSamples - samplesLeft;
+}
+
+
+// ----------------------------------------------------------------------------
+long long AudioStreamDriver::write(const short* buffer, long long numSamples)
+// ----------------------------------------------------------------------------
+{
+	if (!mIsInitialized)
+		return 0;
+
+	stopPlayback();
+	stopPreRenderedBufferPlayback();
+
+	long long samplesLeft = numSamples;
+
+	while (samplesLeft > 0)
+	{
+		int samplesThisBuffer = (int) MIN(samplesLeft, (long long) mNumSamplesInBuffer);
+
+		if (!writeStream(buffer, samplesThisBuffer))
+			break;
+
+		buffer += samplesThisBuffer;
+		mNumSamplesWritten += samplesThisBuffer;
+		samplesLeft -= samplesThisBuffer;
+	}
+
+	return numSamples - samplesLeft;
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioStreamDriver::bufferUnderrun()
+// ----------------------------------------------------------------------------
+{
+	mBufferUnderrunCount++;
+
+	if (mBufferUnderrunCount >= sBufferUnderrunLimit)
+		setBufferUnderrunDetected(true);
+
+	// no stdio here, the next buffer is already late
+	__atomic_add_fetch(&mNumUnloggedUnderruns, 1, __ATOMIC_RELAXED);
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioStreamDriver::logUnderruns()
+// ----------------------------------------------------------------------------
+{
+	int numUnderruns = __atomic_exchange_n(&mNumUnloggedUnderruns, 0, __ATOMIC_RELAXED);
+	if (numUnderruns == 0)
+		return;
+
+	printf("%d underrun%s: ", numUnderruns, numUnderruns == 1 ? "" : "s");
+	mRenderLoad.print(stdout);
+}
+
+
+// ----------------------------------------------------------------------------
+bool AudioStreamDriver::startPlayback()
+// ----------------------------------------------------------------------------
+{
+	if (!mIsInitialized)
+		return false;
+
+	stopPreRenderedBufferPlayback();
+
+	pthread_mutex_lock(&mMutex);
+	if (!mIsPlaying)
+		memset(mSampleBuffer, 0, sizeof(short) * mNumSamplesInBuffer);
+	mIsPlaying = true;
+	pthread_cond_broadcast(&mCondition);
+	pthread_mutex_unlock(&mMutex);
+
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioStreamDriver::stopPlayback()
+// ----------------------------------------------------------------------------
+{
+	if (!mIsInitialized)
+		return;
+
+	pthread_mutex_lock(&mMutex);
+	mIsPlaying = false;
+	while (mBusy)
+		pthread_cond_wait(&mCondition, &mMutex);
+	pthread_mutex_unlock(&mMutex);
+
+	logUnderruns();
+}
+
+
+// ----------------------------------------------------------------------------
+bool AudioStreamDriver::startPreRenderedBufferPlayback()
+// ----------------------------------------------------------------------------
+{
+	if (!mIsInitialized)
+		return false;
+
+	stopPlayback();
+
+	pthread_mutex_lock(&mMutex);
+	mIsPlayingPreRenderedBuffer = true;
+	pthread_cond_broadcast(&mCondition);
+	pthread_mutex_unlock(&mMutex);
+
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioStreamDriver::stopPreRenderedBufferPlayback()
+// ----------------------------------------------------------------------------
+{
+	if (!mIsInitialized)
+		return;
+
+	pthread_mutex_lock(&mMutex);
+	mIsPlayingPreRenderedBuffer = false;
+	while (mBusy)
+		pthread_cond_wait(&mCondition, &mMutex);
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioStreamDriver::setPreRenderedBuffer(short* inBuffer, int inBufferLength)
+// ----------------------------------------------------------------------------
+{
+	stopPreRenderedBufferPlayback();
+
+	mPreRenderedBuffer = inBuffer;
+	mPreRenderedBufferSampleCount = inBufferLength;
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioStreamDriver::setVolume(float volume)
+// ----------------------------------------------------------------------------
+{
+	mVolume = volume;
+}
+
+
+// ----------------------------------------------------------------------------
+void AudioStreamDriver::setPreRenderedBufferVolume(float volume)
+// ----------------------------------------------------------------------------
+{
+	mPreRenderedBufferVolume = volume;
+}
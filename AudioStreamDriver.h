@@ -0,0 +1,140 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _AUDIOSTREAMDRIVER_H_
+#define _AUDIOSTREAMDRIVER_H_
+
+#include <pthread.h>
+#include "AudioDriver.h"
+#include "RenderLoadMonitor.h"
+
+class PlayerLibSidplay;
+
+
+// Common part of the drivers which are not called back by an audio
+// device: a render thread pulls blocks of 16 bit mono samples from the
+// player (or the pre-rendered buffer) and pushes them to writeStream(),
+// which may block to pace the thread (ALSA) or return at once (null, file).
+class AudioStreamDriver : public AudioDriver
+{
+public:
+
+	AudioStreamDriver();
+	virtual ~AudioStreamDriver();
+
+	void initialize(PlayerLibSidplay* player, int sampleRate = 44100, int bitsPerSample = 16);
+	void deinitialize();
+
+	bool startPlayback();
+	void stopPlayback();
+	bool startPreRenderedBufferPlayback();
+	void stopPreRenderedBufferPlayback();
+
+	void setPreRenderedBuffer(short* inBuffer, int inBufferLength);
+
+	// Render from the player in the calling thread instead of the render
+	// thread (stopping any playback), for offline rendering of an exact
+	// length.  Returns the number of samples written.
+	long long render(long long numSamples);
+
+	// Write samples rendered elsewhere to the output as they are, in the
+	// calling thread.  Returns the number of samples written.
+	long long write(const short* buffer, long long numSamples);
+
+	inline bool getIsInitialized()										{ return mIsInitialized; }
+	inline int getSampleRate()											{ return mSampleRate; }
+	inline short* getSampleBuffer()										{ return mRetSampleBuffer; }
+	inline int getNumSamplesInBuffer()									{ return mNumSamplesInBuffer; }
+	inline long long getNumSamplesWritten()								{ return mNumSamplesWritten; }
+
+	inline void setBufferUnderrunDetected(bool flag)					{ mBufferUnderrunDetected = flag; if (!flag) mBufferUnderrunCount = 0; }
+	inline bool getBufferUnderrunDetected()								{ return mBufferUnderrunDetected; };
+	inline int getBufferUnderrunCount()                                 { return mBufferUnderrunCount; };
+
+	// time taken by every buffer the render thread renders from the
+	// player against the time it plays
+	inline RenderLoadMonitor& getRenderLoad()							{ return mRenderLoad; }
+
+	// prints the underruns since the last call with the render load, off
+	// the render thread (stopPlayback() does)
+	void logUnderruns();
+
+	inline bool getIsPlaying()											{ return mIsPlaying; }
+	inline float getVolume()											{ return mVolume; }
+	void setVolume(float volume);
+
+	inline bool getIsPlayingPreRenderedBuffer()							{ return mIsPlayingPreRenderedBuffer; }
+	inline float getPreRenderedBufferVolume()							{ return mPreRenderedBufferVolume; }
+	void setPreRenderedBufferVolume(float volume);
+
+	inline int getPreRenderedBufferPlaybackPosition()					{ return mPreRenderedBufferPlaybackPosition; }
+	inline void setPreRenderedBufferPlaybackPosition(int inPosition)	{ mPreRenderedBufferPlaybackPosition = inPosition; }
+
+protected:
+
+	// Sink interface, openStream() may change mSampleRate and
+	// mNumSamplesInBuffer to what the output actually accepted.
+	virtual bool openStream() = 0;
+	virtual void closeStream() = 0;
+	virtual bool writeStream(const short* buffer, int numSamples) = 0;
+
+	void bufferUnderrun();
+
+	int                         mSampleRate;
+	int                         mNumSamplesInBuffer;
+	long long                   mNumSamplesWritten;
+
+private:
+
+	static void* renderThread(void* inClientData);
+
+	int renderBuffer(bool emulation, int numSamples);
+
+	bool                        mIsInitialized;
+	PlayerLibSidplay*           mPlayer;
+
+	pthread_t                   mThread;
+	pthread_mutex_t             mMutex;
+	pthread_cond_t              mCondition;
+	bool                        mBusy;
+	bool                        mQuit;
+
+	short*                      mSampleBuffer;
+	short*                      mRetSampleBuffer;
+	short*                      mSampleBuffer1;
+	short*                      mSampleBuffer2;
+	short*                      mOutputBuffer;
+
+	bool                        mIsPlaying;
+	float                       mVolume;
+
+	bool						mIsPlayingPreRenderedBuffer;
+	short*						mPreRenderedBuffer;
+	int							mPreRenderedBufferSampleCount;
+	int							mPreRenderedBufferPlaybackPosition;
+	float						mPreRenderedBufferVolume;
+
+	bool						mBufferUnderrunDetected;
+    int                         mBufferUnderrunCount;
+	int                         mNumUnloggedUnderruns;	// counted by the render thread
+	RenderLoadMonitor           mRenderLoad;
+
+    static const int            sBufferUnderrunLimit = 1;
+};
+
+
+#endif // _AUDIOSTREAMDRIVER_H_
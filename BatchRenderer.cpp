@@ -0,0 +1,782 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <fstream>
+#include "NullAudioDriver.h"
+#include "WavFileAudioDriver.h"
+#include "SidTraceFile.h"
+#include "BatchRenderer.h"
+
+
+// shorter slices would spend more time settling than rendering
+const double BatchRenderer::MIN_SLICE_SECONDS = 5.0;
+
+
+// ----------------------------------------------------------------------------
+BatchRenderer::BatchRenderer(const RenderOptions& options, int numWorkers)
+// ----------------------------------------------------------------------------
+{
+	mOptions = options;
+	mNumWorkers = numWorkers > 0 ? numWorkers : 1;
+	// more slices than workers would only add seeks
+	if (mOptions.slices <= 0 || mOptions.slices > mNumWorkers)
+		mOptions.slices = mNumWorkers;
+	mNextWorker = 0;
+	mNumQueued = 0;
+	mNumPending = 0;
+
+	pthread_mutex_init(&mMutex, NULL);
+	pthread_cond_init(&mCondition, NULL);
+
+	mWorkers = new Worker[mNumWorkers];
+	for (int i = 0; i < mNumWorkers; i++)
+	{
+		mWorkers[i].owner = this;
+		mWorkers[i].index = i;
+		mWorkers[i].player = NULL;
+		pthread_mutex_init(&mWorkers[i].mutex, NULL);
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+BatchRenderer::~BatchRenderer()
+// ----------------------------------------------------------------------------
+{
+	for (int i = 0; i < mNumWorkers; i++)
+		pthread_mutex_destroy(&mWorkers[i].mutex);
+
+	delete[] mWorkers;
+
+	pthread_cond_destroy(&mCondition);
+	pthread_mutex_destroy(&mMutex);
+}
+
+
+// ----------------------------------------------------------------------------
+double BatchRenderer::now()
+// ----------------------------------------------------------------------------
+{
+	timeval t;
+	gettimeofday(&t, NULL);
+	return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::add(const char* input, int subtune, bool batch)
+// ----------------------------------------------------------------------------
+{
+	Job job;
+	job.input = input;
+	job.subtune = subtune;
+	job.batch = batch;
+	job.slices = NULL;
+	job.slice = 0;
+	job.lengths = NULL;
+
+	// deal the initial jobs out round robin
+	push(mWorkers[mNextWorker], job);
+	mNextWorker = (mNextWorker + 1) % mNumWorkers;
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::run()
+// ----------------------------------------------------------------------------
+{
+	double start = now();
+
+	for (int i = 0; i < mNumWorkers; i++)
+		pthread_create(&mWorkers[i].thread, NULL, workerThread, (void*)&mWorkers[i]);
+
+	for (int i = 0; i < mNumWorkers; i++)
+		pthread_join(mWorkers[i].thread, NULL);
+
+	mTotals.wallSeconds += now() - start;
+
+	if (mOptions.lengths)
+		writeLengths();
+}
+
+
+// ----------------------------------------------------------------------------
+void* BatchRenderer::workerThread(void* inClientData)
+// ----------------------------------------------------------------------------
+{
+	Worker& worker = *reinterpret_cast<Worker*>(inClientData);
+	BatchRenderer* renderer = worker.owner;
+	Job job;
+
+	worker.player = new PlayerLibSidplay;
+
+	while (renderer->take(worker, job))
+	{
+		if (job.slices)
+			renderer->renderSlice(worker, job);
+		else if (isTrace(job.input))
+			renderer->replayJob(job);
+		else if (job.lengths)
+			renderer->analyzeJob(worker, job);
+		else if (renderer->mOptions.lengths)
+			renderer->lengthJob(worker, job);
+		else if (renderer->mOptions.patches)
+			renderer->renderJob(worker, job);
+		else if (job.subtune == SUBTUNE_ALL)
+			renderer->expandJob(worker, job);
+		else if (renderer->mOptions.traces)
+			renderer->traceJob(worker, job);
+		else if (renderer->mOptions.slices > 1)
+			renderer->sliceJob(worker, job);
+		else
+			renderer->renderJob(worker, job);
+
+		pthread_mutex_lock(&renderer->mMutex);
+		if (--renderer->mNumPending == 0)
+			pthread_cond_broadcast(&renderer->mCondition);
+		pthread_mutex_unlock(&renderer->mMutex);
+	}
+
+	delete worker.player;
+	worker.player = NULL;
+
+	return NULL;
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::push(Worker& worker, const Job& job)
+// ----------------------------------------------------------------------------
+{
+	pthread_mutex_lock(&worker.mutex);
+	worker.jobs.push_back(job);
+	pthread_mutex_unlock(&worker.mutex);
+
+	pthread_mutex_lock(&mMutex);
+	mNumQueued++;
+	mNumPending++;
+	pthread_cond_broadcast(&mCondition);
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+// ----------------------------------------------------------------------------
+bool BatchRenderer::take(Worker& worker, Job& job)
+// ----------------------------------------------------------------------------
+{
+	for (;;)
+	{
+		bool found = false;
+
+		// own queue, newest first
+		pthread_mutex_lock(&worker.mutex);
+		if (!worker.jobs.empty())
+		{
+			job = worker.jobs.back();
+			worker.jobs.pop_back();
+			found = true;
+		}
+		pthread_mutex_unlock(&worker.mutex);
+
+		// steal the oldest job of another worker
+		for (int i = 1; i < mNumWorkers && !found; i++)
+		{
+			Worker& victim = mWorkers[(worker.index + i) % mNumWorkers];
+
+			pthread_mutex_lock(&victim.mutex);
+			if (!victim.jobs.empty())
+			{
+				job = victim.jobs.front();
+				victim.jobs.pop_front();
+				found = true;
+			}
+			pthread_mutex_unlock(&victim.mutex);
+		}
+
+		pthread_mutex_lock(&mMutex);
+
+		if (found)
+		{
+			mNumQueued--;
+			pthread_mutex_unlock(&mMutex);
+			return true;
+		}
+
+		// nothing queued, but a running job may still queue subtunes
+		while (mNumQueued == 0 && mNumPending > 0)
+			pthread_cond_wait(&mCondition, &mMutex);
+
+		bool done = mNumPending == 0;
+		pthread_mutex_unlock(&mMutex);
+
+		if (done)
+			return false;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::expandJob(Worker& worker, const Job& job)
+// ----------------------------------------------------------------------------
+{
+	PlaybackSettings settings = mOptions.settings;
+
+	worker.player->setAudioDriver(NULL);
+
+	if (!worker.player->loadTuneByPath(job.input.c_str(), SUBTUNE_DEFAULT, &settings))
+	{
+		finish(job, 0, 0.0, 0.0, 0.0, false);
+		return;
+	}
+
+	Job subtuneJob = job;
+	for (int subtune = worker.player->getSubtuneCount(); subtune >= 1; subtune--)
+	{
+		// queued backwards so this worker carries on with the first one
+		subtuneJob.subtune = subtune;
+		push(worker, subtuneJob);
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::outputPath(char* path, int size, const Job& job)
+// ----------------------------------------------------------------------------
+{
+	if (!job.batch)
+	{
+		snprintf(path, size, "%s", mOptions.output);
+		return;
+	}
+
+	const char* input = job.input.c_str();
+	const char* base = strrchr(input, '/');
+	base = base ? base + 1 : input;
+
+	int length = (int)strlen(base);
+	const char* ext = strrchr(base, '.');
+	if (ext)
+		length = (int)(ext - base);
+
+	const char* suffix = mOptions.traces && !isTrace(job.input) ? "sidtrace" : (mOptions.rawOutput ? "raw" : "wav");
+	if (job.subtune > 0)
+		snprintf(path, size, "%s/%.*s-%d.%s", mOptions.output, length, base, job.subtune, suffix);
+	else
+		snprintf(path, size, "%s/%.*s.%s", mOptions.output, length, base, suffix);
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::renderJob(Worker& worker, const Job& job)
+// ----------------------------------------------------------------------------
+{
+	PlayerLibSidplay* player = worker.player;
+	AudioStreamDriver* driver;
+	char path[1024];
+
+	if (mOptions.output)
+	{
+		outputPath(path, sizeof(path), job);
+		driver = new WavFileAudioDriver(path, mOptions.rawOutput);
+	}
+	else
+	{
+		driver = new NullAudioDriver;
+	}
+
+	driver->initialize(player, mOptions.settings.mFrequency, mOptions.settings.mBits);
+	player->setAudioDriver(driver);
+
+	PlaybackSettings settings = mOptions.settings;
+	bool success = driver->getIsInitialized();
+
+	if (success && mOptions.patches)
+	{
+		std::ifstream fi(job.input.c_str(), std::ios::in);
+		success = fi.is_open();
+		if (success)
+		{
+			player->getInstrument(0)->load(fi);
+			player->setCurrentInstrument(0);
+			player->initSynthEngine(&settings);
+		}
+	}
+	else if (success)
+	{
+		success = player->loadTuneByPath(job.input.c_str(), job.subtune, &settings);
+	}
+
+	long long numSamples = (long long)(mOptions.duration * driver->getSampleRate());
+	long long numRendered = 0;
+	double start = now();
+
+	if (success && mOptions.patches)
+	{
+		long long gateSamples = (long long)((mOptions.gate < 0.0 ? mOptions.duration / 2 : mOptions.gate) * driver->getSampleRate());
+		if (gateSamples > numSamples)
+			gateSamples = numSamples;
+
+		for (int v = 0; v < mOptions.numNotes; v++)
+		{
+			player->m_keyPressed[v] = v + 1;
+			player->m_keyFreq[v] = mOptions.notes[v];
+			player->m_keyVelocity[v] = 127;
+		}
+		numRendered = driver->render(gateSamples);
+
+		for (int v = 0; v < mOptions.numNotes; v++)
+			player->m_keyReleased[v] = 1;
+		numRendered += driver->render(numSamples - gateSamples);
+	}
+	else if (success)
+	{
+		numRendered = driver->render(numSamples);
+	}
+
+	double elapsed = now() - start;
+	double seconds = (double)numRendered / driver->getSampleRate();
+
+	// closes the output file
+	player->setAudioDriver(NULL);
+	delete driver;
+
+	Job result = job;
+	if (success && !mOptions.patches)
+		result.subtune = player->getCurrentSubtune();
+
+	finish(result, mOptions.patches ? 0 : player->getSubtuneCount(), seconds, elapsed, elapsed, success && numRendered == numSamples);
+}
+
+
+// ----------------------------------------------------------------------------
+bool BatchRenderer::isTrace(const std::string& input)
+// ----------------------------------------------------------------------------
+{
+	static const char suffix[] = ".sidtrace";
+	size_t length = sizeof(suffix) - 1;
+
+	return input.size() > length && input.compare(input.size() - length, length, suffix) == 0;
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::traceJob(Worker& worker, const Job& job)
+// ----------------------------------------------------------------------------
+{
+	PlayerLibSidplay* player = worker.player;
+	AudioStreamDriver* driver = new NullAudioDriver;
+	PlaybackSettings settings = mOptions.settings;
+	SidTraceWriter writer;
+	char path[1024];
+
+	driver->initialize(player, mOptions.settings.mFrequency, mOptions.settings.mBits);
+	player->setAudioDriver(driver);
+
+	bool success = driver->getIsInitialized() && player->loadTuneByPath(job.input.c_str(), job.subtune, &settings);
+
+	double clockFreq = player->getCurrentCpuClockRate();
+	// the tune's own model unless forced, the default one if it has none
+	const char* chipModel = player->getCurrentChipModel();
+	int sidModel = settings.mSidModel;
+	if (!settings.mForceSidModel && chipModel != PlayerLibSidplay::sChipModelUnspecified)
+		sidModel = chipModel == PlayerLibSidplay::sChipModel8580 ? 1 : 0;
+
+	if (success && mOptions.output)
+	{
+		outputPath(path, sizeof(path), job);
+		success = writer.open(path, clockFreq, sidModel, SIDTRACE_C64_BUS, true);
+	}
+
+	long long numSamples = (long long)(mOptions.duration * driver->getSampleRate());
+	long long numRendered = 0;
+	double start = now();
+
+	if (success)
+	{
+		// rendered a second at a time, taking the chunks in between
+		player->enableRegisterLogging(true);
+		SidRegisterTrace* trace = player->getRegisterTrace();
+		long long startTime = trace->getTime();
+		long long dropped = trace->getNumDropped();
+
+		while (success)
+		{
+			bool done = numRendered >= numSamples;
+			if (done)
+				player->enableRegisterLogging(false);
+
+			const SidTraceChunk* chunk;
+			while ((chunk = trace->takeChunk()) != NULL)
+			{
+				// file times count from the start of the tune
+				SidTraceChunk copy = *chunk;
+				copy.mStartTime -= startTime;
+				trace->recycleChunk(chunk);
+
+				if (mOptions.output && !writer.write(&copy))
+					success = false;
+			}
+
+			if (done)
+				break;
+
+			long long samples = numSamples - numRendered < driver->getSampleRate() ? numSamples - numRendered : driver->getSampleRate();
+			long long rendered = driver->render(samples);
+			numRendered += rendered;
+			if (rendered != samples)
+				success = false;
+		}
+
+		player->enableRegisterLogging(false);
+
+		if (trace->getNumDropped() != dropped)
+			success = false;
+	}
+
+	if (mOptions.output && !writer.close((long long)((double)numRendered * clockFreq / driver->getSampleRate())))
+		success = false;
+
+	double elapsed = now() - start;
+	double seconds = (double)numRendered / driver->getSampleRate();
+
+	player->setAudioDriver(NULL);
+	delete driver;
+
+	Job result = job;
+	result.subtune = player->getCurrentSubtune();
+
+	finish(result, player->getSubtuneCount(), seconds, elapsed, elapsed, success && numRendered == numSamples);
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::replayJob(const Job& job)
+// ----------------------------------------------------------------------------
+{
+	SidTraceReplay replay;
+	AudioStreamDriver* driver;
+	char path[1024];
+
+	if (mOptions.output)
+	{
+		outputPath(path, sizeof(path), job);
+		driver = new WavFileAudioDriver(path, mOptions.rawOutput);
+	}
+	else
+	{
+		driver = new NullAudioDriver;
+	}
+
+	// the driver only writes what it is given, it has no player
+	driver->initialize(NULL, mOptions.settings.mFrequency, mOptions.settings.mBits);
+
+	bool success = driver->getIsInitialized() && replay.open(job.input.c_str()) &&
+		replay.setup(driver->getSampleRate(), mOptions.settings.mForceSidModel ? mOptions.settings.mSidModel : -1);
+
+	// the trace ends where its recording did, unless asked for less
+	double duration = success && replay.getDuration() < mOptions.duration ? replay.getDuration() : mOptions.duration;
+	long long numSamples = (long long)(duration * driver->getSampleRate());
+	long long numRendered = 0;
+	double start = now();
+
+	if (success)
+	{
+		short buffer[4096];
+
+		while (numRendered < numSamples)
+		{
+			int samples = numSamples - numRendered < 4096 ? (int)(numSamples - numRendered) : 4096;
+			samples = replay.render(buffer, samples);
+			if (samples == 0 || driver->write(buffer, samples) != samples)
+				break;
+			numRendered += samples;
+		}
+	}
+
+	double elapsed = now() - start;
+	double seconds = (double)numRendered / driver->getSampleRate();
+
+	delete driver;
+
+	finish(job, 0, seconds, elapsed, elapsed, success && numRendered == numSamples);
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::sliceJob(Worker& worker, const Job& job)
+// ----------------------------------------------------------------------------
+{
+	PlaybackSettings settings = mOptions.settings;
+
+	worker.player->setAudioDriver(NULL);
+
+	if (!worker.player->loadTuneByPath(job.input.c_str(), job.subtune, &settings))
+	{
+		finish(job, 0, 0.0, 0.0, 0.0, false);
+		return;
+	}
+
+	long long numSamples = (long long)(mOptions.duration * settings.mFrequency);
+	long long minSamples = (long long)(MIN_SLICE_SECONDS * settings.mFrequency);
+	int count = mOptions.slices;
+
+	if (count > numSamples / minSamples)
+		count = (int)(numSamples / minSamples);
+
+	if (count <= 1)
+	{
+		renderJob(worker, job);
+		return;
+	}
+
+	Slices* slices = new Slices;
+	slices->subtune = job.subtune;
+	slices->subtuneCount = worker.player->getSubtuneCount();
+	slices->count = count;
+	slices->remaining = count;
+	slices->samples = new short[numSamples];
+	slices->numSamples = numSamples;
+	slices->start = now();
+	slices->busy = 0.0;
+	slices->failed = false;
+
+	// the slices all play the subtune the tune started with
+	Job sliceJob = job;
+	sliceJob.subtune = worker.player->getCurrentSubtune();
+	sliceJob.slices = slices;
+
+	for (int slice = count - 1; slice >= 0; slice--)
+	{
+		// queued backwards so this worker carries on with the first one
+		sliceJob.slice = slice;
+		push(worker, sliceJob);
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::renderSlice(Worker& worker, const Job& job)
+// ----------------------------------------------------------------------------
+{
+	PlayerLibSidplay* player = worker.player;
+	Slices& slices = *job.slices;
+	PlaybackSettings settings = mOptions.settings;
+
+	long long first = slices.numSamples * job.slice / slices.count;
+	long long last = slices.numSamples * (job.slice + 1) / slices.count;
+	double start = now();
+
+	player->setAudioDriver(NULL);
+
+	// a worker taking another slice of the tune seeks on from where it is,
+	// or back to a keyframe, rather than from the start of a fresh load
+	bool loaded = player->isTuneLoaded() && job.input == player->getTunePath() && player->getCurrentSubtune() == job.subtune;
+
+	bool success = (loaded || player->loadTuneByPath(job.input.c_str(), job.subtune, &settings)) && player->seekToSample(first);
+
+	short* buffer = slices.samples + first;
+	long long samplesLeft = last - first;
+
+	while (success && samplesLeft > 0)
+	{
+		int samplesThisBuffer = (int)(samplesLeft < 4096 ? samplesLeft : 4096);
+
+		player->fillBuffer(buffer, samplesThisBuffer * sizeof(short));
+		buffer += samplesThisBuffer;
+		samplesLeft -= samplesThisBuffer;
+	}
+
+	double elapsed = now() - start;
+
+	pthread_mutex_lock(&mMutex);
+	slices.busy += elapsed;
+	if (!success)
+		slices.failed = true;
+	bool done = --slices.remaining == 0;
+	pthread_mutex_unlock(&mMutex);
+
+	if (done)
+		writeSlices(job);
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::writeSlices(const Job& job)
+// ----------------------------------------------------------------------------
+{
+	Slices* slices = job.slices;
+	bool success = !slices->failed;
+
+	if (success && mOptions.output)
+	{
+		// named after the job as it was given, like a whole render
+		Job named = job;
+		named.subtune = slices->subtune;
+
+		char path[1024];
+		outputPath(path, sizeof(path), named);
+
+		WavFileAudioDriver driver(path, mOptions.rawOutput);
+		driver.initialize(NULL, mOptions.settings.mFrequency, mOptions.settings.mBits);
+		success = driver.getIsInitialized() && driver.write(slices->samples, slices->numSamples) == slices->numSamples;
+	}
+
+	finish(job, slices->subtuneCount, (double)slices->numSamples / mOptions.settings.mFrequency,
+		   now() - slices->start, slices->busy, success);
+
+	delete[] slices->samples;
+	delete slices;
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::lengthJob(Worker& worker, const Job& job)
+// ----------------------------------------------------------------------------
+{
+	PlaybackSettings settings = mOptions.settings;
+
+	worker.player->setAudioDriver(NULL);
+
+	if (!worker.player->loadTuneByPath(job.input.c_str(), SUBTUNE_DEFAULT, &settings))
+	{
+		finish(job, 0, 0.0, 0.0, 0.0, false);
+		return;
+	}
+
+	int tuneLength;
+	const char* tune = worker.player->getTuneBuffer(tuneLength);
+	int subtuneCount = worker.player->getSubtuneCount();
+
+	// the database has all subtunes whichever was asked for
+	Lengths* lengths = new Lengths;
+	lengths->hash = SongLengthAnalyzer::tuneHash(tune, tuneLength);
+	lengths->remaining = subtuneCount;
+	lengths->failed = false;
+	lengths->subtunes.resize(subtuneCount);
+
+	Job subtuneJob = job;
+	subtuneJob.lengths = lengths;
+
+	for (int subtune = subtuneCount; subtune >= 1; subtune--)
+	{
+		// queued backwards so this worker carries on with the first one
+		subtuneJob.subtune = subtune;
+		push(worker, subtuneJob);
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::analyzeJob(Worker& worker, const Job& job)
+// ----------------------------------------------------------------------------
+{
+	PlayerLibSidplay* player = worker.player;
+	Lengths* lengths = job.lengths;
+	PlaybackSettings settings = mOptions.settings;
+	SongLengthAnalyzer analyzer;
+	SongLength length;
+	double start = now();
+
+	player->setAudioDriver(NULL);
+
+	bool success = player->loadTuneByPath(job.input.c_str(), job.subtune, &settings) &&
+				   analyzer.analyze(player, mOptions.duration, length);
+
+	double elapsed = now() - start;
+
+	pthread_mutex_lock(&mMutex);
+	lengths->subtunes[job.subtune - 1] = length;
+	if (!success)
+		lengths->failed = true;
+	pthread_mutex_unlock(&mMutex);
+
+	finish(job, (int)lengths->subtunes.size(), length.analysed, elapsed, elapsed, success);
+
+	pthread_mutex_lock(&mMutex);
+	bool done = --lengths->remaining == 0;
+	if (done && !lengths->failed)
+	{
+		std::string entry = lengths->hash + "=";
+		for (size_t i = 0; i < lengths->subtunes.size(); i++)
+			entry += (i ? " " : "") + SongLengthAnalyzer::formatLength(lengths->subtunes[i].seconds);
+		mLengths[job.input] = entry;
+	}
+	pthread_mutex_unlock(&mMutex);
+
+	if (done)
+		delete lengths;
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::writeLengths()
+// ----------------------------------------------------------------------------
+{
+	// HVSC Songlengths.md5 layout, sorted by path
+	FILE* fp = fopen(mOptions.lengths, "w");
+	if (fp == NULL)
+	{
+		printf("%s: cannot write\n", mOptions.lengths);
+		mTotals.failed++;
+		return;
+	}
+
+	fprintf(fp, "[Database]\n");
+	for (std::map<std::string, std::string>::iterator i = mLengths.begin(); i != mLengths.end(); ++i)
+		fprintf(fp, "; %s\n%s\n", i->first.c_str(), i->second.c_str());
+
+	fclose(fp);
+}
+
+
+// ----------------------------------------------------------------------------
+void BatchRenderer::finish(const Job& job, int subtuneCount, double seconds, double elapsed, double busy, bool success)
+// ----------------------------------------------------------------------------
+{
+	pthread_mutex_lock(&mMutex);
+
+	if (!success)
+	{
+		printf("%s: cannot render\n", job.input.c_str());
+		mTotals.failed++;
+	}
+	else
+	{
+		if (job.lengths)
+		{
+			static const char* ends[] = { "not found", "silence", "loop", "stopped" };
+			const SongLength& length = job.lengths->subtunes[job.subtune - 1];
+			printf("%s\t%d/%d\t%s (%s)\t%.3fs wall\t%.1fx real-time\n", job.input.c_str(), job.subtune, subtuneCount,
+				   SongLengthAnalyzer::formatLength(length.seconds).c_str(), ends[length.end],
+				   elapsed, elapsed > 0.0 ? seconds / elapsed : 0.0);
+		}
+		else if (mOptions.patches)
+			printf("%s\t%.2fs\t%.3fs wall\t%.1fx real-time\n", job.input.c_str(), seconds, elapsed, elapsed > 0.0 ? seconds / elapsed : 0.0);
+		else
+			printf("%s\t%d/%d\t%.2fs\t%.3fs wall\t%.1fx real-time\n", job.input.c_str(), job.subtune, subtuneCount,
+				   seconds, elapsed, elapsed > 0.0 ? seconds / elapsed : 0.0);
+
+		mTotals.jobs++;
+		mTotals.audioSeconds += seconds;
+		mTotals.renderSeconds += busy;
+	}
+
+	pthread_mutex_unlock(&mMutex);
+}
@@ -0,0 +1,181 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _BATCHRENDERER_H_
+#define _BATCHRENDERER_H_
+
+#include <pthread.h>
+#include <deque>
+#include <map>
+#include <string>
+#include "PlayerLibSidplay.h"
+#include "SongLengthAnalyzer.h"
+
+
+struct RenderOptions
+{
+	// fixed power on delay so renders are reproducible whatever the job order
+	RenderOptions() : output(NULL), lengths(NULL), duration(60.0), gate(-1.0), rawOutput(false), patches(false), traces(false), numNotes(0), slices(1) { settings.mPowerOnDelay = 0; }
+
+	PlaybackSettings    settings;
+	const char*         output;         // file, or directory for batches (NULL renders to nothing)
+	const char*         lengths;        // song length database to write instead of rendering
+	double              duration;       // longest song looked for when finding lengths
+	double              gate;           // patch gate time, < 0 for half the duration
+	bool                rawOutput;
+	bool                patches;
+	bool                traces;         // write register traces instead of audio
+	int                 notes[NUM_VOICES];
+	int                 numNotes;
+	int                 slices;         // time slices per tune, 0 for one per worker
+};
+
+struct RenderTotals
+{
+	RenderTotals() : jobs(0), failed(0), audioSeconds(0.0), renderSeconds(0.0), wallSeconds(0.0) {}
+
+	int                 jobs;
+	int                 failed;
+	double              audioSeconds;
+	double              renderSeconds;  // summed over the workers
+	double              wallSeconds;
+};
+
+
+// Renders tune x subtune (or patch) jobs on a pool of worker threads,
+// each owning its own player (and so emulation engine) which is reused
+// for all of its jobs.  Every worker has its own job queue, taking from
+// the back of it and, once empty, stealing from the front of the others.
+// Expanding "all subtunes" of a tune is a job in itself so the subtunes
+// are queued where the tune was opened and spread by stealing.
+//
+// A long tune can also be split in time slices rendered by different
+// workers, at most one per worker.  Each slice seeks to its start without
+// synthesis and drops a short run-in for the filters to settle, the last
+// one to finish writes the output.  Snapshots cannot be passed between
+// players, so each worker finds its start itself: a worker with the tune
+// still loaded from another slice seeks on from there, or back to one of
+// the keyframes it took on the way (PlaybackSettings::mKeyframeInterval).
+//
+// Finding song lengths runs all subtunes of each tune as jobs of their
+// own through SongLengthAnalyzer and writes the database once all are done.
+//
+// Tunes can also be rendered to register traces (SidTraceFile.h) rather
+// than audio, and traces given as input are played back on resid alone.
+class BatchRenderer
+{
+public:
+
+	static const int SUBTUNE_DEFAULT = 0;
+	static const int SUBTUNE_ALL     = -1;
+	static const double MIN_SLICE_SECONDS;
+
+	BatchRenderer(const RenderOptions& options, int numWorkers);
+	~BatchRenderer();
+
+	// batch: the output option names a directory
+	void add(const char* input, int subtune, bool batch);
+	void run();
+
+	inline const RenderTotals& getTotals()							{ return mTotals; }
+	inline int getNumWorkers()										{ return mNumWorkers; }
+
+	static double now();
+
+private:
+
+	struct Slices;
+	struct Lengths;
+
+	struct Job
+	{
+		std::string         input;
+		int                 subtune;
+		bool                batch;
+		Slices*             slices;         // NULL for a whole job
+		int                 slice;
+		Lengths*            lengths;        // NULL unless finding song lengths
+	};
+
+	// tune rendered in time slices, put together by the last one done
+	struct Slices
+	{
+		int                 subtune;        // as requested, for the output name
+		int                 subtuneCount;
+		int                 count;
+		int                 remaining;
+		short*              samples;
+		long long           numSamples;
+		double              start;
+		double              busy;
+		bool                failed;
+	};
+
+	// song lengths of a tune, the last subtune done adds its entry
+	struct Lengths
+	{
+		std::string         hash;
+		int                 remaining;
+		bool                failed;
+		std::vector<SongLength> subtunes;
+	};
+
+	struct Worker
+	{
+		BatchRenderer*      owner;
+		int                 index;
+		pthread_t           thread;
+		pthread_mutex_t     mutex;
+		std::deque<Job>     jobs;
+		PlayerLibSidplay*   player;
+	};
+
+	static void* workerThread(void* inClientData);
+	static bool isTrace(const std::string& input);
+
+	void push(Worker& worker, const Job& job);
+	bool take(Worker& worker, Job& job);
+	void finish(const Job& job, int subtuneCount, double seconds, double elapsed, double busy, bool success);
+
+	void expandJob(Worker& worker, const Job& job);
+	void sliceJob(Worker& worker, const Job& job);
+	void renderJob(Worker& worker, const Job& job);
+	void renderSlice(Worker& worker, const Job& job);
+	void traceJob(Worker& worker, const Job& job);
+	void replayJob(const Job& job);
+	void writeSlices(const Job& job);
+	void lengthJob(Worker& worker, const Job& job);
+	void analyzeJob(Worker& worker, const Job& job);
+	void writeLengths();
+	void outputPath(char* path, int size, const Job& job);
+
+	RenderOptions               mOptions;
+	int                         mNumWorkers;
+	Worker*                     mWorkers;
+	int                         mNextWorker;
+
+	pthread_mutex_t             mMutex;
+	pthread_cond_t              mCondition;
+	int                         mNumQueued;     // in the worker queues
+	int                         mNumPending;    // queued or running
+
+	RenderTotals                mTotals;
+	std::map<std::string, std::string> mLengths;   // database entries by input
+};
+
+
+#endif // _BATCHRENDERER_H_
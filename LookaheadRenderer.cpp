@@ -0,0 +1,264 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include "LookaheadRenderer.h"
+
+
+const double LookaheadRenderer::DEFAULT_MIN_LOOKAHEAD = 0.010;
+const double LookaheadRenderer::DEFAULT_MAX_LOOKAHEAD = 0.250;
+
+
+// ----------------------------------------------------------------------------
+LookaheadRenderer::LookaheadRenderer()
+// ----------------------------------------------------------------------------
+{
+	mProc = NULL;
+	mClientData = NULL;
+	mSampleRate = 44100;
+	mBlockSize = 0;
+	mDeviceBufferSize = 0;
+	mMinLookahead = DEFAULT_MIN_LOOKAHEAD;
+	mMaxLookahead = DEFAULT_MAX_LOOKAHEAD;
+	mIsRunning = false;
+	mQuit = false;
+	mRing = NULL;
+	mBlock = NULL;
+	mTarget = 0;
+	mNumUnderruns = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+LookaheadRenderer::~LookaheadRenderer()
+// ----------------------------------------------------------------------------
+{
+	stop();
+}
+
+
+// ----------------------------------------------------------------------------
+void LookaheadRenderer::setLookaheadRange(double minSeconds, double maxSeconds)
+// ----------------------------------------------------------------------------
+{
+	mMinLookahead = minSeconds;
+	mMaxLookahead = maxSeconds > minSeconds ? maxSeconds : minSeconds;
+}
+
+
+// ----------------------------------------------------------------------------
+bool LookaheadRenderer::start(RenderProc proc, void* clientData, int sampleRate, int blockSize, int deviceBufferSize)
+// ----------------------------------------------------------------------------
+{
+	stop();
+
+	mProc = proc;
+	mClientData = clientData;
+	mSampleRate = sampleRate;
+	mBlockSize = blockSize;
+	mDeviceBufferSize = deviceBufferSize;
+
+	// never less than a device buffer and a block in flight, never more
+	// than the ring holds
+	mMinTarget = (int)(mMinLookahead * sampleRate);
+	if (mMinTarget < deviceBufferSize + blockSize)
+		mMinTarget = deviceBufferSize + blockSize;
+	mMaxTarget = (int)(mMaxLookahead * sampleRate);
+	if (mMaxTarget > RING_SIZE - blockSize)
+		mMaxTarget = RING_SIZE - blockSize;
+	if (mMaxTarget < mMinTarget)
+		mMaxTarget = mMinTarget;
+
+	mRing = new short[RING_SIZE];
+	mBlock = new short[blockSize];
+	mWritePosition = 0;
+	mReadPosition = 0;
+	mTarget = mMinTarget + deviceBufferSize;
+	if (mTarget > mMaxTarget)
+		mTarget = mMaxTarget;
+
+	mPrimed = false;
+	mNumUnderruns = 0;
+	mLowWater = RING_SIZE;
+	mWindowSamples = 0;
+	mWindowLowWater = RING_SIZE;
+	mNumWindows = 0;
+	mSeenWindows = 0;
+	mSeenUnderruns = 0;
+	mQuit = false;
+
+	if (pthread_create(&mThread, NULL, renderThread, (void*)this) != 0)
+	{
+		printf("LookaheadRenderer: pthread_create failed\n");
+		delete[] mRing;
+		delete[] mBlock;
+		mRing = mBlock = NULL;
+		return false;
+	}
+
+	// the callback waits on it, run it as an audio thread where allowed
+	sched_param param;
+	param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+	pthread_setschedparam(mThread, SCHED_FIFO, &param);
+
+	mIsRunning = true;
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void LookaheadRenderer::stop()
+// ----------------------------------------------------------------------------
+{
+	if (!mIsRunning)
+		return;
+
+	__atomic_store_n(&mQuit, true, __ATOMIC_RELEASE);
+	pthread_join(mThread, NULL);
+
+	delete[] mRing;
+	delete[] mBlock;
+	mRing = mBlock = NULL;
+	mIsRunning = false;
+}
+
+
+// ----------------------------------------------------------------------------
+int LookaheadRenderer::read(short* buffer, int numSamples)
+// ----------------------------------------------------------------------------
+{
+	unsigned int writePosition = __atomic_load_n(&mWritePosition, __ATOMIC_ACQUIRE);
+	int fill = (int)(writePosition - mReadPosition);
+	int numCopied = 0;
+
+	if (!mPrimed)
+		mPrimed = fill >= __atomic_load_n(&mTarget, __ATOMIC_RELAXED);
+
+	if (mPrimed)
+	{
+		if (fill < mLowWater)
+			mLowWater = fill;
+
+		numCopied = fill < numSamples ? fill : numSamples;
+
+		int offset = mReadPosition & (RING_SIZE - 1);
+		int first = RING_SIZE - offset < numCopied ? RING_SIZE - offset : numCopied;
+		memcpy(buffer, mRing + offset, sizeof(short) * first);
+		memcpy(buffer + first, mRing, sizeof(short) * (numCopied - first));
+
+		__atomic_store_n(&mReadPosition, mReadPosition + numCopied, __ATOMIC_RELEASE);
+
+		if (numCopied < numSamples)
+			__atomic_store_n(&mNumUnderruns, mNumUnderruns + 1, __ATOMIC_RELEASE);
+
+		mWindowSamples += numSamples;
+		if (mWindowSamples >= mSampleRate)
+		{
+			__atomic_store_n(&mWindowLowWater, mLowWater, __ATOMIC_RELAXED);
+			__atomic_store_n(&mNumWindows, mNumWindows + 1, __ATOMIC_RELEASE);
+			mLowWater = RING_SIZE;
+			mWindowSamples = 0;
+		}
+	}
+
+	memset(buffer + numCopied, 0, sizeof(short) * (numSamples - numCopied));
+	return numCopied;
+}
+
+
+// ----------------------------------------------------------------------------
+void LookaheadRenderer::adapt()
+// ----------------------------------------------------------------------------
+{
+	int target = mTarget;
+	// the fill the callback should find at the least
+	int margin = mDeviceBufferSize + mBlockSize;
+
+	int numUnderruns = __atomic_load_n(&mNumUnderruns, __ATOMIC_ACQUIRE);
+	if (numUnderruns != mSeenUnderruns)
+	{
+		target += (numUnderruns - mSeenUnderruns) * margin;
+		mSeenUnderruns = numUnderruns;
+	}
+
+	int numWindows = __atomic_load_n(&mNumWindows, __ATOMIC_ACQUIRE);
+	if (numWindows != mSeenWindows)
+	{
+		int lowWater = __atomic_load_n(&mWindowLowWater, __ATOMIC_RELAXED);
+		if (lowWater < margin)
+			target += margin - lowWater + mBlockSize;
+		else
+			target -= (lowWater - margin) / 8;
+		mSeenWindows = numWindows;
+	}
+
+	if (target < mMinTarget)
+		target = mMinTarget;
+	if (target > mMaxTarget)
+		target = mMaxTarget;
+
+	if (target != mTarget)
+		__atomic_store_n(&mTarget, target, __ATOMIC_RELAXED);
+}
+
+
+// ----------------------------------------------------------------------------
+void* LookaheadRenderer::renderThread(void* inClientData)
+// ----------------------------------------------------------------------------
+{
+	LookaheadRenderer* renderer = reinterpret_cast<LookaheadRenderer*>(inClientData);
+
+	while (!__atomic_load_n(&renderer->mQuit, __ATOMIC_ACQUIRE))
+	{
+		renderer->adapt();
+
+		unsigned int readPosition = __atomic_load_n(&renderer->mReadPosition, __ATOMIC_ACQUIRE);
+		int fill = (int)(renderer->mWritePosition - readPosition);
+
+		if (fill + renderer->mBlockSize <= renderer->mTarget)
+		{
+			renderer->mProc(renderer->mBlock, renderer->mBlockSize, renderer->mClientData);
+
+			int offset = renderer->mWritePosition & (RING_SIZE - 1);
+			int first = RING_SIZE - offset < renderer->mBlockSize ? RING_SIZE - offset : renderer->mBlockSize;
+			memcpy(renderer->mRing + offset, renderer->mBlock, sizeof(short) * first);
+			memcpy(renderer->mRing, renderer->mBlock + first, sizeof(short) * (renderer->mBlockSize - first));
+
+			__atomic_store_n(&renderer->mWritePosition, renderer->mWritePosition + renderer->mBlockSize, __ATOMIC_RELEASE);
+			continue;
+		}
+
+		// ahead: sleep about until there is room for a block, waking often
+		// enough to catch up on a callback that came early
+		double seconds = (double)(fill + renderer->mBlockSize - renderer->mTarget) / renderer->mSampleRate;
+		if (seconds < 0.0005)
+			seconds = 0.0005;
+		if (seconds > 0.002)
+			seconds = 0.002;
+
+		timespec t;
+		t.tv_sec = 0;
+		t.tv_nsec = (long)(seconds * 1000000000.0);
+		nanosleep(&t, NULL);
+	}
+
+	return NULL;
+}
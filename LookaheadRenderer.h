@@ -0,0 +1,108 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef _LOOKAHEADRENDERER_H_
+#define _LOOKAHEADRENDERER_H_
+
+#include <pthread.h>
+
+
+// Renders ahead of an audio device callback on a thread of its own, so
+// the callback only copies samples and spikes in the rendering cost (tune
+// init, bursts of register writes, the spectrum) are absorbed by the
+// lookahead instead of the device buffer.  The render thread fills a
+// lock-free single producer, single consumer ring in blocks of its own
+// size up to the lookahead, and sleeps while it is ahead.
+//
+// The lookahead adapts to the jitter seen: every second the callback
+// publishes the lowest fill of the ring it found, and the render thread
+// grows the lookahead at once by what that fell short of a device buffer
+// and a block, or shrinks it by an eighth of the excess, within the range
+// set.  Running dry is counted as an underrun and grows it too.
+class LookaheadRenderer
+{
+public:
+
+	typedef void (*RenderProc)(short* buffer, int numSamples, void* clientData);
+
+	static const int	RING_SIZE = 32768;		// samples, a power of 2
+	static const double	DEFAULT_MIN_LOOKAHEAD;
+	static const double	DEFAULT_MAX_LOOKAHEAD;
+
+	LookaheadRenderer();
+	~LookaheadRenderer();
+
+	// seconds, the upper end is also limited by the ring size; before start()
+	void setLookaheadRange(double minSeconds, double maxSeconds);
+
+	// starts rendering with proc in blocks of blockSize samples, ahead of
+	// reads of deviceBufferSize samples
+	bool start(RenderProc proc, void* clientData, int sampleRate, int blockSize, int deviceBufferSize);
+	void stop();
+	inline bool getIsRunning() const									{ return mIsRunning; }
+
+	// device callback: copies what the ring holds, up to numSamples, and
+	// fills the rest with silence.  Returns the number of samples copied.
+	// Until the ring first reaches the lookahead it only returns silence.
+	int read(short* buffer, int numSamples);
+
+	// any thread
+	inline double getLookahead() const									{ return (double)__atomic_load_n(&mTarget, __ATOMIC_RELAXED) / mSampleRate; }
+	inline int getNumUnderruns() const									{ return __atomic_load_n(&mNumUnderruns, __ATOMIC_RELAXED); }
+
+private:
+
+	static void* renderThread(void* inClientData);
+
+	void adapt();
+
+	RenderProc			mProc;
+	void*				mClientData;
+	int					mSampleRate;
+	int					mBlockSize;
+	int					mDeviceBufferSize;
+	double				mMinLookahead;
+	double				mMaxLookahead;
+
+	pthread_t			mThread;
+	bool				mIsRunning;
+	bool				mQuit;
+
+	short*				mRing;
+	short*				mBlock;
+	unsigned int		mWritePosition;		// in samples, written by the render thread
+	unsigned int		mReadPosition;		// written by the callback
+	int					mTarget;			// lookahead in samples, written by the render thread
+
+	// written by the callback
+	bool				mPrimed;
+	int					mNumUnderruns;
+	int					mLowWater;			// of the window so far
+	int					mWindowSamples;
+	int					mWindowLowWater;	// of the last complete window
+	int					mNumWindows;
+
+	// render thread state
+	int					mMinTarget;
+	int					mMaxTarget;
+	int					mSeenWindows;
+	int					mSeenUnderruns;
+};
+
+
+#endif // _LOOKAHEADRENDERER_H_
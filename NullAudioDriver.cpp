@@ -0,0 +1,82 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include "NullAudioDriver.h"
+
+
+// ----------------------------------------------------------------------------
+NullAudioDriver::NullAudioDriver()
+// ----------------------------------------------------------------------------
+{
+	resetStatistics();
+}
+
+
+// ----------------------------------------------------------------------------
+NullAudioDriver::~NullAudioDriver()
+// ----------------------------------------------------------------------------
+{
+	deinitialize();
+}
+
+
+// ----------------------------------------------------------------------------
+void NullAudioDriver::resetStatistics()
+// ----------------------------------------------------------------------------
+{
+	mStatisticsStart = mNumSamplesWritten;
+	gettimeofday(&mStartTime, NULL);
+}
+
+
+// ----------------------------------------------------------------------------
+double NullAudioDriver::getRealTimeFactor()
+// ----------------------------------------------------------------------------
+{
+	timeval now;
+	gettimeofday(&now, NULL);
+
+	double elapsed = (now.tv_sec - mStartTime.tv_sec) + (now.tv_usec - mStartTime.tv_usec) / 1000000.0;
+	if (elapsed <= 0.0)
+		return 0.0;
+
+	return (double) (mNumSamplesWritten - mStatisticsStart) / mSampleRate / elapsed;
+}
+
+
+// ----------------------------------------------------------------------------
+bool NullAudioDriver::openStream()
+// ----------------------------------------------------------------------------
+{
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void NullAudioDriver::closeStream()
+// ----------------------------------------------------------------------------
+{
+}
+
+
+// ----------------------------------------------------------------------------
+bool NullAudioDriver::writeStream(const short* /*buffer*/, int /*numSamples*/)
+// ----------------------------------------------------------------------------
+{
+	return true;
+}
@@ -0,0 +1,52 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _NULLAUDIODRIVER_H_
+#define _NULLAUDIODRIVER_H_
+
+#include <sys/time.h>
+#include "AudioStreamDriver.h"
+
+
+// Discards the samples and so runs the player as fast as it can render,
+// for measuring throughput without an audio device.
+class NullAudioDriver : public AudioStreamDriver
+{
+public:
+
+	NullAudioDriver();
+	~NullAudioDriver();
+
+	void resetStatistics();
+
+	// seconds of audio rendered per second of wall clock time
+	double getRealTimeFactor();
+
+protected:
+
+	bool openStream();
+	void closeStream();
+	bool writeStream(const short* buffer, int numSamples);
+
+private:
+
+	long long                   mStatisticsStart;
+	timeval                     mStartTime;
+};
+
+
+#endif // _NULLAUDIODRIVER_H_
@@ -18,19 +18,30 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#ifdef __APPLE__
 // carbon headers
 #include <ApplicationServices/ApplicationServices.h>
 #include <CoreFoundation/CoreFoundation.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
 
 // module headers
 #include "AudioDriver.h"
+#include "TuneCache.h"
+#include "SidRegisterTrace.h"
 
 // local module header
 #include "PlayerLibSidplay.h"
 
 
-unsigned char sid_registers[ 0x19 ];
-
 const char*	PlayerLibSidplay::sChipModel6581 = "MOS 6581";
 const char*	PlayerLibSidplay::sChipModel8580 = "MOS 8580";
 const char*	PlayerLibSidplay::sChipModelUnknown = "Unknown";
@@ -77,22 +88,40 @@ static const sid_fc_t sDefault8580[sDefault8580PointCount] =
 // ----------------------------------------------------------------------------
 PlayerLibSidplay::PlayerLibSidplay() :
 // ----------------------------------------------------------------------------
+    m_sid(NULL),
+    m_regWritePut(0),
+    m_regWriteGet(0),
+    m_currentInstrument(0),
+    m_cycleCounter(0),
 	mSidEmuEngine(NULL),
 	mSidTune(NULL),
 	mBuilder(NULL),
 	mAudioDriver(NULL),
+	mTuneBuffer(NULL),
+	mTuneData(NULL),
 	mTuneLength(0),
+	mTuneMap(NULL),
+	mTuneMapSize(0),
 	mCurrentSubtune(0),
 	mSubtuneCount(0),
 	mDefaultSubtune(0),
 	mCurrentTempo(50),
 	mPreviousOversamplingFactor(0),
 	mOversamplingBuffer(NULL),
-    m_sid(NULL),
-    m_regWritePut(0),
-    m_regWriteGet(0),
-    m_currentInstrument(0)
+	mRegisterTrace(NULL),
+	mRegisterLogging(false),
+	mTuneCache(NULL),
+	mCrossfadeSamples(0),
+	mFadeTune(NULL),
+	mFadeLength(0),
+	mFadePosition(0),
+	mFadeBuffer(NULL),
+	mFadeBufferSize(0),
+	mSynthBuffer(NULL),
+	mConvertBuffer(NULL),
+	mSynthBufferSize(0)
 {
+    memset(&mFilterSettings, 0, sizeof(mFilterSettings));
     memset(m_instruments, 0, MAX_INSTRUMENTS*sizeof(Instrument));
 
     memset(m_keyPressed, 0, NUM_VOICES*sizeof(int));
@@ -102,6 +131,8 @@ PlayerLibSidplay::PlayerLibSidplay() :
     memset(m_keyVelocity, 0, NUM_VOICES*sizeof(int));
     memset(m_keyReleased, 0, NUM_VOICES*sizeof(int));
     memset(m_keyReleasedClocks, 0, NUM_VOICES*sizeof(int));
+
+	pthread_mutex_init(&mTuneMutex, NULL);
 }
 
 
@@ -109,11 +140,7 @@ PlayerLibSidplay::PlayerLibSidplay() :
 PlayerLibSidplay::~PlayerLibSidplay()
 // ----------------------------------------------------------------------------
 {
-	if (mSidTune)
-	{
-		delete mSidTune;
-		mSidTune = NULL;
-	}
+	unloadTune();
 	
 	if (mBuilder)
 	{
@@ -126,6 +153,23 @@ PlayerLibSidplay::~PlayerLibSidplay()
 		delete mSidEmuEngine;
 		mSidEmuEngine = NULL;
 	}
+
+	if (m_sid)
+	{
+		delete m_sid;
+		m_sid = NULL;
+	}
+
+	delete[] mOversamplingBuffer;
+
+	delete mFadeTune;
+	delete[] mFadeBuffer;
+	delete[] mSynthBuffer;
+	delete[] mConvertBuffer;
+
+	delete mRegisterTrace;
+
+	pthread_mutex_destroy(&mTuneMutex);
 }
 
 
@@ -136,6 +180,15 @@ void PlayerLibSidplay::setAudioDriver(AudioDriver* audioDriver)
 	mAudioDriver = audioDriver;
 }
 
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::setTuneCache(TuneCache* tuneCache, int crossfadeSamples)
+// ----------------------------------------------------------------------------
+{
+	mTuneCache = tuneCache;
+	mCrossfadeSamples = crossfadeSamples;
+}
+
 // ----------------------------------------------------------------------------
 static inline float approximate_dac(int x, float kinkiness)
 // ----------------------------------------------------------------------------
@@ -171,7 +224,6 @@ void PlayerLibSidplay::setupSIDInfo()
 
 		mFilterSettings.points = sDefault8580PointCount;
 		memcpy(mFilterSettings.cutoff, sDefault8580, sizeof(sDefault8580));
-		mBuilder->set_filter((sid_filter_t*)NULL, mPlaybackSettings.mOverrideCutoffCurve);
 	}
 	else
 	{
@@ -207,9 +259,39 @@ void PlayerLibSidplay::setupSIDInfo()
 			mFilterSettings.cutoff[i][0] = i;
 			mFilterSettings.cutoff[i][1] = freq;
 		}
+	}
+
+	applyFilterSettings();
+}
 
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::applyFilterSettings()
+// ----------------------------------------------------------------------------
+{
+	// the 8580 plays on resid's own curve
+	if (getCurrentChipModel() == sChipModel8580)
+		mBuilder->set_filter((sid_filter_t*)NULL, mPlaybackSettings.mOverrideCutoffCurve);
+	else
 		mBuilder->set_filter(&mFilterSettings, mPlaybackSettings.mOverrideCutoffCurve);
-	}
+}
+
+
+// ----------------------------------------------------------------------------
+bool PlaybackSettings::setEmulation(const char* name)
+// ----------------------------------------------------------------------------
+{
+	bool fast = strcmp(name, "fast") == 0;
+	bool lazy = fast || strcmp(name, "lazy") == 0;
+
+	if (!lazy && strcmp(name, "exact") != 0)
+		return false;
+
+	mCpuEmulation = fast ? SID2_CPU_FAST : SID2_CPU_CYCLE;
+	mEnvironment = fast ? sid2_envBS : sid2_envR;
+	mLazyRaster = lazy;
+	mLazyTimers = lazy;
+	return true;
 }
 
 
@@ -243,13 +325,20 @@ void PlayerLibSidplay::initEmuEngine(PlaybackSettings *settings)
 
 	cfg.clockForced   = true;
 	
-	cfg.environment   = sid2_envR;
+	// the fast 6510 only runs in the sidplay1 environments, RSIDs are
+	// always played in the real one
+	cfg.environment   = mPlaybackSettings.mEnvironment;
 	cfg.playback	  = sid2_mono;
 	cfg.precision     = mPlaybackSettings.mBits;
 	cfg.frequency	  = mPlaybackSettings.mFrequency * mPlaybackSettings.mOversampling;
 	cfg.forceDualSids = false;
 	cfg.emulateStereo = false;
 
+	if (mPlaybackSettings.mPowerOnDelay >= 0)
+		cfg.powerOnDelay = mPlaybackSettings.mPowerOnDelay;
+	else
+		cfg.powerOnDelay = SID2_DEFAULT_POWER_ON_DELAY;
+
 	if (mPlaybackSettings.mSidModel == 0)
 		cfg.sidDefault	  = SID2_MOS6581;
 	else
@@ -258,6 +347,11 @@ void PlayerLibSidplay::initEmuEngine(PlaybackSettings *settings)
 	if (mPlaybackSettings.mForceSidModel)
 		cfg.sidModel = cfg.sidDefault;
 
+	cfg.cpuEmulation     = mPlaybackSettings.mCpuEmulation;
+	cfg.lazyRaster       = mPlaybackSettings.mLazyRaster;
+	cfg.lazyTimers       = mPlaybackSettings.mLazyTimers;
+	cfg.keyframeInterval = mPlaybackSettings.mKeyframeInterval;
+
 	cfg.sidEmulation  = mBuilder;
 	cfg.sidSamples	  = true;
 //	cfg.sampleFormat  = SID2_BIG_UNSIGNED;
@@ -274,6 +368,40 @@ void PlayerLibSidplay::initEmuEngine(PlaybackSettings *settings)
 		printf("configure error: %s\n", mSidEmuEngine->error());
 
 	mSidEmuEngine->setRegisterFrameChangedCallback(NULL, NULL);
+	mSidEmuEngine->setSidWriteCallback((void*) this, mRegisterLogging ? sidWritten : NULL);
+}
+
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::initSynthEngine(PlaybackSettings *settings)
+// ----------------------------------------------------------------------------
+{
+	if (m_sid == NULL)
+		m_sid = new RESID::SID;
+
+	if (mAudioDriver)
+		settings->mFrequency = mAudioDriver->getSampleRate();
+
+	mPlaybackSettings = *settings;
+
+	memset(m_keyPressed, 0, NUM_VOICES*sizeof(int));
+	memset(m_keyPlaying, 0, NUM_VOICES*sizeof(int));
+	memset(m_keyClocks, 0, NUM_VOICES*sizeof(int));
+	memset(m_keyReleased, 0, NUM_VOICES*sizeof(int));
+	memset(m_keyReleasedClocks, 0, NUM_VOICES*sizeof(int));
+	m_regWritePut = 0;
+	m_regWriteGet = 0;
+	m_cycleCounter = 0;
+
+	m_sid->reset();
+	m_sid->set_chip_model(mPlaybackSettings.mSidModel == 0 ? MOS6581 : MOS8580);
+	m_sid->set_distortion_properties(true, 1500, 300, -200000, 200000);   //Note: need large opmin/opmax for more than 3 voices
+	m_sid->enable_filter(true);
+	m_sid->enable_external_filter(true);
+	m_sid->set_mute(0, false);
+	m_sid->set_mute(1, false);
+	m_sid->set_mute(2, false);
+	m_sid->set_sampling_parameters(mPlaybackSettings.mClockSpeed == 0 ? 985248 : 1022727, mPlaybackSettings.mFrequency);
 }
 
 
@@ -312,7 +440,8 @@ bool PlayerLibSidplay::initSIDTune(PlaybackSettings* settings)
 
 	initEmuEngine(settings);
 
-	mSidTune = new SidTune((uint_least8_t *) mTuneBuffer, mTuneLength);
+	// parsed in place, the data is only copied into the C64 memory
+	mSidTune = new SidTune((const uint_least8_t *) mTuneData, mTuneLength, true);
 
     if (!mSidTune)
         return false;
@@ -346,6 +475,9 @@ bool PlayerLibSidplay::playTuneByPath(const char* filename, int subtune, Playbac
 {
 	//printf("loading file: %s\n", filename);
 	
+	if (switchToPreparedTune(filename, subtune, settings))
+		return true;
+
 	mAudioDriver->stopPlayback();
 
 	bool success = loadTuneByPath( filename, subtune, settings );
@@ -353,7 +485,10 @@ bool PlayerLibSidplay::playTuneByPath(const char* filename, int subtune, Playbac
 	//printf("load returned: %d\n", success);
 	
 	if (success)
+	{
 		mAudioDriver->startPlayback();
+		prepareNextSubtune();
+	}
 
 	return success;
 }
@@ -381,21 +516,33 @@ bool PlayerLibSidplay::playTuneFromBuffer(char* buffer, int length, int subtune,
 bool PlayerLibSidplay::loadTuneByPath(const char* filename, int subtune, PlaybackSettings* settings)
 // ----------------------------------------------------------------------------
 {
-	FILE* fp = fopen(filename, "rb");
+	int fd = open(filename, O_RDONLY);
 	
-	if ( fp == NULL )
+	if ( fd < 0 )
 		return false;
 
-	int length = (int)fread(mTuneBuffer, 1, TUNE_BUFFER_SIZE, fp);
-	
-	if (length < 0)
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > TUNE_BUFFER_SIZE)
+	{
+		close(fd);
 		return false;
+	}
 
-	//printf("file reading worked\n");
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
 
-	fclose(fp);
+	if (map == MAP_FAILED)
+		return false;
 
-	mTuneLength = length;
+	//printf("file mapping worked\n");
+
+	unloadTune();
+
+	mTunePath = filename;
+	mTuneMap = map;
+	mTuneMapSize = st.st_size;
+	mTuneData = (const char*) map;
+	mTuneLength = (int) st.st_size;
 	mCurrentSubtune = subtune;
 
 	return initSIDTune(settings);
@@ -419,14 +566,174 @@ bool PlayerLibSidplay::loadTuneFromBuffer(char* buffer, int length, int subtune,
 		return false;
 	}
 	
-	mTuneLength = length;
+	// the caller's buffer may not outlive the tune, keep a copy
+	unloadTune();
+
+	mTuneBuffer = new char[length];
 	memcpy(mTuneBuffer, buffer, length);
+	mTuneData = mTuneBuffer;
+	mTuneLength = length;
 	mCurrentSubtune = subtune;
 
 	return initSIDTune(settings);
 }
 
 
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::unloadTune()
+// ----------------------------------------------------------------------------
+{
+	if (mSidTune != NULL)
+	{
+		delete mSidTune;
+		mSidTune = NULL;
+		mSidEmuEngine->load(NULL);
+	}
+
+	if (mTuneMap != NULL)
+		munmap(mTuneMap, mTuneMapSize);
+
+	delete[] mTuneBuffer;
+
+	mTunePath.clear();
+	mTuneBuffer = NULL;
+	mTuneData = NULL;
+	mTuneLength = 0;
+	mTuneMap = NULL;
+	mTuneMapSize = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+bool PlayerLibSidplay::switchToPreparedTune(const char* filename, int subtune, PlaybackSettings* settings)
+// ----------------------------------------------------------------------------
+{
+	if (mTuneCache == NULL || m_sid != NULL || mSidEmuEngine == NULL || filename[0] == '\0')
+		return false;
+
+	if (mAudioDriver)
+		settings->mFrequency = mAudioDriver->getSampleRate();
+
+	mTuneCache->recycle(releaseFadedTune());
+
+	PlayerLibSidplay* prepared = mTuneCache->take(filename, subtune, *settings);
+
+	if (prepared == NULL)
+		return false;
+
+	mTuneCache->recycle(adoptTune(prepared, mCrossfadeSamples));
+
+	if (!mAudioDriver->getIsPlaying())
+		mAudioDriver->startPlayback();
+
+	prepareNextSubtune();
+
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::prepareNextSubtune()
+// ----------------------------------------------------------------------------
+{
+	if (mTuneCache != NULL && !mTunePath.empty() && mCurrentSubtune < mSubtuneCount)
+		mTuneCache->prepare(mTunePath.c_str(), mCurrentSubtune + 1, mPlaybackSettings);
+}
+
+
+// ----------------------------------------------------------------------------
+PlayerLibSidplay* PlayerLibSidplay::adoptTune(PlayerLibSidplay* prepared, int fadeSamples)
+// ----------------------------------------------------------------------------
+{
+	pthread_mutex_lock(&mTuneMutex);
+
+	bool fade = mSidTune != NULL && fadeSamples > 0;
+
+	swapTune(*prepared);
+
+	PlayerLibSidplay* released = mFadeTune;
+	mFadeTune = prepared;
+	mFadeLength = fade ? fadeSamples : 0;
+	mFadePosition = 0;
+
+	pthread_mutex_unlock(&mTuneMutex);
+
+	return released;
+}
+
+
+// ----------------------------------------------------------------------------
+PlayerLibSidplay* PlayerLibSidplay::releaseFadedTune()
+// ----------------------------------------------------------------------------
+{
+	PlayerLibSidplay* released = NULL;
+
+	pthread_mutex_lock(&mTuneMutex);
+
+	if (mFadeTune != NULL && mFadePosition >= mFadeLength)
+	{
+		released = mFadeTune;
+		mFadeTune = NULL;
+	}
+
+	pthread_mutex_unlock(&mTuneMutex);
+
+	return released;
+}
+
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::swapTune(PlayerLibSidplay& other)
+// ----------------------------------------------------------------------------
+{
+	// everything loading a tune sets up, the tune data is mapped or on
+	// the heap so the parsed tune can refer to it from either player
+	std::swap(mSidEmuEngine, other.mSidEmuEngine);
+	std::swap(mSidTune, other.mSidTune);
+	std::swap(mBuilder, other.mBuilder);
+	std::swap(mTuneInfo, other.mTuneInfo);
+	std::swap(mPlaybackSettings, other.mPlaybackSettings);
+	std::swap(mTunePath, other.mTunePath);
+	std::swap(mTuneBuffer, other.mTuneBuffer);
+	std::swap(mTuneData, other.mTuneData);
+	std::swap(mTuneLength, other.mTuneLength);
+	std::swap(mTuneMap, other.mTuneMap);
+	std::swap(mTuneMapSize, other.mTuneMapSize);
+	std::swap(mCurrentSubtune, other.mCurrentSubtune);
+	std::swap(mSubtuneCount, other.mSubtuneCount);
+	std::swap(mDefaultSubtune, other.mDefaultSubtune);
+
+	// the filter settings are the user's and stay, only the chip defaults
+	// set up for the new tune come along (see setupSIDInfo)
+	const sid_filter_t& chip = other.mFilterSettings;
+	mFilterSettings.distortion_enable = chip.distortion_enable;
+	mFilterSettings.rate = chip.rate;
+	mFilterSettings.headroom = chip.headroom;
+	mFilterSettings.opmin = chip.opmin;
+	mFilterSettings.opmax = chip.opmax;
+	mFilterSettings.points = chip.points;
+	memcpy(mFilterSettings.cutoff, chip.cutoff, sizeof(mFilterSettings.cutoff));
+
+	// the tempo and the register trace stay with the player, the trace
+	// goes on from the new engine's clock
+	if (mSidEmuEngine != NULL)
+	{
+		applyFilterSettings();
+		setTempo(mCurrentTempo);
+		mSidEmuEngine->setSidWriteCallback((void*) this, mRegisterLogging ? sidWritten : NULL);
+	}
+
+	if (mRegisterTrace != NULL && mSidEmuEngine != NULL)
+		mRegisterTrace->resync((unsigned int) mSidEmuEngine->cycles());
+
+	if (other.mSidEmuEngine != NULL)
+	{
+		other.mSidEmuEngine->setRegisterFrameChangedCallback(NULL, NULL);
+		other.mSidEmuEngine->setSidWriteCallback(NULL, NULL);
+	}
+}
+
+
 // ----------------------------------------------------------------------------
 bool PlayerLibSidplay::startPrevSubtune()
 // ----------------------------------------------------------------------------
@@ -436,12 +743,17 @@ bool PlayerLibSidplay::startPrevSubtune()
 	else
 		return true;
 
+	if (switchToPreparedTune(mTunePath.c_str(), mCurrentSubtune, &mPlaybackSettings))
+		return true;
+
 	mAudioDriver->stopPlayback();
 
 	initCurrentSubtune();
 	
 	mAudioDriver->startPlayback();
 
+	prepareNextSubtune();
+
 	return true;
 }
 
@@ -455,12 +767,17 @@ bool PlayerLibSidplay::startNextSubtune()
 	else
 		return true;
 
+	if (switchToPreparedTune(mTunePath.c_str(), mCurrentSubtune, &mPlaybackSettings))
+		return true;
+
 	mAudioDriver->stopPlayback();
 
 	initCurrentSubtune();
 	
 	mAudioDriver->startPlayback();
 
+	prepareNextSubtune();
+
 	return true;
 }
 
@@ -474,12 +791,17 @@ bool PlayerLibSidplay::startSubtune( int which )
 	else
 		return true;
 
+	if (switchToPreparedTune(mTunePath.c_str(), mCurrentSubtune, &mPlaybackSettings))
+		return true;
+
 	mAudioDriver->stopPlayback();
 
 	initCurrentSubtune();
 	
 	mAudioDriver->startPlayback();
 
+	prepareNextSubtune();
+
 	return true;
 }
 
@@ -560,7 +882,6 @@ void PlayerLibSidplay::playbackIRQ()
     Instrument& instrument = m_instruments[m_currentInstrument];
 
     //TODO write these only when something changes
-    static bool init = false;
     PUSH_WRITE(SID_FILTER_FC_LO, instrument.sid_filter_cutoff & 7);
     PUSH_WRITE(SID_FILTER_FC_HI, (instrument.sid_filter_cutoff >> 3) & 0xff);
     PUSH_WRITE(SIDPLUS_FILTER_RES, instrument.sid_filter_resonance & 0xf);
@@ -669,6 +990,13 @@ void PlayerLibSidplay::playbackIRQ()
     }
     if (numActiveVoices > NUM_VOICES)
         printf("out of voices! %d > %d\n", numActiveVoices, NUM_VOICES);
+
+    //voices spread evenly from left to right, heard when rendering stereo
+    //(last, a write takes a cycle and the others keep their timing)
+    for(int v=0;v<NUM_VOICES;v++) {
+        int pan = (int)(instrument.stereo_spread & 0x7f) * (2*v - (NUM_VOICES-1)) / (NUM_VOICES-1);
+        PUSH_WRITE(SIDPLUS_EXT_VOICE_BASE + v * SIDPLUS_VOICE_NUM_REGS + SIDPLUS_VOICE_PAN, pan & 0xff);
+    }
 #if 0
     if (printChanges)
         printf("active voices = %d\n", numActiveVoices);
@@ -676,6 +1004,56 @@ void PlayerLibSidplay::playbackIRQ()
 #undef PUSH_WRITE
 }
 
+// ----------------------------------------------------------------------------
+template <class Sample> void PlayerLibSidplay::synthesize(Sample* b, int samples, int interleave)
+// ----------------------------------------------------------------------------
+{
+    // resid clocks the same whether it writes 16 bit or float samples,
+    // in stereo each frame of interleave samples starts with left and right
+    m_sid->set_stereo(interleave >= 2);
+    cycle_count delta_t = 1;
+    int count = 0;
+    for(int c=0;c<samples;) {
+        //generate IRQ for SW playback
+        m_cycleCounter++;
+        if ((m_cycleCounter % PLAYBACK_IRQ_CLOCK_INTERVAL) == 0) {
+#if RESID_PROFILE
+            unsigned long long irqStart = RESID::SID::profile_clock();
+            playbackIRQ();
+            mProfile.irqTicks += RESID::SID::profile_clock() - irqStart;
+#else
+            playbackIRQ();
+#endif
+        }
+
+        //process a pending register write
+        if (m_regWriteGet != m_regWritePut) {
+#if RESID_PROFILE
+            unsigned long long writeStart = RESID::SID::profile_clock();
+#endif
+            if (mRegisterLogging)
+                mRegisterTrace->record((unsigned int)m_cycleCounter, 0, m_regWriteBuffer[m_regWriteGet], m_regWriteBuffer[m_regWriteGet+1]);
+            m_sid->write(m_regWriteBuffer[m_regWriteGet], m_regWriteBuffer[m_regWriteGet+1]);
+            m_regWriteGet += 2;
+            m_regWriteGet &= REG_WRITE_BUFFER_LENGTH-1;
+#if RESID_PROFILE
+            mProfile.writeTicks += RESID::SID::profile_clock() - writeStart;
+#endif
+        }
+
+        //simulate one cycle
+        delta_t = 1;
+        c += m_sid->clock(delta_t, b+c*interleave, samples-c, interleave);
+        count++;
+    }
+    //printf("count = %d\n", count);
+
+    //alternatively could simulate multiple cycles at once (TODO how much faster is this?)
+    //delta_t = 1000000*512/44100;
+    //m_sid->clock(delta_t, b, samples);
+}
+
+
 // ----------------------------------------------------------------------------
 void PlayerLibSidplay::fillBuffer(void* buffer, int len)
 // ----------------------------------------------------------------------------
@@ -688,9 +1066,14 @@ void PlayerLibSidplay::fillBuffer(void* buffer, int len)
 	samples += len;
 #endif
 
+#if RESID_PROFILE
+	unsigned long long renderStart = RESID::SID::profile_clock();
+#endif
+
     //len = 512 samples
     if (m_sid) {
         //synth mode
+        pthread_mutex_lock(&mTuneMutex);
         short* b = (short*)buffer;
 #if 0
         //generate a sine wave (for testing)
@@ -700,38 +1083,237 @@ void PlayerLibSidplay::fillBuffer(void* buffer, int len)
         }
 #else
         //simulate
-        int samples = len/sizeof(short);
-        cycle_count delta_t = 1;
-        int interleave = 1;
-        int count = 0;
-        static long long cycleCounter = 0;
-        for(int c=0;c<samples;) {
-            //generate IRQ for SW playback
-            cycleCounter++;
-            if ((cycleCounter % PLAYBACK_IRQ_CLOCK_INTERVAL) == 0)
-                playbackIRQ();
-
-            //process a pending register write
-            if (m_regWriteGet != m_regWritePut) {
-                m_sid->write(m_regWriteBuffer[m_regWriteGet], m_regWriteBuffer[m_regWriteGet+1]);
-                m_regWriteGet += 2;
-                m_regWriteGet &= REG_WRITE_BUFFER_LENGTH-1;
-            }
-
-            //simulate one cycle
-            delta_t = 1;
-            c += m_sid->clock(delta_t, b+c, samples-c, interleave);
-            count++;
-        }
-        //printf("count = %d\n", count);
-
-        //alternatively could simulate multiple cycles at once (TODO how much faster is this?)
-        //delta_t = 1000000*512/44100;
-        //m_sid->clock(delta_t, b, samples);
+        synthesize(b, len/sizeof(short), 1);
+#endif
+#if RESID_PROFILE
+        profileBuffer(renderStart, len);
 #endif
+        pthread_mutex_unlock(&mTuneMutex);
         return;
     }
 
+	pthread_mutex_lock(&mTuneMutex);
+
+	renderTune(buffer, len);
+
+	if (mFadeTune != NULL && mFadePosition < mFadeLength)
+		fadeOut(buffer, len);
+
+#if RESID_PROFILE
+	profileBuffer(renderStart, len);
+#endif
+
+	pthread_mutex_unlock(&mTuneMutex);
+}
+
+
+// ----------------------------------------------------------------------------
+template <class Sample> static void spreadChannels(const Sample* __restrict in, float* __restrict out, int numFrames, int numChannels, float scale)
+// ----------------------------------------------------------------------------
+{
+	// the usual channel counts get loops of their own the compiler vectorizes
+	switch (numChannels)
+	{
+		case 1:
+			for (int i = 0; i < numFrames; i++)
+				out[i] = in[i] * scale;
+			break;
+
+		case 2:
+			for (int i = 0; i < numFrames; i++)
+			{
+				float sample = in[i] * scale;
+				out[2 * i] = sample;
+				out[2 * i + 1] = sample;
+			}
+			break;
+
+		default:
+			for (int i = 0; i < numFrames; i++, out += numChannels)
+			{
+				float sample = in[i] * scale;
+				for (int channel = 0; channel < numChannels; channel++)
+					out[channel] = sample;
+			}
+			break;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+static void spreadStereo(const float* __restrict in, float* __restrict out, int numFrames, int numChannels)
+// ----------------------------------------------------------------------------
+{
+	// left on the even channels, right on the odd ones
+	for (int i = 0; i < numFrames; i++, in += 2, out += numChannels)
+	{
+		for (int channel = 0; channel < numChannels; channel++)
+			out[channel] = in[channel & 1];
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::fillBufferFloat(float* buffer, int numFrames, int numChannels)
+// ----------------------------------------------------------------------------
+{
+	if (mSynthBufferSize < numFrames)
+	{
+		delete[] mSynthBuffer;
+		delete[] mConvertBuffer;
+		mSynthBuffer = new float[numFrames * 2];
+		mConvertBuffer = new short[numFrames];
+		mSynthBufferSize = numFrames;
+	}
+
+	if (m_sid)
+	{
+#if RESID_PROFILE
+		unsigned long long renderStart = RESID::SID::profile_clock();
+#endif
+		pthread_mutex_lock(&mTuneMutex);
+		// mono and stereo are written by resid where they play
+		if (numChannels <= 2)
+			synthesize(buffer, numFrames, numChannels);
+		else
+			synthesize(mSynthBuffer, numFrames, 2);
+#if RESID_PROFILE
+		profileBuffer(renderStart, numFrames * sizeof(short));
+#endif
+		pthread_mutex_unlock(&mTuneMutex);
+
+		if (numChannels > 2)
+			spreadStereo(mSynthBuffer, buffer, numFrames, numChannels);
+		return;
+	}
+
+	// libsidplay2 mixes to 16 bits, converted while spreading the channels
+	fillBuffer(mConvertBuffer, numFrames * sizeof(short));
+	spreadChannels(mConvertBuffer, buffer, numFrames, numChannels, 1.0f / 32768.0f);
+}
+
+
+#if RESID_PROFILE
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::profileBuffer(unsigned long long startTicks, int len)
+// ----------------------------------------------------------------------------
+{
+	mProfile.renderTicks += RESID::SID::profile_clock() - startTicks;
+	mProfile.samples += len / sizeof(short);
+
+	if (mProfile.samples >= (long long) PROFILE_DUMP_SECONDS * mPlaybackSettings.mFrequency)
+	{
+		dumpProfile(stderr);
+		resetProfile();
+	}
+}
+#endif
+
+
+// ----------------------------------------------------------------------------
+bool PlayerLibSidplay::getProfile(sid_profile& outSidProfile, PlayerProfile& outPlayerProfile)
+// ----------------------------------------------------------------------------
+{
+	bool enabled = false;
+
+	if (m_sid != NULL)
+		enabled = m_sid->get_profile(outSidProfile);
+	else if (mBuilder != NULL)
+		enabled = mBuilder->profile(outSidProfile, false);
+	else
+		memset(&outSidProfile, 0, sizeof(outSidProfile));
+
+#if RESID_PROFILE
+	outPlayerProfile = mProfile;
+#else
+	outPlayerProfile = PlayerProfile();
+#endif
+
+	return enabled;
+}
+
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::resetProfile()
+// ----------------------------------------------------------------------------
+{
+	sid_profile sidProfile;
+
+	if (m_sid != NULL)
+		m_sid->reset_profile();
+	else if (mBuilder != NULL)
+		mBuilder->profile(sidProfile, true);
+
+#if RESID_PROFILE
+	mProfile = PlayerProfile();
+#endif
+}
+
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::dumpProfile(FILE* outFile)
+// ----------------------------------------------------------------------------
+{
+	sid_profile sidProfile;
+	PlayerProfile playerProfile;
+
+	if (!getProfile(sidProfile, playerProfile))
+	{
+		fprintf(outFile, "profile: resid is built without RESID_PROFILE\n");
+		return;
+	}
+
+	if (sidProfile.cycles == 0 || sidProfile.sampled_cycles == 0 || playerProfile.renderTicks == 0)
+		return;
+
+	// the stages are timed in a sample of the cycles, scale them up to all
+	// of them; every output sample is timed, resampling needs no scaling
+	double scale = (double) sidProfile.cycles / sidProfile.sampled_cycles;
+	double stageTicks = 0.0;
+	for (int stage = 0; stage < PROFILE_STAGES; stage++)
+		stageTicks += sidProfile.stage_ticks[stage] * scale;
+
+	double render = (double) playerProfile.renderTicks;
+	double sid = (double) sidProfile.block_ticks;
+	double resample = (double) sidProfile.resample_ticks;
+
+	fprintf(outFile, "profile: %.1fs audio, %llu SID cycles in %llu blocks, %.1f ticks/cycle\n",
+			(double) playerProfile.samples / mPlaybackSettings.mFrequency, sidProfile.cycles, sidProfile.blocks, sid / sidProfile.cycles);
+
+	for (int stage = 0; stage < PROFILE_STAGES; stage++)
+	{
+		double ticks = sidProfile.stage_ticks[stage] * scale;
+		fprintf(outFile, "  %-12s %7.2f ticks/cycle %5.1f%%\n", RESID::SID::profile_stage_name(stage),
+				ticks / sidProfile.cycles, 100.0 * ticks / render);
+	}
+
+	// tunes are sampled by the libsidplay2 mixer, that is part of c64 below
+	if (sidProfile.samples != 0)
+		fprintf(outFile, "  %-12s %7.2f ticks/cycle %5.1f%%, %.1f ticks/sample\n", "resample",
+				resample / sidProfile.cycles, 100.0 * resample / render, resample / sidProfile.samples);
+
+	// timing a cycle stage by stage slows it down, when the stages add up
+	// to more than the blocks took the difference is that overshoot
+	double rest = sid - stageTicks - resample;
+	fprintf(outFile, "  %-12s %7.2f ticks/cycle %5.1f%%%s\n", RESID::SID::profile_stage_name(PROFILE_STAGES),
+			rest / sidProfile.cycles, 100.0 * rest / render, rest < 0.0 ? " (stage timing overshoot)" : "");
+
+	if (m_sid != NULL)
+		fprintf(outFile, "  %-12s %7.2f ticks/cycle %5.1f%%\n  %-12s %7.2f ticks/cycle %5.1f%%\n",
+				"irq", playerProfile.irqTicks / (double) sidProfile.cycles, 100.0 * playerProfile.irqTicks / render,
+				"writes", playerProfile.writeTicks / (double) sidProfile.cycles, 100.0 * playerProfile.writeTicks / render);
+
+	// for tunes, the 6510 and chips around the SIDs and mixing them
+	double other = render - sid - playerProfile.irqTicks - playerProfile.writeTicks;
+	fprintf(outFile, "  %-12s %7.2f ticks/cycle %5.1f%%\n", m_sid != NULL ? "synth" : "c64",
+			other / sidProfile.cycles, 100.0 * other / render);
+}
+
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::renderTune(void* buffer, int len)
+// ----------------------------------------------------------------------------
+{
 	if (mSidEmuEngine == NULL)
 		return;
 	if (mPlaybackSettings.mOversampling == 1)
@@ -768,22 +1350,125 @@ void PlayerLibSidplay::fillBuffer(void* buffer, int len)
 	}
 }
 
+
 // ----------------------------------------------------------------------------
-void PlayerLibSidplay::sidRegisterFrameHasChanged(void* inInstance, SIDPLAY2_NAMESPACE::SidRegisterFrame& inRegisterFrame)
+void PlayerLibSidplay::fadeOut(void* buffer, int len)
 // ----------------------------------------------------------------------------
 {
-	/*
-	printf("Frame %d: ", inRegisterFrame.mTimeStamp);
+	// the previous tune keeps playing in its player, mixed with the one
+	// just switched to by a linear crossfade
+	int numSamples = len / sizeof(short);
 
-	for (int i = 0; i < SIDPLAY2_NAMESPACE::SidRegisterFrame::SID_REGISTER_COUNT; i++)
-		printf("%02x ", inRegisterFrame.mRegisters[i]);
-	
-	printf("\n");
-	*/
-	
+	if (mFadeBufferSize < numSamples)
+	{
+		delete[] mFadeBuffer;
+		mFadeBuffer = new short[numSamples];
+		mFadeBufferSize = numSamples;
+	}
+
+	memset(mFadeBuffer, 0, len);
+	mFadeTune->fillBuffer(mFadeBuffer, len);
+
+	short* outputBuffer = (short*) buffer;
+
+	for (int i = 0; i < numSamples && mFadePosition < mFadeLength; i++, mFadePosition++)
+	{
+		float gain = (float) mFadePosition / mFadeLength;
+		outputBuffer[i] = (short) (outputBuffer[i] * gain + mFadeBuffer[i] * (1.0f - gain));
+	}
+}
+
+// ----------------------------------------------------------------------------
+bool PlayerLibSidplay::seekToSample(long long sample)
+// ----------------------------------------------------------------------------
+{
+	// Position the tune so the next fillBuffer() continues at the given
+	// output sample of an uninterrupted playback.  The engine seeks without
+	// synthesis to half a second before it, keeping its sample clock, and
+	// the rest is rendered and dropped, which settles the filters (a tenth
+	// or two is not always enough for them to match bit for bit).
+	if (mSidEmuEngine == NULL || m_sid)
+		return false;
+
+	long long rate = (long long) mPlaybackSettings.mFrequency * mPlaybackSettings.mOversampling;
+	long long target = sample * mPlaybackSettings.mOversampling;
+	long long time = target * 10 / rate - 5;
+
+	if (mSidEmuEngine->seek(time > 0 ? (uint_least32_t) time : 0) < 0)
+		return false;
+
+	int bytesPerSample = mPlaybackSettings.mBits / 8;
+	char buffer[4096];
+	long long position = mSidEmuEngine->samples();
+
+	while (position < target)
+	{
+		long long count = target - position;
+		if (count > (long long) sizeof(buffer) / bytesPerSample)
+			count = sizeof(buffer) / bytesPerSample;
+
+		mSidEmuEngine->play(buffer, (uint_least32_t) count * bytesPerSample);
+
+		long long played = mSidEmuEngine->samples();
+		if (played == position)
+			return false;
+		position = played;
+	}
+
+	return position == target;
+}
+
+// ----------------------------------------------------------------------------
+bool PlayerLibSidplay::seekToTime(int tenths)
+// ----------------------------------------------------------------------------
+{
+	// Run the tune up to the given time (in tenths of a second) without
+	// synthesis, for analysing its register writes.  Returns false once
+	// the tune has stopped.
+	if (mSidEmuEngine == NULL || m_sid)
+		return false;
+
+	if (mSidEmuEngine->seek(tenths > 0 ? (uint_least32_t) tenths : 0) < 0)
+		return false;
+
+	return mSidEmuEngine->state() != sid2_stopped;
+}
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::enableRegisterLogging(bool inEnable)
+// ----------------------------------------------------------------------------
+{
+	// under the lock rendering holds, the trace is only ever written from
+	// the thread filling the buffers
+	pthread_mutex_lock(&mTuneMutex);
+
+	if (inEnable && mRegisterTrace == NULL)
+		mRegisterTrace = new SidRegisterTrace;
+
+	if (mRegisterTrace != NULL)
+	{
+		if (inEnable && !mRegisterLogging)
+			mRegisterTrace->resync(m_sid ? (unsigned int) m_cycleCounter : (mSidEmuEngine ? (unsigned int) mSidEmuEngine->cycles() : 0));
+		else if (!inEnable)
+			mRegisterTrace->flush();
+	}
+
+	mRegisterLogging = inEnable;
+
+	if (mSidEmuEngine != NULL)
+		mSidEmuEngine->setSidWriteCallback((void*) this, inEnable ? sidWritten : NULL);
+
+	pthread_mutex_unlock(&mTuneMutex);
+}
+
+
+// ----------------------------------------------------------------------------
+void PlayerLibSidplay::sidWritten(void* inInstance, event_clock_t inTime, int inSid, int inRegister, uint8_t inValue)
+// ----------------------------------------------------------------------------
+{
 	PlayerLibSidplay* player = (PlayerLibSidplay*) inInstance;
 	if (player != NULL)
-		player->mRegisterLog.push_back(inRegisterFrame);
+		player->mRegisterTrace->record((unsigned int) inTime, inSid, inRegister, inValue);
 }
 
 
@@ -7,9 +7,14 @@
 #include "resid-emu.h"
 
 #include "AudioDriver.h"
+#include <pthread.h>
 #include <ostream>
 #include <istream>
 #include <sstream>
+#include <string>
+
+class TuneCache;
+class SidRegisterTrace;
 
 enum SPFilterType
 {
@@ -22,9 +27,23 @@ enum SPFilterType
 };
 
 
+// time spent rendering, in the ticks of the resid stage profile (see
+// RESID_PROFILE in siddefs.h)
+struct PlayerProfile
+{
+	PlayerProfile() : renderTicks(0), irqTicks(0), writeTicks(0), samples(0) {}
+
+	unsigned long long	renderTicks;	// whole buffers, resid included
+	unsigned long long	irqTicks;		// synth mode playback IRQ
+	unsigned long long	writeTicks;		// synth mode register writes
+	long long			samples;
+};
+
+
 struct PlaybackSettings
 {
-    PlaybackSettings() : mFrequency(44100), mBits(16), mStereo(false), mOversampling(1), mSidModel(0), mForceSidModel(false), mClockSpeed(0), mOptimization(0), mOverrideCutoffCurve(false) {}
+    PlaybackSettings() : mFrequency(44100), mBits(16), mStereo(false), mOversampling(1), mSidModel(0), mForceSidModel(false), mClockSpeed(0), mOptimization(0), mOverrideCutoffCurve(false), mPowerOnDelay(-1),
+        mCpuEmulation(SID2_CPU_CYCLE), mEnvironment(sid2_envR), mLazyRaster(false), mLazyTimers(false), mKeyframeInterval(0) {}
 	int				mFrequency;
 	int				mBits;
 	int				mStereo;
@@ -35,6 +54,19 @@ struct PlaybackSettings
 	int				mClockSpeed;
 	int				mOptimization;
     bool            mOverrideCutoffCurve;
+    int             mPowerOnDelay;          // cycles, -1 for random
+
+    // speed ups for analysis and seeking, see sid2_config_t
+    sid2_cpu_t      mCpuEmulation;          // SID2_CPU_FAST runs PSIDs an instruction at a time
+    sid2_env_t      mEnvironment;           // of PSIDs, RSIDs always play in sid2_envR
+    bool            mLazyRaster;
+    bool            mLazyTimers;
+    int             mKeyframeInterval;      // seconds between seek keyframes, 0 for none
+
+    // "exact", "lazy" (VIC and CIAs only wake for what the tune sees) or
+    // "fast" (lazy and PSIDs an instruction at a time, in the sidplay1
+    // environment the fast 6510 needs), false for others
+    bool setEmulation(const char* name);
 };
 
 struct Instrument
@@ -84,6 +116,8 @@ struct Instrument
     unsigned int trebleboost_gain;      //8.8b
     unsigned int trebleboost_cutoff;    //16b
 
+    unsigned int stereo_spread;         //7b, voices panned from left to right
+
     void save(std::ostream& o)
     {
 #define SAVE(A) { o << #A" = " << A << std::endl; }
@@ -121,6 +155,7 @@ struct Instrument
         SAVE(trebleboost_en);
         SAVE(trebleboost_gain);
         SAVE(trebleboost_cutoff);
+        SAVE(stereo_spread);
 #undef SAVE
     }
 
@@ -178,13 +213,12 @@ struct Instrument
             LOAD(trebleboost_en);
             LOAD(trebleboost_gain);
             LOAD(trebleboost_cutoff);
+            LOAD(stereo_spread);
 #undef LOAD
         }
     }
 };
 
-typedef std::vector<SIDPLAY2_NAMESPACE::SidRegisterFrame> SidRegisterLog;
-
 const int TUNE_BUFFER_SIZE = 65536 + 2 + 0x7c;
 
 class PlayerLibSidplay
@@ -197,7 +231,13 @@ public:
 
 	void					setAudioDriver(AudioDriver* audioDriver);
 
+	// Tunes (and the next subtune) prepared by the cache are played by
+	// swapping them in between two buffers, without stopping the audio,
+	// fading the previous tune out over the given number of samples.
+	void					setTuneCache(TuneCache* tuneCache, int crossfadeSamples = 0);
+
 	void					initEmuEngine(PlaybackSettings *settings);
+	void					initSynthEngine(PlaybackSettings *settings);
 	void					updateSampleRate(int newSampleRate);
 	
 	bool					playTuneByPath(const char *filename, int subtune, PlaybackSettings *settings );
@@ -211,8 +251,25 @@ public:
 	bool					startSubtune(int which);
 	bool					initCurrentSubtune();
 
+	// Switch to the tune loaded by another player at the next buffer.  The
+	// other player is left with the previous tune and belongs to this one
+	// while that fades out.  Returns the player faded out by an earlier
+	// switch if still held, which belongs to the caller again.
+	PlayerLibSidplay*		adoptTune(PlayerLibSidplay* prepared, int fadeSamples);
+
+	// the player left with the previous tune once faded out, or NULL
+	PlayerLibSidplay*		releaseFadedTune();
+
 	void					fillBuffer(void* buffer, int len);
 
+	// renders numFrames frames of float samples, 1.0 full scale, copied to
+	// each of numChannels interleaved channels.  Synth patches are rendered
+	// by resid as floats, in stereo for two channels or more (the left one
+	// on even channels), tunes come from the 16 bit mixer.
+	void					fillBufferFloat(float* buffer, int numFrames, int numChannels);
+	bool					seekToSample(long long sample);
+	bool					seekToTime(int tenths);
+
 	inline int				getTempo()											{ return mCurrentTempo; }
 	void					setTempo(int tempo);
 
@@ -237,7 +294,8 @@ public:
 	inline unsigned short	getCurrentPlayAddress()								{ return mTuneInfo.playAddr; }
 	inline const char*		getCurrentFormat()									{ return mTuneInfo.formatString; }
 	inline int				getCurrentFileSize()								{ return mTuneInfo.dataFileLen; }
-	inline char*			getTuneBuffer(int& outTuneLength)					{ outTuneLength = mTuneLength; return mTuneBuffer; }
+	inline const char*		getTuneBuffer(int& outTuneLength)					{ outTuneLength = mTuneLength; return mTuneData; }
+	inline const char*		getTunePath()										{ return mTunePath.c_str(); }
 
 	inline const char* getCurrentChipModel()				
 	{
@@ -250,6 +308,11 @@ public:
 		return sChipModelUnspecified;
 	}
 
+	inline sid2_env_t getCurrentEnvironment()
+	{
+		return mSidEmuEngine != NULL ? mSidEmuEngine->info().environment : sid2_envR;
+	}
+
 	inline double getCurrentCpuClockRate()
 	{
 		if (mSidEmuEngine != NULL)
@@ -272,16 +335,24 @@ public:
 			return SIDPLAY2_NAMESPACE::SidRegisterFrame();
 	}
 
-	inline void enableRegisterLogging(bool inEnable)
+	// record every SID register write to the register trace, created on
+	// first use and kept until the player is gone, for a consumer thread
+	// to take the chunks from
+	void enableRegisterLogging(bool inEnable);
+	inline SidRegisterTrace* getRegisterTrace() const		{ return mRegisterTrace; }
+
+	// stage profile of the emulation since the last reset, false unless
+	// resid is built with RESID_PROFILE, which also dumps it to stderr
+	// every PROFILE_DUMP_SECONDS of audio
+	bool getProfile(sid_profile& outSidProfile, PlayerProfile& outPlayerProfile);
+	void resetProfile();
+	void dumpProfile(FILE* outFile);
+
+	inline void setRegisterFrameCallback(void* inInstance, SIDPLAY2_NAMESPACE::SidRegisterFrameChangedCallback inCallback)
 	{
 		if (mSidEmuEngine != NULL)
-			mSidEmuEngine->setRegisterFrameChangedCallback((void*) this, inEnable ? sidRegisterFrameHasChanged : NULL);
-		
-		if (inEnable)
-			mRegisterLog.clear();
+			mSidEmuEngine->setRegisterFrameChangedCallback(inInstance, inCallback);
 	}
-	
-	inline const SidRegisterLog& getRegisterLog() const		{ return mRegisterLog; }
 
     //synth mode
    	RESID::SID*     m_sid;
@@ -299,9 +370,10 @@ public:
     int             m_regWriteGet;
     Instrument      m_instruments[MAX_INSTRUMENTS];
     int             m_currentInstrument;
+    long long       m_cycleCounter;
     void            playbackIRQ();
 
-	static void sidRegisterFrameHasChanged(void* inInstance, SIDPLAY2_NAMESPACE::SidRegisterFrame& inRegisterFrame);
+	static void sidWritten(void* inInstance, event_clock_t inTime, int inSid, int inRegister, uint8_t inValue);
 
 	static const char*	sChipModel6581;
 	static const char*	sChipModel8580;
@@ -311,7 +383,16 @@ public:
 private:
 
 	bool initSIDTune(PlaybackSettings *settings);
+	void unloadTune();
 	void setupSIDInfo();
+	void applyFilterSettings();
+
+	bool switchToPreparedTune(const char* filename, int subtune, PlaybackSettings* settings);
+	void prepareNextSubtune();
+	void swapTune(PlayerLibSidplay& other);
+	void renderTune(void* buffer, int len);
+	void fadeOut(void* buffer, int len);
+	template <class Sample> void synthesize(Sample* buffer, int numFrames, int interleave);
 
 	sidplay2*			mSidEmuEngine;
 	SidTune*			mSidTune;
@@ -321,8 +402,14 @@ private:
 	
 	AudioDriver*		mAudioDriver;
 
-	char				mTuneBuffer[TUNE_BUFFER_SIZE];
+	// the file is mapped, or copied to the buffer when given in memory,
+	// and the SidTune parses it where it is
+	std::string			mTunePath;			// empty when given in memory
+	char*				mTuneBuffer;
+	const char*			mTuneData;
 	int					mTuneLength;
+	void*				mTuneMap;
+	size_t				mTuneMapSize;
 
 	int					mCurrentSubtune;
 	int					mSubtuneCount;
@@ -334,7 +421,31 @@ private:
 	
 	sid_filter_t		mFilterSettings;
 	
-	SidRegisterLog		mRegisterLog;
+	SidRegisterTrace*	mRegisterTrace;
+	bool				mRegisterLogging;
+
+	// held while rendering, switching tunes waits for the buffer in flight
+	pthread_mutex_t		mTuneMutex;
+	TuneCache*			mTuneCache;
+	int					mCrossfadeSamples;
+	PlayerLibSidplay*	mFadeTune;
+	int					mFadeLength;
+	int					mFadePosition;
+	short*				mFadeBuffer;
+	int					mFadeBufferSize;
+
+	// samples of fillBufferFloat before they are spread on the channels
+	float*				mSynthBuffer;		// stereo frames
+	short*				mConvertBuffer;
+	int					mSynthBufferSize;	// in frames
+
+#if RESID_PROFILE
+	static const int	PROFILE_DUMP_SECONDS = 10;
+
+	PlayerProfile		mProfile;
+
+	void profileBuffer(unsigned long long startTicks, int len);
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,171 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <string.h>
+#include <time.h>
+#include "RenderLoadMonitor.h"
+
+
+const double RenderLoadMonitor::MAX_LOAD = 2.0;
+const double RenderLoadMonitor::DEFAULT_NEAR_MISS_LOAD = 0.8;
+
+
+// ----------------------------------------------------------------------------
+RenderLoadMonitor::RenderLoadMonitor()
+// ----------------------------------------------------------------------------
+{
+	mNearMissLoad = DEFAULT_NEAR_MISS_LOAD;
+	mResetRequested = false;
+	clear();
+}
+
+
+// ----------------------------------------------------------------------------
+double RenderLoadMonitor::now()
+// ----------------------------------------------------------------------------
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1000000000.0;
+}
+
+
+// ----------------------------------------------------------------------------
+void RenderLoadMonitor::clear()
+// ----------------------------------------------------------------------------
+{
+	memset(mBins, 0, sizeof(mBins));
+	mNumNearMisses = 0;
+	mNumMisses = 0;
+	mWorstLoad = 0;
+	mLastLoad = 0;
+	mTotalLoad = 0;
+	__atomic_store_n(&mNumBuffers, 0, __ATOMIC_RELEASE);
+}
+
+
+// ----------------------------------------------------------------------------
+void RenderLoadMonitor::record(double startTime, double bufferSeconds)
+// ----------------------------------------------------------------------------
+{
+	double load = bufferSeconds > 0.0 ? (now() - startTime) / bufferSeconds : 0.0;
+
+	if (__atomic_load_n(&mResetRequested, __ATOMIC_ACQUIRE))
+	{
+		clear();
+		__atomic_store_n(&mResetRequested, false, __ATOMIC_RELEASE);
+	}
+
+	int bin = (int) (load * NUM_BINS / MAX_LOAD);
+	if (bin >= NUM_BINS)
+		bin = NUM_BINS - 1;
+	else if (bin < 0)
+		bin = 0;
+
+	int fixedLoad = load < 100000.0 ? (int) (load * 10000.0 + 0.5) : 1000000000;
+
+	// only this thread writes, the stores need not be read-modify-write
+	__atomic_store_n(&mBins[bin], mBins[bin] + 1, __ATOMIC_RELAXED);
+	if (load >= mNearMissLoad)
+		__atomic_store_n(&mNumNearMisses, mNumNearMisses + 1, __ATOMIC_RELAXED);
+	if (load >= 1.0)
+		__atomic_store_n(&mNumMisses, mNumMisses + 1, __ATOMIC_RELAXED);
+	if (fixedLoad > mWorstLoad)
+		__atomic_store_n(&mWorstLoad, fixedLoad, __ATOMIC_RELAXED);
+	__atomic_store_n(&mLastLoad, fixedLoad, __ATOMIC_RELAXED);
+	__atomic_store_n(&mTotalLoad, mTotalLoad + fixedLoad, __ATOMIC_RELAXED);
+	__atomic_store_n(&mNumBuffers, mNumBuffers + 1, __ATOMIC_RELEASE);
+}
+
+
+// ----------------------------------------------------------------------------
+void RenderLoadMonitor::reset()
+// ----------------------------------------------------------------------------
+{
+	__atomic_store_n(&mResetRequested, true, __ATOMIC_RELEASE);
+}
+
+
+// ----------------------------------------------------------------------------
+double RenderLoadMonitor::getAverageLoad() const
+// ----------------------------------------------------------------------------
+{
+	int numBuffers = getNumBuffers();
+	if (numBuffers == 0)
+		return 0.0;
+
+	return __atomic_load_n(&mTotalLoad, __ATOMIC_RELAXED) / 10000.0 / numBuffers;
+}
+
+
+// ----------------------------------------------------------------------------
+double RenderLoadMonitor::getPercentileLoad(double fraction) const
+// ----------------------------------------------------------------------------
+{
+	// the bins are read one by one while the audio thread goes on, the
+	// total is taken from them so the walk always ends inside
+	int counts[NUM_BINS];
+	long long total = 0;
+	for (int i = 0; i < NUM_BINS; i++)
+	{
+		counts[i] = __atomic_load_n(&mBins[i], __ATOMIC_RELAXED);
+		total += counts[i];
+	}
+
+	if (total == 0)
+		return 0.0;
+
+	long long wanted = (long long) (fraction * total + 0.5);
+	if (wanted < 1)
+		wanted = 1;
+
+	long long count = 0;
+	int bin = 0;
+	for (; bin < NUM_BINS - 1; bin++)
+	{
+		count += counts[bin];
+		if (count >= wanted)
+			break;
+	}
+
+	// the last bin is open ended, the worst load is its best upper bound
+	if (bin == NUM_BINS - 1)
+		return getWorstLoad();
+
+	return (bin + 1) * MAX_LOAD / NUM_BINS;
+}
+
+
+// ----------------------------------------------------------------------------
+void RenderLoadMonitor::format(char* outString, int size) const
+// ----------------------------------------------------------------------------
+{
+	snprintf(outString, size, "load %.0f%% avg %.0f%% p99 %.0f%% worst %.0f%%, %d near misses, %d late of %d buffers",
+			 getLastLoad() * 100.0, getAverageLoad() * 100.0, getPercentileLoad(0.99) * 100.0, getWorstLoad() * 100.0,
+			 getNumNearMisses(), getNumMisses(), getNumBuffers());
+}
+
+
+// ----------------------------------------------------------------------------
+void RenderLoadMonitor::print(FILE* outFile) const
+// ----------------------------------------------------------------------------
+{
+	char line[256];
+	format(line, sizeof(line));
+	fprintf(outFile, "%s\n", line);
+}
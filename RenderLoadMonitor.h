@@ -0,0 +1,83 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef _RENDERLOADMONITOR_H_
+#define _RENDERLOADMONITOR_H_
+
+#include <stdio.h>
+
+
+// Times the rendering of every audio buffer against the time the buffer
+// lasts, its load (1.0 renders just in time, above that the output runs
+// dry), in a histogram of 1% bins up to MAX_LOAD.  The audio thread
+// records, any other thread reads the counters without locking: every
+// counter has the audio thread as its only writer, and reset() is only a
+// request the audio thread carries out before its next buffer.
+class RenderLoadMonitor
+{
+public:
+
+	static const int	NUM_BINS = 200;			// the last one also takes everything above
+	static const double	MAX_LOAD;
+	static const double	DEFAULT_NEAR_MISS_LOAD;
+
+	RenderLoadMonitor();
+
+	// seconds on a monotonic clock, taken before rendering a buffer
+	static double now();
+
+	// audio thread, once the buffer is rendered
+	void record(double startTime, double bufferSeconds);
+
+	// any thread
+	void reset();
+	inline void setNearMissLoad(double load)							{ mNearMissLoad = load; }
+
+	inline int getNumBuffers() const									{ return __atomic_load_n(&mNumBuffers, __ATOMIC_ACQUIRE); }
+	inline int getNumNearMisses() const									{ return __atomic_load_n(&mNumNearMisses, __ATOMIC_RELAXED); }
+	inline int getNumMisses() const										{ return __atomic_load_n(&mNumMisses, __ATOMIC_RELAXED); }
+	inline double getWorstLoad() const									{ return __atomic_load_n(&mWorstLoad, __ATOMIC_RELAXED) / 10000.0; }
+	inline double getLastLoad() const									{ return __atomic_load_n(&mLastLoad, __ATOMIC_RELAXED) / 10000.0; }
+	double getAverageLoad() const;
+
+	// upper edge of the bin where the given fraction of the buffers is
+	// reached, e.g. 0.99 for the load 99% of them stay under
+	double getPercentileLoad(double fraction) const;
+
+	// one line summary, for the display and the log
+	void format(char* outString, int size) const;
+	void print(FILE* outFile) const;
+
+private:
+
+	void clear();
+
+	// loads are kept in 1/10000ths so they can be updated atomically
+	int					mBins[NUM_BINS];
+	int					mNumBuffers;
+	int					mNumNearMisses;		// at or above the near miss load
+	int					mNumMisses;			// at or above 1.0
+	int					mWorstLoad;
+	int					mLastLoad;
+	long long			mTotalLoad;
+	double				mNearMissLoad;
+	bool				mResetRequested;
+};
+
+
+#endif // _RENDERLOADMONITOR_H_
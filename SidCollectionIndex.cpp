@@ -0,0 +1,409 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "SongLengthAnalyzer.h"
+#include "SidCollectionIndex.h"
+
+
+struct SidIndexHeader
+{
+	uint32_t            magic;
+	uint32_t            version;
+	uint32_t            entrySize;
+	uint32_t            count;
+	uint32_t            stringsSize;
+	uint32_t            reserved[3];
+};
+
+static const uint32_t   sIndexMagic   = 0x58444953;    // "SIDX"
+static const uint32_t   sIndexVersion = 1;
+
+
+struct IndexedTune
+{
+	SidIndexEntry       entry;
+	std::string         title;
+	std::string         author;
+	std::string         released;
+	bool                valid;
+};
+
+struct IndexBuild
+{
+	std::string                 root;
+	std::vector<std::string>    paths;
+	std::vector<IndexedTune>    tunes;
+	int                         next;
+	pthread_mutex_t             mutex;
+};
+
+
+static inline uint16_t bigEndian16(const unsigned char* p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+
+static std::string headerString(const unsigned char* p)
+{
+	// 32 bytes, not terminated when full
+	int length = 0;
+	while (length < 32 && p[length])
+		length++;
+	return std::string((const char*)p, length);
+}
+
+
+static void findTunes(const std::string& root, const std::string& dir, std::vector<std::string>& paths)
+{
+	DIR* d = opendir((root + "/" + dir).c_str());
+	if (d == NULL)
+		return;
+
+	while (dirent* e = readdir(d))
+	{
+		const char* name = e->d_name;
+		if (name[0] == '.')
+			continue;
+
+		std::string path = dir.empty() ? std::string(name) : dir + "/" + name;
+		struct stat st;
+		if (stat((root + "/" + path).c_str(), &st) != 0)
+			continue;
+
+		size_t length = strlen(name);
+		if (S_ISDIR(st.st_mode))
+			findTunes(root, path, paths);
+		else if (S_ISREG(st.st_mode) && length > 4 && strcasecmp(name + length - 4, ".sid") == 0)
+			paths.push_back(path);
+	}
+
+	closedir(d);
+}
+
+
+static bool parseTune(const unsigned char* data, int length, IndexedTune& tune)
+{
+	// PSID/RSID header, the fields SidTune::PSID_fileSupport reads
+	if (length < 0x76 || (memcmp(data, "PSID", 4) != 0 && memcmp(data, "RSID", 4) != 0))
+		return false;
+
+	int version = bigEndian16(data + 4);
+	int dataOffset = bigEndian16(data + 6);
+	if (dataOffset < 0x76 || dataOffset > length)
+		return false;
+
+	SidIndexEntry& entry = tune.entry;
+	entry.rsid = data[0] == 'R';
+	entry.loadAddr = bigEndian16(data + 8);
+	entry.initAddr = bigEndian16(data + 10);
+	entry.playAddr = bigEndian16(data + 12);
+	entry.songs = bigEndian16(data + 14);
+	entry.startSong = bigEndian16(data + 16);
+	entry.clock = SIDTUNE_CLOCK_UNKNOWN;
+	entry.sidModel = SIDTUNE_SIDMODEL_UNKNOWN;
+
+	// the load address may be in front of the data instead
+	if (entry.loadAddr == 0 && dataOffset + 2 <= length)
+		entry.loadAddr = (uint16_t)(data[dataOffset] | (data[dataOffset + 1] << 8));
+
+	if (version >= 2 && dataOffset >= 0x7c)
+	{
+		int flags = bigEndian16(data + 0x76);
+		entry.clock = (uint8_t)((flags >> 2) & 3);
+		entry.sidModel = (uint8_t)((flags >> 4) & 3);
+	}
+
+	tune.title = headerString(data + 0x16);
+	tune.author = headerString(data + 0x36);
+	tune.released = headerString(data + 0x56);
+	return true;
+}
+
+
+static void* indexThread(void* inClientData)
+{
+	IndexBuild& build = *reinterpret_cast<IndexBuild*>(inClientData);
+	char* buffer = new char[TUNE_BUFFER_SIZE];
+
+	for (;;)
+	{
+		pthread_mutex_lock(&build.mutex);
+		int i = build.next++;
+		pthread_mutex_unlock(&build.mutex);
+
+		if (i >= (int)build.paths.size())
+			break;
+
+		IndexedTune& tune = build.tunes[i];
+		FILE* fp = fopen((build.root + "/" + build.paths[i]).c_str(), "rb");
+		if (fp == NULL)
+			continue;
+
+		int length = (int)fread(buffer, 1, TUNE_BUFFER_SIZE, fp);
+		fclose(fp);
+
+		tune.valid = parseTune((const unsigned char*)buffer, length, tune);
+		if (!tune.valid)
+			continue;
+
+		tune.entry.fileSize = length;
+
+		std::string hash = SongLengthAnalyzer::tuneHash(buffer, length);
+		for (int b = 0; b < 16; b++)
+			tune.entry.hash[b] = (uint8_t)strtol(hash.substr(b * 2, 2).c_str(), NULL, 16);
+	}
+
+	delete[] buffer;
+	return NULL;
+}
+
+
+static uint32_t addString(std::string& strings, std::map<std::string, uint32_t>& offsets, const std::string& s)
+{
+	// authors and release strings repeat a lot, store them once
+	std::map<std::string, uint32_t>::iterator i = offsets.find(s);
+	if (i != offsets.end())
+		return i->second;
+
+	uint32_t offset = (uint32_t)strings.size();
+	strings.append(s.c_str(), s.size() + 1);
+	offsets[s] = offset;
+	return offset;
+}
+
+
+static bool containsNoCase(const char* haystack, const char* needle)
+{
+	for (; *haystack; haystack++)
+	{
+		int i = 0;
+		while (needle[i] && tolower((unsigned char)haystack[i]) == tolower((unsigned char)needle[i]))
+			i++;
+		if (needle[i] == '\0')
+			return true;
+	}
+	return needle[0] == '\0';
+}
+
+
+// ----------------------------------------------------------------------------
+SidCollectionIndex::SidCollectionIndex()
+// ----------------------------------------------------------------------------
+{
+	mMap = NULL;
+	mMapSize = 0;
+	mEntries = NULL;
+	mStrings = NULL;
+	mCount = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+SidCollectionIndex::~SidCollectionIndex()
+// ----------------------------------------------------------------------------
+{
+	close();
+}
+
+
+// ----------------------------------------------------------------------------
+int SidCollectionIndex::build(const char* root, const char* indexPath, int numThreads)
+// ----------------------------------------------------------------------------
+{
+	IndexBuild build;
+	build.root = root;
+	build.next = 0;
+	pthread_mutex_init(&build.mutex, NULL);
+
+	// sorted for looking paths up by bisection
+	findTunes(build.root, "", build.paths);
+	std::sort(build.paths.begin(), build.paths.end());
+
+	IndexedTune empty;
+	memset(&empty.entry, 0, sizeof(empty.entry));
+	empty.valid = false;
+	build.tunes.resize(build.paths.size(), empty);
+
+	if (numThreads < 1)
+		numThreads = 1;
+
+	pthread_t* threads = new pthread_t[numThreads];
+	for (int i = 0; i < numThreads; i++)
+		pthread_create(&threads[i], NULL, indexThread, (void*)&build);
+	for (int i = 0; i < numThreads; i++)
+		pthread_join(threads[i], NULL);
+	delete[] threads;
+
+	pthread_mutex_destroy(&build.mutex);
+
+	std::vector<SidIndexEntry> entries;
+	std::map<std::string, uint32_t> offsets;
+	std::string strings;
+
+	for (size_t i = 0; i < build.tunes.size(); i++)
+	{
+		IndexedTune& tune = build.tunes[i];
+		if (!tune.valid)
+			continue;
+
+		tune.entry.path = addString(strings, offsets, build.paths[i]);
+		tune.entry.title = addString(strings, offsets, tune.title);
+		tune.entry.author = addString(strings, offsets, tune.author);
+		tune.entry.released = addString(strings, offsets, tune.released);
+		entries.push_back(tune.entry);
+	}
+
+	SidIndexHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = sIndexMagic;
+	header.version = sIndexVersion;
+	header.entrySize = sizeof(SidIndexEntry);
+	header.count = (uint32_t)entries.size();
+	header.stringsSize = (uint32_t)strings.size();
+
+	FILE* fp = fopen(indexPath, "wb");
+	if (fp == NULL)
+		return -1;
+
+	bool success = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+				   (entries.empty() || fwrite(&entries[0], sizeof(SidIndexEntry), entries.size(), fp) == entries.size()) &&
+				   (strings.empty() || fwrite(strings.data(), strings.size(), 1, fp) == 1);
+
+	if (fclose(fp) != 0 || !success)
+		return -1;
+
+	return (int)entries.size();
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidCollectionIndex::open(const char* indexPath)
+// ----------------------------------------------------------------------------
+{
+	close();
+
+	int fd = ::open(indexPath, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SidIndexHeader))
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (map == MAP_FAILED)
+		return false;
+
+	const SidIndexHeader* header = (const SidIndexHeader*)map;
+	size_t entriesSize = (size_t)header->count * sizeof(SidIndexEntry);
+	size_t size = sizeof(SidIndexHeader) + entriesSize + header->stringsSize;
+	const char* strings = (const char*)map + sizeof(SidIndexHeader) + entriesSize;
+
+	if (header->magic != sIndexMagic || header->version != sIndexVersion ||
+		header->entrySize != sizeof(SidIndexEntry) || size != (size_t)st.st_size ||
+		(header->stringsSize > 0 && strings[header->stringsSize - 1] != '\0'))
+	{
+		munmap(map, st.st_size);
+		return false;
+	}
+
+	mMap = map;
+	mMapSize = st.st_size;
+	mEntries = (const SidIndexEntry*)((const char*)map + sizeof(SidIndexHeader));
+	mStrings = strings;
+	mCount = header->count;
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void SidCollectionIndex::close()
+// ----------------------------------------------------------------------------
+{
+	if (mMap != NULL)
+		munmap(mMap, mMapSize);
+
+	mMap = NULL;
+	mMapSize = 0;
+	mEntries = NULL;
+	mStrings = NULL;
+	mCount = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+int SidCollectionIndex::findPath(const char* path)
+// ----------------------------------------------------------------------------
+{
+	int low = 0;
+	int high = mCount - 1;
+
+	while (low <= high)
+	{
+		int middle = (low + high) / 2;
+		int order = strcmp(getString(mEntries[middle].path), path);
+
+		if (order == 0)
+			return middle;
+		if (order < 0)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+
+	return -1;
+}
+
+
+// ----------------------------------------------------------------------------
+int SidCollectionIndex::search(const char* text, int from)
+// ----------------------------------------------------------------------------
+{
+	for (int i = from < 0 ? 0 : from; i < mCount; i++)
+	{
+		const SidIndexEntry& entry = mEntries[i];
+
+		if (containsNoCase(getString(entry.title), text) ||
+			containsNoCase(getString(entry.author), text) ||
+			containsNoCase(getString(entry.path), text))
+			return i;
+	}
+
+	return -1;
+}
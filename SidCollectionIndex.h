@@ -0,0 +1,89 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef _SIDCOLLECTIONINDEX_H_
+#define _SIDCOLLECTIONINDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// One tune of the index, strings are offsets into the string table.
+struct SidIndexEntry
+{
+	uint32_t            path;           // relative to the collection root
+	uint32_t            title;
+	uint32_t            author;
+	uint32_t            released;
+	uint8_t             hash[16];       // MD5 of the file, as in Songlengths.md5
+	uint32_t            fileSize;
+	uint16_t            loadAddr;
+	uint16_t            initAddr;
+	uint16_t            playAddr;
+	uint16_t            songs;
+	uint16_t            startSong;
+	uint8_t             rsid;
+	uint8_t             clock;          // SIDTUNE_CLOCK_*
+	uint8_t             sidModel;       // SIDTUNE_SIDMODEL_*
+	uint8_t             reserved[3];
+};
+
+
+// Index of the .sid files of a collection (HVSC), built once from the
+// PSID/RSID headers of the files and then mapped read only, so listing
+// and searching the collection does not open a single tune.  The file
+// is a header, the entries sorted by path and a string table, in host
+// byte order.
+class SidCollectionIndex
+{
+public:
+
+	SidCollectionIndex();
+	~SidCollectionIndex();
+
+	// Scans root for .sid files and parses them on numThreads threads.
+	// Returns the number of tunes indexed, -1 if the index could not
+	// be written.
+	static int build(const char* root, const char* indexPath, int numThreads);
+
+	bool open(const char* indexPath);
+	void close();
+
+	inline bool isOpen()												{ return mMap != NULL; }
+	inline int getCount()												{ return mCount; }
+	inline const SidIndexEntry& getEntry(int i)							{ return mEntries[i]; }
+	inline const char* getString(uint32_t offset)						{ return mStrings + offset; }
+
+	// entry of a path relative to the root, -1 if not indexed
+	int findPath(const char* path);
+
+	// next entry from the given one whose path, title or author
+	// contains the text (ignoring case), -1 if none
+	int search(const char* text, int from);
+
+private:
+
+	void*                       mMap;
+	size_t                      mMapSize;
+	const SidIndexEntry*        mEntries;
+	const char*                 mStrings;
+	int                         mCount;
+};
+
+
+#endif // _SIDCOLLECTIONINDEX_H_
@@ -0,0 +1,267 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <stdio.h>
+#include "SidRegisterTrace.h"
+
+
+// room left for the longest write: 5 bytes of cycles, 5 of SID index,
+// 3 of register and the value
+static const int sMaxWriteSize = 14;
+
+
+// ----------------------------------------------------------------------------
+static inline unsigned char* putNumber(unsigned char* data, unsigned long long value)
+// ----------------------------------------------------------------------------
+{
+	while (value >= 0x80)
+	{
+		*data++ = (unsigned char) (value | 0x80);
+		value >>= 7;
+	}
+	*data++ = (unsigned char) value;
+	return data;
+}
+
+
+// ----------------------------------------------------------------------------
+static inline const unsigned char* getNumber(const unsigned char* data, const unsigned char* end, unsigned long long& value)
+// ----------------------------------------------------------------------------
+{
+	value = 0;
+	for (int shift = 0; data < end && shift < 64; shift += 7)
+	{
+		unsigned char byte = *data++;
+		value |= (unsigned long long) (byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return data;
+	}
+	return NULL;
+}
+
+
+// ----------------------------------------------------------------------------
+SidRegisterTrace::SidRegisterTrace(int numChunks)
+// ----------------------------------------------------------------------------
+{
+	mNumChunks = numChunks > 1 ? numChunks : 2;
+	mArena = new SidTraceChunk[mNumChunks];
+
+	// one slot more than chunks, so neither ring is ever full
+	Ring* rings[2] = { &mFull, &mFree };
+	for (int i = 0; i < 2; i++)
+	{
+		rings[i]->size = mNumChunks + 1;
+		rings[i]->slots = new SidTraceChunk*[mNumChunks + 1];
+		rings[i]->head = 0;
+		rings[i]->tail = 0;
+	}
+
+	for (int i = 0; i < mNumChunks; i++)
+		push(mFree, &mArena[i]);
+
+	mChunk = NULL;
+	mTime = 0;
+	mLastClock = 0;
+	mHasClock = false;
+	mSid = 0;
+	mNumDropped = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+SidRegisterTrace::~SidRegisterTrace()
+// ----------------------------------------------------------------------------
+{
+	delete[] mFull.slots;
+	delete[] mFree.slots;
+	delete[] mArena;
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidRegisterTrace::push(Ring& ring, SidTraceChunk* chunk)
+// ----------------------------------------------------------------------------
+{
+	int head = ring.head;
+	int next = head + 1 < ring.size ? head + 1 : 0;
+
+	if (next == __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE))
+		return false;
+
+	ring.slots[head] = chunk;
+	__atomic_store_n(&ring.head, next, __ATOMIC_RELEASE);
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+SidTraceChunk* SidRegisterTrace::pop(Ring& ring)
+// ----------------------------------------------------------------------------
+{
+	int tail = ring.tail;
+
+	if (tail == __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	SidTraceChunk* chunk = ring.slots[tail];
+	__atomic_store_n(&ring.tail, tail + 1 < ring.size ? tail + 1 : 0, __ATOMIC_RELEASE);
+	return chunk;
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidRegisterTrace::startChunk()
+// ----------------------------------------------------------------------------
+{
+	mChunk = pop(mFree);
+	if (mChunk == NULL)
+		return false;
+
+	mChunk->mStartTime = mTime;
+	mChunk->mStartSid = mSid;
+	mChunk->mNumBytes = 0;
+	mChunk->mNumWrites = 0;
+	mChunk->mReserved = 0;
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void SidRegisterTrace::record(unsigned int clock, int sid, int reg, int value)
+// ----------------------------------------------------------------------------
+{
+	// differences of the 32 bit clock survive it wrapping, going back
+	// (more than half the range ahead) is the engine restarting it
+	unsigned int delta = mHasClock ? clock - mLastClock : 0;
+	long long time = mTime + (delta < 0x80000000u ? delta : 0);
+	mLastClock = clock;
+	mHasClock = true;
+
+	if (mChunk != NULL && mChunk->mNumBytes > SidTraceChunk::DATA_SIZE - sMaxWriteSize)
+		flush();
+
+	if (mChunk == NULL && !startChunk())
+	{
+		// the time moves on, the next chunk starts where it should
+		mTime = time;
+		__atomic_store_n(&mNumDropped, mNumDropped + 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	bool sidChanged = sid != mSid;
+	unsigned char* data = mChunk->mData + mChunk->mNumBytes;
+
+	data = putNumber(data, ((unsigned long long) (time - mTime) << 1) | (sidChanged ? 1 : 0));
+	if (sidChanged)
+		data = putNumber(data, (unsigned int) sid);
+	data = putNumber(data, (unsigned int) reg);
+	*data++ = (unsigned char) value;
+
+	mChunk->mNumBytes = (int) (data - mChunk->mData);
+	mChunk->mNumWrites++;
+	mTime = time;
+	mSid = sid;
+}
+
+
+// ----------------------------------------------------------------------------
+void SidRegisterTrace::flush()
+// ----------------------------------------------------------------------------
+{
+	if (mChunk == NULL || mChunk->mNumWrites == 0)
+		return;
+
+	// the full ring has room for every chunk
+	push(mFull, mChunk);
+	mChunk = NULL;
+}
+
+
+// ----------------------------------------------------------------------------
+void SidRegisterTrace::resync(unsigned int clock)
+// ----------------------------------------------------------------------------
+{
+	// the time of the last write goes on from here
+	mLastClock = clock;
+	mHasClock = true;
+}
+
+
+// ----------------------------------------------------------------------------
+const SidTraceChunk* SidRegisterTrace::takeChunk()
+// ----------------------------------------------------------------------------
+{
+	return pop(mFull);
+}
+
+
+// ----------------------------------------------------------------------------
+void SidRegisterTrace::recycleChunk(const SidTraceChunk* chunk)
+// ----------------------------------------------------------------------------
+{
+	if (chunk != NULL)
+		push(mFree, const_cast<SidTraceChunk*>(chunk));
+}
+
+
+// ----------------------------------------------------------------------------
+long long SidRegisterTrace::getNumDropped() const
+// ----------------------------------------------------------------------------
+{
+	return __atomic_load_n(&mNumDropped, __ATOMIC_RELAXED);
+}
+
+
+// ----------------------------------------------------------------------------
+SidRegisterTrace::Reader::Reader(const SidTraceChunk* chunk)
+// ----------------------------------------------------------------------------
+{
+	mData = chunk ? chunk->mData : NULL;
+	mEnd = chunk ? chunk->mData + chunk->mNumBytes : NULL;
+	mTime = chunk ? chunk->mStartTime : 0;
+	mSid = chunk ? chunk->mStartSid : 0;
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidRegisterTrace::Reader::next(SidRegisterWrite& write)
+// ----------------------------------------------------------------------------
+{
+	unsigned long long delta, sid, reg;
+
+	if (mData >= mEnd || (mData = getNumber(mData, mEnd, delta)) == NULL)
+		return false;
+
+	if ((delta & 1) && (mData = getNumber(mData, mEnd, sid)) != NULL)
+		mSid = (int) sid;
+
+	if (mData == NULL || (mData = getNumber(mData, mEnd, reg)) == NULL || mData >= mEnd)
+	{
+		mData = mEnd;
+		return false;
+	}
+
+	mTime += (long long) (delta >> 1);
+
+	write.mTime = mTime;
+	write.mSid = mSid;
+	write.mRegister = (int) reg;
+	write.mValue = *mData++;
+	return true;
+}
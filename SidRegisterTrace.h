@@ -0,0 +1,127 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef _SIDREGISTERTRACE_H_
+#define _SIDREGISTERTRACE_H_
+
+#include <stddef.h>
+
+
+// One block of a register trace.  The writes are coded from the start of
+// the chunk, so every chunk decodes on its own: per write the cycles since
+// the previous one (shifted left, the low bit set when the SID index
+// changes), the SID index if it did, the register and the value, all but
+// the value as variable length numbers of 7 bits per byte, low first.
+// A write to one of the first 0x80 registers a cycle or so after the
+// previous one on the same SID takes 3 bytes.
+struct SidTraceChunk
+{
+	static const int DATA_SIZE = 1024 - 24;
+
+	long long           mStartTime;     // cycles, first write is coded from it
+	int                 mNumBytes;
+	int                 mNumWrites;
+	int                 mStartSid;
+	int                 mReserved;
+	unsigned char       mData[DATA_SIZE];
+};
+
+struct SidRegisterWrite
+{
+	long long           mTime;          // cycles since the trace started
+	int                 mSid;
+	int                 mRegister;
+	int                 mValue;
+};
+
+
+// Records the SID register writes of the emulation, at the cycle they
+// happen, in chunks of an arena allocated up front.  The emulation thread
+// records, and hands full chunks to a consumer thread through a ring
+// without locking, which gives them back once done with them.  Recording
+// never allocates or waits: when the consumer falls behind and no chunk
+// is free the writes are counted as dropped.
+class SidRegisterTrace
+{
+public:
+
+	static const int DEFAULT_NUM_CHUNKS = 256;
+
+	SidRegisterTrace(int numChunks = DEFAULT_NUM_CHUNKS);
+	~SidRegisterTrace();
+
+	// producer (emulation thread): clock is the emulation's cycle
+	// counter, which may wrap at 32 bits
+	void record(unsigned int clock, int sid, int reg, int value);
+	void flush();                           // hand over the chunk being filled
+	void resync(unsigned int clock);        // the clock goes on from a new engine, now at clock
+	inline long long getTime() const		{ return mTime; }
+
+	// consumer: chunks in the order recorded, NULL when there are none
+	const SidTraceChunk* takeChunk();
+	void recycleChunk(const SidTraceChunk* chunk);
+
+	// writes lost since the trace was created, for lack of a free chunk
+	long long getNumDropped() const;
+
+	// decodes the writes of a chunk one by one
+	class Reader
+	{
+	public:
+		Reader(const SidTraceChunk* chunk = NULL);
+		bool next(SidRegisterWrite& write);
+
+	private:
+		const unsigned char* mData;
+		const unsigned char* mEnd;
+		long long           mTime;
+		int                 mSid;
+	};
+
+private:
+
+	// single producer, single consumer ring of chunks
+	struct Ring
+	{
+		SidTraceChunk**     slots;
+		int                 size;
+		int                 head;           // written by the producer
+		int                 tail;           // written by the consumer
+	};
+
+	static bool push(Ring& ring, SidTraceChunk* chunk);
+	static SidTraceChunk* pop(Ring& ring);
+
+	bool startChunk();
+
+	SidTraceChunk*      mArena;
+	int                 mNumChunks;
+	Ring                mFull;
+	Ring                mFree;
+
+	// producer state
+	SidTraceChunk*      mChunk;         // NULL when none was free
+	long long           mTime;
+	unsigned int        mLastClock;
+	bool                mHasClock;
+	int                 mSid;
+	long long           mNumDropped;
+};
+
+
+#endif // _SIDREGISTERTRACE_H_
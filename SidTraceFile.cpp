@@ -0,0 +1,590 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "SidTraceFile.h"
+
+
+static const char sTraceMagic[8] = { 'S', 'I', 'D', 'T', 'R', 'A', 'C', 'E' };
+static const uint32_t sTraceVersion = 1;
+
+// lengths of the copies in compressed chunks
+static const int sMinMatch = 3;
+static const int sMaxMatch = 0xff - 0x7d;
+static const int sMaxLiterals = 0x80;
+
+
+// ----------------------------------------------------------------------------
+SidTraceWriter::SidTraceWriter()
+// ----------------------------------------------------------------------------
+{
+	mFile = NULL;
+	mCompress = false;
+	mFailed = false;
+	memset(&mHeader, 0, sizeof(mHeader));
+}
+
+
+// ----------------------------------------------------------------------------
+SidTraceWriter::~SidTraceWriter()
+// ----------------------------------------------------------------------------
+{
+	if (mFile)
+		fclose(mFile);
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidTraceWriter::open(const char* path, double clockFreq, int sidModel, uint32_t flags, bool compress)
+// ----------------------------------------------------------------------------
+{
+	if (mFile)
+		return false;
+
+	mFile = fopen(path, "wb");
+	if (mFile == NULL)
+		return false;
+
+	memset(&mHeader, 0, sizeof(mHeader));
+	memcpy(mHeader.magic, sTraceMagic, sizeof(mHeader.magic));
+	mHeader.version = sTraceVersion;
+	mHeader.flags = flags;
+	mHeader.clockFreq = clockFreq;
+	mHeader.sidModel = sidModel;
+	mHeader.indexOffset = sizeof(SidTraceHeader);
+
+	mIndex.clear();
+	mCompress = compress;
+
+	// the header is written again once the index is
+	mFailed = fwrite(&mHeader, sizeof(mHeader), 1, mFile) != 1;
+	return !mFailed;
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidTraceWriter::write(const SidTraceChunk* chunk)
+// ----------------------------------------------------------------------------
+{
+	if (mFile == NULL || mFailed)
+		return false;
+
+	if (chunk->mNumWrites == 0)
+		return true;
+
+	SidRegisterTrace::Reader reader(chunk);
+	SidRegisterWrite write;
+	while (reader.next(write))
+	{
+		if ((uint32_t)write.mSid >= mHeader.numSids)
+			mHeader.numSids = write.mSid + 1;
+	}
+
+	SidTraceIndexEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.startTime = chunk->mStartTime;
+	entry.offset = mHeader.indexOffset;
+	entry.dataSize = chunk->mNumBytes;
+	entry.numWrites = chunk->mNumWrites;
+	entry.startSid = chunk->mStartSid;
+
+	unsigned char packed[SidTraceChunk::DATA_SIZE];
+	int packedSize = mCompress ? SidTraceReplay::compress(chunk->mData, chunk->mNumBytes, packed, chunk->mNumBytes - 1) : 0;
+
+	if (packedSize > 0)
+	{
+		entry.compression = SIDTRACE_COMPRESSION_LZ;
+		entry.storedSize = packedSize;
+		mFailed = fwrite(packed, packedSize, 1, mFile) != 1;
+	}
+	else
+	{
+		entry.compression = SIDTRACE_COMPRESSION_NONE;
+		entry.storedSize = chunk->mNumBytes;
+		mFailed = fwrite(chunk->mData, chunk->mNumBytes, 1, mFile) != 1;
+	}
+
+	mIndex.push_back(entry);
+	mHeader.indexOffset += entry.storedSize;
+	mHeader.numWrites += entry.numWrites;
+	return !mFailed;
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidTraceWriter::close(long long duration)
+// ----------------------------------------------------------------------------
+{
+	if (mFile == NULL)
+		return false;
+
+	mHeader.duration = duration > 0 ? duration : 0;
+	mHeader.numChunks = (uint32_t)mIndex.size();
+
+	if (!mFailed && !mIndex.empty())
+		mFailed = fwrite(&mIndex[0], sizeof(SidTraceIndexEntry), mIndex.size(), mFile) != mIndex.size();
+
+	if (!mFailed)
+		mFailed = fseek(mFile, 0, SEEK_SET) != 0 || fwrite(&mHeader, sizeof(mHeader), 1, mFile) != 1;
+
+	if (fclose(mFile) != 0)
+		mFailed = true;
+	mFile = NULL;
+
+	return !mFailed;
+}
+
+
+// ----------------------------------------------------------------------------
+SidTraceReplay::SidTraceReplay()
+// ----------------------------------------------------------------------------
+{
+	mMap = NULL;
+	mMapSize = 0;
+	mHeader = NULL;
+	mIndex = NULL;
+
+	for (int i = 0; i < MAX_SIDS; i++)
+		mSids[i] = NULL;
+	mNumSids = 0;
+	mMixBuffer = NULL;
+	mMixBufferSize = 0;
+
+	memset(&mChunk, 0, sizeof(mChunk));
+	mNextChunk = 0;
+	mHasWrite = false;
+	mTime = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+SidTraceReplay::~SidTraceReplay()
+// ----------------------------------------------------------------------------
+{
+	close();
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidTraceReplay::open(const char* path)
+// ----------------------------------------------------------------------------
+{
+	close();
+
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SidTraceHeader))
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (map == MAP_FAILED)
+		return false;
+
+	const SidTraceHeader* header = (const SidTraceHeader*)map;
+	const SidTraceIndexEntry* index = (const SidTraceIndexEntry*)((const char*)map + header->indexOffset);
+	size_t size = (size_t)st.st_size;
+
+	bool valid = memcmp(header->magic, sTraceMagic, sizeof(header->magic)) == 0 &&
+		header->version == sTraceVersion && header->clockFreq > 0.0 &&
+		header->indexOffset >= sizeof(SidTraceHeader) && header->indexOffset <= size &&
+		(size - header->indexOffset) / sizeof(SidTraceIndexEntry) >= header->numChunks;
+
+	for (uint32_t i = 0; valid && i < header->numChunks; i++)
+	{
+		valid = index[i].offset <= header->indexOffset &&
+			index[i].storedSize <= header->indexOffset - index[i].offset &&
+			index[i].dataSize <= (uint32_t)SidTraceChunk::DATA_SIZE &&
+			index[i].compression <= SIDTRACE_COMPRESSION_LZ &&
+			(i == 0 || index[i].startTime >= index[i - 1].startTime);
+	}
+
+	if (!valid)
+	{
+		munmap(map, st.st_size);
+		return false;
+	}
+
+	mMap = map;
+	mMapSize = size;
+	mHeader = header;
+	mIndex = index;
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void SidTraceReplay::close()
+// ----------------------------------------------------------------------------
+{
+	for (int i = 0; i < MAX_SIDS; i++)
+	{
+		delete mSids[i];
+		mSids[i] = NULL;
+	}
+	mNumSids = 0;
+
+	delete[] mMixBuffer;
+	mMixBuffer = NULL;
+	mMixBufferSize = 0;
+
+	if (mMap)
+		munmap(mMap, mMapSize);
+
+	mMap = NULL;
+	mMapSize = 0;
+	mHeader = NULL;
+	mIndex = NULL;
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidTraceReplay::setup(int sampleRate, int sidModel)
+// ----------------------------------------------------------------------------
+{
+	if (mMap == NULL)
+		return false;
+
+	if (sidModel < 0)
+		sidModel = mHeader->sidModel;
+
+	mNumSids = mHeader->numSids < 1 ? 1 : (mHeader->numSids > MAX_SIDS ? MAX_SIDS : mHeader->numSids);
+
+	for (int i = 0; i < mNumSids; i++)
+	{
+		if (mSids[i] == NULL)
+			mSids[i] = new SID;
+
+		mSids[i]->set_chip_model(sidModel == 1 ? MOS8580 : MOS6581);
+		mSids[i]->enable_filter(true);
+		mSids[i]->enable_external_filter(true);
+		if (!mSids[i]->set_sampling_parameters(mHeader->clockFreq, sampleRate))
+			return false;
+	}
+
+	seek(0.0);
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidTraceReplay::loadChunk(int chunk)
+// ----------------------------------------------------------------------------
+{
+	const SidTraceIndexEntry& entry = mIndex[chunk];
+	const unsigned char* data = (const unsigned char*)mMap + entry.offset;
+
+	if (entry.compression == SIDTRACE_COMPRESSION_LZ)
+	{
+		if (decompress(data, entry.storedSize, mChunk.mData, entry.dataSize) != (int)entry.dataSize)
+			return false;
+	}
+	else
+	{
+		if (entry.storedSize != entry.dataSize)
+			return false;
+		memcpy(mChunk.mData, data, entry.dataSize);
+	}
+
+	mChunk.mStartTime = entry.startTime;
+	mChunk.mStartSid = entry.startSid;
+	mChunk.mNumBytes = entry.dataSize;
+	mChunk.mNumWrites = entry.numWrites;
+	mReader = SidRegisterTrace::Reader(&mChunk);
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+bool SidTraceReplay::nextWrite()
+// ----------------------------------------------------------------------------
+{
+	while (!mReader.next(mWrite))
+	{
+		if (mNextChunk >= (int)mHeader->numChunks || !loadChunk(mNextChunk++))
+			return false;
+	}
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void SidTraceReplay::apply(const SidRegisterWrite& write)
+// ----------------------------------------------------------------------------
+{
+	if (write.mSid >= mNumSids || write.mRegister >= NUM_SID_REGS)
+		return;
+
+	// XSID has no counterpart here
+	if ((mHeader->flags & SIDTRACE_C64_BUS) && write.mRegister > 0x1c)
+		return;
+
+	mSids[write.mSid]->write(write.mRegister, write.mValue);
+}
+
+
+// ----------------------------------------------------------------------------
+void SidTraceReplay::seek(double seconds)
+// ----------------------------------------------------------------------------
+{
+	if (mMap == NULL || mNumSids == 0)
+		return;
+
+	long long target = seconds > 0.0 ? (long long)(seconds * mHeader->clockFreq) : 0;
+	long long settle = target - (long long)mHeader->clockFreq;
+
+	// libsidplay powers the SIDs on at full volume, not through the bus
+	for (int i = 0; i < mNumSids; i++)
+	{
+		mSids[i]->reset();
+		if (mHeader->flags & SIDTRACE_C64_BUS)
+			mSids[i]->write(0x18, 0x0f);
+	}
+
+	// the last chunk starting a second or more before the target
+	int lo = 0, hi = (int)mHeader->numChunks;
+	while (hi - lo > 1)
+	{
+		int mid = (lo + hi) / 2;
+		if ((long long)mIndex[mid].startTime <= settle)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	int first = settle > 0 ? lo : 0;
+
+	// the registers as the earlier chunks left them
+	if (first > 0)
+	{
+		std::vector<int> registers(mNumSids * NUM_SID_REGS, -1);
+		for (int i = 0; i < first; i++)
+		{
+			if (!loadChunk(i))
+				continue;
+			while (mReader.next(mWrite))
+			{
+				if (mWrite.mSid < mNumSids && mWrite.mRegister < NUM_SID_REGS)
+					registers[mWrite.mSid * NUM_SID_REGS + mWrite.mRegister] = mWrite.mValue;
+			}
+		}
+
+		for (int i = 0; i < (int)registers.size(); i++)
+		{
+			if (registers[i] < 0)
+				continue;
+			SidRegisterWrite write = { 0, i / NUM_SID_REGS, i % NUM_SID_REGS, registers[i] };
+			apply(write);
+		}
+	}
+
+	mChunk.mNumBytes = 0;
+	mReader = SidRegisterTrace::Reader(&mChunk);
+	mNextChunk = first;
+	mHasWrite = false;
+	mTime = first < (int)mHeader->numChunks ? (long long)mIndex[first].startTime : 0;
+
+	// from there on the writes are clocked in, without output
+	while ((mHasWrite = nextWrite()) && mWrite.mTime < target)
+	{
+		for (int i = 0; i < mNumSids; i++)
+			mSids[i]->skip((cycle_count)(mWrite.mTime - mTime));
+		mTime = mWrite.mTime;
+		apply(mWrite);
+	}
+
+	if (mTime < target)
+	{
+		for (int i = 0; i < mNumSids; i++)
+			mSids[i]->skip((cycle_count)(target - mTime));
+		mTime = target;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+int SidTraceReplay::render(short* buffer, int numSamples)
+// ----------------------------------------------------------------------------
+{
+	if (mMap == NULL || mNumSids == 0)
+		return 0;
+
+	if (mNumSids > 1 && mMixBufferSize < numSamples)
+	{
+		delete[] mMixBuffer;
+		mMixBuffer = new short[numSamples];
+		mMixBufferSize = numSamples;
+	}
+
+	int numRendered = 0;
+
+	while (numRendered < numSamples)
+	{
+		if (!mHasWrite)
+			mHasWrite = nextWrite();
+
+		long long until = mHasWrite ? mWrite.mTime : (long long)mHeader->duration;
+
+		if (mTime < until)
+		{
+			cycle_count cycles = until - mTime < 1000000 ? (cycle_count)(until - mTime) : 1000000;
+			cycle_count left = cycles;
+			short* out = buffer + numRendered;
+			int n = mSids[0]->clock(left, out, numSamples - numRendered);
+
+			// the other SIDs are clocked alike, so give as many samples
+			for (int i = 1; i < mNumSids; i++)
+			{
+				cycle_count other = cycles;
+				mSids[i]->clock(other, mMixBuffer, n);
+				for (int s = 0; s < n; s++)
+				{
+					int sample = out[s] + mMixBuffer[s];
+					out[s] = (short)(sample > 32767 ? 32767 : (sample < -32768 ? -32768 : sample));
+				}
+			}
+
+			numRendered += n;
+			mTime += cycles - left;
+			continue;
+		}
+
+		if (!mHasWrite)
+			break;
+
+		apply(mWrite);
+		mHasWrite = false;
+	}
+
+	return numRendered;
+}
+
+
+// ----------------------------------------------------------------------------
+int SidTraceReplay::compress(const unsigned char* data, int size, unsigned char* out, int outSize)
+// ----------------------------------------------------------------------------
+{
+	// greedy, finding matches through the last position of each 3 bytes;
+	// returns 0 when the result does not fit
+	static const int HASH_SIZE = 1024;
+	int last[HASH_SIZE];
+	for (int i = 0; i < HASH_SIZE; i++)
+		last[i] = -1;
+
+	int o = 0;
+	int literals = 0;       // pending, ending at position i
+
+	for (int i = 0; i <= size; )
+	{
+		int length = 0, distance = 0;
+
+		if (i + sMinMatch <= size)
+		{
+			int h = ((data[i] << 8) ^ (data[i + 1] << 4) ^ data[i + 2]) & (HASH_SIZE - 1);
+			int candidate = last[h];
+			last[h] = i;
+
+			if (candidate >= 0 && i - candidate <= 0xffff)
+			{
+				while (i + length < size && length < sMaxMatch && data[candidate + length] == data[i + length])
+					length++;
+				distance = i - candidate;
+			}
+		}
+
+		bool match = length >= sMinMatch;
+		if ((match || i == size || literals == sMaxLiterals) && literals > 0)
+		{
+			if (o + 1 + literals > outSize)
+				return 0;
+			out[o++] = (unsigned char)(literals - 1);
+			memcpy(out + o, data + i - literals, literals);
+			o += literals;
+			literals = 0;
+		}
+
+		if (i == size)
+			break;
+
+		if (match)
+		{
+			if (o + 3 > outSize)
+				return 0;
+			out[o++] = (unsigned char)(length + 0x7d);
+			out[o++] = (unsigned char)(distance & 0xff);
+			out[o++] = (unsigned char)(distance >> 8);
+			i += length;
+		}
+		else
+		{
+			literals++;
+			i++;
+		}
+	}
+
+	return o;
+}
+
+
+// ----------------------------------------------------------------------------
+int SidTraceReplay::decompress(const unsigned char* data, int size, unsigned char* out, int outSize)
+// ----------------------------------------------------------------------------
+{
+	const unsigned char* end = data + size;
+	int o = 0;
+
+	while (data < end)
+	{
+		int n = *data++;
+
+		if (n < 0x80)
+		{
+			n++;
+			if (end - data < n || o + n > outSize)
+				return -1;
+			memcpy(out + o, data, n);
+			data += n;
+			o += n;
+		}
+		else
+		{
+			if (end - data < 2)
+				return -1;
+			int distance = data[0] | (data[1] << 8);
+			data += 2;
+			n -= 0x7d;
+			if (distance == 0 || distance > o || o + n > outSize)
+				return -1;
+			// overlapping copies repeat the bytes
+			for (int i = 0; i < n; i++, o++)
+				out[o] = out[o - distance];
+		}
+	}
+
+	return o;
+}
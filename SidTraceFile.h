@@ -0,0 +1,167 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef _SIDTRACEFILE_H_
+#define _SIDTRACEFILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "sid.h"
+#include "SidRegisterTrace.h"
+
+
+// Register trace file, version 1, in host byte order:
+//
+//   SidTraceHeader
+//   the chunks, each the writes of a SidTraceChunk coded as recorded
+//   (see SidRegisterTrace.h), stored as they are or compressed
+//   a SidTraceIndexEntry per chunk at indexOffset, in time order
+//
+// Chunks decode on their own, so the index is enough to start reading
+// anywhere.  Compressed chunks are a series of runs, each a byte n and
+// then n + 1 literal bytes when n < 0x80, or a copy of n - 0x7d bytes
+// from a 16 bit distance (low byte first) back in the output.
+struct SidTraceHeader
+{
+	char                magic[8];       // "SIDTRACE"
+	uint32_t            version;
+	uint32_t            flags;          // SIDTRACE_*
+	double              clockFreq;      // cycles per second
+	uint64_t            duration;       // cycles, the end of the recording
+	uint64_t            numWrites;
+	uint64_t            indexOffset;
+	uint32_t            numChunks;
+	uint32_t            numSids;
+	uint32_t            sidModel;       // 0 for 6581, 1 for 8580
+	uint32_t            reserved;
+};
+
+struct SidTraceIndexEntry
+{
+	uint64_t            startTime;      // cycles, the first write is coded from it
+	uint64_t            offset;
+	uint32_t            storedSize;
+	uint32_t            dataSize;
+	uint32_t            numWrites;
+	uint8_t             startSid;
+	uint8_t             compression;    // SIDTRACE_COMPRESSION_*
+	uint16_t            reserved;
+};
+
+enum
+{
+	// written by the C64, registers past 0x1c are XSID sample commands
+	// rather than SIDPLUS registers
+	SIDTRACE_C64_BUS            = 1,
+
+	SIDTRACE_COMPRESSION_NONE   = 0,
+	SIDTRACE_COMPRESSION_LZ     = 1,
+};
+
+
+// Writes the chunks taken from a SidRegisterTrace to a trace file.
+class SidTraceWriter
+{
+public:
+
+	SidTraceWriter();
+	~SidTraceWriter();
+
+	bool open(const char* path, double clockFreq, int sidModel, uint32_t flags, bool compress);
+	bool write(const SidTraceChunk* chunk);
+
+	// writes the index, duration in cycles; false if anything failed
+	bool close(long long duration);
+
+private:
+
+	FILE*                       mFile;
+	SidTraceHeader              mHeader;
+	std::vector<SidTraceIndexEntry> mIndex;
+	bool                        mCompress;
+	bool                        mFailed;
+};
+
+
+// Plays a trace file back on resid, without the 6510, CIAs or VIC: the
+// file is mapped and its writes go to the SIDs at their cycle, which
+// are clocked in between.  The output is the SIDs' own, it does not go
+// through the libsidplay mixer, so it is close to but not the same as
+// rendering the tune.
+class SidTraceReplay
+{
+public:
+
+	static const int MAX_SIDS = 4;
+
+	SidTraceReplay();
+	~SidTraceReplay();
+
+	bool open(const char* path);
+	void close();
+
+	// sets up the SIDs to render at the sample rate, with the model of
+	// the recording unless one is given (0 for 6581, 1 for 8580)
+	bool setup(int sampleRate, int sidModel = -1);
+
+	inline bool isOpen()												{ return mMap != NULL; }
+	inline const SidTraceHeader& getHeader()							{ return *mHeader; }
+	inline double getDuration()											{ return mHeader->duration / mHeader->clockFreq; }
+	inline SID* getSid(int i)											{ return mSids[i]; }
+
+	// continues from the given time: the registers written by the chunks
+	// ending a second or more before it are set without clocking, the
+	// writes from there on are clocked in without output.  Envelopes and
+	// filters settle, the oscillators are not in the phase an unbroken
+	// replay would have them in.
+	void seek(double seconds);
+
+	// renders up to numSamples samples, fewer once at the end
+	int render(short* buffer, int numSamples);
+
+	static int compress(const unsigned char* data, int size, unsigned char* out, int outSize);
+	static int decompress(const unsigned char* data, int size, unsigned char* out, int outSize);
+
+private:
+
+	bool loadChunk(int chunk);
+	bool nextWrite();
+	void apply(const SidRegisterWrite& write);
+
+	void*                       mMap;
+	size_t                      mMapSize;
+	const SidTraceHeader*       mHeader;
+	const SidTraceIndexEntry*   mIndex;
+
+	SID*                        mSids[MAX_SIDS];
+	int                         mNumSids;
+	short*                      mMixBuffer;
+	int                         mMixBufferSize;
+
+	SidTraceChunk               mChunk;
+	SidRegisterTrace::Reader    mReader;
+	int                         mNextChunk;
+	SidRegisterWrite            mWrite;
+	bool                        mHasWrite;
+	long long                   mTime;
+};
+
+
+#endif // _SIDTRACEFILE_H_
@@ -0,0 +1,382 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "SongLengthAnalyzer.h"
+
+
+const double SongLengthAnalyzer::SILENCE_SECONDS = 3.0;
+const double SongLengthAnalyzer::MIN_LOOP_SECONDS = 1.0;
+const double SongLengthAnalyzer::LOOP_CONFIRM_SECONDS = 30.0;
+
+static const unsigned long long sHashOffset = 14695981039346656037ULL;
+static const unsigned long long sHashPrime  = 1099511628211ULL;
+
+// envelope rates of the SID in ms, attack and decay/release
+static const int sAttackMs[16]  = { 2, 8, 16, 24, 38, 56, 68, 80, 100, 250, 500, 800, 1000, 3000, 5000, 8000 };
+static const int sReleaseMs[16] = { 6, 24, 48, 72, 114, 168, 204, 240, 300, 750, 1500, 2400, 3000, 9000, 15000, 24000 };
+
+
+static inline unsigned long long hashRegisters(unsigned long long hash, const unsigned char* registers)
+{
+	// FNV-1a
+	for (int i = 0; i < SIDPLAY2_NAMESPACE::SidRegisterFrame::SID_REGISTER_COUNT; i++)
+		hash = (hash ^ registers[i]) * sHashPrime;
+	return hash;
+}
+
+
+// ----------------------------------------------------------------------------
+SongLengthAnalyzer::SongLengthAnalyzer()
+// ----------------------------------------------------------------------------
+{
+	mFrameCycles = PAL_FRAME_CYCLES;
+	mFrameSeconds = 0.02;
+	mFrame = 0;
+	mHash = sHashOffset;
+	mVolumeChanges = 0;
+	memset(mGateFrame, 0, sizeof(mGateFrame));
+	memset(mRegisters, 0, sizeof(mRegisters));
+}
+
+
+// ----------------------------------------------------------------------------
+void SongLengthAnalyzer::registerFrameChanged(void* inInstance, SIDPLAY2_NAMESPACE::SidRegisterFrame& inRegisterFrame)
+// ----------------------------------------------------------------------------
+{
+	SongLengthAnalyzer* analyzer = reinterpret_cast<SongLengthAnalyzer*>(inInstance);
+
+	// only the register written is taken, the others of the frame may
+	// be from before the subtune started
+	int reg = inRegisterFrame.mRegister;
+	unsigned char value = inRegisterFrame.mRegisters[reg];
+
+	// frames are closed at the end of each step, a write from before
+	// that only lands here by rounding and goes to the open frame
+	unsigned long frame = (unsigned long)(inRegisterFrame.mTimeStamp / analyzer->mFrameCycles);
+	if (frame > analyzer->mFrame)
+		analyzer->closeFrames(frame);
+
+	if (reg < 3 * 7 && reg % 7 == 4 && ((value ^ analyzer->mRegisters[reg]) & 0x01))
+		analyzer->mGateFrame[reg / 7] = analyzer->mFrame;
+	if (reg == 0x18 && value != analyzer->mRegisters[0x18])
+		analyzer->mVolumeChanges++;
+
+	// every write goes into the hash, so gates toggled within a frame count
+	analyzer->mRegisters[reg] = value;
+	analyzer->mHash = (analyzer->mHash ^ reg) * sHashPrime;
+	analyzer->mHash = (analyzer->mHash ^ value) * sHashPrime;
+}
+
+
+// ----------------------------------------------------------------------------
+void SongLengthAnalyzer::closeFrames(unsigned long frame)
+// ----------------------------------------------------------------------------
+{
+	while (mFrame < frame)
+	{
+		mHashes.push_back(hashRegisters(mHash, mRegisters));
+		mAudible.push_back(isAudible());
+
+		mFrame++;
+		mHash = sHashOffset;
+		mVolumeChanges = 0;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+bool SongLengthAnalyzer::isAudible()
+// ----------------------------------------------------------------------------
+{
+	// samples played through the volume register
+	if (mVolumeChanges >= DIGI_VOLUME_CHANGES)
+		return true;
+
+	if ((mRegisters[0x18] & 0x0f) == 0)
+		return false;
+
+	for (int v = 0; v < 3; v++)
+	{
+		const unsigned char* voice = mRegisters + v * 7;
+		int control = voice[4];
+
+		// no waveform, or the oscillator held by the test bit
+		if ((control & 0xf0) == 0 || (control & 0x08))
+			continue;
+
+		double ms = (mFrame - mGateFrame[v]) * mFrameSeconds * 1000.0;
+
+		if (control & 0x01)
+		{
+			// sounds until the decay reaches a sustain level of zero
+			if ((voice[6] >> 4) != 0 || ms < sAttackMs[voice[5] >> 4] + sReleaseMs[voice[5] & 0x0f])
+				return true;
+		}
+		else if (ms < sReleaseMs[voice[6] & 0x0f])
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+// ----------------------------------------------------------------------------
+long SongLengthAnalyzer::findSilence()
+// ----------------------------------------------------------------------------
+{
+	// first silence long enough after the song made a sound
+	long silenceFrames = (long)(SILENCE_SECONDS / mFrameSeconds);
+	long numFrames = (long)mAudible.size();
+	long start = -1;
+	bool heard = false;
+
+	for (long i = 0; i < numFrames; i++)
+	{
+		if (mAudible[i])
+		{
+			heard = true;
+			start = -1;
+		}
+		else if (heard)
+		{
+			if (start < 0)
+				start = i;
+			if (i + 1 - start >= silenceFrames)
+				return start;
+		}
+	}
+
+	return -1;
+}
+
+
+// ----------------------------------------------------------------------------
+bool SongLengthAnalyzer::findLoop(long confirmFrames, long& start, long& period)
+// ----------------------------------------------------------------------------
+{
+	// The stretch up to the last frame which repeats with a period p
+	// starts over at its start s + p, the earliest of these is taken.
+	// The loop must have played twice, and for confirmFrames since its
+	// first repetition.
+	long numFrames = (long)mHashes.size();
+	long minPeriod = (long)(MIN_LOOP_SECONDS / mFrameSeconds);
+	long end = numFrames + 1;
+
+	for (long p = minPeriod; 2 * p <= numFrames && p < end; p++)
+	{
+		long s = numFrames - p;
+		while (s > 0 && mHashes[s - 1] == mHashes[s - 1 + p])
+			s--;
+
+		long repeated = numFrames - p - s;
+		if (repeated < p || repeated < confirmFrames || s + p >= end)
+			continue;
+
+		// a silent loop is left to findSilence()
+		bool audible = false;
+		for (long i = s; i < s + p && !audible; i++)
+			audible = mAudible[i];
+
+		if (audible)
+		{
+			start = s;
+			period = p;
+			end = s + p;
+		}
+	}
+
+	return end <= numFrames;
+}
+
+
+// ----------------------------------------------------------------------------
+bool SongLengthAnalyzer::analyze(PlayerLibSidplay* player, double maxSeconds, SongLength& length)
+// ----------------------------------------------------------------------------
+{
+	if (!player->isTuneLoaded())
+		return false;
+
+	double clock = player->getCurrentCpuClockRate();
+	mFrameCycles = clock > 1000000.0 ? NTSC_FRAME_CYCLES : PAL_FRAME_CYCLES;
+
+	// the sidplay1 environments call the player at the rate of a fake VBI
+	// timer, the frames must follow it for a loop to repeat exactly
+	if (player->getCurrentEnvironment() != sid2_envR)
+		mFrameCycles = (unsigned long)(clock / (clock > 1000000.0 ? 60.0 : 50.0) + 0.5);
+	mFrameSeconds = mFrameCycles / clock;
+	mFrame = 0;
+	mHash = sHashOffset;
+	mVolumeChanges = 0;
+	memset(mGateFrame, 0, sizeof(mGateFrame));
+	memset(mRegisters, 0, sizeof(mRegisters));
+	mHashes.clear();
+	mAudible.clear();
+
+	player->setRegisterFrameCallback(this, registerFrameChanged);
+
+	int maxTenths = (int)(maxSeconds * 10.0);
+	long confirmFrames = (long)(LOOP_CONFIRM_SECONDS / mFrameSeconds);
+	int tenths = 0;
+	bool playing = true;
+	long silence = -1;
+	long loopStart = 0;
+	long loopPeriod = 0;
+	bool loop = false;
+
+	// in steps, stopping as soon as the end is certain
+	while (playing && tenths < maxTenths && silence < 0 && !loop)
+	{
+		tenths = tenths + STEP_TENTHS < maxTenths ? tenths + STEP_TENTHS : maxTenths;
+		playing = player->seekToTime(tenths);
+
+		if (playing)
+			closeFrames((unsigned long)(tenths * clock / 10.0) / mFrameCycles);
+		else
+			closeFrames(mFrame + 1);
+
+		silence = findSilence();
+		loop = findLoop(confirmFrames, loopStart, loopPeriod);
+	}
+
+	// at the end, a loop only needs to have played twice
+	if (!loop && silence < 0)
+		loop = findLoop(0, loopStart, loopPeriod);
+
+	player->setRegisterFrameCallback(NULL, NULL);
+
+	long frames = (long)mHashes.size();
+	length.end = SongLength::END_NONE;
+
+	if (loop && (silence < 0 || loopStart + loopPeriod < silence))
+	{
+		frames = loopStart + loopPeriod;
+		length.end = SongLength::END_LOOP;
+	}
+	else if (silence >= 0)
+	{
+		frames = silence;
+		length.end = SongLength::END_SILENCE;
+	}
+	else if (!playing)
+	{
+		length.end = SongLength::END_STOPPED;
+	}
+
+	length.analysed = playing ? tenths / 10.0 : mHashes.size() * mFrameSeconds;
+	length.seconds = length.end == SongLength::END_NONE ? length.analysed : frames * mFrameSeconds;
+
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+std::string SongLengthAnalyzer::formatLength(double seconds)
+// ----------------------------------------------------------------------------
+{
+	long ms = (long)(seconds * 1000.0 + 0.5);
+	char text[32];
+
+	snprintf(text, sizeof(text), "%ld:%02ld.%03ld", ms / 60000, ms / 1000 % 60, ms % 1000);
+	return text;
+}
+
+
+// MD5 (RFC 1321) of a 64 byte block
+static void md5Block(uint32_t state[4], const unsigned char* block, const uint32_t* k)
+{
+	static const int shift[4][4] = { { 7, 12, 17, 22 }, { 5, 9, 14, 20 }, { 4, 11, 16, 23 }, { 6, 10, 15, 21 } };
+	uint32_t w[16];
+
+	for (int i = 0; i < 16; i++)
+		w[i] = block[i * 4] | (block[i * 4 + 1] << 8) | (block[i * 4 + 2] << 16) | ((uint32_t)block[i * 4 + 3] << 24);
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+	for (int i = 0; i < 64; i++)
+	{
+		uint32_t f;
+		int g;
+
+		switch (i >> 4)
+		{
+			case 0:  f = (b & c) | (~b & d); g = i; break;
+			case 1:  f = (d & b) | (~d & c); g = (5 * i + 1) & 15; break;
+			case 2:  f = b ^ c ^ d;          g = (3 * i + 5) & 15; break;
+			default: f = c ^ (b | ~d);       g = (7 * i) & 15; break;
+		}
+
+		uint32_t x = a + f + k[i] + w[g];
+		int s = shift[i >> 4][i & 3];
+
+		a = d;
+		d = c;
+		c = b;
+		b = b + ((x << s) | (x >> (32 - s)));
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+
+// ----------------------------------------------------------------------------
+std::string SongLengthAnalyzer::tuneHash(const char* data, int length)
+// ----------------------------------------------------------------------------
+{
+	uint32_t state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+	uint32_t k[64];
+	unsigned char block[64];
+	int i;
+
+	for (i = 0; i < 64; i++)
+		k[i] = (uint32_t)(fabs(sin(i + 1.0)) * 4294967296.0);
+
+	for (i = 0; i + 64 <= length; i += 64)
+		md5Block(state, (const unsigned char*)data + i, k);
+
+	// pad with a one bit and the length in bits
+	int rest = length - i;
+	memcpy(block, data + i, rest);
+	block[rest++] = 0x80;
+	if (rest > 56)
+	{
+		memset(block + rest, 0, 64 - rest);
+		md5Block(state, block, k);
+		rest = 0;
+	}
+	memset(block + rest, 0, 56 - rest);
+
+	unsigned long long bits = (unsigned long long)length * 8;
+	for (i = 0; i < 8; i++)
+		block[56 + i] = (unsigned char)(bits >> (i * 8));
+	md5Block(state, block, k);
+
+	char hex[33];
+	for (i = 0; i < 16; i++)
+		snprintf(hex + i * 2, 3, "%02x", (state[i / 4] >> ((i % 4) * 8)) & 0xff);
+
+	return hex;
+}
@@ -0,0 +1,101 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef _SONGLENGTHANALYZER_H_
+#define _SONGLENGTHANALYZER_H_
+
+#include <string>
+#include <vector>
+#include "PlayerLibSidplay.h"
+
+
+struct SongLength
+{
+	enum End
+	{
+		END_NONE = 0,       // nothing found within the time analysed
+		END_SILENCE,        // followed by silence
+		END_LOOP,           // starts over from an earlier point
+		END_STOPPED         // the player stopped
+	};
+
+	SongLength() : seconds(0.0), analysed(0.0), end(END_NONE) {}
+
+	double              seconds;
+	double              analysed;       // emulated, for the real-time factor
+	End                 end;
+};
+
+
+// Finds how long a subtune plays by running it without synthesis and
+// hashing the SID register writes of every video frame.  The song ends
+// where the frame hashes start repeating what they did one period
+// earlier, or where a few seconds of silence begin, judged from the
+// volume and the envelope settings of the voices.  Repetitions are
+// only taken once they went on for LOOP_CONFIRM_SECONDS (or up to the
+// end of the time analysed) so a riff repeated in the intro does not
+// pass for the loop of the whole song.
+class SongLengthAnalyzer
+{
+public:
+
+	static const double SILENCE_SECONDS;
+	static const double MIN_LOOP_SECONDS;
+	static const double LOOP_CONFIRM_SECONDS;
+
+	SongLengthAnalyzer();
+
+	// the player has the subtune loaded and not yet played
+	bool analyze(PlayerLibSidplay* player, double maxSeconds, SongLength& length);
+
+	// MD5 of the whole file, the key of the HVSC Songlengths.md5 database
+	static std::string tuneHash(const char* data, int length);
+
+	// m:ss.mmm as in the database
+	static std::string formatLength(double seconds);
+
+private:
+
+	static const int PAL_FRAME_CYCLES  = 63 * 312;
+	static const int NTSC_FRAME_CYCLES = 65 * 263;
+	static const int STEP_TENTHS       = 100;
+	static const int DIGI_VOLUME_CHANGES = 4;   // per frame
+
+	static void registerFrameChanged(void* inInstance, SIDPLAY2_NAMESPACE::SidRegisterFrame& inRegisterFrame);
+
+	void closeFrames(unsigned long frame);
+	bool isAudible();
+	long findSilence();
+	bool findLoop(long confirmFrames, long& start, long& period);
+
+	unsigned long               mFrameCycles;
+	double                      mFrameSeconds;
+
+	// frame being written to
+	unsigned long               mFrame;
+	unsigned long long          mHash;
+	int                         mVolumeChanges;
+	unsigned long               mGateFrame[3];
+	unsigned char               mRegisters[SIDPLAY2_NAMESPACE::SidRegisterFrame::SID_REGISTER_COUNT];
+
+	std::vector<unsigned long long> mHashes;
+	std::vector<bool>           mAudible;
+};
+
+
+#endif // _SONGLENGTHANALYZER_H_
@@ -0,0 +1,249 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <stdio.h>
+#include "TuneCache.h"
+
+
+// players kept for preparing tunes in, beyond those holding one
+static const int sMaxSpare = 2;
+
+
+// ----------------------------------------------------------------------------
+TuneCache::TuneCache(int capacity)
+// ----------------------------------------------------------------------------
+{
+	mCapacity = capacity > 0 ? capacity : 1;
+	mIsPreparing = false;
+	mQuit = false;
+
+	pthread_mutex_init(&mMutex, NULL);
+	pthread_cond_init(&mCondition, NULL);
+
+	if (pthread_create(&mThread, NULL, prepareThread, (void*)this) != 0)
+	{
+		printf("TuneCache: pthread_create failed\n");
+		mQuit = true;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+TuneCache::~TuneCache()
+// ----------------------------------------------------------------------------
+{
+	pthread_mutex_lock(&mMutex);
+	bool running = !mQuit;
+	mQuit = true;
+	pthread_cond_broadcast(&mCondition);
+	pthread_mutex_unlock(&mMutex);
+
+	if (running)
+		pthread_join(mThread, NULL);
+
+	pthread_cond_destroy(&mCondition);
+	pthread_mutex_destroy(&mMutex);
+
+	for (std::list<Entry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+		delete it->player;
+
+	for (size_t i = 0; i < mSpare.size(); i++)
+		delete mSpare[i];
+}
+
+
+// ----------------------------------------------------------------------------
+bool TuneCache::sameSettings(const PlaybackSettings& a, const PlaybackSettings& b)
+// ----------------------------------------------------------------------------
+{
+	return a.mFrequency == b.mFrequency &&
+		a.mBits == b.mBits &&
+		a.mOversampling == b.mOversampling &&
+		a.mSidModel == b.mSidModel &&
+		a.mForceSidModel == b.mForceSidModel &&
+		a.mClockSpeed == b.mClockSpeed &&
+		a.mOverrideCutoffCurve == b.mOverrideCutoffCurve &&
+		a.mPowerOnDelay == b.mPowerOnDelay;
+}
+
+
+// ----------------------------------------------------------------------------
+void TuneCache::prepare(const char* path, int subtune, const PlaybackSettings& settings)
+// ----------------------------------------------------------------------------
+{
+	pthread_mutex_lock(&mMutex);
+
+	for (std::list<Entry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (it->path == path && it->subtune == subtune && sameSettings(it->settings, settings))
+		{
+			// asked for again, the last to be dropped
+			mEntries.splice(mEntries.begin(), mEntries, it);
+			pthread_mutex_unlock(&mMutex);
+			return;
+		}
+	}
+
+	bool queued = mIsPreparing && mPreparing.path == path && mPreparing.subtune == subtune && sameSettings(mPreparing.settings, settings);
+
+	for (size_t i = 0; i < mRequests.size() && !queued; i++)
+		queued = mRequests[i].path == path && mRequests[i].subtune == subtune && sameSettings(mRequests[i].settings, settings);
+
+	if (queued)
+	{
+		pthread_mutex_unlock(&mMutex);
+		return;
+	}
+
+	Entry request;
+	request.path = path;
+	request.subtune = subtune;
+	request.settings = settings;
+	request.player = NULL;
+	mRequests.push_back(request);
+
+	// requests older than what the cache holds would be dropped anyway
+	while ((int) mRequests.size() > mCapacity)
+		mRequests.pop_front();
+
+	pthread_cond_broadcast(&mCondition);
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+// ----------------------------------------------------------------------------
+PlayerLibSidplay* TuneCache::take(const char* path, int subtune, const PlaybackSettings& settings)
+// ----------------------------------------------------------------------------
+{
+	PlayerLibSidplay* player = NULL;
+
+	pthread_mutex_lock(&mMutex);
+
+	for (std::list<Entry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (it->path == path && it->subtune == subtune)
+		{
+			if (sameSettings(it->settings, settings))
+				player = it->player;
+			else
+				addSpare(it->player);
+
+			mEntries.erase(it);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&mMutex);
+
+	return player;
+}
+
+
+// ----------------------------------------------------------------------------
+void TuneCache::recycle(PlayerLibSidplay* player)
+// ----------------------------------------------------------------------------
+{
+	if (player == NULL)
+		return;
+
+	pthread_mutex_lock(&mMutex);
+	addSpare(player);
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+// ----------------------------------------------------------------------------
+void TuneCache::addSpare(PlayerLibSidplay* player)
+// ----------------------------------------------------------------------------
+{
+	if ((int) mSpare.size() < sMaxSpare)
+		mSpare.push_back(player);
+	else
+		delete player;
+}
+
+
+// ----------------------------------------------------------------------------
+void* TuneCache::prepareThread(void* inClientData)
+// ----------------------------------------------------------------------------
+{
+	TuneCache* cache = reinterpret_cast<TuneCache*>(inClientData);
+
+	cache->prepareQueued();
+
+	return NULL;
+}
+
+
+// ----------------------------------------------------------------------------
+void TuneCache::prepareQueued()
+// ----------------------------------------------------------------------------
+{
+	pthread_mutex_lock(&mMutex);
+
+	while (!mQuit)
+	{
+		if (mRequests.empty())
+		{
+			pthread_cond_wait(&mCondition, &mMutex);
+			continue;
+		}
+
+		Entry entry = mRequests.front();
+		mRequests.pop_front();
+		mPreparing = entry;
+		mIsPreparing = true;
+
+		PlayerLibSidplay* player = NULL;
+		if (!mSpare.empty())
+		{
+			player = mSpare.back();
+			mSpare.pop_back();
+		}
+
+		// load without holding the lock, the player is ours alone
+		pthread_mutex_unlock(&mMutex);
+
+		if (player == NULL)
+			player = new PlayerLibSidplay;
+
+		PlaybackSettings settings = entry.settings;
+		bool success = player->loadTuneByPath(entry.path.c_str(), entry.subtune, &settings);
+
+		pthread_mutex_lock(&mMutex);
+		mIsPreparing = false;
+
+		if (!success)
+		{
+			printf("TuneCache: could not prepare %s\n", entry.path.c_str());
+			addSpare(player);
+			continue;
+		}
+
+		entry.player = player;
+		mEntries.push_front(entry);
+
+		while ((int) mEntries.size() > mCapacity)
+		{
+			addSpare(mEntries.back().player);
+			mEntries.pop_back();
+		}
+	}
+
+	pthread_mutex_unlock(&mMutex);
+}
@@ -0,0 +1,85 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef _TUNECACHE_H_
+#define _TUNECACHE_H_
+
+#include <pthread.h>
+#include <deque>
+#include <list>
+#include <string>
+#include <vector>
+#include "PlayerLibSidplay.h"
+
+
+// Tunes loaded ahead of playing them, for switching without a gap.  A
+// background thread prepares each requested tune in a player of its own,
+// parsed, with the driver relocated and the C64 memory initialised, so
+// playing it only swaps its engine into the playing player between two
+// buffers (see PlayerLibSidplay::adoptTune).  The most recently prepared
+// tunes are kept, up to the capacity.
+class TuneCache
+{
+public:
+
+	static const int DEFAULT_CAPACITY = 4;
+
+	TuneCache(int capacity = DEFAULT_CAPACITY);
+	~TuneCache();
+
+	// queue a tune to be prepared, unless it already is
+	void prepare(const char* path, int subtune, const PlaybackSettings& settings);
+
+	// a prepared tune, taken out of the cache and owned by the caller,
+	// NULL if it is not ready or was prepared with other settings
+	PlayerLibSidplay* take(const char* path, int subtune, const PlaybackSettings& settings);
+
+	// give back a player no longer used, to prepare another tune in
+	void recycle(PlayerLibSidplay* player);
+
+private:
+
+	struct Entry
+	{
+		std::string         path;
+		int                 subtune;
+		PlaybackSettings    settings;
+		PlayerLibSidplay*   player;         // NULL while queued
+	};
+
+	static void* prepareThread(void* inClientData);
+	static bool sameSettings(const PlaybackSettings& a, const PlaybackSettings& b);
+
+	void prepareQueued();
+	void addSpare(PlayerLibSidplay* player);
+
+	int                         mCapacity;
+	std::list<Entry>            mEntries;       // prepared, most recent first
+	std::deque<Entry>           mRequests;
+	Entry                       mPreparing;
+	bool                        mIsPreparing;
+	std::vector<PlayerLibSidplay*> mSpare;
+
+	pthread_t                   mThread;
+	pthread_mutex_t             mMutex;
+	pthread_cond_t              mCondition;
+	bool                        mQuit;
+};
+
+
+#endif // _TUNECACHE_H_
@@ -0,0 +1,136 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "WavFileAudioDriver.h"
+
+
+static const int    sWavHeaderSize = 44;
+
+
+static inline unsigned char* putLittleEndian(unsigned char* p, unsigned int value, int bytes)
+{
+	for (int i = 0; i < bytes; i++)
+		*p++ = (unsigned char) (value >> (i * 8));
+	return p;
+}
+
+
+// ----------------------------------------------------------------------------
+WavFileAudioDriver::WavFileAudioDriver(const char* filename, bool rawOutput)
+// ----------------------------------------------------------------------------
+{
+	mFilename = new char[strlen(filename) + 1];
+	strcpy(mFilename, filename);
+	mRawOutput = rawOutput;
+	mFile = NULL;
+	mFileBuffer = NULL;
+}
+
+
+// ----------------------------------------------------------------------------
+WavFileAudioDriver::~WavFileAudioDriver()
+// ----------------------------------------------------------------------------
+{
+	deinitialize();
+	delete[] mFilename;
+}
+
+
+// ----------------------------------------------------------------------------
+void WavFileAudioDriver::writeHeader(unsigned int dataSize)
+// ----------------------------------------------------------------------------
+{
+	unsigned char header[sWavHeaderSize];
+	unsigned char* p = header;
+
+	memcpy(p, "RIFF", 4);										p += 4;
+	p = putLittleEndian(p, dataSize + sWavHeaderSize - 8, 4);
+	memcpy(p, "WAVE", 4);										p += 4;
+	memcpy(p, "fmt ", 4);										p += 4;
+	p = putLittleEndian(p, 16, 4);								// fmt chunk size
+	p = putLittleEndian(p, 1, 2);								// PCM
+	p = putLittleEndian(p, 1, 2);								// channels
+	p = putLittleEndian(p, mSampleRate, 4);
+	p = putLittleEndian(p, mSampleRate * sizeof(short), 4);		// bytes per second
+	p = putLittleEndian(p, sizeof(short), 2);					// block align
+	p = putLittleEndian(p, 16, 2);								// bits per sample
+	memcpy(p, "data", 4);										p += 4;
+	p = putLittleEndian(p, dataSize, 4);
+
+	fseek(mFile, 0, SEEK_SET);
+	fwrite(header, 1, sWavHeaderSize, mFile);
+}
+
+
+// ----------------------------------------------------------------------------
+bool WavFileAudioDriver::openStream()
+// ----------------------------------------------------------------------------
+{
+	mFile = fopen(mFilename, "wb");
+
+	if (mFile == NULL)
+	{
+		printf("WavFileAudioDriver: cannot create %s\n", mFilename);
+		return false;
+	}
+
+	mFileBuffer = new unsigned char[mNumSamplesInBuffer * sizeof(short)];
+
+	// placeholder until the length is known
+	if (!mRawOutput)
+		writeHeader(0);
+
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+void WavFileAudioDriver::closeStream()
+// ----------------------------------------------------------------------------
+{
+	if (mFile == NULL)
+		return;
+
+	if (!mRawOutput)
+		writeHeader((unsigned int) (mNumSamplesWritten * sizeof(short)));
+	fclose(mFile);
+	mFile = NULL;
+
+	delete[] mFileBuffer;
+	mFileBuffer = NULL;
+}
+
+
+// ----------------------------------------------------------------------------
+bool WavFileAudioDriver::writeStream(const short* buffer, int numSamples)
+// ----------------------------------------------------------------------------
+{
+	unsigned char* p = mFileBuffer;
+
+	for (int i = 0; i < numSamples; i++)
+		p = putLittleEndian(p, (unsigned short) buffer[i], 2);
+
+	if (fwrite(mFileBuffer, sizeof(short), numSamples, mFile) != (size_t) numSamples)
+	{
+		printf("WavFileAudioDriver: write to %s failed\n", mFilename);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,53 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _WAVFILEAUDIODRIVER_H_
+#define _WAVFILEAUDIODRIVER_H_
+
+#include <stdio.h>
+#include "AudioStreamDriver.h"
+
+
+// Streams the rendered samples to a 16 bit mono RIFF/WAVE file, as fast
+// as the player renders them.  The header sizes are filled in on close.
+// With rawOutput the samples are written as is (little endian) without
+// a header.
+class WavFileAudioDriver : public AudioStreamDriver
+{
+public:
+
+	WavFileAudioDriver(const char* filename, bool rawOutput = false);
+	~WavFileAudioDriver();
+
+protected:
+
+	bool openStream();
+	void closeStream();
+	bool writeStream(const short* buffer, int numSamples);
+
+private:
+
+	void writeHeader(unsigned int dataSize);
+
+	char*                       mFilename;
+	bool                        mRawOutput;
+	FILE*                       mFile;
+	unsigned char*              mFileBuffer;
+};
+
+
+#endif // _WAVFILEAUDIODRIVER_H_
@@ -0,0 +1,432 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+// Checks the lazy timers of the CIA (sid2_config_t::lazyTimers) against
+// the event-driven ones.  Two MOS6526 run side by side on one scheduler,
+// only one of them lazy, through the same scripted accesses to the timer,
+// interrupt and control registers at exact cycles.  Every value read and
+// every change of the interrupt line has to be the same on both.  The
+// scripts cover one shot and continuous timers, timer B counting timer A
+// underflows, forced loads, latch writes while running, the latches that
+// underflow every cycle or two, and long runs of random accesses from
+// fixed seeds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "mos6526/mos6526.h"
+
+
+static const double PAL_CLOCK = 985248.0;
+
+enum
+{
+    PRB = 0x01,
+    TAL = 0x04,
+    TAH = 0x05,
+    TBL = 0x06,
+    TBH = 0x07,
+    SDR = 0x0c,
+    ICR = 0x0d,
+    CRA = 0x0e,
+    CRB = 0x0f
+};
+
+
+// A CIA keeping track of its interrupt line.
+class CheckCia : public MOS6526
+{
+public:
+    CheckCia(EventContext* context) : MOS6526(context), irq(false), irqChanges(0), irqClk(0) {}
+    const char* error() { return ""; }
+
+    bool            irq;
+    int             irqChanges;
+    event_clock_t   irqClk;         // of the last change
+
+protected:
+    void interrupt(bool state)
+    {
+        irq = state;
+        irqChanges++;
+        irqClk = event_context.getTime(EVENT_CLOCK_PHI1);
+    }
+};
+
+
+struct Access
+{
+    event_clock_t   delay;          // cycles after the access before
+    bool            write;
+    uint8_t         addr;
+    uint8_t         data;
+};
+
+// Accesses a cycle apart unless waited for longer.
+class Script
+{
+public:
+    Script(const std::string& inName) : name(inName), mDelay(1) {}
+
+    Script& wait(event_clock_t cycles) { mDelay += cycles; return *this; }
+    Script& write(uint8_t addr, uint8_t data) { add(true, addr, data); return *this; }
+    Script& read(uint8_t addr) { add(false, addr, 0); return *this; }
+
+    Script& latchA(uint_least16_t latch) { return write(TAL, latch & 0xff).write(TAH, latch >> 8); }
+    Script& latchB(uint_least16_t latch) { return write(TBL, latch & 0xff).write(TBH, latch >> 8); }
+    // both counters and their bits on port B
+    Script& readTimers() { return read(TAL).read(TAH).read(TBL).read(TBH).read(PRB); }
+
+    std::string         name;
+    std::vector<Access> accesses;
+
+private:
+    void add(bool write, uint8_t addr, uint8_t data)
+    {
+        Access access = { mDelay, write, addr, data };
+        accesses.push_back(access);
+        mDelay = 1;
+    }
+
+    event_clock_t       mDelay;
+};
+
+
+// Plays a script on both CIAs as the 6510 would, in phase 2.
+class ScriptRunner : public Event
+{
+public:
+    ScriptRunner(const Script& inScript) :
+        Event("CIA Check Script"),
+        scheduler("CIA Check Scheduler"),
+        cia(&scheduler),
+        lazyCia(&scheduler),
+        script(inScript),
+        next(0),
+        reads(0),
+        failed(false)
+    {
+        lazyCia.lazy(true);
+        cia.clock(PAL_CLOCK);
+        lazyCia.clock(PAL_CLOCK);
+        scheduler.reset();
+        cia.reset();
+        lazyCia.reset();
+    }
+
+    bool run()
+    {
+        if (script.accesses.empty())
+            return true;
+        schedule(scheduler, script.accesses[0].delay, EVENT_CLOCK_PHI2);
+        while (next < script.accesses.size() && !failed)
+            scheduler.clock();
+        return !failed;
+    }
+
+    EventScheduler  scheduler;
+    CheckCia        cia;
+    CheckCia        lazyCia;
+    const Script&   script;
+    size_t          next;
+    int             reads;
+    bool            failed;
+    std::string     error;
+
+private:
+    void event()
+    {
+        const Access& access = script.accesses[next++];
+        char message[160];
+        unsigned long clk = (unsigned long)scheduler.getTime(EVENT_CLOCK_PHI2);
+
+        if (access.write) {
+            cia.write(access.addr, access.data);
+            lazyCia.write(access.addr, access.data);
+        }
+        else {
+            uint8_t data = cia.read(access.addr);
+            uint8_t lazyData = lazyCia.read(access.addr);
+            reads++;
+            if (data != lazyData) {
+                snprintf(message, sizeof(message), "access %lu, cycle %lu: read $%02x gave $%02x, lazy $%02x",
+                         (unsigned long)next, clk, access.addr, data, lazyData);
+                fail(message);
+                return;
+            }
+        }
+
+        if (cia.irq != lazyCia.irq || cia.irqChanges != lazyCia.irqChanges || cia.irqClk != lazyCia.irqClk) {
+            snprintf(message, sizeof(message), "access %lu, cycle %lu: irq %d after %d changes (last at %lu), lazy %d after %d (last at %lu)",
+                     (unsigned long)next, clk, cia.irq, cia.irqChanges, (unsigned long)cia.irqClk,
+                     lazyCia.irq, lazyCia.irqChanges, (unsigned long)lazyCia.irqClk);
+            fail(message);
+            return;
+        }
+
+        if (next < script.accesses.size())
+            schedule(scheduler, script.accesses[next].delay, EVENT_CLOCK_PHI2);
+    }
+
+    void fail(const char* message)
+    {
+        failed = true;
+        error = message;
+    }
+};
+
+
+// ----------------------------------------------------------------------------
+// scripts
+// ----------------------------------------------------------------------------
+
+// Reads at offsets shifting by a cycle each time, so that they fall on
+// every cycle of a timer period in turn.
+static void readShifting(Script& script, int count, event_clock_t interval)
+{
+    for (int i = 0; i < count; i++)
+        script.wait(interval + i).readTimers();
+}
+
+static Script continuousA(uint_least16_t latch)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "continuous-a-%04x", latch);
+    Script script(name);
+    script.latchA(latch).write(CRA, 0x11);
+    readShifting(script, 48, 97);
+    script.read(ICR).wait(3 * latch + 5).read(ICR);
+    // the interrupt made visible, then masked again
+    script.write(ICR, 0x81).wait(latch + 3).read(ICR).read(ICR);
+    readShifting(script, 16, 13);
+    script.write(ICR, 0x01).wait(2 * latch + 7).readTimers().read(ICR);
+    return script;
+}
+
+static Script continuousB(uint_least16_t latch)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "continuous-b-%04x", latch);
+    Script script(name);
+    script.latchB(latch).write(CRB, 0x11);
+    readShifting(script, 48, 89);
+    script.read(ICR).write(ICR, 0x82).wait(latch + 2).read(ICR);
+    script.write(ICR, 0x02);
+    readShifting(script, 16, 31);
+    script.read(ICR);
+    return script;
+}
+
+static Script oneShot()
+{
+    Script script("one-shot");
+    // timer A, pulse then toggle on port B
+    script.latchA(0x0321).write(CRA, 0x1b);
+    readShifting(script, 12, 71);
+    script.read(CRA).read(ICR).wait(0x0321).readTimers().read(CRA);
+    script.write(CRA, 0x1f).wait(0x0320).readTimers().readTimers().read(CRA).read(ICR);
+    // timer B, with its interrupt
+    script.write(ICR, 0x82).latchB(0x0007).write(CRB, 0x19);
+    for (int i = 0; i < 12; i++)
+        script.readTimers().read(ICR);
+    script.read(CRB);
+    // restarted while still running, without and with a forced load
+    script.latchA(0x1234).write(CRA, 0x19).wait(100).write(CRA, 0x09).wait(50).readTimers();
+    script.write(CRA, 0x19).wait(0x1234).readTimers().read(CRA).read(ICR);
+    return script;
+}
+
+static Script cascade(uint_least16_t latchA, uint_least16_t latchB)
+{
+    char name[40];
+    snprintf(name, sizeof(name), "cascade-%04x-%04x", latchA, latchB);
+    Script script(name);
+    script.latchA(latchA).latchB(latchB).write(CRA, 0x11).write(CRB, 0x51);
+    readShifting(script, 32, 17);
+    script.read(ICR);
+    // timer B between phi2 and timer A underflows
+    script.write(CRB, 0x01);
+    readShifting(script, 16, 23);
+    script.write(CRB, 0x41);
+    readShifting(script, 16, 29);
+    script.write(ICR, 0x82).wait(8 * (latchA + 1) * (latchB + 1)).read(ICR).read(ICR);
+    script.write(ICR, 0x02).write(CRB, 0x49).wait(4 * (latchA + 1) * (latchB + 1)).readTimers().read(CRB).read(ICR);
+    // timer A stopped under a counting timer B
+    script.write(CRB, 0x51).wait(50).write(CRA, 0x00).wait(200).readTimers().write(CRA, 0x01);
+    readShifting(script, 16, 7);
+    script.read(ICR);
+    return script;
+}
+
+static Script latchWrites()
+{
+    Script script("latch-writes");
+    script.latchA(0x1234).latchB(0x0321).write(CRA, 0x01).write(CRB, 0x01);
+    // new latches while running only load at the next underflow
+    script.wait(100).latchA(0x0007).latchB(0x0002).readTimers();
+    script.wait(0x1234).readTimers().read(ICR);
+    readShifting(script, 16, 3);
+    // high byte while stopped loads the counter
+    script.write(CRA, 0x00).write(TAH, 0x03).readTimers().write(TAL, 0x21).readTimers();
+    script.write(CRA, 0x01);
+    readShifting(script, 16, 101);
+    // forced loads while running
+    script.latchA(0x0005).write(CRA, 0x11).readTimers().wait(2).write(CRA, 0x11).readTimers();
+    script.latchB(0x0000).write(CRB, 0x11).readTimers().read(ICR);
+    readShifting(script, 16, 2);
+    script.latchA(0x0000).latchB(0x0001).write(CRA, 0x11).write(CRB, 0x11);
+    readShifting(script, 16, 1);
+    script.write(CRB, 0x51);
+    readShifting(script, 16, 1);
+    script.read(ICR);
+    return script;
+}
+
+static Script irqSwitching()
+{
+    Script script("irq-switching");
+    script.latchA(0x0007).latchB(0x0321).write(CRA, 0x01).write(CRB, 0x01);
+    for (int i = 0; i < 64; i++) {
+        uint8_t mask = 0x01 << (i & 1);
+        script.wait(i * 5).write(ICR, 0x80 | mask).wait(i % 11).read(ICR);
+        script.wait(i * 3).write(ICR, mask).wait(i * 7).readTimers();
+    }
+    // serial port and one shot take the timer out of lazy mode too
+    script.write(CRA, 0x41).write(SDR, 0x55).wait(200).read(ICR).write(CRA, 0x01).wait(99).read(ICR);
+    script.write(CRA, 0x09).wait(300).readTimers().read(CRA).read(ICR);
+    return script;
+}
+
+// Deterministic on every platform, unlike rand().
+static unsigned nextRandom(unsigned& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static Script randomAccesses(unsigned seed, int count)
+{
+    static const uint_least16_t latches[] = { 0x0000, 0x0001, 0x0002, 0x0005, 0x0007, 0x0321, 0x1234, 0x00ff };
+    static const int numLatches = sizeof(latches) / sizeof(latches[0]);
+    static const uint8_t readable[] = { TAL, TAH, TBL, TBH, PRB, ICR, CRA, CRB };
+
+    char name[32];
+    snprintf(name, sizeof(name), "random-%u", seed);
+    Script script(name);
+    unsigned state = seed * 2654435761u + 1;
+
+    for (int i = 0; i < count; i++) {
+        unsigned r = nextRandom(state);
+        unsigned wait = nextRandom(state);
+        // mostly close together, sometimes across many periods
+        if (wait % 16 == 0)
+            script.wait(wait % 20000);
+        else
+            script.wait(wait % 8);
+
+        switch (r % 16) {
+            case 0: script.latchA(latches[(r >> 8) % numLatches]); break;
+            case 1: script.latchB(latches[(r >> 8) % numLatches]); break;
+            case 2: script.write((r & 0x100) ? TAL : TAH, r >> 16); break;
+            case 3: script.write((r & 0x100) ? TBL : TBH, r >> 16); break;
+            case 4: script.write(CRA, (r >> 8) & 0x9f); break;
+            case 5: script.write(CRB, (r >> 8) & 0x7f); break;
+            case 6: script.write(ICR, (r >> 8) & 0x83); break;
+            case 7: script.read(ICR); break;
+            case 8: script.readTimers(); break;
+            default: script.read(readable[(r >> 8) % sizeof(readable)]); break;
+        }
+    }
+    return script;
+}
+
+
+// ----------------------------------------------------------------------------
+// main
+// ----------------------------------------------------------------------------
+
+static void usage(const char* name)
+{
+    printf("usage: %s [options]\n", name);
+    printf("  -n <count>    random accesses per seed (default 20000)\n");
+    printf("  -b <text>     check only the scripts whose name contains the text\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* filter = NULL;
+    int numRandom = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (arg[0] != '-' || arg[1] == '\0' || arg[2] != '\0' || i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        switch (arg[1]) {
+            case 'n': numRandom = atoi(value); break;
+            case 'b': filter = value; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    std::vector<Script> scripts;
+    scripts.push_back(continuousA(0x1234));
+    scripts.push_back(continuousA(0x0007));
+    scripts.push_back(continuousA(0x0001));
+    scripts.push_back(continuousA(0x0000));
+    scripts.push_back(continuousB(0x0321));
+    scripts.push_back(continuousB(0x0002));
+    scripts.push_back(continuousB(0x0000));
+    scripts.push_back(oneShot());
+    scripts.push_back(cascade(0x1234, 0x0321));
+    scripts.push_back(cascade(0x0007, 0x0002));
+    scripts.push_back(cascade(0x0000, 0x0001));
+    scripts.push_back(cascade(0x0005, 0x0000));
+    scripts.push_back(latchWrites());
+    scripts.push_back(irqSwitching());
+    for (unsigned seed = 1; seed <= 8; seed++)
+        scripts.push_back(randomAccesses(seed, numRandom));
+
+    int numChecked = 0, numFailed = 0;
+    for (size_t s = 0; s < scripts.size(); s++) {
+        if (filter && strstr(scripts[s].name.c_str(), filter) == NULL)
+            continue;
+
+        ScriptRunner runner(scripts[s]);
+        bool passed = runner.run();
+        numChecked++;
+        if (passed) {
+            printf("%s\tok\t%d reads\n", scripts[s].name.c_str(), runner.reads);
+        }
+        else {
+            printf("%s\tFAIL\t%s\n", scripts[s].name.c_str(), runner.error.c_str());
+            numFailed++;
+        }
+    }
+
+    printf("total\t%d scripts\t%d failed\n", numChecked, numFailed);
+    return numFailed ? 1 : 0;
+}
@@ -0,0 +1,387 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+// Checks the instruction level 6510 engine (sid2_config_t::cpuEmulation
+// SID2_CPU_FAST) against the cycle based one.  Both run the same routine
+// in a sidplay1 environment as a play call would, and the writes, the
+// reads of the I/O area (the only ones that can have side effects), the
+// bank jump checks, the registers and the whole memory afterwards have
+// to be the same.  Reads of RAM and ROM are not compared: the cycle based
+// engine also reads the bytes after RTS and RTI as timing fillers.  The
+// routines cover JSR/RTS and RTI (run as RTS in these environments)
+// nesting, decimal mode, the addressing modes, and random code from
+// fixed seeds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "mos6510/mos6510.h"
+
+
+static const uint_least16_t CODE = 0x1000;
+
+
+// An access seen by the environment.
+struct BusAccess
+{
+    enum Kind { READ_IO, WRITE, BANK_JUMP };
+
+    Kind            kind;
+    uint_least16_t  addr;
+    uint8_t         data;
+
+    bool operator!=(const BusAccess& other) const
+    {
+        return kind != other.kind || addr != other.addr || data != other.data;
+    }
+};
+
+// Flat 64K of RAM around the CPU, I/O included, logging the accesses.
+class LogEnvironment : public C64Environment
+{
+public:
+    LogEnvironment() : sleeping(false), endless(false) { memset(ram, 0, sizeof(ram)); }
+
+    uint8_t                 ram[0x10000];
+    std::vector<BusAccess>  accesses;
+    bool                    sleeping;
+    bool                    endless;    // stopped by the timeout of the routine
+
+protected:
+    void    envReset           (void) { endless = true; }
+    uint8_t envReadMemByte     (uint_least16_t addr) { return read(addr); }
+    uint8_t envReadMemDataByte (uint_least16_t addr) { return read(addr); }
+    void    envWriteMemByte    (uint_least16_t addr, uint8_t data) { log(BusAccess::WRITE, addr, data); ram[addr] = data; }
+    void    envTriggerIRQ      (void) {}
+    void    envTriggerNMI      (void) {}
+    void    envTriggerRST      (void) {}
+    void    envClearIRQ        (void) {}
+    bool    envCheckBankJump   (uint_least16_t addr) { log(BusAccess::BANK_JUMP, addr, 0); return true; }
+    void    envSleep           (void) { sleeping = true; }
+    void    envLoadFile        (char *) {}
+
+private:
+    uint8_t read(uint_least16_t addr)
+    {
+        if ((addr & 0xf000) == 0xd000)
+            log(BusAccess::READ_IO, addr, ram[addr]);
+        return ram[addr];
+    }
+
+    void log(BusAccess::Kind kind, uint_least16_t addr, uint8_t data)
+    {
+        BusAccess access = { kind, addr, data };
+        accesses.push_back(access);
+    }
+};
+
+// The registers of the 6510 after a routine.
+class CheckCpu : public SID6510
+{
+public:
+    CheckCpu(EventContext* context) : SID6510(context) {}
+
+    // only debug() on sends its messages elsewhere than stdout
+    void messages(FILE* out) { m_fdbg = out; }
+
+    std::string registers()
+    {
+        char text[80];
+        snprintf(text, sizeof(text), "pc %04x a %02x x %02x y %02x sp %03x nvzc %d%d%d%d dib %d%d%d",
+                 (unsigned)(Register_ProgramCounter & 0xffff), Register_Accumulator, Register_X, Register_Y,
+                 (unsigned)Register_StackPointer, (Register_n_Flag & 0x80) != 0, Register_v_Flag != 0,
+                 Register_z_Flag == 0, Register_c_Flag != 0, (Register_Status >> SR_DECIMAL) & 1,
+                 (Register_Status >> SR_INTERRUPT) & 1, (Register_Status >> SR_BREAK) & 1);
+        return text;
+    }
+};
+
+
+struct Routine
+{
+    std::string             name;
+    std::vector<uint8_t>    code;       // at CODE
+    std::vector<uint8_t>    data;       // at DATA
+    uint8_t                 a, x, y;
+};
+
+static const uint_least16_t DATA = 0x2000;
+
+// Runs a routine on one engine as a play call.
+class RoutineRunner
+{
+public:
+    RoutineRunner(const Routine& routine, bool fast, FILE* debugOut) :
+        scheduler("CPU Check Scheduler"),
+        cpu(&scheduler)
+    {
+        memcpy(&env.ram[CODE], &routine.code[0], routine.code.size());
+        if (!routine.data.empty())
+            memcpy(&env.ram[DATA], &routine.data[0], routine.data.size());
+
+        cpu.setEnvironment(&env);
+        cpu.environment(sid2_envPS);
+        cpu.fastMode(fast);
+        cpu.messages(debugOut);
+        scheduler.reset();
+        cpu.reset(CODE, routine.a, routine.x, routine.y);
+
+        while (!env.sleeping)
+            scheduler.clock();
+    }
+
+    EventScheduler  scheduler;
+    LogEnvironment  env;
+    CheckCpu        cpu;
+};
+
+
+// ----------------------------------------------------------------------------
+// routines
+// ----------------------------------------------------------------------------
+
+static Routine routine(const char* name, const uint8_t* code, size_t size)
+{
+    Routine r;
+    r.name = name;
+    r.code.assign(code, code + size);
+    r.a = 0x12;
+    r.x = 0x34;
+    r.y = 0x56;
+    return r;
+}
+
+// Subroutines three deep, returning through RTS and RTI alike.
+static Routine returns()
+{
+    static const uint8_t code[] = {
+        0xa2, 0x03,             // $1000 LDX #$03
+        0x20, 0x10, 0x10,       // $1002 JSR $1010
+        0xca,                   // $1005 DEX
+        0xd0, 0xfa,             // $1006 BNE $1002
+        0x8d, 0x00, 0xd4,       // $1008 STA $D400
+        0x60,                   // $100b RTS
+        0xea, 0xea, 0xea, 0xea, // $100c
+        0xee, 0x00, 0x20,       // $1010 INC $2000
+        0x20, 0x20, 0x10,       // $1013 JSR $1020
+        0xa9, 0x10,             // $1016 LDA #>$102f
+        0x48,                   // $1018 PHA
+        0xa9, 0x2f,             // $1019 LDA #<$102f
+        0x48,                   // $101b PHA
+        0x40,                   // $101c RTI, on to $1030
+        0xea, 0xea, 0xea,       // $101d
+        0xad, 0x0d, 0xdc,       // $1020 LDA $DC0D
+        0x9d, 0x01, 0x20,       // $1023 STA $2001,X
+        0x8a,                   // $1026 TXA
+        0x8d, 0x01, 0xd4,       // $1027 STA $D401
+        0x60,                   // $102a RTS
+        0xea, 0xea, 0xea, 0xea, 0xea,
+        0x8e, 0x08, 0xd4,       // $1030 STX $D408
+        0x60                    // $1033 RTS
+    };
+    return routine("returns", code, sizeof(code));
+}
+
+// A table summed in decimal mode and shifted through the addressing modes.
+static Routine addressing()
+{
+    static const uint8_t code[] = {
+        0xf8,                   // SED
+        0xa0, 0x00,             // LDY #$00
+        0xa9, 0x00,             // LDA #$00
+        0x85, 0xf0,             // STA $F0
+        0xa9, 0x20,             // LDA #$20
+        0x85, 0xf1,             // STA $F1
+        0x18,                   // CLC         loop:
+        0x71, 0xf0,             // ADC ($F0),Y
+        0x99, 0x00, 0x21,       // STA $2100,Y
+        0xe9, 0x07,             // SBC #$07
+        0x96, 0x80,             // STX $80,Y
+        0xb6, 0x80,             // LDX $80,Y
+        0x3e, 0x00, 0x20,       // ROL $2000,X
+        0x5e, 0x01, 0x20,       // LSR $2001,X
+        0xf6, 0x90,             // INC $90,X
+        0x24, 0x90,             // BIT $90
+        0x08,                   // PHP
+        0x68,                   // PLA
+        0x9d, 0x00, 0xd4,       // STA $D400,X
+        0xc8,                   // INY
+        0xc0, 0x40,             // CPY #$40
+        0xd0, 0xe2,             // BNE loop
+        0xd8,                   // CLD
+        0x6c, 0x00, 0x22,       // JMP ($2200)
+    };
+    Routine r = routine("addressing", code, sizeof(code));
+    r.data.resize(0x300);
+    for (int i = 0; i < 0x100; i++)
+        r.data[i] = (uint8_t)(i * 37 + 11);
+    // JMP ($2200) to an RTS
+    r.data[0x200] = 0x00;
+    r.data[0x201] = 0x30;
+    r.data.resize(0x1001);
+    r.data[0x1000] = 0x60;
+    return r;
+}
+
+// Deterministic on every platform, unlike rand().
+static unsigned nextRandom(unsigned& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Random code and data.  Jumps elsewhere mostly land on BRK, which ends
+// the routine as RTS does in these environments.
+static Routine randomCode(unsigned seed)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "random-%u", seed);
+    unsigned state = seed * 2654435761u + 1;
+
+    Routine r;
+    r.name = name;
+    r.code.resize(0x100);
+    r.data.resize(0x100);
+    for (size_t i = 0; i < r.code.size(); i++)
+        r.code[i] = (uint8_t)nextRandom(state);
+    for (size_t i = 0; i < r.data.size(); i++)
+        r.data[i] = (uint8_t)nextRandom(state);
+    r.a = (uint8_t)nextRandom(state);
+    r.x = (uint8_t)nextRandom(state);
+    r.y = (uint8_t)nextRandom(state);
+    return r;
+}
+
+
+// ----------------------------------------------------------------------------
+// main
+// ----------------------------------------------------------------------------
+
+static bool check(const Routine& routine, FILE* debugOut, std::string& error)
+{
+    RoutineRunner cycle(routine, false, debugOut);
+    RoutineRunner fast(routine, true, debugOut);
+    const std::vector<BusAccess>& expected = cycle.env.accesses;
+    const std::vector<BusAccess>& accesses = fast.env.accesses;
+    static const char* kinds[] = { "read", "write", "bank jump" };
+    char message[160];
+
+    // The timeout counts cycles on one and instructions on the other, so
+    // endless loops are only compared as far as the shorter one ran
+    bool endless = cycle.env.endless || fast.env.endless;
+    if (cycle.env.endless != fast.env.endless) {
+        error = cycle.env.endless ? "endless, fast not" : "fast endless, cycle based not";
+        return false;
+    }
+
+    for (size_t i = 0; i < expected.size() && i < accesses.size(); i++) {
+        if (expected[i] != accesses[i]) {
+            snprintf(message, sizeof(message), "access %lu: %s $%04x $%02x, fast %s $%04x $%02x", (unsigned long)i,
+                     kinds[expected[i].kind], expected[i].addr, expected[i].data,
+                     kinds[accesses[i].kind], accesses[i].addr, accesses[i].data);
+            error = message;
+            return false;
+        }
+    }
+    if (endless)
+        return true;
+    if (expected.size() != accesses.size()) {
+        snprintf(message, sizeof(message), "%lu accesses, fast %lu", (unsigned long)expected.size(), (unsigned long)accesses.size());
+        error = message;
+        return false;
+    }
+
+    std::string registers = cycle.cpu.registers();
+    std::string fastRegisters = fast.cpu.registers();
+    if (registers != fastRegisters) {
+        error = registers + ", fast " + fastRegisters;
+        return false;
+    }
+
+    for (int addr = 0; addr < 0x10000; addr++) {
+        if (cycle.env.ram[addr] != fast.env.ram[addr]) {
+            snprintf(message, sizeof(message), "memory $%04x $%02x, fast $%02x", addr, cycle.env.ram[addr], fast.env.ram[addr]);
+            error = message;
+            return false;
+        }
+    }
+    return true;
+}
+
+static void usage(const char* name)
+{
+    printf("usage: %s [options]\n", name);
+    printf("  -n <count>    random routines (default 200)\n");
+    printf("  -b <text>     check only the routines whose name contains the text\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* filter = NULL;
+    unsigned numRandom = 200;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (arg[0] != '-' || arg[1] == '\0' || arg[2] != '\0' || i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        switch (arg[1]) {
+            case 'n': numRandom = (unsigned)atoi(value); break;
+            case 'b': filter = value; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    std::vector<Routine> routines;
+    routines.push_back(returns());
+    routines.push_back(addressing());
+    for (unsigned seed = 1; seed <= numRandom; seed++)
+        routines.push_back(randomCode(seed));
+
+    // the endless loops of random code are reported by both engines
+    FILE* debugOut = fopen("/dev/null", "w");
+
+    int numChecked = 0, numFailed = 0;
+    for (size_t r = 0; r < routines.size(); r++) {
+        if (filter && strstr(routines[r].name.c_str(), filter) == NULL)
+            continue;
+
+        std::string error;
+        numChecked++;
+        if (!check(routines[r], debugOut, error)) {
+            printf("%s\tFAIL\t%s\n", routines[r].name.c_str(), error.c_str());
+            numFailed++;
+        }
+        else if (routines[r].name.compare(0, 7, "random-") != 0) {
+            printf("%s\tok\n", routines[r].name.c_str());
+        }
+    }
+
+    if (debugOut)
+        fclose(debugOut);
+    printf("total\t%d routines\t%d failed\n", numChecked, numFailed);
+    return numFailed ? 1 : 0;
+}
@@ -100,6 +100,16 @@ public:
             m_gain = 200;
     }
 
+    // Snapshot support, xsid itself is saved with the player
+    int_least32_t stateSize (void)
+    {   return m_sid->stateSize (); }
+    void saveState (uint8_t *state)
+    {   m_sid->saveState (state); }
+    void restoreState (const uint8_t *state)
+    {   m_sid->restoreState (state); }
+    void seek (bool enable)
+    {   m_sid->seek (enable); }
+
     // Xsid specific
     void emulation (sidemu *sid) {m_sid = sid;}
     sidemu *emulation (void) { return m_sid; }
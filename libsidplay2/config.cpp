@@ -180,6 +180,9 @@ int Player::config (const sid2_config_t &cfg)
         goto Player_configure_error;
     }
 
+    // Old snapshots/keyframes no longer match the machine
+    keyframeReset ();
+
     // Check for base sampling frequency
     if (cfg.frequency < 4000)
     {   // Rev 1.6 (saw) - Added descriptive error
@@ -231,6 +234,9 @@ int Player::config (const sid2_config_t &cfg)
             float64_t cpuFreq;
             // Must be this order:
             // Determine clock speed
+            vic.lazy  (cfg.lazyRaster);
+            cia.lazy  (cfg.lazyTimers);
+            cia2.lazy (cfg.lazyTimers);
             cpuFreq = clockSpeed (cfg.clockSpeed, cfg.clockDefault,
                                   cfg.clockForced);
             // Fixed point conversion 16.16
@@ -277,6 +283,7 @@ int Player::config (const sid2_config_t &cfg)
         monosid = !m_tuneInfo.sidChipBase2;
     }
     sidSamples (cfg.sidSamples);
+    cpu.fastMode (cfg.cpuEmulation == SID2_CPU_FAST);
 
     // All parameters check out, so configure player.
     m_info.channels = 1;
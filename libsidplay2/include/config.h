@@ -115,7 +115,11 @@
    (like Motorola and SPARC, unlike Intel and VAX). */
 
 // [AV]
+#ifdef __APPLE__
 #include "TargetConditionals.h"
+#elif defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define TARGET_RT_LITTLE_ENDIAN 1
+#endif
    
 #if TARGET_RT_LITTLE_ENDIAN
 	#undef WORDS_BIGENDIAN
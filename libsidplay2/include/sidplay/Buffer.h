@@ -49,6 +49,17 @@ template <class T> class Buffer_sidtt
 		bufLen = newLen;
 		return (buf!=0);
 	}
+
+	// Refer to memory owned by someone else, it is not freed
+	// by erase() and must outlive the buffer.
+	bool borrow(T* newBuf, uint_least32_t newLen)
+	{
+		erase();
+		buf = newBuf;
+		bufLen = newLen;
+		owned = false;
+		return (buf!=0);
+	}
 	
 	T* get(void) const  { return buf; }
 	uint_least32_t len(void) const  { return bufLen; }
@@ -76,10 +87,11 @@ template <class T> class Buffer_sidtt
 	}
 	
 	bool isEmpty(void) const  { return (buf==0); }
+	bool isOwned(void) const  { return owned; }
 
 	void erase(void)
 	{
-		if (buf!=0 && bufLen!=0)
+		if (buf!=0 && bufLen!=0 && owned)
 		{
 #ifndef SID_HAVE_BAD_COMPILER
 			delete[] buf;
@@ -98,12 +110,14 @@ template <class T> class Buffer_sidtt
  private:
 	T* buf;
 	uint_least32_t bufLen;
+	bool owned;
 	T dummy;
         
 	void kill(void)
 	{
 		buf = 0;
 		bufLen = 0;
+		owned = true;
 	}
 	
  private:	// prevent copying
@@ -162,7 +162,11 @@ class SID_EXTERN SidTune
 
     // Load a single-file sidtune from a memory buffer.
     // Currently supported: PSID format
-    SidTune(const uint_least8_t* oneFileFormatSidtune, const uint_least32_t sidtuneLength);
+    // With ``borrowBuffer'' the data is parsed in place instead of being
+    // copied, and must then stay valid and unchanged until the object is
+    // destroyed or loads another sidtune.
+    SidTune(const uint_least8_t* oneFileFormatSidtune, const uint_least32_t sidtuneLength,
+            const bool borrowBuffer = false);
 
     virtual ~SidTune();
 
@@ -177,7 +181,8 @@ class SID_EXTERN SidTune
     bool load(const char* fileName, const bool separatorIsSlash = false);
     
     // From a buffer.
-    bool read(const uint_least8_t* sourceBuffer, const uint_least32_t bufferLen);
+    bool read(const uint_least8_t* sourceBuffer, const uint_least32_t bufferLen,
+              const bool borrowBuffer = false);
 
     // Select sub-song (0 = default starting song)
     // and retrieve active song information.
@@ -347,7 +352,8 @@ class SID_EXTERN SidTune
     void deleteFileNameCopies();
     
     // Try to retrieve single-file sidtune from specified buffer.
-    void getFromBuffer(const uint_least8_t* const buffer, const uint_least32_t bufferLen);
+    void getFromBuffer(const uint_least8_t* const buffer, const uint_least32_t bufferLen,
+                       const bool borrowBuffer = false);
     
     // Cache the data of a single-file or two-file sidtune and its
     // corresponding file names.
@@ -28,6 +28,8 @@
 //#include <sidplay/sidbuilder.h>
 //#include <sidplay/event.h>
 
+struct sid_profile;
+
 
 /***************************************************************************
  * ReSID Builder Class
@@ -63,6 +65,10 @@ public:
     void filter   (bool enable);
     void set_filter   (const sid_filter_t *filter, bool overrideCutoffCurve);
     void sampling (uint_least32_t freq);
+
+    // Stage profile summed over all SIDs, false unless resid is built
+    // with RESID_PROFILE
+    bool profile  (sid_profile &total, bool reset);
 };
 
 #endif // _resid_h_
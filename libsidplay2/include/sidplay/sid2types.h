@@ -44,6 +44,7 @@ typedef enum {sid2_envPS = 0, sid2_envTP, sid2_envBS,  sid2_envR,
               sid2_envTR} sid2_env_t;
 typedef enum {SID2_MODEL_CORRECT, SID2_MOS6581, SID2_MOS8580}      sid2_model_t;
 typedef enum {SID2_CLOCK_CORRECT, SID2_CLOCK_PAL, SID2_CLOCK_NTSC} sid2_clock_t;
+typedef enum {SID2_CPU_CYCLE,     SID2_CPU_FAST}                   sid2_cpu_t;
 
 typedef enum
 {   // Soundcard sample format
@@ -60,6 +61,12 @@ sid2_envBS = Sidplay  - Bankswitching
 sid2_envR  = Sidplay2 - Real C64 Environment
 */
 
+/* CPU Emulation
+SID2_CPU_CYCLE = Cycle based (all environments)
+SID2_CPU_FAST  = Instruction based, sidplay1 environments only.  Intended
+                 for analysis/batch work, real mode is always cycle based
+*/
+
 struct sid2_config_t
 {
     sid2_clock_t        clockDefault;  // Intended tune speed when unknown
@@ -80,6 +87,10 @@ struct sid2_config_t
     sid2_sample_t       sampleFormat;
     uint_least16_t      powerOnDelay;
     uint_least32_t      sid2crcCount;  // Max sid writes to form crc
+    sid2_cpu_t          cpuEmulation;
+    bool                lazyRaster;    // VIC only wakes for irqs/bad lines
+    bool                lazyTimers;    // CIAs only wake for seen underflows
+    uint_least32_t      keyframeInterval; // Seconds between seek keyframes (0 = off)
 };
 
 struct sid2_info_t
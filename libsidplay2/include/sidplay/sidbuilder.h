@@ -48,6 +48,17 @@ public:
     virtual void          mute    (uint_least8_t num, bool enable) = 0;
     virtual void          gain    (int_least8_t precent) = 0;
     sidbuilder           *builder (void) const { return m_builder; }
+
+    // Machine snapshot support (-1 = unsupported).  Emulations with
+    // state outside of the player (i.e. real hardware) must not
+    // provide these.
+    virtual int_least32_t stateSize    (void) { return -1; }
+    virtual void          saveState    (uint8_t *) { ; }
+    virtual void          restoreState (const uint8_t *) { ; }
+
+    // Whilst seeking only register writes need to be tracked,
+    // no output will be requested.
+    virtual void          seek         (bool) { ; }
 };
 
 
@@ -15,7 +15,11 @@
    with the least significant byte first (like Intel and VAX).  */
 
 // [AV]
+#ifdef __APPLE__
 #include "TargetConditionals.h"
+#elif defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define TARGET_RT_LITTLE_ENDIAN 1
+#endif
    
 #if TARGET_RT_LITTLE_ENDIAN
 	#define SID_WORDS_LITTLEENDIAN
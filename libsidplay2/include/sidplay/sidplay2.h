@@ -51,6 +51,16 @@ public:
     void           pause        (void);
     uint_least32_t play         (void *buffer, uint_least32_t length);
     sid2_player_t  state        (void) const;
+    int            restore      (const void *state);
+    uint_least32_t samples      (void) const;
+    int            seek         (uint_least32_t time);
+    // Snapshots (snapshotSize bytes, 0 when the sid emulation has no
+    // state support) are raw images of the emulated components, not a
+    // file format.  They can only be restored by the player which made
+    // them, before the next config() or load(), and must not be stored
+    // beyond its lifetime or passed to another process or build.
+    int            snapshot     (void *state);
+    uint_least32_t snapshotSize (void);
     void           stop         (void);
     void           debug        (bool enable, FILE *out);
 
@@ -58,9 +68,11 @@ public:
     uint_least32_t timebase (void) const;
     uint_least32_t time     (void) const;
     uint_least32_t mileage  (void) const;
+    event_clock_t  cycles   (void) const;   // CPU cycles since the tune was loaded
 
 	const SIDPLAY2_NAMESPACE::SidRegisterFrame& getCurrentRegisterFrame() const;
 	void setRegisterFrameChangedCallback(void* inInstance, SIDPLAY2_NAMESPACE::SidRegisterFrameChangedCallback inCallback);
+	void setSidWriteCallback(void* inInstance, SIDPLAY2_NAMESPACE::SidWriteCallback inCallback);
 
     operator bool()  const { return (&sidplayer ? true: false); }
     bool operator!() const { return (&sidplayer ? false: true); }
@@ -69,12 +69,39 @@ SIDPLAY2_NAMESPACE_START
 
 void Player::mixerReset (void)
 {   // Fixed point 16.16
-    m_sampleClock  = m_samplePeriod & 0x0FFFF;
+    m_sampleClock    = m_samplePeriod & 0x0FFFF;
+    m_samplePosition = 0;
     // Schedule next sample event
+    m_mixerClk = context ().getTime (EVENT_CLOCK_PHI1) + (m_samplePeriod >> 16);
     m_mixerEvent.schedule (context (),
         m_samplePeriod >> 16, EVENT_CLOCK_PHI1);
 }
 
+// Restart the mixer after it was stopped for a seek, on the same
+// sample clock as if it had kept running.  The samples it missed
+// are still counted so the position can be matched to a continuous
+// playback.
+void Player::mixerResume (void)
+{
+    event_clock_t  now    = context ().getTime (EVENT_CLOCK_PHI1);
+    uint_least32_t passed = (uint_least32_t) (now - m_mixerClk);
+    uint64_t       clock  = m_sampleClock;
+
+    // Not passed when the stop was shorter than a sample
+    if (passed && (passed < 0x80000000))
+    {   // Samples missed, the first one due at or after now
+        uint64_t missed = (((uint64_t) passed << 16) - m_sampleClock
+                        + m_samplePeriod - 1) / m_samplePeriod;
+        clock            += missed * m_samplePeriod;
+        m_mixerClk       += (event_clock_t) (clock >> 16);
+        m_sampleClock     = (event_clock_t) (clock & 0x0FFFF);
+        m_samplePosition += (uint_least32_t) missed;
+    }
+
+    m_mixerEvent.schedule (context (),
+        (event_clock_t) (uint_least32_t) (m_mixerClk - now), EVENT_CLOCK_PHI1);
+}
+
 void Player::mixer (void)
 { 
 
@@ -89,8 +116,10 @@ void Player::mixer (void)
     cycles         = m_sampleClock >> 16;
     m_sampleClock &= 0x0FFFF;
     m_sampleIndex += (this->*output) (buf);
+    m_samplePosition++;
  
     // Schedule next sample event
+    m_mixerClk += cycles;
     m_mixerEvent.schedule (context (), cycles, EVENT_CLOCK_PHI1);
 
     // Filled buffer
@@ -98,6 +98,7 @@ private:
     sid2_env_t    m_mode;
     event_clock_t m_delayClk;
     bool          m_framelock;
+    bool          m_fastCpu;
 
 public:
     SID6510 (EventContext *context);
@@ -107,6 +108,7 @@ public:
     void reset (uint_least16_t pc, uint8_t a, uint8_t x, uint8_t y);
 
     void environment (sid2_env_t mode) { m_mode = mode; }
+    void fastMode    (bool enable)     { m_fastCpu = enable; }
     void triggerRST (void);
     void triggerNMI (void);
     void triggerIRQ (void);
@@ -126,6 +128,10 @@ private:
     inline void sid_cli  (void);
     inline void sid_rti  (void);
     inline void sid_irq  (void);
+
+    // Instruction level execution (sidplay1 modes only)
+    void        fast_frame (void);
+    inline void fast_instr (void);
 };
 
 #endif // _sid6510c_h_
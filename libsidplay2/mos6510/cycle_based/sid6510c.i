@@ -155,7 +155,8 @@
 SID6510::SID6510 (EventContext *context)
 :MOS6510(context),
  m_mode(sid2_envR),
- m_framelock(false)
+ m_framelock(false),
+ m_fastCpu(false)
 {   // Ok start all the hacks for sidplay.  This prevents
     // execution of code in roms.  For real c64 emulation
     // create object from base class!  Also stops code
@@ -267,6 +268,12 @@ void SID6510::FetchOpcode (void)
         return;
     }
     
+    if (m_fastCpu && !m_framelock)
+    {   // Whole routine an instruction at a time
+        fast_frame ();
+        return;
+    }
+
     // Sid tunes end by wrapping the stack.  For compatibilty it
     // has to be handled.
     m_sleeping |= (endian_16hi8  (Register_StackPointer)   != SP_PAGE);
@@ -0,0 +1,629 @@
+/***************************************************************************
+                          sid6510f.i  -  Sidplay Specific 6510 emulation
+                                         (instruction level fast path)
+                             -------------------
+    begin                : Mon Oct 19 2026
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+// In the sidplay1 environments a whole play/init call is executed inside
+// a single cpu event (see SID6510::FetchOpcode) so the scheduler never
+// sees the individual cycles.  This path does the same thing a complete
+// instruction at a time rather than walking the per cycle function tables.
+// Memory accesses and the sidplay compatibility hacks (bank jumps, brk,
+// rti, cli, illegal instructions) are identical to the cycle based code.
+
+
+//**************************************************************************************
+// Execute the routine until the processor goes to sleep
+//**************************************************************************************
+void SID6510::fast_frame (void)
+{
+    uint timeout = 6000000;
+    m_framelock = true;
+
+    for (;;)
+    {   // Sid tunes end by wrapping the stack.
+        m_sleeping |= (endian_16hi8  (Register_StackPointer)   != SP_PAGE);
+        m_sleeping |= (endian_32hi16 (Register_ProgramCounter) != 0);
+        if (m_sleeping || !timeout)
+            break;
+        fast_instr ();
+        timeout--;
+    }
+
+    if (!timeout)
+    {
+        fprintf   (m_fdbg, "\n\nINFINITE LOOP DETECTED *********************************\n");
+        envReset ();
+    }
+    sleep ();
+    m_framelock = false;
+}
+
+
+//**************************************************************************************
+// Execute one complete instruction
+//**************************************************************************************
+void SID6510::fast_instr (void)
+{
+    bool read = false;
+
+    interrupts.irqLatch = false;
+    instrStartPC = endian_32lo16 (Register_ProgramCounter++);
+    instrOpcode  = envReadMemByte (instrStartPC);
+
+    //---------------------------------------------------------------------------------------
+    // Addressing modes
+    switch (instrOpcode)
+    {
+    // Accumulator or Implied addressing
+    case ASLn: case CLCn: case CLDn: case CLIn: case CLVn:  case DEXn:
+    case DEYn: case INXn: case INYn: case LSRn: case NOPn_: case PHAn:
+    case PHPn: case PLAn: case PLPn: case ROLn: case RORn:
+    case SECn: case SEDn: case SEIn: case TAXn:  case TAYn:
+    case TSXn: case TXAn: case TXSn: case TYAn:
+    // The cycle table reads two bytes after these as timing fillers,
+    // the popped address replaces the PC either way
+    case RTIn: case RTSn:
+    break;
+
+    // Immediate and Relative Addressing Mode Handler
+    case ADCb: case ANDb:  case ANCb_: case ANEb: case ASRb: case ARRb:
+    case BCCr: case BCSr:  case BEQr:  case BMIr: case BNEr: case BPLr:
+    case BRKn: case BVCr:  case BVSr:  case CMPb: case CPXb: case CPYb:
+    case EORb: case LDAb:  case LDXb:  case LDYb: case LXAb: case NOPb_:
+    case ORAb: case SBCb_: case SBXb:
+        Cycle_Data = envReadMemByte (endian_32lo16 (Register_ProgramCounter));
+        Register_ProgramCounter++;
+    break;
+
+    // Zero Page Addressing Mode Handler - Read & RMW
+    case ADCz:  case ANDz: case BITz: case CMPz: case CPXz: case CPYz:
+    case EORz:  case LAXz: case LDAz: case LDXz: case LDYz: case ORAz:
+    case NOPz_: case SBCz:
+    case ASLz: case DCPz: case DECz: case INCz: case ISBz: case LSRz:
+    case ROLz: case RORz: case SREz: case SLOz: case RLAz: case RRAz:
+        read = true;
+    case SAXz: case STAz: case STXz: case STYz:
+        Cycle_EffectiveAddress = envReadMemByte (endian_32lo16 (Register_ProgramCounter));
+        Register_ProgramCounter++;
+    break;
+
+    // Zero Page with X Offset Addressing Mode Handler
+    case ADCzx: case ANDzx:  case CMPzx: case EORzx: case LDAzx: case LDYzx:
+    case NOPzx_: case ORAzx: case SBCzx:
+    case ASLzx: case DCPzx: case DECzx: case INCzx: case ISBzx: case LSRzx:
+    case RLAzx: case ROLzx: case RORzx: case RRAzx: case SLOzx: case SREzx:
+        read = true;
+    case STAzx: case STYzx:
+        Cycle_EffectiveAddress = envReadMemByte (endian_32lo16 (Register_ProgramCounter));
+        Cycle_EffectiveAddress = (Cycle_EffectiveAddress + Register_X) & 0xFF;
+        Register_ProgramCounter++;
+    break;
+
+    // Zero Page with Y Offset Addressing Mode Handler
+    case LDXzy: case LAXzy:
+        read = true;
+    case STXzy: case SAXzy:
+        Cycle_EffectiveAddress = envReadMemByte (endian_32lo16 (Register_ProgramCounter));
+        Cycle_EffectiveAddress = (Cycle_EffectiveAddress + Register_Y) & 0xFF;
+        Register_ProgramCounter++;
+    break;
+
+    // Absolute Addressing Mode Handler
+    case ADCa: case ANDa: case BITa: case CMPa: case CPXa: case CPYa:
+    case EORa: case LAXa: case LDAa: case LDXa: case LDYa: case NOPa:
+    case ORAa: case SBCa:
+    case ASLa: case DCPa: case DECa: case INCa: case ISBa: case LSRa:
+    case ROLa: case RORa: case SLOa: case SREa: case RLAa: case RRAa:
+        read = true;
+    case JMPw: case JSRw: case SAXa: case STAa: case STXa: case STYa:
+        Cycle_EffectiveAddress = envReadMemByte (endian_32lo16 (Register_ProgramCounter));
+        Register_ProgramCounter++;
+        endian_16hi8 (Cycle_EffectiveAddress, envReadMemByte (endian_32lo16 (Register_ProgramCounter)));
+        Register_ProgramCounter++;
+    break;
+
+    // Absolute With X Offset Addressing Mode Handler
+    case ADCax: case ANDax:  case CMPax: case EORax: case LDAax:
+    case LDYax: case NOPax_: case ORAax: case SBCax:
+    case ASLax: case DCPax: case DECax: case INCax: case ISBax:
+    case LSRax: case RLAax: case ROLax: case RORax: case RRAax:
+    case SLOax: case SREax:
+        read = true;
+    case SHYax: case STAax:
+        Cycle_EffectiveAddress = envReadMemByte (endian_32lo16 (Register_ProgramCounter));
+        Register_ProgramCounter++;
+        endian_16hi8 (Cycle_EffectiveAddress, envReadMemByte (endian_32lo16 (Register_ProgramCounter)));
+        Register_ProgramCounter++;
+        Cycle_EffectiveAddress += Register_X;
+    break;
+
+    // Absolute With Y Offset Addresing Mode Handler
+    case ADCay: case ANDay: case CMPay: case EORay: case LASay:
+    case LAXay: case LDAay: case LDXay: case ORAay: case SBCay:
+    case DCPay: case ISBay: case RLAay: case RRAay: case SLOay:
+    case SREay:
+        read = true;
+    case SHAay: case SHSay: case SHXay: case STAay:
+        Cycle_EffectiveAddress = envReadMemByte (endian_32lo16 (Register_ProgramCounter));
+        Register_ProgramCounter++;
+        endian_16hi8 (Cycle_EffectiveAddress, envReadMemByte (endian_32lo16 (Register_ProgramCounter)));
+        Register_ProgramCounter++;
+        Cycle_EffectiveAddress += Register_Y;
+    break;
+
+    // Absolute Indirect Addressing Mode Handler
+    case JMPi:
+        Cycle_Pointer = envReadMemByte (endian_32lo16 (Register_ProgramCounter));
+        Register_ProgramCounter++;
+        endian_16hi8 (Cycle_Pointer, envReadMemByte (endian_32lo16 (Register_ProgramCounter)));
+        Register_ProgramCounter++;
+        FetchLowEffAddr  ();
+        FetchHighEffAddr ();
+    break;
+
+    // Indexed with X Preinc Addressing Mode Handler
+    case ADCix: case ANDix: case CMPix: case EORix: case LAXix: case LDAix:
+    case ORAix: case SBCix:
+    case DCPix: case ISBix: case SLOix: case SREix: case RLAix: case RRAix:
+        read = true;
+    case SAXix: case STAix:
+        Cycle_Pointer = envReadMemByte (endian_32lo16 (Register_ProgramCounter));
+        Register_ProgramCounter++;
+        // Page boundary crossing is not handled
+        Cycle_Pointer = (Cycle_Pointer + Register_X) & 0xFF;
+        FetchLowEffAddr  ();
+        FetchHighEffAddr ();
+    break;
+
+    // Indexed with Y Postinc Addressing Mode Handler
+    case ADCiy: case ANDiy: case CMPiy: case EORiy: case LAXiy:
+    case LDAiy: case ORAiy: case SBCiy:
+    case DCPiy: case ISBiy: case RLAiy: case RRAiy: case SLOiy:
+    case SREiy:
+        read = true;
+    case SHAiy: case STAiy:
+        Cycle_Pointer = envReadMemByte (endian_32lo16 (Register_ProgramCounter));
+        Register_ProgramCounter++;
+        FetchLowEffAddr    ();
+        FetchHighEffAddrY2 ();
+    break;
+
+    default:
+    break;
+    }
+
+    if (read)
+        Cycle_Data = envReadMemDataByte (Cycle_EffectiveAddress);
+
+    //---------------------------------------------------------------------------------------
+    // Operations
+    switch (instrOpcode)
+    {
+    case ADCz:  case ADCzx: case ADCa: case ADCax: case ADCay: case ADCix:
+    case ADCiy: case ADCb:
+        Perform_ADC ();
+    break;
+
+    case ANCb_:
+        setFlagsNZ (Register_Accumulator &= Cycle_Data);
+        setFlagC   (getFlagN ());
+    break;
+
+    case ANDz:  case ANDzx: case ANDa: case ANDax: case ANDay: case ANDix:
+    case ANDiy: case ANDb:
+        setFlagsNZ (Register_Accumulator &= Cycle_Data);
+    break;
+
+    case ANEb: // Also known as XAA
+        setFlagsNZ (Register_Accumulator = (Register_Accumulator | 0xee) & Register_X & Cycle_Data);
+    break;
+
+    case ARRb:
+    {
+        uint8_t data = Cycle_Data & Register_Accumulator;
+        Register_Accumulator = data >> 1;
+        if (getFlagC ()) Register_Accumulator |= 0x80;
+
+        if (getFlagD ())
+        {
+            setFlagN (0);
+            if (getFlagC ()) setFlagN (1 << SR_NEGATIVE);
+            setFlagZ (Register_Accumulator);
+            setFlagV ((data ^ Register_Accumulator) & 0x40);
+
+            if ((data & 0x0f) + (data & 0x01) > 5)
+                Register_Accumulator  = (Register_Accumulator & 0xf0) | ((Register_Accumulator + 6) & 0x0f);
+            setFlagC (((data + (data & 0x10)) & 0x1f0) > 0x50);
+            if (getFlagC ())
+                Register_Accumulator += 0x60;
+        }
+        else
+        {
+            setFlagsNZ (Register_Accumulator);
+            setFlagC   (Register_Accumulator & 0x40);
+            setFlagV  ((Register_Accumulator & 0x40) ^ ((Register_Accumulator & 0x20) << 1));
+        }
+        break;
+    }
+
+    case ASLn:
+        setFlagC   (Register_Accumulator & 0x80);
+        setFlagsNZ (Register_Accumulator <<= 1);
+    break;
+
+    case ASLz: case ASLzx: case ASLa: case ASLax:
+        asl_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case ASRb: // Also known as ALR
+        Register_Accumulator &= Cycle_Data;
+        setFlagC   (Register_Accumulator & 0x01);
+        setFlagsNZ (Register_Accumulator >>= 1);
+    break;
+
+    case BCCr:
+        if (!getFlagC ()) Register_ProgramCounter += (int8_t) Cycle_Data;
+    break;
+
+    case BCSr:
+        if (getFlagC ())  Register_ProgramCounter += (int8_t) Cycle_Data;
+    break;
+
+    case BEQr:
+        if (getFlagZ ())  Register_ProgramCounter += (int8_t) Cycle_Data;
+    break;
+
+    case BITz: case BITa:
+        setFlagZ (Register_Accumulator & Cycle_Data);
+        setFlagN (Cycle_Data);
+        setFlagV (Cycle_Data & 0x40);
+    break;
+
+    case BMIr:
+        if (getFlagN ())  Register_ProgramCounter += (int8_t) Cycle_Data;
+    break;
+
+    case BNEr:
+        if (!getFlagZ ()) Register_ProgramCounter += (int8_t) Cycle_Data;
+    break;
+
+    case BPLr:
+        if (!getFlagN ()) Register_ProgramCounter += (int8_t) Cycle_Data;
+    break;
+
+    case BRKn:
+        // See sid_brk, the high pc byte is never pushed
+        setFlagI (true);
+        interrupts.irqRequest = false;
+        PushLowPC ();
+#if !defined(NO_RTS_UPON_BRK)
+        sid_rts ();
+#endif
+    break;
+
+    case BVCr:
+        if (!getFlagV ()) Register_ProgramCounter += (int8_t) Cycle_Data;
+    break;
+
+    case BVSr:
+        if (getFlagV ())  Register_ProgramCounter += (int8_t) Cycle_Data;
+    break;
+
+    case CLCn:
+        setFlagC (false);
+    break;
+
+    case CLDn:
+        setFlagD (false);
+    break;
+
+    case CLIn:
+        // No overlapping IRQs allowed
+    break;
+
+    case CLVn:
+        setFlagV (false);
+    break;
+
+    case CMPz:  case CMPzx: case CMPa: case CMPax: case CMPay: case CMPix:
+    case CMPiy: case CMPb:
+    {
+        uint_least16_t tmp = (uint_least16_t) Register_Accumulator - Cycle_Data;
+        setFlagsNZ (tmp);
+        setFlagC   (tmp < 0x100);
+        break;
+    }
+
+    case CPXz: case CPXa: case CPXb:
+    {
+        uint_least16_t tmp = (uint_least16_t) Register_X - Cycle_Data;
+        setFlagsNZ (tmp);
+        setFlagC   (tmp < 0x100);
+        break;
+    }
+
+    case CPYz: case CPYa: case CPYb:
+    {
+        uint_least16_t tmp = (uint_least16_t) Register_Y - Cycle_Data;
+        setFlagsNZ (tmp);
+        setFlagC   (tmp < 0x100);
+        break;
+    }
+
+    case DCPz: case DCPzx: case DCPa: case DCPax: case DCPay: case DCPix:
+    case DCPiy: // Also known as DCM
+        dcm_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case DECz: case DECzx: case DECa: case DECax:
+        dec_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case DEXn:
+        setFlagsNZ (--Register_X);
+    break;
+
+    case DEYn:
+        setFlagsNZ (--Register_Y);
+    break;
+
+    case EORz:  case EORzx: case EORa: case EORax: case EORay: case EORix:
+    case EORiy: case EORb:
+        setFlagsNZ (Register_Accumulator ^= Cycle_Data);
+    break;
+
+    case INCz: case INCzx: case INCa: case INCax:
+        inc_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case INXn:
+        setFlagsNZ (++Register_X);
+    break;
+
+    case INYn:
+        setFlagsNZ (++Register_Y);
+    break;
+
+    case ISBz: case ISBzx: case ISBa: case ISBax: case ISBay: case ISBix:
+    case ISBiy: // Also known as INS
+        ins_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case JSRw:
+        Register_ProgramCounter--;
+        PushHighPC ();
+        PushLowPC  ();
+    case JMPw: case JMPi:
+        // Stop jumps into rom code
+        if (envCheckBankJump (Cycle_EffectiveAddress))
+            endian_32lo16 (Register_ProgramCounter, Cycle_EffectiveAddress);
+        else
+            sid_rts ();
+    break;
+
+    case LASay:
+        setFlagsNZ (Cycle_Data &= endian_16lo8 (Register_StackPointer));
+        Register_Accumulator  = Cycle_Data;
+        Register_X            = Cycle_Data;
+        Register_StackPointer = Cycle_Data;
+    break;
+
+    case LAXz: case LAXzy: case LAXa: case LAXay: case LAXix: case LAXiy:
+        setFlagsNZ (Register_Accumulator = Register_X = Cycle_Data);
+    break;
+
+    case LDAz:  case LDAzx: case LDAa: case LDAax: case LDAay: case LDAix:
+    case LDAiy: case LDAb:
+        setFlagsNZ (Register_Accumulator = Cycle_Data);
+    break;
+
+    case LDXz: case LDXzy: case LDXa: case LDXay: case LDXb:
+        setFlagsNZ (Register_X = Cycle_Data);
+    break;
+
+    case LDYz: case LDYzx: case LDYa: case LDYax: case LDYb:
+        setFlagsNZ (Register_Y = Cycle_Data);
+    break;
+
+    case LSRn:
+        setFlagC   (Register_Accumulator & 0x01);
+        setFlagsNZ (Register_Accumulator >>= 1);
+    break;
+
+    case LSRz: case LSRzx: case LSRa: case LSRax:
+        lsr_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case NOPn_: case NOPb_:
+    case NOPz_: case NOPzx_: case NOPa: case NOPax_:
+    break;
+
+    case LXAb: // Also known as OAL
+        setFlagsNZ (Register_X = (Register_Accumulator = (Cycle_Data & (Register_Accumulator | 0xee))));
+    break;
+
+    case ORAz:  case ORAzx: case ORAa: case ORAax: case ORAay: case ORAix:
+    case ORAiy: case ORAb:
+        setFlagsNZ (Register_Accumulator |= Cycle_Data);
+    break;
+
+    case PHAn:
+        pha_instr ();
+    break;
+
+    case PHPn:
+        PushSR ();
+    break;
+
+    case PLAn:
+        pla_instr ();
+    break;
+
+    case PLPn:
+        PopSR ();
+    break;
+
+    case RLAz: case RLAzx: case RLAix: case RLAa: case RLAax: case RLAay:
+    case RLAiy:
+        rla_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case ROLn:
+    {
+        uint8_t tmp = Register_Accumulator & 0x80;
+        Register_Accumulator <<= 1;
+        if (getFlagC ()) Register_Accumulator |= 0x01;
+        setFlagsNZ (Register_Accumulator);
+        setFlagC   (tmp);
+        break;
+    }
+
+    case ROLz: case ROLzx: case ROLa: case ROLax:
+        rol_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case RORn:
+    {
+        uint8_t tmp = Register_Accumulator & 0x01;
+        Register_Accumulator >>= 1;
+        if (getFlagC ()) Register_Accumulator |= 0x80;
+        setFlagsNZ (Register_Accumulator);
+        setFlagC   (tmp);
+        break;
+    }
+
+    case RORz: case RORzx: case RORa: case RORax:
+        ror_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case RRAa: case RRAax: case RRAay: case RRAz: case RRAzx: case RRAix:
+    case RRAiy:
+        rra_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case RTIn: // Fake RTS
+    case RTSn:
+        sid_rts ();
+    break;
+
+    case SAXz: case SAXzy: case SAXa: case SAXix: // Also known as AXS
+        axs_instr ();
+    break;
+
+    case SBCz:  case SBCzx: case SBCa: case SBCax: case SBCay: case SBCix:
+    case SBCiy: case SBCb_:
+        Perform_SBC ();
+    break;
+
+    case SBXb:
+    {
+        uint tmp = (Register_X & Register_Accumulator) - Cycle_Data;
+        setFlagsNZ (Register_X = tmp & 0xff);
+        setFlagC   (tmp < 0x100);
+        break;
+    }
+
+    case SECn:
+        setFlagC (true);
+    break;
+
+    case SEDn:
+        setFlagD (true);
+    break;
+
+    case SEIn:
+        setFlagI (true);
+        interrupts.irqRequest = false;
+    break;
+
+    case SHAay: case SHAiy: // Also known as AXA
+        axa_instr ();
+    break;
+
+    case SHSay: // Also known as TAS
+        shs_instr ();
+    break;
+
+    case SHXay: // Also known as XAS
+        xas_instr ();
+    break;
+
+    case SHYax: // Also known as SAY
+        say_instr ();
+    break;
+
+    case SLOz: case SLOzx: case SLOa: case SLOax: case SLOay: case SLOix:
+    case SLOiy: // Also known as ASO
+        aso_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case SREz: case SREzx: case SREa: case SREax: case SREay: case SREix:
+    case SREiy: // Also known as LSE
+        lse_instr ();
+        PutEffAddrDataByte ();
+    break;
+
+    case STAz: case STAzx: case STAa: case STAax: case STAay: case STAix:
+    case STAiy:
+        sta_instr ();
+    break;
+
+    case STXz: case STXzy: case STXa:
+        stx_instr ();
+    break;
+
+    case STYz: case STYzx: case STYa:
+        sty_instr ();
+    break;
+
+    case TAXn:
+        setFlagsNZ (Register_X = Register_Accumulator);
+    break;
+
+    case TAYn:
+        setFlagsNZ (Register_Y = Register_Accumulator);
+    break;
+
+    case TSXn:
+        setFlagsNZ (Register_X = endian_16lo8 (Register_StackPointer));
+    break;
+
+    case TXAn:
+        setFlagsNZ (Register_Accumulator = Register_X);
+    break;
+
+    case TXSn:
+        endian_16lo8 (Register_StackPointer, Register_X);
+    break;
+
+    case TYAn:
+        setFlagsNZ (Register_Accumulator = Register_Y);
+    break;
+
+    default:
+        // Sidplay Suppresses Illegal Instructions
+    break;
+    }
+}
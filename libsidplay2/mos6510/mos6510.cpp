@@ -79,6 +79,7 @@
 #   ifdef MOS6510_SIDPLAY
         // Compile in sidplay code
 #       include "cycle_based/sid6510c.i"
+#       include "cycle_based/sid6510f.i"
 #   endif // MOS6510_SIDPLAY
 #else
     // Line based emulation code has not been provided
@@ -165,7 +165,8 @@ MOS6526::MOS6526 (EventContext *context)
  m_todPeriod(~0), // Dummy
  m_taEvent("CIA Timer A", *this, &MOS6526::ta_event),
  m_tbEvent("CIA Timer B", *this, &MOS6526::tb_event),
- m_todEvent("CIA Time of Day", *this, &MOS6526::tod_event)
+ m_todEvent("CIA Time of Day", *this, &MOS6526::tod_event),
+ m_lazy(false)
 {
     reset ();
 }
@@ -180,6 +181,8 @@ void MOS6526::reset (void)
     ta  = ta_latch = 0xffff;
     tb  = tb_latch = 0xffff;
     ta_underflow = tb_underflow = false;
+    m_taLazy = m_tbLazy = false;
+    m_taClk  = m_tbClk  = 0;
     cra = crb = sdr_out = 0;
     sdr_count = 0;
     sdr_buffered = false;
@@ -212,6 +215,8 @@ uint8_t MOS6526::read (uint_least8_t addr)
     if (addr > 0x0f) return 0;
     bool ta_pulse = false, tb_pulse = false;
 
+    if (m_lazy)
+        lazySync ();
     cycles       = event_context.getTime (m_accessClk, event_context.phase ());
     m_accessClk += cycles;
 
@@ -299,6 +304,8 @@ void MOS6526::write (uint_least8_t addr, uint8_t data)
     if (addr > 0x0f) return;
 
     regs[addr] = data;
+    if (m_lazy)
+        lazySync ();
     cycles     = event_context.getTime (m_accessClk, event_context.phase ());
 
     if (cycles)
@@ -400,8 +407,7 @@ void MOS6526::write (uint_least8_t addr, uint8_t data)
 
         if ((data & 0x21) == 0x01)
         {   // Active
-            m_taEvent.schedule (event_context, (event_clock_t) ta + 1,
-                                m_phase);
+            ta_schedule ();
         } else
         {   // Inactive
             m_taEvent.cancel ();
@@ -425,8 +431,7 @@ void MOS6526::write (uint_least8_t addr, uint8_t data)
 
         if ((data & 0x61) == 0x01)
         {   // Active
-            m_tbEvent.schedule (event_context, (event_clock_t) tb + 1,
-                                m_phase);
+            tb_schedule ();
         } else
         {   // Inactive
             m_tbEvent.cancel ();
@@ -436,6 +441,16 @@ void MOS6526::write (uint_least8_t addr, uint8_t data)
     default:
     break;
     }
+
+    if (m_lazy)
+    {
+        switch (addr)
+        {
+        case ICR: case CRA: case CRB:
+            lazyUpdate ();
+        break;
+        }
+    }
 }
 
 void MOS6526::trigger (int irq)
@@ -464,6 +479,8 @@ void MOS6526::ta_event (void)
     event_clock_t cycles;
     uint8_t mode = cra & 0x21;
 
+    if (m_lazy)
+        lazySync ();
     if (mode == 0x21)
     {
         if (ta--)
@@ -480,8 +497,7 @@ void MOS6526::ta_event (void)
         cra &= (~0x01);
     } else if (mode == 0x01)
     {   // Reset event
-        m_taEvent.schedule (event_context, (event_clock_t) ta + 1,
-                            m_phase);
+        ta_schedule ();
     }
     trigger (INTERRUPT_TA);
     
@@ -514,6 +530,8 @@ void MOS6526::ta_event (void)
 void MOS6526::tb_event (void)
 {   // Timer Modes
     uint8_t mode = crb & 0x61;
+    if (m_lazy)
+        lazySync ();
     switch (mode)
     {
     case 0x01:
@@ -545,12 +563,113 @@ void MOS6526::tb_event (void)
         crb &= (~0x01);
     } else if (mode == 0x01)
     {   // Reset event
-        m_tbEvent.schedule (event_context, (event_clock_t) tb + 1,
-                            m_phase);
+        tb_schedule ();
     }
     trigger (INTERRUPT_TB);
 }
 
+void MOS6526::ta_schedule (void)
+{   // Keep track of when it occurs even if not scheduled
+    m_taClk = event_context.getTime (m_phase) + ta + 1;
+    if (!m_taLazy)
+        m_taEvent.schedule (event_context, (event_clock_t) ta + 1, m_phase);
+}
+
+void MOS6526::tb_schedule (void)
+{
+    m_tbClk = event_context.getTime (m_phase) + tb + 1;
+    if (!m_tbLazy)
+        m_tbEvent.schedule (event_context, (event_clock_t) tb + 1, m_phase);
+}
+
+
+/***************************************************************************
+ * Lazy timers.  Underflows are only scheduled when something can see
+ * them as they happen (irq, one shot, serial port or timer B counting
+ * timer A).  Otherwise the time of the next underflow is remembered and
+ * any that are due are played back in order when the chip is next
+ * accessed.  The results are the same as if the events had been run.
+ **************************************************************************/
+static inline event_clock_t lazyDiff (event_clock_t a, event_clock_t b)
+{   // 31 bit res. as getTime
+    return ((a - b) << 1) >> 1;
+}
+
+static inline bool lazyDue (event_clock_t clk, event_clock_t now)
+{   // Times in the future wrap to huge values
+    return lazyDiff (now, clk) < 0x40000000;
+}
+
+void MOS6526::lazySync (void)
+{
+    event_clock_t now = event_context.getTime (event_context.phase ());
+    for (;;)
+    {
+        bool ta_due = m_taLazy && ((cra & 0x21) == 0x01) && lazyDue (m_taClk, now);
+        bool tb_due = m_tbLazy && ((crb & 0x61) == 0x01) && lazyDue (m_tbClk, now);
+
+        if (ta_due && (!tb_due || lazyDue (m_taClk, m_tbClk)))
+        {   // Timer A underflows up to timer B's or now
+            event_clock_t period = (event_clock_t) ta_latch + 1;
+            event_clock_t count  = lazyDiff (tb_due ? m_tbClk : now, m_taClk) / period;
+            event_clock_t clk    = m_taClk + count * period;
+            if ((crb & 0x61) == 0x01)
+                tb -= (uint_least16_t) lazyDiff (clk, m_accessClk);
+            m_accessClk = clk;
+            ta      = ta_latch;
+            m_taClk = clk + period;
+            if (!(count & 1))
+                ta_underflow ^= true; // toggle flipflop
+            trigger (INTERRUPT_TA);
+        }
+        else if (tb_due)
+        {   // Timer B underflows up to timer A's or now
+            event_clock_t period = (event_clock_t) tb_latch + 1;
+            event_clock_t count  = lazyDiff (ta_due ? m_taClk - 1 : now, m_tbClk) / period;
+            event_clock_t clk    = m_tbClk + count * period;
+            m_accessClk = clk;
+            tb      = tb_latch;
+            m_tbClk = clk + period;
+            if (!(count & 1))
+                tb_underflow ^= true; // toggle flipflop
+            trigger (INTERRUPT_TB);
+        }
+        else
+            break;
+    }
+}
+
+void MOS6526::lazyUpdate (void)
+{
+    bool ta_lazy = !(icr & INTERRUPT_TA) && !(cra & 0x48) &&
+                   ((crb & 0x41) != 0x41);
+    bool tb_lazy = !(icr & INTERRUPT_TB) && !(crb & 0x08);
+
+    if (ta_lazy != m_taLazy)
+    {
+        m_taLazy = ta_lazy;
+        if (ta_lazy)
+            m_taEvent.cancel ();
+        else if ((cra & 0x21) == 0x01)
+        {   // Put back the underflow we skipped scheduling
+            m_taEvent.schedule (event_context, lazyDiff (m_taClk,
+                                event_context.getTime (m_phase)), m_phase);
+        }
+    }
+
+    if (tb_lazy != m_tbLazy)
+    {
+        m_tbLazy = tb_lazy;
+        if (tb_lazy)
+            m_tbEvent.cancel ();
+        else if ((crb & 0x61) == 0x01)
+        {
+            m_tbEvent.schedule (event_context, lazyDiff (m_tbClk,
+                                event_context.getTime (m_phase)), m_phase);
+        }
+    }
+}
+
 // TOD implementation taken from Vice
 #define byte2bcd(byte) (((((byte) / 10) << 4) + ((byte) % 10)) & 0xff)
 #define bcd2byte(bcd)  (((10*(((bcd) & 0xf0) >> 4)) + ((bcd) & 0xf)) & 0xff)
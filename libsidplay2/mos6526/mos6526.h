@@ -134,6 +134,11 @@ protected:
     EventCallback<MOS6526> m_tbEvent;
     EventCallback<MOS6526> m_todEvent;
 
+    // Lazy timers, only schedule underflows that are seen
+    bool    m_lazy;
+    bool    m_taLazy, m_tbLazy;
+    event_clock_t m_taClk, m_tbClk; // Next underflow
+
     /*
     class EventStateMachineA: public Event
     {
@@ -154,6 +159,10 @@ protected:
     void tb_event  (void);
     void tod_event (void);
     void trigger   (int irq);
+    void ta_schedule (void);
+    void tb_schedule (void);
+    void lazySync    (void);
+    void lazyUpdate  (void);
 //    void stateMachineA_event (void);
 
     // Environment Interface
@@ -167,6 +176,7 @@ public:
     uint8_t read  (uint_least8_t addr);
     void    write (uint_least8_t addr, uint8_t data);
     const   char *credits (void) {return credit;}
+    void    lazy  (bool enable) { m_lazy = enable; }
 
     // @FIXME@ This is not correct!  There should be
     // muliple schedulers running at different rates
@@ -52,10 +52,11 @@ const char *MOS656X::credit =
 
 MOS656X::MOS656X (EventContext *context)
 :Event("VIC Raster"),
+ sprite_enable(regs[0x15]),
+ sprite_y_expansion(regs[0x17]),
  event_context(*context),
  m_phase(EVENT_CLOCK_PHI1),
- sprite_enable(regs[0x15]),
- sprite_y_expansion(regs[0x17])
+ m_lazy(false)
 {
     chip (MOS6569);
 }
@@ -67,8 +68,9 @@ void MOS656X::reset ()
     y_scroll     = 0;
     raster_y     = yrasters - 1;
     raster_x     = 0;
-    bad_lines_enabled = false;
+    bad_lines_enabled = bad_line = false;
     m_rasterClk  = 0;
+    m_lazyActive = m_lazy;
     vblanking    = lp_triggered = false;
     lpx          = lpy = 0;
     sprite_dma   = 0;
@@ -107,6 +109,12 @@ void MOS656X::chip (mos656x_model_t model)
     break;
     }
 
+	// AV
+	for ( int i = 0; i < 100; i++ ) {
+		cycle_table[i] = (i + 9) % xrasters;
+		raster_x_table[i] = i % xrasters;
+	}
+
     reset ();
 }
 
@@ -191,6 +199,10 @@ void MOS656X::write (uint_least8_t addr, uint8_t data)
         trigger (icr & idr); 
         break;
     }
+
+    // Next raster irq or bad line may have moved
+    if (m_lazyActive)
+        lazySchedule ();
 }
 
 
@@ -223,22 +235,24 @@ void MOS656X::event (void)
     if (!cycles)
         return;
 
+    if (m_lazyActive)
+    {
+        // Nothing runs from a reset until the first access, after which
+        // the per cycle emulation below has only moved along the line it
+        // was in.  Do the same, leaving the last cycle to step normally.
+        if (!m_rasterClk)
+        {
+            m_rasterClk = cycles - 1;
+            raster_x    = (uint_least16_t) ((raster_x + cycles - 1) % xrasters);
+            cycles      = 1;
+        }
+        lazyEvent (cycles);
+        return;
+    }
+
     event_clock_t  delay  = 1;
     uint_least16_t cycle;
 
-	// AV
-	static bool calced = false;
-	static int table[ 100 ];
-	static int table2[ 100 ];
-
-	if ( !calced ) {
-		for ( int i = 0; i < 100; i++ ) {
-			table[i] = (i + 9) % xrasters;
-			table2[i] = i % xrasters;
-		}
-		calced = true;
-	}
-
     // Update x raster
     m_rasterClk += cycles;
     raster_x    += cycles;
@@ -246,8 +260,19 @@ void MOS656X::event (void)
 	//cycle        = (raster_x + 9) % xrasters;
     //raster_x    %= xrasters;
 
-	cycle		= table[raster_x];
-    raster_x    = table2[raster_x];
+    // The tables only cover a normal step, divide after a
+    // long gap (first event after a reset) rather than
+    // reading past their end
+    if (raster_x < sizeof (cycle_table) / sizeof (cycle_table[0]))
+    {
+        cycle    = cycle_table[raster_x];
+        raster_x = raster_x_table[raster_x];
+    }
+    else
+    {
+        cycle     = (raster_x + 9) % xrasters;
+        raster_x %= xrasters;
+    }
 	
 
     switch (cycle)
@@ -453,6 +478,158 @@ void MOS656X::event (void)
             delay = xrasters - cycle;
     }
 
+    // Drop back to lazy raster once sprites are done
+    if (m_lazy && !(sprite_enable | sprite_dma))
+    {
+        m_lazyActive = true;
+        delay = lazyDelay ();
+    }
+    schedule (event_context, delay - event_context.phase(), m_phase);
+}
+
+
+/***************************************************************************
+ * Lazy raster.  Rather than stepping through every line the raster
+ * position is worked out from the clock when needed and the event is
+ * only scheduled for the next raster irq, DEN latch or bad line.  Raster
+ * positions are in raster_x terms, which is 9 cycles behind the cycle
+ * numbers used in event above (raster_x 0 is cycle 9).  Sprites need the
+ * per cycle emulation so fall back to that whilst any are enabled.
+ **************************************************************************/
+static inline event_clock_t lazyDistance (uint_least32_t from, uint_least32_t to,
+                                          uint_least32_t period)
+{   // Cycles until position next reached (never 0)
+    uint_least32_t dist = (to + period - from) % period;
+    return dist ? dist : period;
+}
+
+void MOS656X::lazyEvent (event_clock_t cycles)
+{
+    for (;;)
+    {
+        event_clock_t delay = lazyDelay ();
+        if (delay > cycles)
+            break;
+        lazyAdvance (delay);
+        cycles -= delay;
+        lazyAction  ();
+    }
+    lazyAdvance  (cycles);
+    lazySchedule ();
+}
+
+void MOS656X::lazyAdvance (event_clock_t cycles)
+{
+    if (!cycles)
+        return;
+
+    uint_least32_t frame = (uint_least32_t) yrasters * xrasters;
+    uint_least32_t line  = vblanking ? 0 : raster_y;
+    uint_least32_t pos   = line * xrasters + raster_x;
+
+    // Bad line only lasts until the next cycle 20
+    if (cycles >= lazyDistance (raster_x, 11, xrasters))
+        bad_line = false;
+    // Light pen can trigger again once per frame
+    if (cycles >= lazyDistance (pos, 1, frame))
+        lp_triggered = false;
+
+    m_rasterClk += cycles;
+    pos       = (pos + (uint_least32_t) (cycles % frame)) % frame;
+    line      = pos / xrasters;
+    raster_x  = (uint_least16_t) (pos % xrasters);
+    // Line 0 cycle 9 is still reported as the last line
+    vblanking = !line && !raster_x;
+    raster_y  = vblanking ? yrasters - 1 : (uint_least16_t) line;
+}
+
+event_clock_t MOS656X::lazyDelay (void) const
+{
+    uint_least32_t frame = (uint_least32_t) yrasters * xrasters;
+    uint_least32_t line  = vblanking ? 0 : raster_y;
+    uint_least32_t pos   = line * xrasters + raster_x;
+    event_clock_t  delay, next;
+
+    // DEN is latched once a frame so always wake for that
+    delay = lazyDistance (pos, first_dma_line * xrasters + 11, frame);
+
+    if (raster_irq < yrasters)
+    {   // Line 0 irq occurs a cycle late (see event)
+        next = lazyDistance (pos, raster_irq * xrasters + (raster_irq ? 0 : 1),
+                             frame);
+        if (next < delay)
+            delay = next;
+    }
+
+    if (bad_lines_enabled)
+    {   // Find the next line matching y_scroll
+        uint_least32_t l = (raster_x < 11) ? line : line + 1;
+        if (l < first_dma_line)
+            l = first_dma_line;
+        l += (y_scroll - l) & 7;
+        if (l > last_dma_line)
+        {   // Next frame
+            l  = first_dma_line + ((y_scroll - first_dma_line) & 7);
+            l += yrasters;
+        }
+        next = l * xrasters + 11 - pos;
+        if (next < delay)
+            delay = next;
+    }
+
+    // DMA released on cycle 63
+    if (bad_line && (raster_x < 54))
+    {
+        next = 54 - raster_x;
+        if (next < delay)
+            delay = next;
+    }
+    return delay;
+}
+
+void MOS656X::lazyAction (void)
+{
+    uint_least16_t line = vblanking ? 0 : raster_y;
+
+    switch (raster_x)
+    {
+    case 0:  // Cycle 9
+        if (line && (line == raster_irq))
+            trigger (MOS656X_INTERRUPT_RST);
+        break;
+
+    case 1:  // Cycle 10
+        if (!line && !raster_irq)
+            trigger (MOS656X_INTERRUPT_RST);
+        break;
+
+    case 11: // Cycle 20, start bad line
+        if (line == first_dma_line)
+            bad_lines_enabled = (ctrl1 & 0x10) != 0;
+
+        bad_line = (line >= first_dma_line) &&
+                   (line <= last_dma_line)  &&
+                   ((line & 7) == y_scroll) &&
+                   bad_lines_enabled;
+        if (bad_line)
+            addrctrl (false);
+        break;
+
+    case 54: // Cycle 63, end DMA
+        if (bad_line)
+            addrctrl (true);
+        break;
+    }
+}
+
+void MOS656X::lazySchedule (void)
+{
+    event_clock_t delay = 1;
+    // Sprites require the cycle exact emulation
+    if (sprite_enable)
+        m_lazyActive = false;
+    else
+        delay = lazyDelay ();
     schedule (event_context, delay - event_context.phase(), m_phase);
 }
 
@@ -47,15 +47,25 @@ protected:
     uint8_t       &sprite_enable, &sprite_y_expansion;
     uint8_t        sprite_dma, sprite_expand_y;
     uint8_t        sprite_mc_base[8];
+    uint_least16_t cycle_table[100], raster_x_table[100];
 
     event_clock_t m_rasterClk;
     EventContext &event_context;
     event_phase_t m_phase;
 
+    // Lazy raster, only wake for raster irqs and bad lines
+    bool          m_lazy;
+    bool          m_lazyActive;
+
 protected:
     MOS656X (EventContext *context);
     void    event       (void);
     void    trigger     (int irq);
+    void    lazyEvent   (event_clock_t cycles);
+    void    lazyAdvance (event_clock_t cycles);
+    void    lazyAction  (void);
+    void    lazySchedule (void);
+    event_clock_t lazyDelay (void) const;
 
     // Environment Interface
     virtual void interrupt (bool state) = 0;
@@ -64,6 +74,7 @@ protected:
 public:
     void    chip  (mos656x_model_t model);
     void    lightpen ();
+    void    lazy  (bool enable) { m_lazy = enable; }
 
     // Component Standard Calls
     void    reset (void);
@@ -38,6 +38,9 @@ public:
     void          volume (uint_least8_t, uint_least8_t) { ; }
     void          mute   (uint_least8_t, bool) { ; }
     void          gain   (int_least8_t) { ; }
+
+    // Snapshot support
+    int_least32_t stateSize (void) { return 0; }
 };
 
 #endif // _nullsid_h_
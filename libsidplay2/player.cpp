@@ -354,7 +354,6 @@ const char  *Player::ERR_UNSUPPORTED_PRECISION = "SIDPLAYER ERROR: Unsupported s
 const char  *Player::ERR_MEM_ALLOC             = "SIDPLAYER ERROR: Memory Allocation Failure.";
 const char  *Player::ERR_UNSUPPORTED_MODE      = "SIDPLAYER ERROR: Unsupported Environment Mode (Coming Soon).";
 
-const char  *Player::credit[];
 
 
 // Set the ICs environment variable to point to
@@ -369,6 +368,10 @@ Player::Player (void)
  cia2    (this),
  sid6526 (this),
  vic     (this),
+ m_RegisterFrameChangedCallback(NULL),
+ m_RegisterFrameChangedCallbackInstance(NULL),
+ m_SidWriteCallback(NULL),
+ m_SidWriteCallbackInstance(NULL),
  m_mixerEvent ("Mixer", *this, &Player::mixer),
  rtc        (&m_scheduler),
  m_tune (NULL),
@@ -383,11 +386,13 @@ Player::Player (void)
  m_sid2crcCount      (0),
  m_emulateStereo     (true),
  m_sampleCount       (0),
- m_RegisterFrameChangedCallback(NULL),
- m_RegisterFrameChangedCallbackInstance(NULL)
+ m_snapshotGeneration (0),
+ m_keyframes         (NULL),
+ m_keyframeCount     (0),
+ m_keyframeMax       (0)
 {
-    srand ((uint) ::time(NULL));
-    m_rand = (uint_least32_t) rand ();
+    // Seed without srand/rand, which are shared by all instances
+    m_rand = (uint_least32_t) ::time(NULL) * 1103515245 + 12345;
     
     // Set the ICs to use this environment
     cpu.setEnvironment (this);
@@ -437,6 +442,10 @@ Player::Player (void)
     m_cfg.sampleFormat    = SID2_LITTLE_SIGNED;
     m_cfg.powerOnDelay    = SID2_DEFAULT_POWER_ON_DELAY;
     m_cfg.sid2crcCount    = 0;
+    m_cfg.cpuEmulation    = SID2_CPU_CYCLE;
+    m_cfg.lazyRaster      = false;
+    m_cfg.lazyTimers      = false;
+    m_cfg.keyframeInterval = 0;
 
     // Configured by default for Sound Blaster (compatibles)
     if (SID2_DEFAULT_PRECISION == 8)
@@ -457,6 +466,7 @@ Player::Player (void)
 
 Player::~Player ()
 {
+   keyframeReset ();
    if (m_ram == m_rom)
       delete [] m_ram;
    else
@@ -640,6 +650,10 @@ uint_least32_t Player::play (void *buffer, uint_least32_t length)
 		
     } else {
 
+		// Extend the seek index
+		if (m_cfg.keyframeInterval)
+			keyframe ();
+
 		// Setup Sample Information
 		m_sampleIndex  = 0;
 		m_sampleCount  = length;
@@ -910,11 +924,14 @@ void Player::writeMemByte_playsid (uint_least16_t addr, uint8_t data)
     // Map to real address to support PlaySID
     // Extended SID Chip Registers.
     sid2crc (data);
+    int i = m_sidmapper[(addr >> 5) & (SID2_MAPPER_SIZE - 1)];
+    if (m_SidWriteCallback)
+        m_SidWriteCallback (m_SidWriteCallbackInstance, m_scheduler.getTime (EVENT_CLOCK_PHI2),
+                            i, tempAddr & 0x1f, data);
     if (( tempAddr & 0x00ff ) >= 0x001d )
         xsid.write16 (addr & 0x01ff, data);
     else // Mirrored SID.
     {
-        int i = m_sidmapper[(addr >> 5) & (SID2_MAPPER_SIZE - 1)];
         // Convert address to that acceptable by resid
         sid[i]->write (tempAddr & 0xff, data);
         // Support dual sid
@@ -925,6 +942,7 @@ void Player::writeMemByte_playsid (uint_least16_t addr, uint8_t data)
 		if ( ( tempAddr & 0xff ) <= 0x18 )
 		{
 			m_CurrentRegisterFrame.mRegisters[tempAddr & 0xff] = data;
+			m_CurrentRegisterFrame.mRegister  = tempAddr & 0xff;
 			m_CurrentRegisterFrame.mTimeStamp = m_scheduler.getTime(EVENT_CLOCK_PHI2);
 			if (m_RegisterFrameChangedCallback)
 				m_RegisterFrameChangedCallback(m_RegisterFrameChangedCallbackInstance, m_CurrentRegisterFrame);
@@ -976,6 +994,9 @@ void Player::reset (void)
     cpu.environment (m_info.environment);
 
     m_scheduler.reset ();
+    // Power on, a reset leaves the registers alone so they
+    // would otherwise carry over from the previous tune
+    cpu.reset (0, 0, 0, 0);
     for (i = 0; i < SID2_MAX_SIDS; i++)
     {
         sidemu &s = *sid[i];
@@ -989,6 +1010,9 @@ void Player::reset (void)
         s.write (0x0b, 0x00);
         s.write (0x12, 0x00);
     }
+    // AV, the register frame starts over with the SIDs rather than
+    // keeping what the last tune wrote
+    m_CurrentRegisterFrame = SidRegisterFrame ();
 
     if (m_info.environment == sid2_envR)
     {
@@ -212,6 +212,7 @@
 #define  SID2_MAX_SIDS 1
 #define  SID2_TIME_BASE 10
 #define  SID2_MAPPER_SIZE 32
+#define  SID2_SEEK_SETTLE 1 // Full emulation before a seek target
 
 SIDPLAY2_NAMESPACE_START
 
@@ -223,14 +224,18 @@ struct SidRegisterFrame
 		SID_REGISTER_COUNT = 0x19
 	};
 	
-	SidRegisterFrame() : mTimeStamp(0) { for (int i = 0; i < SID_REGISTER_COUNT; i++) mRegisters[i] = 0; }
+	SidRegisterFrame() : mRegister(0), mTimeStamp(0) { for (int i = 0; i < SID_REGISTER_COUNT; i++) mRegisters[i] = 0; }
 	
 	unsigned char mRegisters[SID_REGISTER_COUNT];
+	unsigned char mRegister;	// written last, at mTimeStamp
 	event_clock_t mTimeStamp;
 };
 
 typedef void (*SidRegisterFrameChangedCallback) (void* inInstance, SidRegisterFrame& inRegisterFrame);
 
+// Every SID register write, of any SID and register, at the cycle it happens
+typedef void (*SidWriteCallback) (void* inInstance, event_clock_t inTime, int inSid, int inRegister, uint8_t inValue);
+
 
 
 class Player: private C64Environment, c64env
@@ -256,10 +261,12 @@ private:
     static const char  *ERR_UNSUPPORTED_PRECISION;
     static const char  *ERR_MEM_ALLOC;
     static const char  *ERR_UNSUPPORTED_MODE;
-    static const char  *credit[10]; // 10 credits max
+    const char         *credit[10]; // 10 credits max
 
     static const char  *ERR_PSIDDRV_NO_SPACE; 
     static const char  *ERR_PSIDDRV_RELOC;
+    static const char  *ERR_SNAPSHOT_UNSUPPORTED;
+    static const char  *ERR_SNAPSHOT_INVALID;
 
     EventScheduler m_scheduler;
 
@@ -279,6 +286,8 @@ private:
 	SidRegisterFrame m_CurrentRegisterFrame;
 	SidRegisterFrameChangedCallback m_RegisterFrameChangedCallback;
 	void* m_RegisterFrameChangedCallbackInstance;
+	SidWriteCallback m_SidWriteCallback;
+	void* m_SidWriteCallbackInstance;
 	
     EventCallback<Player> m_mixerEvent;
     class EventRTC: public Event
@@ -344,6 +353,8 @@ private:
     // Mixer settings
     event_clock_t  m_sampleClock;
     event_clock_t  m_samplePeriod;
+    event_clock_t  m_mixerClk;      // Next sample, keeps the grid over a seek
+    uint_least32_t m_samplePosition; // Samples since the song started
     uint_least32_t m_sampleCount;
     uint_least32_t m_sampleIndex;
     char          *m_sampleBuffer;
@@ -354,6 +365,13 @@ private:
     event_clock_t  m_rtcClock;
     event_clock_t  m_rtcPeriod;
 
+    // Machine snapshots, keyframes are stored back to
+    // back in time order for seeking
+    uint_least32_t m_snapshotGeneration;
+    uint8_t       *m_keyframes;
+    uint_least32_t m_keyframeCount;
+    uint_least32_t m_keyframeMax;
+
     // C64 environment settings
     struct
     {
@@ -382,12 +400,17 @@ private:
     void      nextSequence   (void);
     void      mixer          (void);
     void      mixerReset     (void);
+    void      mixerResume    (void);
     void      mileageCorrect (void);
     int       sidCreate      (sidbuilder *builder, sid2_model_t model,
                               sid2_model_t defaultModel);
     void      sidSamples     (bool enable);
     void      reset          ();
     uint8_t   iomap          (uint_least16_t addr);
+    uint_least32_t snapshotTransfer (uint8_t *state, bool save);
+    void      keyframe       (void);
+    void      keyframeReset  (void);
+    void      seekSkip       (uint_least32_t until);
 
     uint8_t readMemByte_plain     (uint_least16_t addr);
     uint8_t readMemByte_io        (uint_least16_t addr);
@@ -471,15 +494,22 @@ public:
     uint_least32_t mileage      (void) const { return m_mileage + time(); }
     void           pause        (void);
     uint_least32_t play         (void *buffer, uint_least32_t length);
+    int            restore      (const void *state);
+    uint_least32_t samples      (void) const { return m_samplePosition; }
+    int            seek         (uint_least32_t time);
+    int            snapshot     (void *state);
+    uint_least32_t snapshotSize (void);
     sid2_player_t  state        (void) const { return m_playerState; }
     void           stop         (void);
     uint_least32_t time         (void) const {return rtc.getTime (); }
+    event_clock_t  cycles       (void) const {return m_scheduler.getTime (EVENT_CLOCK_PHI2); }
     void           debug        (bool enable, FILE *out)
                                 { cpu.debug (enable, out); }
     const char    *error        (void) const { return m_errorString; }
 	
 	const SidRegisterFrame& getCurrentRegisterFrame()	{ return m_CurrentRegisterFrame; }
 	void setRegisterFrameChangedCallback(void* inInstance, SidRegisterFrameChangedCallback inCallback) { m_RegisterFrameChangedCallback = inCallback; m_RegisterFrameChangedCallbackInstance = inInstance; }
+	void setSidWriteCallback(void* inInstance, SidWriteCallback inCallback) { m_SidWriteCallback = inCallback; m_SidWriteCallbackInstance = inInstance; }
 };
 
 
@@ -40,6 +40,7 @@
  ***************************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 
 #include "config.h"
 #ifdef HAVE_EXCEPTIONS
@@ -227,3 +228,25 @@ void ReSIDBuilder::sampling (uint_least32_t freq)
         sid->sampling (freq);
     }
 }
+
+bool ReSIDBuilder::profile (sid_profile &total, bool reset)
+{
+    int size = (int)sidobjs.size ();
+    bool enabled = false;
+    memset (&total, 0, sizeof (total));
+    for (int i = 0; i < size; i++)
+    {
+        ReSID *sid = (ReSID *) sidobjs[i];
+        sid_profile one;
+        enabled = sid->profile (one, reset);
+        for (int stage = 0; stage < PROFILE_STAGES; stage++)
+            total.stage_ticks[stage] += one.stage_ticks[stage];
+        total.sampled_cycles += one.sampled_cycles;
+        total.resample_ticks += one.resample_ticks;
+        total.samples        += one.samples;
+        total.block_ticks    += one.block_ticks;
+        total.cycles         += one.cycles;
+        total.blocks         += one.blocks;
+    }
+    return enabled;
+}
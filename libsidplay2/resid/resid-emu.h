@@ -44,12 +44,15 @@ private:
     event_phase_t m_phase;
     event_clock_t m_accessClk;
     int_least32_t m_gain;
-    static char   m_credit[180];
+    char          m_credit[180];
     const  char  *m_error;
     bool          m_status;
     bool          m_locked;
+    bool          m_seeking;
 	RESID::SID    m_sid;
 
+    void update (void);
+
 public:
     ReSID  (sidbuilder *builder);
     ~ReSID (void);
@@ -69,6 +72,12 @@ public:
     void          mute    (uint_least8_t num, bool enable);
     void          gain    (int_least8_t precent);
 
+    // Snapshot support
+    int_least32_t stateSize    (void);
+    void          saveState    (uint8_t *state);
+    void          restoreState (const uint8_t *state);
+    void          seek         (bool enable);
+
     operator bool () { return m_status; }
     static   int  devices (char *error);
 
@@ -76,6 +85,8 @@ public:
     void sampling (uint freq);
     bool set_filter   (const sid_filter_t *filter, bool overrideCutoffCurve);
     void model    (sid2_model_t model);
+    // Stage profile of the emulation, see RESID_PROFILE
+    bool profile  (sid_profile &result, bool reset);
     // Must lock the SID before using the standard functions.
     bool lock     (c64env *env);
 };
@@ -22,11 +22,12 @@
 #   include <new>
 #endif
 
+#include <string.h>
+
 #include "resid.h"
 #include "resid-emu.h"
 
 
-char ReSID::m_credit[];
 
 ReSID::ReSID (sidbuilder *builder)
 :sidemu(builder),
@@ -34,7 +35,8 @@ ReSID::ReSID (sidbuilder *builder)
  m_phase(EVENT_CLOCK_PHI1),
  m_gain(100),
  m_status(true),
- m_locked(false)
+ m_locked(false),
+ m_seeking(false)
 {
     char *p = m_credit;
     m_error = "N/A";
@@ -167,33 +169,63 @@ void ReSID::reset (uint8_t volume)
     m_sid.write (SID_FILTER_MODE_VOL, volume);
 }
 
-uint8_t ReSID::read (uint_least8_t addr)
+// Bring the sid up to the current time.  Whilst seeking only the
+// register side is advanced, no audio is produced.
+void ReSID::update (void)
 {
     event_clock_t cycles = m_context->getTime (m_accessClk, m_phase);
     m_accessClk += cycles;
-    while(cycles--)
-        m_sid.clock ();
+    if (m_seeking)
+        m_sid.skip (cycles);
+    else
+        m_sid.clock (cycles);
+}
+
+uint8_t ReSID::read (uint_least8_t addr)
+{
+    update ();
     return m_sid.read (addr);
 }
 
 void ReSID::write (uint_least8_t addr, uint8_t data)
 {
-    event_clock_t cycles = m_context->getTime (m_accessClk, m_phase);
-    m_accessClk += cycles;
-    while(cycles--)
-        m_sid.clock ();
+    update ();
     m_sid.write (addr, data);
 }
 
 int_least32_t ReSID::output (uint_least8_t bits)
 {
-    event_clock_t cycles = m_context->getTime (m_accessClk, m_phase);
-    m_accessClk += cycles;
-    while(cycles--)
-        m_sid.clock ();
+    update ();
     return m_sid.output (bits) * m_gain / 100;
 }
 
+int_least32_t ReSID::stateSize (void)
+{
+    return sizeof (RESID::SID::State) + sizeof (m_accessClk);
+}
+
+void ReSID::saveState (uint8_t *state)
+{   // Bring the sid up to date so the access clock is current
+    update ();
+    RESID::SID::State sidState = m_sid.read_state ();
+    memcpy (state, &sidState, sizeof (sidState));
+    memcpy (state + sizeof (sidState), &m_accessClk, sizeof (m_accessClk));
+}
+
+void ReSID::restoreState (const uint8_t *state)
+{
+    RESID::SID::State sidState;
+    memcpy (&sidState, state, sizeof (sidState));
+    memcpy (&m_accessClk, state + sizeof (sidState), sizeof (m_accessClk));
+    m_sid.write_state (sidState);
+}
+
+void ReSID::seek (bool enable)
+{
+    update ();
+    m_seeking = enable;
+}
+
 void ReSID::filter (bool enable)
 {
     m_sid.enable_filter (enable);
@@ -251,3 +283,11 @@ void ReSID::model (sid2_model_t model)
     else
         m_sid.set_chip_model (RESID::MOS6581);
 }
+
+bool ReSID::profile (sid_profile &result, bool reset)
+{
+    bool enabled = m_sid.get_profile (result);
+    if (reset)
+        m_sid.reset_profile ();
+    return enabled;
+}
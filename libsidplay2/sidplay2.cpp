@@ -135,12 +135,30 @@ uint_least32_t sidplay2::time (void) const
 uint_least32_t sidplay2::mileage (void) const
 {   return sidplayer.mileage (); }
 
+event_clock_t sidplay2::cycles (void) const
+{   return sidplayer.cycles (); }
+
 const char *sidplay2::error (void) const
 {   return sidplayer.error (); }
 
 int  sidplay2::fastForward  (uint percent)
 {   return sidplayer.fastForward (percent); }
 
+int sidplay2::restore (const void *state)
+{   return sidplayer.restore (state); }
+
+uint_least32_t sidplay2::samples (void) const
+{   return sidplayer.samples (); }
+
+int sidplay2::seek (uint_least32_t time)
+{   return sidplayer.seek (time); }
+
+int sidplay2::snapshot (void *state)
+{   return sidplayer.snapshot (state); }
+
+uint_least32_t sidplay2::snapshotSize (void)
+{   return sidplayer.snapshotSize (); }
+
 void sidplay2::debug (bool enable, FILE *out)
 {   sidplayer.debug (enable, out); }
 
@@ -159,3 +177,8 @@ void sidplay2::setRegisterFrameChangedCallback(void* inInstance, SIDPLAY2_NAMESP
 {
 	sidplayer.setRegisterFrameChangedCallback(inInstance, inCallback);
 }
+
+void sidplay2::setSidWriteCallback(void* inInstance, SIDPLAY2_NAMESPACE::SidWriteCallback inCallback)
+{
+	sidplayer.setSidWriteCallback(inInstance, inCallback);
+}
@@ -143,10 +143,11 @@ SidTune::SidTune(const char* fileName, const char **fileNameExt,
     }
 }
 
-SidTune::SidTune(const uint_least8_t* data, const uint_least32_t dataLen)
+SidTune::SidTune(const uint_least8_t* data, const uint_least32_t dataLen,
+                 const bool borrowBuffer)
 {
     init();
-    getFromBuffer(data,dataLen);
+    getFromBuffer(data,dataLen,borrowBuffer);
 }
 
 SidTune::~SidTune()
@@ -168,11 +169,12 @@ bool SidTune::load(const char* fileName, const bool separatorIsSlash)
     return status;
 }
 
-bool SidTune::read(const uint_least8_t* data, uint_least32_t dataLen)
+bool SidTune::read(const uint_least8_t* data, uint_least32_t dataLen,
+                   const bool borrowBuffer)
 {
     cleanup();
     init();
-    getFromBuffer(data,dataLen);
+    getFromBuffer(data,dataLen,borrowBuffer);
     return status;
 }
 
@@ -485,7 +487,8 @@ void SidTune::getFromStdIn()
 
 #endif
 
-void SidTune::getFromBuffer(const uint_least8_t* const buffer, const uint_least32_t bufferLen)
+void SidTune::getFromBuffer(const uint_least8_t* const buffer, const uint_least32_t bufferLen,
+                            const bool borrowBuffer)
 {
     // Assume a failure, so we can simply return.
     status = false;
@@ -501,20 +504,29 @@ void SidTune::getFromBuffer(const uint_least8_t* const buffer, const uint_least3
         return;
     }
 
-    uint_least8_t* tmpBuf;
+    Buffer_sidtt<const uint_least8_t> buf1;
+    Buffer_sidtt<const uint_least8_t> buf2;  // empty
+
+    if ( borrowBuffer )
+    {   // Parsed in place, only a decompressed or merged
+        // tune gets a buffer of its own
+        buf1.borrow(buffer,bufferLen);
+    }
+    else
+    {
+        uint_least8_t* tmpBuf;
 #ifdef HAVE_EXCEPTIONS
-    if ( 0 == (tmpBuf = new(std::nothrow) uint_least8_t[bufferLen]) )
+        if ( 0 == (tmpBuf = new(std::nothrow) uint_least8_t[bufferLen]) )
 #else
-    if ( 0 == (tmpBuf = new uint_least8_t[bufferLen]) )
+        if ( 0 == (tmpBuf = new uint_least8_t[bufferLen]) )
 #endif
-    {
-        info.statusString = SidTune::txt_notEnoughMemory;
-        return;
+        {
+            info.statusString = SidTune::txt_notEnoughMemory;
+            return;
+        }
+        memcpy(tmpBuf,buffer,bufferLen);
+        buf1.assign(tmpBuf,bufferLen);
     }
-    memcpy(tmpBuf,buffer,bufferLen);
-
-    Buffer_sidtt<const uint_least8_t> buf1(tmpBuf,bufferLen);
-    Buffer_sidtt<const uint_least8_t> buf2;  // empty
 
     if ( decompressPP20(buf1) < 0 )
         return;
@@ -670,7 +682,10 @@ bool SidTune::acceptSidTune(const char* dataFileName, const char* infoFileName,
         return false;
     }
 
-    cache.assign(buf.xferPtr(),buf.xferLen());
+    if ( buf.isOwned() )
+        cache.assign(buf.xferPtr(),buf.xferLen());
+    else
+        cache.borrow(buf.get(),buf.len());
 
     info.statusString = SidTune::txt_noErrors;
     return true;
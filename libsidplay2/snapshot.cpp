@@ -0,0 +1,313 @@
+/***************************************************************************
+                          snapshot.cpp  -  Machine snapshots and seeking
+                             -------------------
+    begin                : Mon Oct 19 2026
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <string.h>
+#include "player.h"
+
+#ifdef HAVE_EXCEPTIONS
+#   include <new>
+#endif
+
+SIDPLAY2_NAMESPACE_START
+
+// A snapshot is a raw image of the emulated components, vtable and
+// event queue pointers included, and so is only valid for the player
+// instance which created it.  The owner rejects those of other players
+// (whose generation counts may well match) and the generation count is
+// moved on by every configuration change to invalidate old snapshots
+// (sid emulation, memory and event setup may have changed).
+struct Snapshot
+{
+    uint_least32_t magic;
+    uint_least32_t generation;
+    uint_least32_t size;
+    uint_least32_t time;
+    const Player  *owner;
+};
+
+static const uint_least32_t SNAPSHOT_MAGIC = 0x53494432; // "SID2"
+
+const char *Player::ERR_SNAPSHOT_UNSUPPORTED = "SIDPLAYER ERROR: Sid emulation does not support snapshots.";
+const char *Player::ERR_SNAPSHOT_INVALID     = "SIDPLAYER ERROR: Snapshot does not belong to the current tune/configuration.";
+
+static inline void snapshotCopy (uint8_t *state, uint_least32_t &offset,
+                                 void *data, uint_least32_t size, bool save)
+{
+    if (state)
+    {
+        if (save)
+            memcpy (state + offset, data, size);
+        else
+            memcpy (data, state + offset, size);
+    }
+    offset += size;
+}
+
+// Single list of everything forming the machine state, used to size,
+// save and restore a snapshot.  Passing a NULL state only sizes it.
+uint_least32_t Player::snapshotTransfer (uint8_t *state, bool save)
+{
+    uint_least32_t offset = sizeof (Snapshot);
+
+    // Components, copied whole over themselves.  Their vtables and
+    // the pointers between them (event queue links, environment,
+    // sid emulations) are those of this instance and unchanged since
+    // the snapshot was made, the event queue links staying consistent
+    // as the components are all copied at the same time.  Heap memory
+    // they own (the 6510 instruction tables) must be allocated once at
+    // construction, so the copied pointers stay the same.
+    snapshotCopy (state, offset, &m_scheduler,  sizeof (m_scheduler),  save);
+    snapshotCopy (state, offset, &cpu,          sizeof (cpu),          save);
+    snapshotCopy (state, offset, &xsid,         sizeof (xsid),         save);
+    snapshotCopy (state, offset, &cia,          sizeof (cia),          save);
+    snapshotCopy (state, offset, &cia2,         sizeof (cia2),         save);
+    snapshotCopy (state, offset, &sid6526,      sizeof (sid6526),      save);
+    snapshotCopy (state, offset, &vic,          sizeof (vic),          save);
+    snapshotCopy (state, offset, &m_mixerEvent, sizeof (m_mixerEvent), save);
+    snapshotCopy (state, offset, &rtc,          sizeof (rtc),          save);
+
+    // Player
+    snapshotCopy (state, offset, &m_sampleClock,  sizeof (m_sampleClock),  save);
+    snapshotCopy (state, offset, &m_mixerClk,     sizeof (m_mixerClk),     save);
+    snapshotCopy (state, offset, &m_samplePosition,
+                  sizeof (m_samplePosition), save);
+    snapshotCopy (state, offset, &m_rtcClock,     sizeof (m_rtcClock),     save);
+    snapshotCopy (state, offset, &m_port,         sizeof (m_port),         save);
+    snapshotCopy (state, offset, &m_playBank,     sizeof (m_playBank),     save);
+    snapshotCopy (state, offset, &isKernal,       sizeof (isKernal),       save);
+    snapshotCopy (state, offset, &isBasic,        sizeof (isBasic),        save);
+    snapshotCopy (state, offset, &isIO,           sizeof (isIO),           save);
+    snapshotCopy (state, offset, &isChar,         sizeof (isChar),         save);
+    snapshotCopy (state, offset, &m_sid2crc,      sizeof (m_sid2crc),      save);
+    snapshotCopy (state, offset, &m_sid2crcCount, sizeof (m_sid2crcCount), save);
+    snapshotCopy (state, offset, &m_CurrentRegisterFrame,
+                  sizeof (m_CurrentRegisterFrame), save);
+
+    // Memory
+    snapshotCopy (state, offset, m_ram, 0x10000, save);
+    if (m_rom != m_ram)
+        snapshotCopy (state, offset, m_rom, 0x10000, save);
+
+    // Sids
+    for (int i = 0; i < SID2_MAX_SIDS; i++)
+    {
+        int_least32_t size = sid[i]->stateSize ();
+        if (state)
+        {
+            if (save)
+                sid[i]->saveState (state + offset);
+            else
+                sid[i]->restoreState (state + offset);
+        }
+        offset += size;
+    }
+    // Keep keyframes stored back to back aligned
+    return (offset + 7) & ~7;
+}
+
+uint_least32_t Player::snapshotSize (void)
+{
+    if (!m_tune || !m_ram)
+        return 0;
+    for (int i = 0; i < SID2_MAX_SIDS; i++)
+    {
+        if (sid[i]->stateSize () < 0)
+            return 0;
+    }
+    return snapshotTransfer (NULL, true);
+}
+
+int Player::snapshot (void *state)
+{
+    Snapshot *header = (Snapshot *) state;
+    uint_least32_t size = snapshotSize ();
+    if (!size)
+    {
+        m_errorString = ERR_SNAPSHOT_UNSUPPORTED;
+        return -1;
+    }
+
+    header->magic      = SNAPSHOT_MAGIC;
+    header->generation = m_snapshotGeneration;
+    header->size       = size;
+    header->owner      = this;
+    header->time       = time ();
+    snapshotTransfer ((uint8_t *) state, true);
+    return 0;
+}
+
+int Player::restore (const void *state)
+{
+    const Snapshot *header = (const Snapshot *) state;
+    if (m_running)
+    {
+        m_errorString = ERR_CONF_WHILST_ACTIVE;
+        return -1;
+    }
+
+    if ((header->magic != SNAPSHOT_MAGIC) ||
+        (header->owner != this) ||
+        (header->generation != m_snapshotGeneration) ||
+        (header->size != snapshotSize ()))
+    {
+        m_errorString = ERR_SNAPSHOT_INVALID;
+        return -1;
+    }
+
+    snapshotTransfer ((uint8_t *) state, false);
+    return 0;
+}
+
+// Drop all keyframes and invalidate any outstanding snapshots.
+void Player::keyframeReset (void)
+{
+    m_snapshotGeneration++;
+    delete [] m_keyframes;
+    m_keyframes     = NULL;
+    m_keyframeCount = 0;
+    m_keyframeMax   = 0;
+}
+
+// Called on each play request to extend the keyframe index.  Only
+// extends forwards so the index remains in time order after a seek.
+void Player::keyframe (void)
+{
+    uint_least32_t interval = m_cfg.keyframeInterval * SID2_TIME_BASE;
+    uint_least32_t size;
+    if (!interval)
+        return;
+    size = snapshotSize ();
+    if (!size)
+        return;
+
+    if (m_keyframeCount)
+    {
+        const Snapshot *last = (const Snapshot *)
+            (m_keyframes + (m_keyframeCount - 1) * size);
+        if (time () < (last->time / interval + 1) * interval)
+            return;
+    }
+
+    if (m_keyframeCount == m_keyframeMax)
+    {   // Grow the index
+        uint_least32_t max = m_keyframeMax ? m_keyframeMax * 2 : 16;
+        uint8_t *keyframes;
+#ifdef HAVE_EXCEPTIONS
+        keyframes = new(std::nothrow) uint8_t[max * size];
+#else
+        keyframes = new uint8_t[max * size];
+#endif
+        if (!keyframes)
+            return;
+        if (m_keyframeCount)
+            memcpy (keyframes, m_keyframes, m_keyframeCount * size);
+        delete [] m_keyframes;
+        m_keyframes   = keyframes;
+        m_keyframeMax = max;
+    }
+
+    snapshot (m_keyframes + m_keyframeCount * size);
+    m_keyframeCount++;
+}
+
+// Run the machine up to the requested time without producing any
+// audio.  The sids only follow the register writes and are left a
+// moment of full emulation before the seek target to settle.
+// Keyframes are taken on the way, so seeking back to somewhere in
+// between does not start over.
+void Player::seekSkip (uint_least32_t until)
+{   // The mixer is restarted afterwards
+    uint_least32_t interval = m_cfg.keyframeInterval * SID2_TIME_BASE;
+    m_mixerEvent.cancel ();
+    for (int i = 0; i < SID2_MAX_SIDS; i++)
+        sid[i]->seek (true);
+
+    m_playerState = sid2_playing;
+    m_running     = true;
+    while (m_running && (time () < until))
+    {
+        uint_least32_t stop = until;
+        if (interval && ((time () / interval + 1) * interval < stop))
+            stop = (time () / interval + 1) * interval;
+        while (m_running && (time () < stop))
+            m_scheduler.clock ();
+        if (m_running)
+            keyframe ();
+    }
+    m_running     = false;
+
+    for (int i = 0; i < SID2_MAX_SIDS; i++)
+        sid[i]->seek (false);
+    mixerResume ();
+
+    if (m_playerState == sid2_stopped)
+        initialise ();
+}
+
+// Position the tune at the requested time (in units of timebase).
+// Restores the nearest keyframe at or before the target (when that
+// is better than the current position) and emulates the remainder,
+// all but the last moment of which is without audio.
+int Player::seek (uint_least32_t target)
+{
+    uint_least32_t size = snapshotSize ();
+    char buffer[4096];
+
+    if (!m_tune)
+        return 0;
+    if (m_running)
+    {
+        m_errorString = ERR_CONF_WHILST_ACTIVE;
+        return -1;
+    }
+
+    {   // Find the nearest keyframe
+        const Snapshot *best = NULL;
+        for (uint_least32_t i = 0; i < m_keyframeCount; i++)
+        {
+            const Snapshot *key = (const Snapshot *) (m_keyframes + i * size);
+            if (key->time > target)
+                break;
+            best = key;
+        }
+
+        if (best && ((time () > target) || (best->time > time ())))
+        {
+            if (restore (best) < 0)
+                return -1;
+        }
+        else if (time () > target)
+        {   // Nothing to go back to, restart the song
+            initialise ();
+        }
+    }
+
+    if (time () + SID2_SEEK_SETTLE < target)
+    {
+        seekSkip (target - SID2_SEEK_SETTLE);
+        if (m_playerState == sid2_stopped)
+            return 0;
+    }
+
+    while (time () < target)
+    {
+        play (buffer, sizeof (buffer));
+        if (m_playerState == sid2_stopped)
+            break;
+    }
+    return 0;
+}
+
+SIDPLAY2_NAMESPACE_STOP
@@ -173,6 +173,37 @@ reg8 EnvelopeGenerator::sustain_level[] = {
 };
 
 
+// ----------------------------------------------------------------------------
+// SID clocking - delta_t cycles.
+// Only the rate periods are visited, and once the envelope counter can no
+// longer change (frozen at zero or holding the sustain level) the remaining
+// periods just advance the exponential counter.
+// ----------------------------------------------------------------------------
+void EnvelopeGenerator::clock(cycle_count delta_t)
+{
+    // NB! The rate counter may be negative after the ADSR delay bug wrap.
+    cycle_count rate_step = rate_period - rate_counter;
+    
+    while (delta_t >= rate_step) {
+        delta_t -= rate_step;
+        rate_counter = 0;
+        step();
+        rate_step = rate_period;
+        
+        if (hold_zero ||
+            (state == DECAY_SUSTAIN && envelope_counter == sustain_level[sustain])) {
+            cycle_count steps = delta_t / rate_period;
+            delta_t -= steps*rate_period;
+            exponential_counter =
+            (exponential_counter + steps) % exponential_counter_period;
+            break;
+        }
+    }
+    
+    rate_counter += delta_t;
+}
+
+
 // ----------------------------------------------------------------------------
 // Register functions.
 // ----------------------------------------------------------------------------
@@ -39,6 +39,7 @@ public:
     enum State { ATTACK, DECAY_SUSTAIN, RELEASE };
     
     RESID_INLINE void clock();
+    void clock(cycle_count delta_t);
     void reset();
     
     void writeCONTROL_REG(reg8);
@@ -51,6 +52,7 @@ public:
     
 protected:
     void update_rate_period(reg16 period);
+    RESID_INLINE void step();
     
     int rate_counter;
     int rate_period;
@@ -88,7 +90,15 @@ void EnvelopeGenerator::clock()
         return;
     
     rate_counter = 0;
-    
+    step();
+}
+
+// ----------------------------------------------------------------------------
+// Envelope step, taken each time the rate counter reaches the rate period.
+// ----------------------------------------------------------------------------
+RESID_INLINE
+void EnvelopeGenerator::step()
+{
     // The first envelope step in the attack state also resets the exponential
     // counter. This has been verified by sampling ENV3.
     //
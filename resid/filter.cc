@@ -22,6 +22,8 @@
 #include "spline.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
 
 // Maximum cutoff frequency is specified as
 // FCmax = 2.6e-5/C = 2.6e-5/2200e-12 = 11818.
@@ -108,11 +110,88 @@ fc_point Filter::f0_points_8580[] =
 };
 
 
+// ----------------------------------------------------------------------------
+// Cutoff frequency tables shared between filters.
+// Every filter used to interpolate its own 2048 entry table. Tables are now
+// kept once per set of interpolation points and reference counted, so
+// filters of the same chip model (or fed the same custom curve) share one.
+// Only a few distinct curves are ever in use, a list will do.
+// ----------------------------------------------------------------------------
+struct SharedCutoffTable
+{
+    SharedCutoffTable* next;
+    int refs;
+    int points;
+    fc_point* curve;
+    sound_sample f0[2048];
+};
+
+static SharedCutoffTable* shared_cutoff_tables = 0;
+static pthread_mutex_t shared_cutoff_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const sound_sample* acquire_cutoff_table(const fc_point* curve, int points)
+{
+    pthread_mutex_lock(&shared_cutoff_mutex);
+
+    SharedCutoffTable* table;
+    for (table = shared_cutoff_tables; table; table = table->next) {
+        if (table->points == points &&
+            memcmp(table->curve, curve, points*sizeof(fc_point)) == 0) {
+            break;
+        }
+    }
+
+    if (!table) {
+        table = new SharedCutoffTable;
+        table->refs = 0;
+        table->points = points;
+        table->curve = new fc_point[points];
+        memcpy(table->curve, curve, points*sizeof(fc_point));
+        interpolate(curve, curve + (points - 1),
+                    PointPlotter<sound_sample>(table->f0), 1.0);
+        table->next = shared_cutoff_tables;
+        shared_cutoff_tables = table;
+    }
+
+    table->refs++;
+
+    pthread_mutex_unlock(&shared_cutoff_mutex);
+
+    return table->f0;
+}
+
+static void release_cutoff_table(const sound_sample* f0)
+{
+    if (!f0) {
+        return;
+    }
+
+    pthread_mutex_lock(&shared_cutoff_mutex);
+
+    for (SharedCutoffTable** link = &shared_cutoff_tables; *link;
+         link = &(*link)->next) {
+        SharedCutoffTable* table = *link;
+        if (table->f0 == f0) {
+            if (--table->refs == 0) {
+                *link = table->next;
+                delete[] table->curve;
+                delete table;
+            }
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&shared_cutoff_mutex);
+}
+
+
 // ----------------------------------------------------------------------------
 // Constructor.
 // ----------------------------------------------------------------------------
 Filter::Filter()
 {
+    m_f0 = 0;
+
     m_fc = 0;
     
     m_res = 0;
@@ -147,6 +226,15 @@ Filter::Filter()
 }
 
 
+// ----------------------------------------------------------------------------
+// Destructor.
+// ----------------------------------------------------------------------------
+Filter::~Filter()
+{
+    release_cutoff_table(m_f0);
+}
+
+
 // ----------------------------------------------------------------------------
 // Enable filter.
 // ----------------------------------------------------------------------------
@@ -217,7 +305,9 @@ void Filter::set_filter_cutoff_table(const fc_point* table, int points)
         f0 = m_f0_points;
         points = m_f0_count;
     }
-    interpolate (f0, f0 + (points - 1), PointPlotter<sound_sample>(m_f0), 1.0);
+    const sound_sample* previous = m_f0;
+    m_f0 = acquire_cutoff_table(f0, points);
+    release_cutoff_table(previous);
 //    for(int i=0;i<2048;i++) printf("point %d = %d\n", i, m_f0[i]);
 }
 
@@ -122,6 +122,7 @@ class Filter
 {
 public:
     Filter();
+    ~Filter();
     
     void enable_filter(bool enable);
     void set_chip_model(chip_model model);
@@ -191,14 +192,20 @@ protected:
     sound_sample m_1024_div_Q;
     
     // Cutoff frequency tables.
-    // FC is an 11 bit register.
-    sound_sample m_f0[2048];
+    // FC is an 11 bit register.  The table is shared by all filters
+    // interpolated from the same points, see filter.cc.
+    const sound_sample* m_f0;
     static fc_point f0_points_6581[];
     static fc_point f0_points_8580[];
     fc_point* m_f0_points;
     int m_f0_count;
     
     friend class SID;
+
+private:
+    // The cutoff table is referenced, not owned.
+    Filter(const Filter&);
+    Filter& operator=(const Filter&);
 };
 
 
@@ -19,6 +19,21 @@
 
 #include "sid.h"
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#if RESID_PROFILE
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif
 
 // ----------------------------------------------------------------------------
 // Constructor.
@@ -27,6 +42,7 @@ SID::SID()
 {
     // Initialize pointers.
     sample = 0;
+    sample_right = 0;
     fir = 0;
 
 	ASSERT(NUM_VOICES >= 3);
@@ -40,6 +56,17 @@ SID::SID()
     bus_value_ttl = 0;
     
     ext_in = 0;
+
+    sampling = SAMPLE_INTERPOLATE;
+
+    stereo = false;
+    panned = false;
+    Vo_right = 0;
+    for (int i = 0; i < NUM_VOICES; i++) {
+        write_pan(i, 0);
+    }
+
+    reset_profile();
 }
 
 
@@ -49,7 +76,8 @@ SID::SID()
 SID::~SID()
 {
     delete[] sample;
-    delete[] fir;
+    delete[] sample_right;
+    release_fir_table(fir);
 }
 
 
@@ -64,6 +92,8 @@ void SID::set_chip_model(chip_model model)
     
     filter.set_chip_model(model);
     extfilt.set_chip_model(model);
+    filter_right.set_chip_model(model);
+    extfilt_right.set_chip_model(model);
 
 	//see voice.cc for explanation
     if (model == MOS6581) {
@@ -79,6 +109,7 @@ void SID::set_chip_model(chip_model model)
 void SID::set_distortion_properties(int a1, int a2, int a3, int a4, int a5)
 {
     filter.set_distortion_properties(a1, a2, a3, a4, a5);
+    filter_right.set_distortion_properties(a1, a2, a3, a4, a5);
 }
 
 // ----------------------------------------------------------------------------
@@ -90,6 +121,7 @@ void SID::reset()
         voice[i].reset();
         fuzz[i].reset();
 		mute[i] = false;
+        write_pan(i, 0);
     }
     filter.reset();
     extfilt.reset();
@@ -97,6 +129,12 @@ void SID::reset()
 	trebleboost.reset();
     fuzzMain.reset();
 	Vo = 0;
+    filter_right.reset();
+    extfilt_right.reset();
+    bassboost_right.reset();
+    trebleboost_right.reset();
+    fuzzMain_right.reset();
+    Vo_right = 0;
     
     bus_value = 0;
     bus_value_ttl = 0;
@@ -124,10 +162,16 @@ void SID::input(int sample)
 // ----------------------------------------------------------------------------
 
 int SID::output(int bits)
+{
+    return output_sample(Vo, bits);
+}
+
+RESID_INLINE
+int SID::output_sample(sound_sample v, int bits)
 {
     const int range = 1 << bits;
     const int half = range >> 1;
-    int sample = Vo/((4095*255 >> 7)*3*15*2/range);
+    int sample = v/((4095*255 >> 7)*3*15*2/range);
     if (sample >= half) {
         return half - 1;
     }
@@ -137,6 +181,14 @@ int SID::output(int bits)
     return sample;
 }
 
+// Audio output at the gain of output(16), without its truncation and clamp.
+RESID_INLINE
+float SID::output_float(sound_sample v)
+{
+    const float scale = 1.0f/((4095*255 >> 7)*3*15*2/65536*32768.0f);
+    return v*scale;
+}
+
 
 // ----------------------------------------------------------------------------
 // Read registers.
@@ -206,31 +258,10 @@ void SID::write(reg8 offset, reg8 value)
         case SID_VOICE2_ENV_ATTACK_DECAY:	voice[2].envelope.writeATTACK_DECAY(value); break;
         case SID_VOICE2_ENV_SUSTAIN_RELEASE:voice[2].envelope.writeSUSTAIN_RELEASE(value); break;
 
-        case SID_FILTER_FC_LO:				filter.writeFC_LO(value); break;
-        case SID_FILTER_FC_HI:				filter.writeFC_HI(value); break;
-        case SID_FILTER_RES_FILT:			filter.writeRES_FILT(value); break;
-        case SID_FILTER_MODE_VOL:			filter.writeMODE_VOL(value); break;
-
-		//SID+ registers
-		case SIDPLUS_BASSBOOST_GAIN_LO:		bassboost.writeGAIN_LO(value); break;
-		case SIDPLUS_BASSBOOST_GAIN_HI:		bassboost.writeGAIN_HI(value); break;
-		case SIDPLUS_BASSBOOST_CUTOFF_LO:	bassboost.writeCUTOFF_LO(value); break;
-		case SIDPLUS_BASSBOOST_CUTOFF_HI:	bassboost.writeCUTOFF_HI(value); break;
-
-		case SIDPLUS_TREBLEBOOST_GAIN_LO:	trebleboost.writeGAIN_LO(value); break;
-		case SIDPLUS_TREBLEBOOST_GAIN_HI:	trebleboost.writeGAIN_HI(value); break;
-		case SIDPLUS_TREBLEBOOST_CUTOFF_LO:	trebleboost.writeCUTOFF_LO(value); break;
-		case SIDPLUS_TREBLEBOOST_CUTOFF_HI:	trebleboost.writeCUTOFF_HI(value); break;
-
-        case SIDPLUS_FILTER_RES:            filter.writeRES(value); break;
-
-		case SIDPLUS_FUZZ_GAIN_LO:          fuzzMain.writeGAIN_LO(value); break;
-		case SIDPLUS_FUZZ_GAIN_HI:		fuzzMain.writeGAIN_HI(value); break;
-		case SIDPLUS_FUZZ_MULT_LO:		fuzzMain.writeMULT_LO(value); break;
-		case SIDPLUS_FUZZ_MULT_HI:		fuzzMain.writeMULT_HI(value); break;
-		case SIDPLUS_FUZZ_MIX:			fuzzMain.writeMIX(value); break;
-
+        // Filter and SID+ effects.
         default:
+            write_output_stage(offset, value, filter, bassboost, trebleboost, fuzzMain);
+            write_output_stage(offset, value, filter_right, bassboost_right, trebleboost_right, fuzzMain_right);
             break;
     }
 
@@ -261,25 +292,137 @@ void SID::write(reg8 offset, reg8 value)
 		case SIDPLUS_VOICE_FUZZ_MULT_LO:		fuzz[v].writeMULT_LO(value); break;
 		case SIDPLUS_VOICE_FUZZ_MULT_HI:		fuzz[v].writeMULT_HI(value); break;
 		case SIDPLUS_VOICE_FUZZ_MIX:			fuzz[v].writeMIX(value); break;
-		case SIDPLUS_VOICE_FILT:				filter.writeSIDPLUSFILT((value<<7)|(v&0x7f)); break;
+		case SIDPLUS_VOICE_FILT:
+			filter.writeSIDPLUSFILT((value<<7)|(v&0x7f));
+			filter_right.writeSIDPLUSFILT((value<<7)|(v&0x7f));
+			break;
+		case SIDPLUS_VOICE_PAN:					write_pan(v, value); break;
 		default: break;
 		}
 	}
 }
 
 
+// ----------------------------------------------------------------------------
+// Write the filter and SID+ effect registers of one channel.
+// ----------------------------------------------------------------------------
+void SID::write_output_stage(reg8 offset, reg8 value, Filter& f, BassBoostFilter& bb,
+                             TrebleBoostFilter& tb, FuzzFilter& fz)
+{
+    switch (offset) {
+        case SID_FILTER_FC_LO:				f.writeFC_LO(value); break;
+        case SID_FILTER_FC_HI:				f.writeFC_HI(value); break;
+        case SID_FILTER_RES_FILT:			f.writeRES_FILT(value); break;
+        case SID_FILTER_MODE_VOL:			f.writeMODE_VOL(value); break;
+
+		//SID+ registers
+		case SIDPLUS_BASSBOOST_GAIN_LO:		bb.writeGAIN_LO(value); break;
+		case SIDPLUS_BASSBOOST_GAIN_HI:		bb.writeGAIN_HI(value); break;
+		case SIDPLUS_BASSBOOST_CUTOFF_LO:	bb.writeCUTOFF_LO(value); break;
+		case SIDPLUS_BASSBOOST_CUTOFF_HI:	bb.writeCUTOFF_HI(value); break;
+
+		case SIDPLUS_TREBLEBOOST_GAIN_LO:	tb.writeGAIN_LO(value); break;
+		case SIDPLUS_TREBLEBOOST_GAIN_HI:	tb.writeGAIN_HI(value); break;
+		case SIDPLUS_TREBLEBOOST_CUTOFF_LO:	tb.writeCUTOFF_LO(value); break;
+		case SIDPLUS_TREBLEBOOST_CUTOFF_HI:	tb.writeCUTOFF_HI(value); break;
+
+        case SIDPLUS_FILTER_RES:            f.writeRES(value); break;
+
+		case SIDPLUS_FUZZ_GAIN_LO:          fz.writeGAIN_LO(value); break;
+		case SIDPLUS_FUZZ_GAIN_HI:		fz.writeGAIN_HI(value); break;
+		case SIDPLUS_FUZZ_MULT_LO:		fz.writeMULT_LO(value); break;
+		case SIDPLUS_FUZZ_MULT_HI:		fz.writeMULT_HI(value); break;
+		case SIDPLUS_FUZZ_MIX:			fz.writeMIX(value); break;
+
+        default:
+            break;
+    }
+}
+
+
+// ----------------------------------------------------------------------------
+// Voice panning.
+// Signed, 0 is the center and -127 and 127 are all left and all right. The
+// channel away from the voice fades out while the other stays at full level,
+// so voices in the center sound as they do in mono.
+// ----------------------------------------------------------------------------
+void SID::write_pan(int v, reg8 value)
+{
+    int p = (signed char)value;
+    if (p < -127) {
+        p = -127;
+    }
+    pan[v] = value & 0xff;
+    pan_left[v] = p > 0 ? ((127 - p) << 8)/127 : 1 << 8;
+    pan_right[v] = p < 0 ? ((127 + p) << 8)/127 : 1 << 8;
+
+    bool was_panned = panned;
+    panned = false;
+    for (int i = 0; i < NUM_VOICES; i++) {
+        if (pan[i] != 0) {
+            panned = true;
+        }
+    }
+
+    // The right channel was the left one until now.
+    if (panned && !was_panned) {
+        sync_right_channel();
+    }
+}
+
+
+// ----------------------------------------------------------------------------
+// Start the right channel output stage from the state of the left one.
+// ----------------------------------------------------------------------------
+void SID::sync_right_channel()
+{
+    filter_right.m_Vhp = filter.m_Vhp;
+    filter_right.m_Vbp = filter.m_Vbp;
+    filter_right.m_Vlp = filter.m_Vlp;
+    filter_right.m_Vnf = filter.m_Vnf;
+    filter_right.m_w0_deriv_smoothed = filter.m_w0_deriv_smoothed;
+    extfilt_right.Vlp = extfilt.Vlp;
+    extfilt_right.Vhp = extfilt.Vhp;
+    extfilt_right.Vo = extfilt.Vo;
+    bassboost_right.y1_curr = bassboost.y1_curr;
+    bassboost_right.y1_prev = bassboost.y1_prev;
+    bassboost_right.x_prev = bassboost.x_prev;
+    bassboost_right.Vo = bassboost.Vo;
+    trebleboost_right.y1_curr = trebleboost.y1_curr;
+    trebleboost_right.y1_prev = trebleboost.y1_prev;
+    trebleboost_right.x_prev = trebleboost.x_prev;
+    trebleboost_right.Vo = trebleboost.Vo;
+    fuzzMain_right.Vo = fuzzMain.Vo;
+    Vo_right = Vo;
+}
+
+
+// ----------------------------------------------------------------------------
+// Stereo output.
+// ----------------------------------------------------------------------------
+void SID::set_stereo(bool enable)
+{
+    if (enable && !stereo) {
+        sync_right_channel();
+        memcpy(sample_right, sample, sizeof(short)*RINGSIZE*2);
+        sample_prev_right = sample_prev;
+        sample_prev_right_float = sample_prev_float;
+    }
+    stereo = enable;
+}
+
+
 // ----------------------------------------------------------------------------
 // Constructor.
 // ----------------------------------------------------------------------------
 SID::State::State()
 {
-    int i;
+    int i, j;
     
     for (i = 0; i < NUM_SID_REGS; i++) {
         sid_register[i] = 0;
     }
     
-    ASSERT(NUM_VOICES == 3);	//TODO check this function
     bus_value = 0;
     bus_value_ttl = 0;
     
@@ -293,19 +436,36 @@ SID::State::State()
         envelope_counter[i] = 0;
         envelope_state[i] = EnvelopeGenerator::RELEASE;
         hold_zero[i] = true;
+        for (j = 0; j < NUM_HARMONICS; j++) {
+            harmonics_accumulator[i][j] = 0;
+        }
+        noise_output_cached[i] = 0;
+        waveform_output[i] = 0;
+        noise_overwrite_delay[i] = 0;
+        fuzz_Vo[i] = 0;
     }
+    
+    filter_Vhp = filter_Vbp = filter_Vlp = filter_Vnf = 0;
+    filter_w0_deriv_smoothed = 0;
+    extfilt_Vlp = extfilt_Vhp = extfilt_Vo = 0;
+    bassboost_y1_curr = bassboost_y1_prev = bassboost_x_prev = bassboost_Vo = 0;
+    trebleboost_y1_curr = trebleboost_y1_prev = trebleboost_x_prev = trebleboost_Vo = 0;
+    fuzzMain_Vo = 0;
+    Vo = 0;
 }
 
 
 // ----------------------------------------------------------------------------
 // Read state.
+// The SID+ registers are reconstructed so that write_state() can restore
+// the boost filters, harmonics, fuzz and per voice filter routing by
+// writing them back.
 // ----------------------------------------------------------------------------
 SID::State SID::read_state()
 {
     State state;
     int i, j;
-    ASSERT(NUM_VOICES == 3);	//TODO check this function
-    for (i = 0, j = 0; i < NUM_VOICES; i++, j += 7) {
+    for (i = 0, j = 0; i < 3; i++, j += 7) {
         WaveformGenerator& wave = voice[i].wave;
         EnvelopeGenerator& envelope = voice[i].envelope;
         state.sid_register[j + 0] = wave.freq & 0xff;
@@ -330,12 +490,49 @@ SID::State SID::read_state()
     | (filter.m_hp_bp_lp << 4)
     | filter.m_vol;
     
-    // These registers are superfluous, but included for completeness.
-    for (; j < 0x1d; j++) {
-        state.sid_register[j] = read(j);
-    }
-    for (; j < NUM_SID_REGS; j++) {
-        state.sid_register[j] = 0;
+    // SID+ registers, these overlay the read only registers.
+    state.sid_register[SIDPLUS_BASSBOOST_GAIN_LO] = bassboost.gain & 0xff;
+    state.sid_register[SIDPLUS_BASSBOOST_GAIN_HI] = (bassboost.gain >> 8) & 0xff;
+    state.sid_register[SIDPLUS_BASSBOOST_CUTOFF_LO] = bassboost.cutoff_freq & 0xff;
+    state.sid_register[SIDPLUS_BASSBOOST_CUTOFF_HI] = (bassboost.cutoff_freq >> 8) & 0xff;
+    state.sid_register[SIDPLUS_TREBLEBOOST_GAIN_LO] = trebleboost.gain & 0xff;
+    state.sid_register[SIDPLUS_TREBLEBOOST_GAIN_HI] = (trebleboost.gain >> 8) & 0xff;
+    state.sid_register[SIDPLUS_TREBLEBOOST_CUTOFF_LO] = trebleboost.cutoff_freq & 0xff;
+    state.sid_register[SIDPLUS_TREBLEBOOST_CUTOFF_HI] = (trebleboost.cutoff_freq >> 8) & 0xff;
+    state.sid_register[SIDPLUS_FILTER_RES] = filter.m_res << 4;
+    state.sid_register[SIDPLUS_FUZZ_GAIN_LO] = fuzzMain.gain & 0xff;
+    state.sid_register[SIDPLUS_FUZZ_GAIN_HI] = (fuzzMain.gain >> 8) & 0xff;
+    state.sid_register[SIDPLUS_FUZZ_MULT_LO] = fuzzMain.multiplier & 0xff;
+    state.sid_register[SIDPLUS_FUZZ_MULT_HI] = (fuzzMain.multiplier >> 8) & 0xff;
+    state.sid_register[SIDPLUS_FUZZ_MIX] = fuzzMain.mix & 0xff;
+    
+    for (i = 0; i < NUM_VOICES; i++) {
+        WaveformGenerator& wave = voice[i].wave;
+        EnvelopeGenerator& envelope = voice[i].envelope;
+        char* reg = state.sid_register + SIDPLUS_EXT_VOICE_BASE
+                  + i*SIDPLUS_VOICE_NUM_REGS;
+        reg[SIDPLUS_VOICE_WAVE_FREQ_LO] = wave.freq & 0xff;
+        reg[SIDPLUS_VOICE_WAVE_FREQ_HI] = wave.freq >> 8;
+        reg[SIDPLUS_VOICE_WAVE_PW_LO] = wave.pw & 0xff;
+        reg[SIDPLUS_VOICE_WAVE_PW_HI] = wave.pw >> 8;
+        reg[SIDPLUS_VOICE_CONTROL_REG] =
+        (wave.waveform << 4)
+        | (wave.test ? 0x08 : 0)
+        | (wave.ring_mod ? 0x04 : 0)
+        | (wave.sync ? 0x02 : 0)
+        | (envelope.gate ? 0x01 : 0);
+        reg[SIDPLUS_VOICE_ENV_ATTACK_DECAY] = (envelope.attack << 4) | envelope.decay;
+        reg[SIDPLUS_VOICE_ENV_SUSTAIN_RELEASE] = (envelope.sustain << 4) | envelope.release;
+        for (j = 0; j < NUM_HARMONICS; j++) {
+            reg[SIDPLUS_VOICE_HVOL_0 + j] = wave.harmonic_vol[j];
+        }
+        reg[SIDPLUS_VOICE_FUZZ_GAIN_LO] = fuzz[i].gain & 0xff;
+        reg[SIDPLUS_VOICE_FUZZ_GAIN_HI] = (fuzz[i].gain >> 8) & 0xff;
+        reg[SIDPLUS_VOICE_FUZZ_MULT_LO] = fuzz[i].multiplier & 0xff;
+        reg[SIDPLUS_VOICE_FUZZ_MULT_HI] = (fuzz[i].multiplier >> 8) & 0xff;
+        reg[SIDPLUS_VOICE_FUZZ_MIX] = fuzz[i].mix & 0xff;
+        reg[SIDPLUS_VOICE_FILT] = (filter.m_filt1 >> i) & 1;
+        reg[SIDPLUS_VOICE_PAN] = pan[i];
     }
     
     state.bus_value = bus_value;
@@ -351,8 +548,34 @@ SID::State SID::read_state()
         state.envelope_counter[i] = voice[i].envelope.envelope_counter;
         state.envelope_state[i] = voice[i].envelope.state;
         state.hold_zero[i] = voice[i].envelope.hold_zero;
+        for (j = 0; j < NUM_HARMONICS; j++) {
+            state.harmonics_accumulator[i][j] = voice[i].wave.harmonics_accumulator[j];
+        }
+        state.noise_output_cached[i] = voice[i].wave.noise_output_cached;
+        state.waveform_output[i] = voice[i].wave.previous;
+        state.noise_overwrite_delay[i] = voice[i].wave.noise_overwrite_delay;
+        state.fuzz_Vo[i] = fuzz[i].Vo;
     }
     
+    state.filter_Vhp = filter.m_Vhp;
+    state.filter_Vbp = filter.m_Vbp;
+    state.filter_Vlp = filter.m_Vlp;
+    state.filter_Vnf = filter.m_Vnf;
+    state.filter_w0_deriv_smoothed = filter.m_w0_deriv_smoothed;
+    state.extfilt_Vlp = extfilt.Vlp;
+    state.extfilt_Vhp = extfilt.Vhp;
+    state.extfilt_Vo = extfilt.Vo;
+    state.bassboost_y1_curr = bassboost.y1_curr;
+    state.bassboost_y1_prev = bassboost.y1_prev;
+    state.bassboost_x_prev = bassboost.x_prev;
+    state.bassboost_Vo = bassboost.Vo;
+    state.trebleboost_y1_curr = trebleboost.y1_curr;
+    state.trebleboost_y1_prev = trebleboost.y1_prev;
+    state.trebleboost_x_prev = trebleboost.x_prev;
+    state.trebleboost_Vo = trebleboost.Vo;
+    state.fuzzMain_Vo = fuzzMain.Vo;
+    state.Vo = Vo;
+    
     return state;
 }
 
@@ -362,8 +585,7 @@ SID::State SID::read_state()
 // ----------------------------------------------------------------------------
 void SID::write_state(const State& state)
 {
-    int i;
-    ASSERT(NUM_VOICES == 3);	//TODO check this function
+    int i, j;
     
     for (i = 0; i < NUM_SID_REGS; i++) {
         write(i, state.sid_register[i]);
@@ -382,7 +604,36 @@ void SID::write_state(const State& state)
         voice[i].envelope.envelope_counter = state.envelope_counter[i];
         voice[i].envelope.state = state.envelope_state[i];
         voice[i].envelope.hold_zero = state.hold_zero[i];
+        for (j = 0; j < NUM_HARMONICS; j++) {
+            voice[i].wave.harmonics_accumulator[j] = state.harmonics_accumulator[i][j];
+        }
+        voice[i].wave.noise_output_cached = state.noise_output_cached[i];
+        voice[i].wave.previous = state.waveform_output[i];
+        voice[i].wave.noise_overwrite_delay = state.noise_overwrite_delay[i];
+        fuzz[i].Vo = state.fuzz_Vo[i];
     }
+    
+    filter.m_Vhp = state.filter_Vhp;
+    filter.m_Vbp = state.filter_Vbp;
+    filter.m_Vlp = state.filter_Vlp;
+    filter.m_Vnf = state.filter_Vnf;
+    filter.m_w0_deriv_smoothed = state.filter_w0_deriv_smoothed;
+    extfilt.Vlp = state.extfilt_Vlp;
+    extfilt.Vhp = state.extfilt_Vhp;
+    extfilt.Vo = state.extfilt_Vo;
+    bassboost.y1_curr = state.bassboost_y1_curr;
+    bassboost.y1_prev = state.bassboost_y1_prev;
+    bassboost.x_prev = state.bassboost_x_prev;
+    bassboost.Vo = state.bassboost_Vo;
+    trebleboost.y1_curr = state.trebleboost_y1_curr;
+    trebleboost.y1_prev = state.trebleboost_y1_prev;
+    trebleboost.x_prev = state.trebleboost_x_prev;
+    trebleboost.Vo = state.trebleboost_Vo;
+    fuzzMain.Vo = state.fuzzMain_Vo;
+    Vo = state.Vo;
+
+    // Only the left channel is kept, the right one goes on from it.
+    sync_right_channel();
 }
 
 
@@ -392,6 +643,7 @@ void SID::write_state(const State& state)
 void SID::enable_filter(bool enable)
 {
     filter.enable_filter(enable);
+    filter_right.enable_filter(enable);
 }
 
 
@@ -401,6 +653,7 @@ void SID::enable_filter(bool enable)
 void SID::enable_external_filter(bool enable)
 {
     extfilt.enable_filter(enable);
+    extfilt_right.enable_filter(enable);
 }
 
 // ----------------------------------------------------------------------------
@@ -439,77 +692,196 @@ double SID::I0(double x)
 
 
 // ----------------------------------------------------------------------------
-// Setting of SID sampling parameters.
-//
-// Use a clock freqency of 985248Hz for PAL C64, 1022730Hz for NTSC C64.
-// The default end of passband frequency is pass_freq = 0.9*sample_freq/2
-// for sample frequencies up to ~ 44.1kHz, and 20kHz for higher sample
-// frequencies.
-//
-// For resampling, the ratio between the clock frequency and the sample
-// frequency is limited as follows:
-//   125*clock_freq/sample_freq < 16384
-// E.g. provided a clock frequency of ~ 1MHz, the sample frequency can not
-// be set lower than ~ 8kHz. A lower sample frequency would make the
-// resampling code overfill its 16k sample ring buffer.
-//
-// The end of passband frequency is also limited:
-//   pass_freq <= 0.9*sample_freq/2
-
-// E.g. for a 44.1kHz sampling rate the end of passband frequency is limited
-// to slightly below 20kHz. This constraint ensures that the FIR table is
-// not overfilled.
+// FIR tables shared between SIDs.
+// The tables only depend on the sampling parameters, so they are designed
+// once per set of parameters and reference counted, instead of by (and
+// for) every SID. A few tables no longer referenced are kept, so switching
+// the sample rate back and forth is a lookup. Given a cache directory the
+// tables are also written to files there and read back by later runs.
 // ----------------------------------------------------------------------------
-bool SID::set_sampling_parameters(double clock_freq,
-                                  double sample_freq, double pass_freq,
-                                  double filter_scale)
+struct SharedFirTable
 {
-    // Check resampling constraints.
-    // Check whether the sample ring buffer would overfill.
-    if (FIR_N*clock_freq/sample_freq >= RINGSIZE) {
+    SharedFirTable* next;
+    int refs;
+    double clock_freq;
+    double sample_freq;
+    double pass_freq;
+    double filter_scale;
+    int fir_N;
+    int fir_RES;
+    short* fir;
+};
+
+static SharedFirTable* shared_fir_tables = 0;
+static pthread_mutex_t shared_fir_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const int FIR_KEEP_UNUSED = 4;
+
+static char fir_cache_directory[1024] = "";
+
+// Cache file header, the tables follow in host byte order.
+struct FirCacheHeader
+{
+    char magic[8];
+    int version;
+    int fir_N;
+    int fir_RES;
+    double clock_freq;
+    double sample_freq;
+    double pass_freq;
+    double filter_scale;
+};
+
+static const char fir_cache_magic[8] = { 'r', 'e', 'S', 'I', 'D', 'F', 'I', 'R' };
+static const int fir_cache_version = 1;
+
+static void fir_cache_path(char* path, int size, const SharedFirTable* table)
+{
+    snprintf(path, size, "%s/resid-fir-%d-%d-%d-%d.bin", fir_cache_directory,
+             int(table->clock_freq + 0.5), int(table->sample_freq + 0.5),
+             int(table->pass_freq + 0.5), int(table->filter_scale*1000 + 0.5));
+}
+
+static bool load_fir_table(SharedFirTable* table, int fir_N, int fir_RES)
+{
+    if (!fir_cache_directory[0]) {
         return false;
     }
-    
-    // The default passband limit is 0.9*sample_freq/2 for sample
-    // frequencies below ~ 44.1kHz, and 20kHz for higher sample frequencies.
-    if (pass_freq < 0) {
-        pass_freq = 20000;
-        if (2*pass_freq/sample_freq >= 0.9) {
-            pass_freq = 0.9*sample_freq/2;
+
+    char path[1024 + 64];
+    fir_cache_path(path, sizeof(path), table);
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+
+    // The name is rounded, the header has the exact parameters and the
+    // table size they design.
+    FirCacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+        memcmp(header.magic, fir_cache_magic, sizeof(header.magic)) == 0 &&
+        header.version == fir_cache_version &&
+        header.clock_freq == table->clock_freq &&
+        header.sample_freq == table->sample_freq &&
+        header.pass_freq == table->pass_freq &&
+        header.filter_scale == table->filter_scale &&
+        header.fir_N == fir_N && header.fir_RES == fir_RES;
+
+    if (ok) {
+        int size = header.fir_N*header.fir_RES;
+        short* fir = new short[size];
+        if (fread(fir, sizeof(short), size, f) == size_t(size)) {
+            table->fir_N = header.fir_N;
+            table->fir_RES = header.fir_RES;
+            table->fir = fir;
+        }
+        else {
+            delete[] fir;
+            ok = false;
         }
     }
-    // Check whether the FIR table would overfill.
-    else if (pass_freq > 0.9*sample_freq/2) {
+
+    fclose(f);
+    return ok;
+}
+
+static void save_fir_table(const SharedFirTable* table)
+{
+    if (!fir_cache_directory[0]) {
+        return;
+    }
+
+    char path[1024 + 64];
+    char temp[sizeof(path) + 8];
+    fir_cache_path(path, sizeof(path), table);
+    snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
+
+    FirCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, fir_cache_magic, sizeof(header.magic));
+    header.version = fir_cache_version;
+    header.fir_N = table->fir_N;
+    header.fir_RES = table->fir_RES;
+    header.clock_freq = table->clock_freq;
+    header.sample_freq = table->sample_freq;
+    header.pass_freq = table->pass_freq;
+    header.filter_scale = table->filter_scale;
+
+    // Written aside, to a file of this process only, and renamed, so other
+    // processes never read half a file.
+    int fd = mkstemp(temp);
+    if (fd < 0) {
+        return;
+    }
+    FILE* f = fdopen(fd, "wb");
+    if (!f) {
+        close(fd);
+        remove(temp);
+        return;
+    }
+    int size = table->fir_N*table->fir_RES;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(table->fir, sizeof(short), size, f) == size_t(size);
+    ok = fclose(f) == 0 && ok;
+
+    if (!ok || rename(temp, path) != 0) {
+        remove(temp);
+    }
+}
+
+void SID::set_fir_cache_directory(const char* directory)
+{
+    pthread_mutex_lock(&shared_fir_mutex);
+    snprintf(fir_cache_directory, sizeof(fir_cache_directory), "%s",
+             directory ? directory : "");
+    pthread_mutex_unlock(&shared_fir_mutex);
+}
+
+// A directory only this user can write to, made if missing.
+static bool private_directory(const char* path)
+{
+    if (mkdir(path, 0700) != 0 && errno != EEXIST) {
         return false;
     }
-    
-    // The filter scaling is only included to avoid clipping, so keep
-    // it sane.
-    if (filter_scale < 0.9 || filter_scale > 1.0) {
+    struct stat st;
+    return lstat(path, &st) == 0 && S_ISDIR(st.st_mode) &&
+        st.st_uid == getuid() && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+bool SID::set_user_fir_cache_directory()
+{
+    char base[1024];
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if (xdg && xdg[0] == '/') {
+        snprintf(base, sizeof(base), "%s", xdg);
+    }
+    else if (home && home[0] == '/') {
+        snprintf(base, sizeof(base), "%s/.cache", home);
+    }
+    else {
+        set_fir_cache_directory(0);
         return false;
     }
-    
-    clock_frequency = clock_freq;
-    
-    cycles_per_sample = cycle_count(clock_freq/sample_freq*(1 << FIXP_SHIFT) + 0.5);
-    
-    sample_offset = 0;
-    sample_prev = 0;
-    
+
+    char directory[sizeof(base) + 8];
+    snprintf(directory, sizeof(directory), "%s/resid", base);
+    bool ok = private_directory(base) && private_directory(directory);
+    set_fir_cache_directory(ok ? directory : 0);
+    return ok;
+}
+
+void SID::fir_table_size(double clock_freq,
+                         double sample_freq, double pass_freq,
+                         int& fir_N, int& fir_RES)
+{
     const double pi = 3.1415926535897932385;
     
     // 16 bits -> -96dB stopband attenuation.
     const double A = -20*log10(1.0/(1 << 16));
     // A fraction of the bandwidth is allocated to the transition band,
     double dw = (1 - 2*pass_freq/sample_freq)*pi;
-    // The cutoff frequency is midway through the transition band.
-    double wc = (2*pass_freq/sample_freq + 1)*pi/2;
-    
-    // For calculation of beta and N see the reference for the kaiserord
-    // function in the MATLAB Signal Processing Toolbox:
-    // http://www.mathworks.com/access/helpdesk/help/toolbox/signal/kaiserord.html
-    const double beta = 0.1102*(A - 8.7);
-    const double I0beta = I0(beta);
     
     // The filter order will maximally be 124 with the current constraints.
     // N >= (96.33 - 7.95)/(2.285*0.1*pi) -> N >= 123
@@ -518,7 +890,6 @@ bool SID::set_sampling_parameters(double clock_freq,
     int N = int((A - 7.95)/(2.285*dw) + 0.5);
     N += N & 1;
     
-    double f_samples_per_cycle = sample_freq/clock_freq;
     double f_cycles_per_sample = clock_freq/sample_freq;
     
     // The filter length is equal to the filter order + 1.
@@ -536,10 +907,33 @@ bool SID::set_sampling_parameters(double clock_freq,
     
     int n = (int)ceil(log(res/f_cycles_per_sample)/log(2));
     fir_RES = 1 << n;
+}
+
+short* SID::design_fir_table(double clock_freq,
+                             double sample_freq, double pass_freq,
+                             double filter_scale,
+                             int& fir_N, int& fir_RES)
+{
+    const double pi = 3.1415926535897932385;
+    
+    // 16 bits -> -96dB stopband attenuation.
+    const double A = -20*log10(1.0/(1 << 16));
+    // The cutoff frequency is midway through the transition band.
+    double wc = (2*pass_freq/sample_freq + 1)*pi/2;
+    
+    // For calculation of beta and N see the reference for the kaiserord
+    // function in the MATLAB Signal Processing Toolbox:
+    // http://www.mathworks.com/access/helpdesk/help/toolbox/signal/kaiserord.html
+    const double beta = 0.1102*(A - 8.7);
+    const double I0beta = I0(beta);
+    
+    fir_table_size(clock_freq, sample_freq, pass_freq, fir_N, fir_RES);
+    
+    double f_samples_per_cycle = sample_freq/clock_freq;
+    double f_cycles_per_sample = clock_freq/sample_freq;
     
     // Allocate memory for FIR tables.
-    delete[] fir;
-    fir = new short[fir_N*fir_RES];
+    short* fir = new short[fir_N*fir_RES];
     
     // Calculate fir_RES FIR tables for linear interpolation.
     for (int i = 0; i < fir_RES; i++) {
@@ -560,14 +954,171 @@ bool SID::set_sampling_parameters(double clock_freq,
             fir[fir_offset + j] = short(val + 0.5);
         }
     }
+
+    return fir;
+}
+
+const short* SID::acquire_fir_table(double clock_freq,
+                                    double sample_freq, double pass_freq,
+                                    double filter_scale,
+                                    int& fir_N, int& fir_RES)
+{
+    pthread_mutex_lock(&shared_fir_mutex);
+
+    SharedFirTable* table;
+    for (table = shared_fir_tables; table; table = table->next) {
+        if (table->clock_freq == clock_freq &&
+            table->sample_freq == sample_freq &&
+            table->pass_freq == pass_freq &&
+            table->filter_scale == filter_scale) {
+            break;
+        }
+    }
+
+    if (table) {
+        table->refs++;
+        fir_N = table->fir_N;
+        fir_RES = table->fir_RES;
+        pthread_mutex_unlock(&shared_fir_mutex);
+        return table->fir;
+    }
+
+    table = new SharedFirTable;
+    table->refs = 1;
+    table->clock_freq = clock_freq;
+    table->sample_freq = sample_freq;
+    table->pass_freq = pass_freq;
+    table->filter_scale = filter_scale;
+
+    // Designing the tables takes milliseconds, reading them back from the
+    // cache directory a fraction of that.
+    int fir_N_design, fir_RES_design;
+    fir_table_size(clock_freq, sample_freq, pass_freq,
+                   fir_N_design, fir_RES_design);
+    if (!load_fir_table(table, fir_N_design, fir_RES_design)) {
+        table->fir = design_fir_table(clock_freq, sample_freq, pass_freq,
+                                      filter_scale,
+                                      table->fir_N, table->fir_RES);
+        save_fir_table(table);
+    }
+
+    table->next = shared_fir_tables;
+    shared_fir_tables = table;
+
+    fir_N = table->fir_N;
+    fir_RES = table->fir_RES;
+
+    pthread_mutex_unlock(&shared_fir_mutex);
+
+    return table->fir;
+}
+
+void SID::release_fir_table(const short* fir)
+{
+    if (!fir) {
+        return;
+    }
+
+    pthread_mutex_lock(&shared_fir_mutex);
+
+    // New tables go first, so the unused ones past the first few kept
+    // are the least recently designed.
+    int unused = 0;
+    for (SharedFirTable** link = &shared_fir_tables; *link; ) {
+        SharedFirTable* table = *link;
+        if (table->fir == fir) {
+            table->refs--;
+        }
+        if (table->refs == 0 && ++unused > FIR_KEEP_UNUSED) {
+            *link = table->next;
+            delete[] table->fir;
+            delete table;
+        }
+        else {
+            link = &table->next;
+        }
+    }
+
+    pthread_mutex_unlock(&shared_fir_mutex);
+}
+
+
+// ----------------------------------------------------------------------------
+// Setting of SID sampling parameters.
+//
+// Use a clock freqency of 985248Hz for PAL C64, 1022730Hz for NTSC C64.
+// The default end of passband frequency is pass_freq = 0.9*sample_freq/2
+// for sample frequencies up to ~ 44.1kHz, and 20kHz for higher sample
+// frequencies.
+//
+// For resampling, the ratio between the clock frequency and the sample
+// frequency is limited as follows:
+//   125*clock_freq/sample_freq < 16384
+// E.g. provided a clock frequency of ~ 1MHz, the sample frequency can not
+// be set lower than ~ 8kHz. A lower sample frequency would make the
+// resampling code overfill its 16k sample ring buffer.
+//
+// The end of passband frequency is also limited:
+//   pass_freq <= 0.9*sample_freq/2
+
+// E.g. for a 44.1kHz sampling rate the end of passband frequency is limited
+// to slightly below 20kHz. This constraint ensures that the FIR table is
+// not overfilled.
+// ----------------------------------------------------------------------------
+bool SID::set_sampling_parameters(double clock_freq,
+                                  double sample_freq, double pass_freq,
+                                  double filter_scale)
+{
+    // Check resampling constraints.
+    // Check whether the sample ring buffer would overfill.
+    if (FIR_N*clock_freq/sample_freq >= RINGSIZE) {
+        return false;
+    }
     
-    // Allocate sample buffer.
+    // The default passband limit is 0.9*sample_freq/2 for sample
+    // frequencies below ~ 44.1kHz, and 20kHz for higher sample frequencies.
+    if (pass_freq < 0) {
+        pass_freq = 20000;
+        if (2*pass_freq/sample_freq >= 0.9) {
+            pass_freq = 0.9*sample_freq/2;
+        }
+    }
+    // Check whether the FIR table would overfill.
+    else if (pass_freq > 0.9*sample_freq/2) {
+        return false;
+    }
+    
+    // The filter scaling is only included to avoid clipping, so keep
+    // it sane.
+    if (filter_scale < 0.9 || filter_scale > 1.0) {
+        return false;
+    }
+    
+    clock_frequency = clock_freq;
+    
+    cycles_per_sample = cycle_count(clock_freq/sample_freq*(1 << FIXP_SHIFT) + 0.5);
+    
+    sample_offset = 0;
+    sample_prev = 0;
+    sample_prev_float = 0;
+    sample_prev_right = 0;
+    sample_prev_right_float = 0;
+    
+    // Look up the FIR tables, designed by the first SID to use them.
+    const short* previous = fir;
+    fir = acquire_fir_table(clock_freq, sample_freq, pass_freq, filter_scale,
+                            fir_N, fir_RES);
+    release_fir_table(previous);
+    
+    // Allocate sample buffers.
     if (!sample) {
         sample = new short[RINGSIZE*2];
+        sample_right = new short[RINGSIZE*2];
     }
-    // Clear sample buffer.
+    // Clear sample buffers.
     for (int j = 0; j < RINGSIZE*2; j++) {
         sample[j] = 0;
+        sample_right[j] = 0;
     }
     sample_index = 0;
     
@@ -593,6 +1144,108 @@ void SID::adjust_sampling_frequency(double sample_freq)
     cycle_count(clock_frequency/sample_freq*(1 << FIXP_SHIFT) + 0.5);
 }
 
+// ----------------------------------------------------------------------------
+// Stage profile.
+// ----------------------------------------------------------------------------
+#if RESID_PROFILE
+static inline unsigned long long profile_ticks()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec*1000000000 + now.tv_nsec;
+#endif
+}
+
+// Cost of reading the time itself, taken off every stage.
+static unsigned long long profile_overhead = 0;
+
+static void calibrate_profile()
+{
+    unsigned long long least = ~0ULL;
+    for (int i = 0; i < 1000; i++) {
+        unsigned long long start = profile_ticks();
+        unsigned long long ticks = profile_ticks() - start;
+        if (ticks < least) {
+            least = ticks;
+        }
+    }
+    profile_overhead = least;
+}
+
+// Charges the time since the previous mark to a stage of a sampled cycle.
+#define PROFILE_MARK(stage) \
+    if (profiling) { \
+        unsigned long long profile_now = profile_ticks(); \
+        unsigned long long profile_delta = profile_now - profile_last; \
+        if (profile_delta > profile_overhead) { \
+            profile.stage_ticks[stage] += profile_delta - profile_overhead; \
+        } \
+        profile_last = profile_now; \
+    }
+
+// Times the output of every sample in full, interpolation or convolution,
+// these are too few per cycle to be worth sampling.
+#define PROFILE_SAMPLE_BEGIN \
+    unsigned long long profile_sample = profile_ticks();
+#define PROFILE_SAMPLE_END \
+    { \
+        unsigned long long profile_delta = profile_ticks() - profile_sample; \
+        if (profile_delta > profile_overhead) { \
+            profile.resample_ticks += profile_delta - profile_overhead; \
+        } \
+        profile.samples++; \
+    }
+#else
+#define PROFILE_MARK(stage)
+#define PROFILE_SAMPLE_BEGIN
+#define PROFILE_SAMPLE_END
+#endif
+
+bool SID::get_profile(sid_profile& result) const
+{
+#if RESID_PROFILE
+    result = profile;
+    return true;
+#else
+    memset(&result, 0, sizeof(result));
+    return false;
+#endif
+}
+
+void SID::reset_profile()
+{
+#if RESID_PROFILE
+    memset(&profile, 0, sizeof(profile));
+    profile_countdown = PROFILE_INTERVAL;
+    if (profile_overhead == 0) {
+        calibrate_profile();
+    }
+#endif
+}
+
+// Time stamp in profile ticks, for timing around the SIDs in the same unit.
+unsigned long long SID::profile_clock()
+{
+#if RESID_PROFILE
+    return profile_ticks();
+#else
+    return 0;
+#endif
+}
+
+const char* SID::profile_stage_name(int stage)
+{
+    static const char* names[PROFILE_STAGES] = {
+        "envelope", "oscillator", "voice", "filter",
+        "bassboost", "trebleboost", "fuzz", "extfilt", "stereo"
+    };
+    return (stage >= 0 && stage < PROFILE_STAGES) ? names[stage] : "other";
+}
+
+
 // ----------------------------------------------------------------------------
 // SID clocking - 1 cycle.
 // ----------------------------------------------------------------------------
@@ -600,6 +1253,16 @@ void SID::clock()
 {
     int i;
     
+#if RESID_PROFILE
+    bool profiling = --profile_countdown <= 0;
+    unsigned long long profile_last = 0;
+    if (profiling) {
+        profile_countdown = PROFILE_INTERVAL;
+        profile.sampled_cycles++;
+        profile_last = profile_ticks();
+    }
+#endif
+
     // Age bus value.
     if (--bus_value_ttl <= 0) {
         bus_value = 0;
@@ -610,6 +1273,7 @@ void SID::clock()
     for (i = 0; i < NUM_VOICES; i++) {
         voice[i].envelope.clock();
     }
+    PROFILE_MARK(PROFILE_ENVELOPE);
     
     // Clock oscillators.
     for (i = 0; i < NUM_VOICES; i++) {
@@ -620,6 +1284,7 @@ void SID::clock()
     for (i = 0; i < NUM_VOICES; i++) {
         voice[i].wave.synchronize();
     }
+    PROFILE_MARK(PROFILE_OSCILLATOR);
 #if 0   //original SID
     // Clock filter.
 	sound_sample s[NUM_VOICES];
@@ -656,22 +1321,118 @@ void SID::clock()
     }
 #endif
 
+    // Panned voices are mixed in two, the filter scales its input in place.
+    bool split = stereo && panned;
+    sound_sample s_right[NUM_VOICES];
+    if (split) {
+        for (i = 0; i < NUM_VOICES; i++) {
+            s_right[i] = s[i]*pan_right[i] >> 8;
+            s[i] = s[i]*pan_left[i] >> 8;
+        }
+    }
+    PROFILE_MARK(PROFILE_VOICE);
+
     // Clock filter.
     filter.clock(s, ext_in);
+    PROFILE_MARK(PROFILE_FILTER);
     
 	// Clock bassboost filter
 	bassboost.clock(filter.output());
+    PROFILE_MARK(PROFILE_BASSBOOST);
 
 	// Clock trebleboost filter
 	trebleboost.clock(bassboost.output());
+    PROFILE_MARK(PROFILE_TREBLEBOOST);
 
     fuzzMain.clock(trebleboost.output());
+    PROFILE_MARK(PROFILE_FUZZ);
 
     // Clock external filter.
     extfilt.clock(fuzzMain.output());
 
 	Vo = clamp(extfilt.output());
+    PROFILE_MARK(PROFILE_EXTFILT);
+
+    if (split) {
+        filter_right.clock(s_right, ext_in);
+        bassboost_right.clock(filter_right.output());
+        trebleboost_right.clock(bassboost_right.output());
+        fuzzMain_right.clock(trebleboost_right.output());
+        extfilt_right.clock(fuzzMain_right.output());
+        Vo_right = clamp(extfilt_right.output());
+        PROFILE_MARK(PROFILE_STEREO);
+    }
+    else {
+        Vo_right = Vo;
+    }
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// SID clocking - delta_t cycles, output sampled by the caller.
+// ----------------------------------------------------------------------------
+void SID::clock(cycle_count delta_t)
+{
+#if RESID_PROFILE
+    unsigned long long start = profile_ticks();
+    profile.cycles += delta_t;
+    profile.blocks++;
 #endif
+    while (delta_t-- > 0) {
+        clock();
+    }
+#if RESID_PROFILE
+    profile.block_ticks += profile_ticks() - start;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// SID clocking - delta_t cycles, without audio.
+// Used when seeking, the envelopes and oscillators are advanced in closed form
+// and the filter and output stages are left as they are. These settle again
+// once clock() is resumed.
+// ----------------------------------------------------------------------------
+void SID::skip(cycle_count delta_t)
+{
+    int i;
+    
+    if (delta_t <= 0) {
+        return;
+    }
+    
+    // Age bus value.
+    bus_value_ttl -= delta_t;
+    if (bus_value_ttl <= 0) {
+        bus_value = 0;
+        bus_value_ttl = 0;
+    }
+    
+    for (i = 0; i < NUM_VOICES; i++) {
+        voice[i].envelope.clock(delta_t);
+    }
+    
+    // Hard sync needs the oscillators clocked on the exact cycle.
+    for (i = 0; i < NUM_VOICES; i++) {
+        if (voice[i].wave.sync) {
+            break;
+        }
+    }
+    
+    if (i == NUM_VOICES) {
+        for (i = 0; i < NUM_VOICES; i++) {
+            voice[i].wave.clock(delta_t);
+        }
+    }
+    else {
+        while (delta_t--) {
+            for (i = 0; i < NUM_VOICES; i++) {
+                voice[i].wave.clock();
+            }
+            for (i = 0; i < NUM_VOICES; i++) {
+                voice[i].wave.synchronize();
+            }
+        }
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -690,8 +1451,36 @@ void SID::clock()
 // ----------------------------------------------------------------------------
 int SID::clock(cycle_count& delta_t, short* buf, int n, int interleave)
 {
-//    return clock_resample_interpolate(delta_t, buf, n, interleave); //slow
-    return clock_interpolate(delta_t, buf, n, interleave);    //fast
+#if RESID_PROFILE
+    unsigned long long start = profile_ticks();
+    cycle_count delta_start = delta_t;
+#endif
+    int s = sampling == SAMPLE_RESAMPLE_INTERPOLATE ?
+        clock_resample_interpolate(delta_t, buf, n, interleave) :   //slow
+        clock_interpolate(delta_t, buf, n, interleave);             //fast
+#if RESID_PROFILE
+    profile.block_ticks += profile_ticks() - start;
+    profile.cycles += delta_start - delta_t;
+    profile.blocks++;
+#endif
+    return s;
+}
+
+int SID::clock(cycle_count& delta_t, float* buf, int n, int interleave)
+{
+#if RESID_PROFILE
+    unsigned long long start = profile_ticks();
+    cycle_count delta_start = delta_t;
+#endif
+    int s = sampling == SAMPLE_RESAMPLE_INTERPOLATE ?
+        clock_resample_interpolate(delta_t, buf, n, interleave) :
+        clock_interpolate(delta_t, buf, n, interleave);
+#if RESID_PROFILE
+    profile.block_ticks += profile_ticks() - start;
+    profile.cycles += delta_start - delta_t;
+    profile.blocks++;
+#endif
+    return s;
 }
 
 RESID_INLINE
@@ -714,16 +1503,28 @@ int SID::clock_interpolate(cycle_count& delta_t, short* buf, int n, int interlea
     }
     if (i < delta_t_sample) {
       sample_prev = output();
+      if (stereo) {
+        sample_prev_right = output_sample(Vo_right, 16);
+      }
       clock();
     }
 
     delta_t -= delta_t_sample;
     sample_offset = next_sample_offset & FIXP_MASK;
 
+    PROFILE_SAMPLE_BEGIN
     short sample_now = output();
-    buf[s++*interleave] =
+    buf[s*interleave] =
       sample_prev + (sample_offset*(sample_now - sample_prev) >> FIXP_SHIFT);
     sample_prev = sample_now;
+    if (stereo) {
+      short sample_now_right = output_sample(Vo_right, 16);
+      buf[s*interleave + 1] =
+        sample_prev_right + (sample_offset*(sample_now_right - sample_prev_right) >> FIXP_SHIFT);
+      sample_prev_right = sample_now_right;
+    }
+    PROFILE_SAMPLE_END
+    s++;
   }
 
   for (i = 0; i < delta_t - 1; i++) {
@@ -731,6 +1532,69 @@ int SID::clock_interpolate(cycle_count& delta_t, short* buf, int n, int interlea
   }
   if (i < delta_t) {
     sample_prev = output();
+    if (stereo) {
+      sample_prev_right = output_sample(Vo_right, 16);
+    }
+    clock();
+  }
+  sample_offset -= delta_t << FIXP_SHIFT;
+  delta_t = 0;
+  return s;
+}
+
+RESID_INLINE
+int SID::clock_interpolate(cycle_count& delta_t, float* buf, int n, int interleave)
+{
+  const float fixp_scale = 1.0f/(1 << FIXP_SHIFT);
+  int s = 0;
+  int i;
+
+  for (;;) {
+    cycle_count next_sample_offset = sample_offset + cycles_per_sample;
+    cycle_count delta_t_sample = next_sample_offset >> FIXP_SHIFT;
+    if (delta_t_sample > delta_t) {
+      break;
+    }
+    if (s >= n) {
+      return s;
+    }
+    for (i = 0; i < delta_t_sample - 1; i++) {
+      clock();
+    }
+    if (i < delta_t_sample) {
+      sample_prev_float = output_float(Vo);
+      if (stereo) {
+        sample_prev_right_float = output_float(Vo_right);
+      }
+      clock();
+    }
+
+    delta_t -= delta_t_sample;
+    sample_offset = next_sample_offset & FIXP_MASK;
+
+    PROFILE_SAMPLE_BEGIN
+    float sample_now = output_float(Vo);
+    buf[s*interleave] =
+      sample_prev_float + sample_offset*fixp_scale*(sample_now - sample_prev_float);
+    sample_prev_float = sample_now;
+    if (stereo) {
+      float sample_now_right = output_float(Vo_right);
+      buf[s*interleave + 1] =
+        sample_prev_right_float + sample_offset*fixp_scale*(sample_now_right - sample_prev_right_float);
+      sample_prev_right_float = sample_now_right;
+    }
+    PROFILE_SAMPLE_END
+    s++;
+  }
+
+  for (i = 0; i < delta_t - 1; i++) {
+    clock();
+  }
+  if (i < delta_t) {
+    sample_prev_float = output_float(Vo);
+    if (stereo) {
+      sample_prev_right_float = output_float(Vo_right);
+    }
     clock();
   }
   sample_offset -= delta_t << FIXP_SHIFT;
@@ -774,6 +1638,40 @@ int SID::clock_interpolate(cycle_count& delta_t, short* buf, int n, int interlea
 // NB! the result of right shifting negative numbers is really
 // implementation dependent in the C++ standard.
 // ----------------------------------------------------------------------------
+RESID_INLINE
+int SID::convolve(const short* ring)
+{
+    int fir_offset = sample_offset*fir_RES >> FIXP_SHIFT;
+    int fir_offset_rmd = sample_offset*fir_RES & FIXP_MASK;
+    const short* fir_start = fir + fir_offset*fir_N;
+    const short* sample_start = ring + sample_index - fir_N + RINGSIZE;
+    
+    // Convolution with filter impulse response.
+    int v1 = 0;
+    for (int j = 0; j < fir_N; j++) {
+        v1 += sample_start[j]*fir_start[j];
+    }
+    
+    // Use next FIR table, wrap around to first FIR table using
+    // previous sample.
+    if (++fir_offset == fir_RES) {
+        fir_offset = 0;
+        --sample_start;
+    }
+    fir_start = fir + fir_offset*fir_N;
+    
+    // Convolution with filter impulse response.
+    int v2 = 0;
+    for (int j = 0; j < fir_N; j++) {
+        v2 += sample_start[j]*fir_start[j];
+    }
+    
+    // Linear interpolation.
+    // fir_offset_rmd is equal for all samples, it can thus be factorized out:
+    // sum(v1 + rmd*(v2 - v1)) = sum(v1) + rmd*(sum(v2) - sum(v1))
+    return v1 + (fir_offset_rmd*(v2 - v1) >> FIXP_SHIFT);
+}
+
 RESID_INLINE
 int SID::clock_resample_interpolate(cycle_count& delta_t, short* buf, int n,
                                     int interleave)
@@ -792,59 +1690,95 @@ int SID::clock_resample_interpolate(cycle_count& delta_t, short* buf, int n,
         for (int i = 0; i < delta_t_sample; i++) {
             clock();
             sample[sample_index] = sample[sample_index + RINGSIZE] = output();
+            if (stereo) {
+                sample_right[sample_index] = sample_right[sample_index + RINGSIZE] = output_sample(Vo_right, 16);
+            }
             ++sample_index;
             sample_index &= 0x3fff;
         }
         delta_t -= delta_t_sample;
         sample_offset = next_sample_offset & FIXP_MASK;
         
-        int fir_offset = sample_offset*fir_RES >> FIXP_SHIFT;
-        int fir_offset_rmd = sample_offset*fir_RES & FIXP_MASK;
-        short* fir_start = fir + fir_offset*fir_N;
-        short* sample_start = sample + sample_index - fir_N + RINGSIZE;
-        
-        // Convolution with filter impulse response.
-        int v1 = 0;
-        for (int j = 0; j < fir_N; j++) {
-            v1 += sample_start[j]*fir_start[j];
+        PROFILE_SAMPLE_BEGIN
+        for (int c = 0; c < (stereo ? 2 : 1); c++) {
+            int v = convolve(c ? sample_right : sample);
+            
+            v >>= FIR_SHIFT;
+            
+            // Saturated arithmetics to guard against 16 bit sample overflow.
+            const int half = 1 << 15;
+            if (v >= half) {
+                v = half - 1;
+            }
+            else if (v < -half) {
+                v = -half;
+            }
+            
+            buf[s*interleave + c] = v;
         }
-        
-        // Use next FIR table, wrap around to first FIR table using
-        // previous sample.
-        if (++fir_offset == fir_RES) {
-            fir_offset = 0;
-            --sample_start;
+        PROFILE_SAMPLE_END
+        s++;
+    }
+    
+    for (int i = 0; i < delta_t; i++) {
+        clock();
+        sample[sample_index] = sample[sample_index + RINGSIZE] = output();
+        if (stereo) {
+            sample_right[sample_index] = sample_right[sample_index + RINGSIZE] = output_sample(Vo_right, 16);
         }
-        fir_start = fir + fir_offset*fir_N;
-        
-        // Convolution with filter impulse response.
-        int v2 = 0;
-        for (int j = 0; j < fir_N; j++) {
-            v2 += sample_start[j]*fir_start[j];
+        ++sample_index;
+        sample_index &= 0x3fff;
+    }
+    sample_offset -= delta_t << FIXP_SHIFT;
+    delta_t = 0;
+    return s;
+}
+
+// The FIR input is still the 16-bit output of every cycle, the convolution
+// is kept at its full precision instead of shifted and clamped to 16 bits.
+RESID_INLINE
+int SID::clock_resample_interpolate(cycle_count& delta_t, float* buf, int n,
+                                    int interleave)
+{
+    const float fir_scale = 1.0f/(1 << FIR_SHIFT)/(1 << 15);
+    int s = 0;
+    
+    for (;;) {
+        cycle_count next_sample_offset = sample_offset + cycles_per_sample;
+        cycle_count delta_t_sample = next_sample_offset >> FIXP_SHIFT;
+        if (delta_t_sample > delta_t) {
+            break;
         }
-        
-        // Linear interpolation.
-        // fir_offset_rmd is equal for all samples, it can thus be factorized out:
-        // sum(v1 + rmd*(v2 - v1)) = sum(v1) + rmd*(sum(v2) - sum(v1))
-        int v = v1 + (fir_offset_rmd*(v2 - v1) >> FIXP_SHIFT);
-        
-        v >>= FIR_SHIFT;
-        
-        // Saturated arithmetics to guard against 16 bit sample overflow.
-        const int half = 1 << 15;
-        if (v >= half) {
-            v = half - 1;
+        if (s >= n) {
+            return s;
         }
-        else if (v < -half) {
-            v = -half;
+        for (int i = 0; i < delta_t_sample; i++) {
+            clock();
+            sample[sample_index] = sample[sample_index + RINGSIZE] = output();
+            if (stereo) {
+                sample_right[sample_index] = sample_right[sample_index + RINGSIZE] = output_sample(Vo_right, 16);
+            }
+            ++sample_index;
+            sample_index &= 0x3fff;
         }
+        delta_t -= delta_t_sample;
+        sample_offset = next_sample_offset & FIXP_MASK;
         
-        buf[s++*interleave] = v;
+        PROFILE_SAMPLE_BEGIN
+        buf[s*interleave] = convolve(sample)*fir_scale;
+        if (stereo) {
+            buf[s*interleave + 1] = convolve(sample_right)*fir_scale;
+        }
+        PROFILE_SAMPLE_END
+        s++;
     }
     
     for (int i = 0; i < delta_t; i++) {
         clock();
         sample[sample_index] = sample[sample_index + RINGSIZE] = output();
+        if (stereo) {
+            sample_right[sample_index] = sample_right[sample_index + RINGSIZE] = output_sample(Vo_right, 16);
+        }
         ++sample_index;
         sample_index &= 0x3fff;
     }
@@ -34,7 +34,7 @@ public:
     
     void set_chip_model(chip_model model);
 	void set_distortion_properties(int enable, int rate, int headroom, int opmin, int opmax);
-    void set_filter_cutoff_table(const fc_point* table, int points) { filter.set_filter_cutoff_table(table, points); }
+    void set_filter_cutoff_table(const fc_point* table, int points) { filter.set_filter_cutoff_table(table, points); filter_right.set_filter_cutoff_table(table, points); }
     void enable_filter(bool enable);
     void enable_external_filter(bool enable);
 	void set_mute(int voice, bool enable);
@@ -43,8 +43,46 @@ public:
                                  double filter_scale = 0.97);
     void adjust_sampling_frequency(double sample_freq);
 
+    // Linear interpolation between cycles (the default), or resampling
+    // through the FIR table, about 3 times as slow.
+    void set_sampling_method(sampling_method method) { sampling = method; }
+
+    // Stereo output: the clock functions below write a left and a right
+    // sample, at buf[s*interleave] and buf[s*interleave + 1], so interleave
+    // is 2 or more.  The voices are placed by their SIDPLUS_VOICE_PAN
+    // registers; the filter and effects run once more for the right channel
+    // only while a voice is off center, otherwise it is the left one.
+    void set_stereo(bool enable);
+
+    // Directory to keep the resampling FIR tables in between runs (none
+    // by default), designing them is the slow part of setting up a SID.
+    static void set_fir_cache_directory(const char* directory);
+
+    // The per user cache, resid in $XDG_CACHE_HOME or ~/.cache, made mode
+    // 0700 if missing.  False, and no cache, when there is no home or the
+    // directory is not private to this user.
+    static bool set_user_fir_cache_directory();
+
     void clock();
+    void clock(cycle_count delta_t);
     int clock(cycle_count& delta_t, short* buf, int n, int interleave = 1);
+
+    // As above with float samples, 1.0 being full scale of the 16-bit
+    // output, neither clamped nor rounded to 16 bits.
+    int clock(cycle_count& delta_t, float* buf, int n, int interleave = 1);
+
+    // Stage profile since construction or the last reset_profile(), false
+    // (and all zero) unless built with RESID_PROFILE.  Stage ticks cover
+    // the sampled cycles only, scale them by cycles/sampled_cycles for the
+    // whole; resample ticks cover every output sample.  What both leave of
+    // the block ticks went to calls and loops, profile_stage_name(
+    // PROFILE_STAGES) names it; timing a cycle stage by stage slows it
+    // down, so this can come out negative.
+    bool get_profile(sid_profile& profile) const;
+    void reset_profile();
+    static const char* profile_stage_name(int stage);
+    static unsigned long long profile_clock();
+    void skip(cycle_count delta_t);
     void reset();
     
     // Read/write registers.
@@ -71,6 +109,22 @@ public:
         reg8 envelope_counter[NUM_VOICES];
         EnvelopeGenerator::State envelope_state[NUM_VOICES];
         bool hold_zero[NUM_VOICES];
+
+        // SID+ oscillators.
+        reg24 harmonics_accumulator[NUM_VOICES][NUM_HARMONICS];
+        reg12 noise_output_cached[NUM_VOICES];
+        reg12 waveform_output[NUM_VOICES];
+        int noise_overwrite_delay[NUM_VOICES];
+
+        // Filter and output stage.
+        sound_sample filter_Vhp, filter_Vbp, filter_Vlp, filter_Vnf;
+        sound_sample filter_w0_deriv_smoothed;
+        sound_sample extfilt_Vlp, extfilt_Vhp, extfilt_Vo;
+        sound_sample bassboost_y1_curr, bassboost_y1_prev, bassboost_x_prev, bassboost_Vo;
+        sound_sample trebleboost_y1_curr, trebleboost_y1_prev, trebleboost_x_prev, trebleboost_Vo;
+        sound_sample fuzz_Vo[NUM_VOICES];
+        sound_sample fuzzMain_Vo;
+        sound_sample Vo;
     };
     
     State read_state();
@@ -79,15 +133,39 @@ public:
     // 16-bit input (EXT IN).
     void input(int sample);
     
-    // n-bit output (AUDIO OUT).
+    // n-bit output (AUDIO OUT), of the left channel in stereo.
     int output(int bits = 16);
     
 protected:
     static double I0(double x);
+    static void fir_table_size(double clock_freq,
+                               double sample_freq, double pass_freq,
+                               int& fir_N, int& fir_RES);
+    static short* design_fir_table(double clock_freq,
+                                   double sample_freq, double pass_freq,
+                                   double filter_scale,
+                                   int& fir_N, int& fir_RES);
+    static const short* acquire_fir_table(double clock_freq,
+                                          double sample_freq, double pass_freq,
+                                          double filter_scale,
+                                          int& fir_N, int& fir_RES);
+    static void release_fir_table(const short* fir);
     RESID_INLINE int clock_resample_interpolate(cycle_count& delta_t, short* buf,
                                                 int n, int interleave);
     RESID_INLINE int clock_interpolate(cycle_count& delta_t, short* buf,
                                                 int n, int interleave);
+    RESID_INLINE int clock_resample_interpolate(cycle_count& delta_t, float* buf,
+                                                int n, int interleave);
+    RESID_INLINE int clock_interpolate(cycle_count& delta_t, float* buf,
+                                                int n, int interleave);
+    RESID_INLINE static int output_sample(sound_sample v, int bits);
+    RESID_INLINE static float output_float(sound_sample v);
+    RESID_INLINE int convolve(const short* ring);
+
+    void write_output_stage(reg8 offset, reg8 value, Filter& f, BassBoostFilter& bb,
+                            TrebleBoostFilter& tb, FuzzFilter& fz);
+    void write_pan(int v, reg8 value);
+    void sync_right_channel();
 
     Voice voice[NUM_VOICES];
     Filter filter;
@@ -101,6 +179,21 @@ protected:
 	sound_sample	Vo;
 	bool	mute[NUM_VOICES];
 
+    // Output stage of the right channel, written the same registers.
+    Filter filter_right;
+    ExternalFilter extfilt_right;
+    BassBoostFilter bassboost_right;
+    TrebleBoostFilter trebleboost_right;
+    FuzzFilter fuzzMain_right;
+    sound_sample Vo_right;
+
+    // Voice panning, channel gains with 8 fractional bits.
+    reg8 pan[NUM_VOICES];
+    sound_sample pan_left[NUM_VOICES];
+    sound_sample pan_right[NUM_VOICES];
+    bool stereo;
+    bool panned;    // any voice off center
+
     // Waveform D/A zero level.
     sound_sample wave_zero;
     
@@ -133,18 +226,38 @@ protected:
     static const int FIXP_MASK = 0xffff;
     
     // Sampling variables.
+    sampling_method sampling;
     cycle_count cycles_per_sample;
     cycle_count sample_offset;
     int sample_index;
     short sample_prev;
+    float sample_prev_float;
+    short sample_prev_right;
+    float sample_prev_right_float;
     int fir_N;
     int fir_RES;
     
     // Ring buffer with overflow for contiguous storage of RINGSIZE samples.
     short* sample;
+    short* sample_right;
     
-    // FIR_RES filter tables (FIR_N*FIR_RES).
-    short* fir;
+    // FIR_RES filter tables (FIR_N*FIR_RES), shared by all SIDs with
+    // the same sampling parameters.
+    const short* fir;
+
+#if RESID_PROFILE
+    // Cycles are timed one in PROFILE_INTERVAL, reading the time stamp
+    // counter costs about as much as a stage.
+    static const int PROFILE_INTERVAL = 64;
+
+    sid_profile profile;
+    int profile_countdown;
+#endif
+
+private:
+    // The FIR tables are referenced, not owned.
+    SID(const SID&);
+    SID& operator=(const SID&);
 };
 
 #endif // not __SID_H__
@@ -125,6 +125,7 @@ enum SidPlusVoiceRegs
 	SIDPLUS_VOICE_FUZZ_MULT_HI          = 0x12,
 	SIDPLUS_VOICE_FUZZ_MIX              = 0x13,
 	SIDPLUS_VOICE_FILT					= 0x14,
+	SIDPLUS_VOICE_PAN					= 0x15,	//signed, 0 = center, -127 = left, 127 = right
 	SIDPLUS_VOICE_NUM_REGS				= 0x20,
 };
 
@@ -139,6 +140,8 @@ const int FILTER_DECIMAL_BITS	= 8;
 
 enum chip_model { MOS6581, MOS8580 };
 
+enum sampling_method { SAMPLE_INTERPOLATE, SAMPLE_RESAMPLE_INTERPOLATE };
+
 extern "C"
 {
 #ifndef __VERSION_CC__
@@ -152,6 +155,43 @@ extern "C"
 #define RESID_INLINING 1
 #define RESID_INLINE inline
 
+// Per stage profiling on/off.  When on every SID times the stages of one
+// cycle in PROFILE_INTERVAL, every output sample and all of each block it
+// renders, see SID::get_profile().  Off compiles all of it out.
+#define RESID_PROFILE 0
+
+enum profile_stage
+{
+    PROFILE_ENVELOPE,       // amplitude modulators
+    PROFILE_OSCILLATOR,     // oscillators and their synchronization
+    PROFILE_VOICE,          // waveform times envelope
+    PROFILE_FILTER,
+    PROFILE_BASSBOOST,
+    PROFILE_TREBLEBOOST,
+    PROFILE_FUZZ,
+    PROFILE_EXTFILT,        // external filter and output clamp
+    PROFILE_STEREO,         // right channel filter and effects, when panned
+    PROFILE_STAGES
+};
+
+struct sid_profile
+{
+    // Ticks spent in each stage of the sampled cycles.
+    unsigned long long stage_ticks[PROFILE_STAGES];
+    unsigned long long sampled_cycles;
+
+    // Ticks spent on the output samples, interpolation or convolution,
+    // each of them timed.
+    unsigned long long resample_ticks;
+    unsigned long long samples;
+
+    // Ticks spent rendering blocks, resampling included, and the cycles
+    // they clocked.
+    unsigned long long block_ticks;
+    unsigned long long cycles;
+    unsigned long long blocks;
+};
+
 #if 1
 RESID_INLINE sound_sample clamp(sound_sample s)
 {
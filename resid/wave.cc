@@ -64,6 +64,138 @@ void WaveformGenerator::set_chip_model(chip_model model)
 }
 
 
+// ----------------------------------------------------------------------------
+// Noise shift register jumps.
+// The shift register is a linear feedback register, so shifting it n times
+// is a linear map. noise_jump[k][j] holds the image of register bit j after
+// 2^k shifts, any shift count is then applied in at most 32 steps.
+// ----------------------------------------------------------------------------
+static reg24 noise_jump[32][23];
+
+static struct NoiseJumpInit
+{
+    NoiseJumpInit()
+    {
+        int j, k, i;
+        for (j = 0; j < 23; j++) {
+            reg24 bit = 1 << j;
+            reg24 bit0 = ((bit >> 22) ^ (bit >> 17)) & 0x1;
+            noise_jump[0][j] = ((bit << 1) | bit0) & 0x7fffff;
+        }
+        for (k = 1; k < 32; k++) {
+            for (j = 0; j < 23; j++) {
+                reg24 image = noise_jump[k - 1][j];
+                reg24 result = 0;
+                for (i = 0; i < 23; i++) {
+                    if (image & (1 << i)) {
+                        result ^= noise_jump[k - 1][i];
+                    }
+                }
+                noise_jump[k][j] = result;
+            }
+        }
+    }
+} noise_jump_init;
+
+static reg24 noise_shift(reg24 shift_register, reg24 n)
+{
+    // The last 9 shifts are done one at a time, this leaves the bits above
+    // bit 22 as they would be after single cycle shifts.
+    if (n > 9) {
+        reg24 low = shift_register & 0x7fffff;
+        reg24 jump = n - 9;
+        for (int k = 0; jump; k++, jump >>= 1) {
+            if (jump & 1) {
+                reg24 result = 0;
+                for (int j = 0; j < 23; j++) {
+                    if (low & (1 << j)) {
+                        result ^= noise_jump[k][j];
+                    }
+                }
+                low = result;
+            }
+        }
+        shift_register = low;
+        n = 9;
+    }
+    
+    while (n--) {
+        reg24 bit0 = ((shift_register >> 22) ^ (shift_register >> 17)) & 0x1;
+        shift_register <<= 1;
+        shift_register |= bit0;
+    }
+    return shift_register;
+}
+
+
+// ----------------------------------------------------------------------------
+// SID clocking - delta_t cycles.
+// The accumulators and the noise register are advanced in closed form. Hard
+// sync is not handled, see SID::skip().
+// ----------------------------------------------------------------------------
+void WaveformGenerator::clock(cycle_count delta_t)
+{
+    if (delta_t <= 0) {
+        return;
+    }
+    
+    /* no digital operation if test bit is set. Only emulate analog fade. */
+    if (test) {
+        if (noise_overwrite_delay != 0) {
+            if (delta_t < noise_overwrite_delay) {
+                noise_overwrite_delay -= delta_t;
+            }
+            else {
+                noise_overwrite_delay = 0;
+                shift_register |= 0x7ffffc;
+                noise_output_cached = outputN___();
+            }
+        }
+        return;
+    }
+    
+    // Count the times accumulator bit 19 is set high. FREQ is less than
+    // 2^19 so no rising edge can be stepped over. Chunks keep the sum
+    // within 32 bits.
+    reg24 shifts = 0;
+    cycle_count remaining = delta_t;
+    reg24 acc = accumulator;
+    while (remaining > 0) {
+        cycle_count chunk = remaining < 0x8000 ? remaining : 0x8000;
+        reg24 start = acc + 0x080000;
+        reg24 delta_acc = freq*chunk;
+        shifts += ((start + delta_acc) >> 20) - (start >> 20);
+        acc = (acc + delta_acc) & 0xffffff;
+        remaining -= chunk;
+    }
+    accumulator = acc;
+    
+    reg24 hfreq = freq<<1;
+    for(int i=0;i<NUM_HARMONICS;i++) {
+        harmonics_accumulator[i] += hfreq*(reg24)delta_t;
+        harmonics_accumulator[i] &= 0xffffff;
+        hfreq += freq;
+    }
+    
+    if (waveform > 8) {
+        // The output bits are cleared on every cycle, so shift one at a time.
+        reg24 mask = 0x7fffff^(1<<22)^(1<<20)^(1<<16)^(1<<13)^(1<<11)^(1<<7)^(1<<4)^(1<<2);
+        while (shifts--) {
+            reg24 bit0 = ((shift_register >> 22) ^ (shift_register >> 17)) & 0x1;
+            shift_register <<= 1;
+            shift_register |= bit0;
+            shift_register &= mask;
+        }
+        shift_register &= mask;
+        noise_output_cached = outputN___();
+    }
+    else if (shifts) {
+        shift_register = noise_shift(shift_register, shifts);
+        noise_output_cached = outputN___();
+    }
+}
+
+
 // ----------------------------------------------------------------------------
 // Register functions.
 // ----------------------------------------------------------------------------
@@ -41,6 +41,7 @@ public:
     void set_chip_model(chip_model model);
     
     RESID_INLINE void clock();
+    void clock(cycle_count delta_t);
     RESID_INLINE void synchronize();
     void reset();
     
@@ -24,6 +24,7 @@
 #define SYNTH_MODE      1
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <math.h>
 #include <float.h>
@@ -31,6 +32,8 @@
 #include <sys/time.h>
 #include "AudioCoreDriver.h"
 #include "PlayerLibSidplay.h"
+#include "SidCollectionIndex.h"
+#include "TuneCache.h"
 #include <GLUT/glut.h>
 
 #include <CoreMIDI/CoreMIDI.h>
@@ -52,7 +55,19 @@ void setSwapInterval(int swapInterval)
 }
 #endif
 
-const char *STR( const char *format, ... )		{ static char string[1024]; va_list arg; va_start(arg, format); vsprintf(string, format, arg); va_end(arg); return string; }
+// collection the song names are relative to, its index is built by sidindex
+static const char* sCollectionRoot = "/Users/jussi/jussi/stuff/hvsids-4.1/";
+static const char* sCollectionIndex = "/Users/jussi/jussi/stuff/hvsids-4.1/collection.idx";
+
+// formatted string, owned by the temporary until the end of the full expression
+class STR
+{
+public:
+	STR( const char *format, ... )					{ va_list arg; va_start(arg, format); vsnprintf(m_string, sizeof(m_string), format, arg); va_end(arg); }
+	operator const char*() const					{ return m_string; }
+private:
+	char m_string[1024];
+};
 
 int                 width = 1600;
 int                 height = 1000;
@@ -338,6 +353,7 @@ public:
 	void drawWaveform(const ivec2& origin, const ivec2& size);
 	void drawFrequencySpectrum(const ivec2& origin, const ivec2& size);
     void drawUnderrun(const ivec2& origin);
+	void acquireAudioFrame();
 
 	void keyEvent(unsigned char key, bool up, int modifiers);
 	void specialKeyEvent(int key, bool up, int modifiers);
@@ -345,7 +361,14 @@ public:
     void midiEvent(unsigned int event, unsigned int value);
 
 private:
+	// the songs are the tunes of the collection index when there is
+	// one, the list set up in the constructor otherwise
+	int getNumSongs();
+	const char* getSongPath(int i);
+	int getSubtune(int i);
 	void playSong(int i);
+	void prepareSong(int i);
+	void searchSong(int from);
 	void drawText(int x, int y, const char* s);
 	void plot(const ivec2& origin, const vec2& scale, const ivec2* points, int numPoints);
 	void logLogPlot(const ivec2& origin, const vec2& scale, const float* y, int numPoints);
@@ -361,6 +384,7 @@ private:
 
 	AudioCoreDriver* 	m_audioCoreDriver;
     PlayerLibSidplay*	m_player;
+	TuneCache*			m_tuneCache;
 	sid_filter_t*		m_filterSettings;
 	PlaybackSettings	m_playbackSettings;
 	Param				m_params[NUM_PARAMS];
@@ -379,6 +403,9 @@ private:
 	int					m_numSongs;
 	char				m_songNames[MAX_SONGS][MAX_SONG_NAME_LENGTH];
 	int					m_subTunes[MAX_SONGS];
+	SidCollectionIndex	m_collection;
+	bool				m_searching;			// typing the text to search for
+	char				m_searchText[MAX_SONG_NAME_LENGTH];
 
     static const int MAX_INSTRUMENT_NAME_LENGTH = 64;
     char                m_instrumentPath[256];
@@ -391,6 +418,7 @@ private:
 
 	float*				m_spectrum;
 	int					m_numSpectrumSamples;
+	const AudioFrame*	m_audioFrame;			// drawn this frame, NULL before playing
 
     int                 m_keyFreq[256];
     int                 m_numUnderruns;
@@ -646,12 +674,16 @@ SIDPlayer::SIDPlayer()
 	m_currSong = -1;
 
 	m_numSongs = 0;
+	m_collection.open(sCollectionIndex);
+	m_searching = false;
+	m_searchText[0] = '\0';
 
 	m_paramSelectionX = 0;
 	m_paramSelectionY = 0;
 
 	m_spectrum = NULL;
 	m_numSpectrumSamples = 0;
+	m_audioFrame = NULL;
 
     m_numUnderruns = 0;
 
@@ -668,11 +700,19 @@ SIDPlayer::SIDPlayer()
 	m_playbackSettings.mOversampling = 1;
     m_playbackSettings.mOverrideCutoffCurve = false;
 
+	// the resampling filters take a while to design, keep them between runs
+	RESID::SID::set_user_fir_cache_directory();
+
 	m_player = new PlayerLibSidplay;
 	m_player->initEmuEngine(&m_playbackSettings);
 	m_audioCoreDriver->initialize(m_player, 44100, 16);
     m_audioCoreDriver->setSpectrumTemporalSmoothing(0.6f);
+	// songs can take the latency of rendering ahead, the synth plays keys as they come
+	m_audioCoreDriver->setLookaheadRendering(SYNTH_MODE == 0);
     m_player->setAudioDriver(m_audioCoreDriver);
+	// songs switch without a gap once prepared, with a 50 ms crossfade
+	m_tuneCache = new TuneCache;
+	m_player->setTuneCache(m_tuneCache, m_playbackSettings.mFrequency / 20);
 	m_filterSettings = m_player->getFilterSettings();
 	m_player->setFilterSettings(m_filterSettings);
 #if SYNTH_MODE == 1
@@ -680,15 +720,7 @@ SIDPlayer::SIDPlayer()
     m_songMode = false;
     setupMIDI();
 	//glutSetKeyRepeat(GLUT_KEY_REPEAT_OFF);
-    m_player->m_sid = new RESID::SID;
-    m_player->m_sid->reset();
-    m_player->m_sid->set_chip_model(MOS6581);
-	m_player->m_sid->set_distortion_properties(true, 1500, 300, -200000, 200000);   //Note: need large opmin/opmax for more than 3 voices
-    m_player->m_sid->enable_filter(true);
-    m_player->m_sid->enable_external_filter(true);
-	m_player->m_sid->set_mute(0, false);
-	m_player->m_sid->set_mute(1, false);
-	m_player->m_sid->set_mute(2, false);
+    m_player->initSynthEngine(&m_playbackSettings);
 
     snprintf(m_instrumentPath, 256, "/Users/jussi/jussi_git/sid/instruments");
 
@@ -894,6 +926,15 @@ enum Keylab_Button {    //0 = release, 7f = press
     l++;
     ASSERT(x <= GRID_WIDTH);
 
+	//stereo, voices spread from left to right
+    x = 0;
+    m_params[p] = Param("spread", 0, 4, 0, 0, 127, instrument, offsetof(Instrument, stereo_spread), K_NONE, Keylab_P20, 0);
+    m_paramGrid[x++][l] = p;
+    p++;
+    m_paramGridWidths[l] = x;
+    l++;
+    ASSERT(x <= GRID_WIDTH);
+
 
     for(int i=0;i<p;i++) {
         unsigned char k = m_params[i].getKey();
@@ -1078,7 +1119,9 @@ enum Keylab_Button {    //0 = release, 7f = press
 	snprintf(m_songNames[m_numSongs], MAX_SONG_NAME_LENGTH, "MUSICIANS/H/Huelsbeck_Chris/Third_TFMX_Song.sid"); m_subTunes[m_numSongs++] = 1;
 	ASSERT(m_numSongs <= MAX_SONGS);
 
-	playSong(0);
+	// the first song of the list, where it is in the index if there is one
+	int first = m_collection.getCount() > 0 ? m_collection.findPath(m_songNames[0]) : 0;
+	playSong(first >= 0 ? first : 0);
 #endif
 
     m_paramGridHeight = l;
@@ -1088,18 +1131,66 @@ enum Keylab_Button {    //0 = release, 7f = press
 	ASSERT(l <= GRID_HEIGHT);
 }
 
-void SIDPlayer::playSong(int i)
+int SIDPlayer::getNumSongs()
 {
-	if (m_currSong >= 0)
-	    m_audioCoreDriver->stopPlayback();
+	return m_collection.getCount() > 0 ? m_collection.getCount() : m_numSongs;
+}
 
-	ASSERT(i >= 0 && i < m_numSongs);
+const char* SIDPlayer::getSongPath(int i)
+{
+	if (m_collection.getCount() > 0)
+		return m_collection.getString(m_collection.getEntry(i).path);
+	return m_songNames[i];
+}
+
+int SIDPlayer::getSubtune(int i)
+{
+	if (m_collection.getCount() > 0)
+		return m_collection.getEntry(i).startSong;
+	return m_subTunes[i];
+}
+
+void SIDPlayer::playSong(int i)
+{
+	// the player stops the audio itself unless the song was prepared
+	int numSongs = getNumSongs();
+	ASSERT(i >= 0 && i < numSongs);
 	char path[256];
-	snprintf(path, 256, "/Users/jussi/jussi/stuff/hvsids-4.1/%s", m_songNames[i]);
-	bool ok = m_player->playTuneByPath(path, m_subTunes[i], &m_playbackSettings);
-    printf("play %s %s\n", m_songNames[i], ok ? "ok" : "failed");
+	snprintf(path, 256, "%s%s", sCollectionRoot, getSongPath(i));
+	bool ok = m_player->playTuneByPath(path, getSubtune(i), &m_playbackSettings);
+    printf("play %s %s\n", getSongPath(i), ok ? "ok" : "failed");
 	m_currSong = i;
 	m_player->setFilterSettings(m_filterSettings);
+
+	if (m_songMode)
+	{
+		prepareSong((i + 1) % numSongs);
+		prepareSong((i + numSongs - 1) % numSongs);
+	}
+}
+
+void SIDPlayer::prepareSong(int i)
+{
+	char path[256];
+	snprintf(path, 256, "%s%s", sCollectionRoot, getSongPath(i));
+	m_tuneCache->prepare(path, getSubtune(i), m_playbackSettings);
+}
+
+// plays the next tune of the index from the given one whose path, title
+// or author has the search text, wrapping around once
+void SIDPlayer::searchSong(int from)
+{
+	if (m_searchText[0] == '\0')
+		return;
+
+	int i = m_collection.search(m_searchText, from);
+	if (i < 0 && from > 0)
+		i = m_collection.search(m_searchText, 0);
+
+	if (i >= 0)
+		playSong(i);
+	else
+		printf("search %s: not found\n", m_searchText);
 }
 
 void SIDPlayer::drawText(int x, int y, const char* s)
@@ -1147,8 +1238,17 @@ void SIDPlayer::drawSongName(const ivec2& origin)
 	gluOrtho2D(0.0, width, 0.0, height);
 
 	char s[256];
-    if (m_songMode)
-        snprintf(s, 256, "%s subtune %d chip %s", m_currSong >= 0 ? m_songNames[m_currSong] : "not playing", m_currSong >= 0 ? m_subTunes[m_currSong] : 0, m_player->getCurrentChipModel());
+    if (m_searching)
+        snprintf(s, 256, "search: %s_", m_searchText);
+    else if (m_songMode && m_currSong >= 0 && m_collection.getCount() > 0)
+    {
+        // from the index, the tune file is not read again
+        const SidIndexEntry& tune = m_collection.getEntry(m_currSong);
+        snprintf(s, 256, "%s - %s (%s) subtune %d/%d chip %s", m_collection.getString(tune.title), m_collection.getString(tune.author),
+                 m_collection.getString(tune.released), tune.startSong, tune.songs, m_player->getCurrentChipModel());
+    }
+    else if (m_songMode)
+        snprintf(s, 256, "%s subtune %d chip %s", m_currSong >= 0 ? getSongPath(m_currSong) : "not playing", m_currSong >= 0 ? getSubtune(m_currSong) : 0, m_player->getCurrentChipModel());
     else
         snprintf(s, 256, "%s", m_instrumentNames[m_currentInstrument]);
 
@@ -1170,10 +1270,15 @@ void SIDPlayer::drawUnderrun(const ivec2& origin)
         m_numUnderruns += m_audioCoreDriver->getBufferUnderrunCount();
         m_audioCoreDriver->setBufferUnderrunDetected(false);
     }
+    char load[192];
+    m_audioCoreDriver->getRenderLoad().format(load, sizeof(load));
     if (m_numUnderruns)
-        snprintf(s, 256, "UNDERRUNS %d", m_numUnderruns);
+        snprintf(s, 256, "UNDERRUNS %d, %s", m_numUnderruns, load);
     else
-        snprintf(s, 256, "no underruns");
+        snprintf(s, 256, "no underruns, %s", load);
+    LookaheadRenderer& lookahead = m_audioCoreDriver->getLookaheadRenderer();
+    if (lookahead.getIsRunning())
+        snprintf(s + strlen(s), 256 - strlen(s), ", lookahead %.0f ms", lookahead.getLookahead() * 1000.0);
 
 	drawText(origin.x, height-origin.y, s);
 
@@ -1294,13 +1399,19 @@ float bspline(float t)
 */
 }
 
+void SIDPlayer::acquireAudioFrame()
+{
+	// the same frame for all the views, whatever the audio thread does meanwhile
+	m_audioFrame = m_audioCoreDriver ? m_audioCoreDriver->acquireFrame() : NULL;
+}
+
 void SIDPlayer::drawColors(const ivec2& origin)
 {
-	if (!m_audioCoreDriver)
+	if (!m_audioFrame)
 		return;
 
-	float* samples = m_audioCoreDriver->getSpectrumBuffer();
-	int numSamples = m_audioCoreDriver->getNumSamplesInSpectrum();
+	const float* samples = m_audioFrame->mSpectrum;
+	int numSamples = m_audioFrame->mNumSpectrumBins;
 
     const int numShapes = 16;
     glDisable(GL_CULL_FACE);
@@ -1419,11 +1530,11 @@ void SIDPlayer::drawColors(const ivec2& origin)
 
 void SIDPlayer::drawWaveform(const ivec2& origin, const ivec2& size)
 {
-	if (!m_audioCoreDriver)
+	if (!m_audioFrame)
 		return;
 
-	short* samples = m_audioCoreDriver->getSampleBuffer();
-	int numSamples = m_audioCoreDriver->getNumSamplesInBuffer();
+	const short* samples = m_audioFrame->mSamples;
+	int numSamples = m_audioFrame->mNumSamples;
 
 	vec2 s(float(size.x)/float(numSamples), -float(size.y) / 65536.0f);
 	plot(origin, s, samples, numSamples);
@@ -1454,11 +1565,11 @@ void SIDPlayer::drawWaveform(const ivec2& origin, const ivec2& size)
 
 void SIDPlayer::drawFrequencySpectrum(const ivec2& origin, const ivec2& size)
 {
-	if (!m_audioCoreDriver)
+	if (!m_audioFrame)
 		return;
 
-	float* spectrum = m_audioCoreDriver->getSpectrumBuffer();
-	int numSamples = m_audioCoreDriver->getNumSamplesInSpectrum();
+	const float* spectrum = m_audioFrame->mSpectrum;
+	int numSamples = m_audioFrame->mNumSpectrumBins;
 
 	vec2 s(float(size.x)/float(numSamples), -float(size.y) / 65536.0f);
 	logLogPlot(origin, s, spectrum, numSamples);
@@ -1483,6 +1594,26 @@ void SIDPlayer::drawFrequencySpectrum(const ivec2& origin, const ivec2& size)
 
 void SIDPlayer::keyEvent(unsigned char key, bool up, int modifiers)
 {
+    // the search text takes the keys until return or escape
+    if (m_searching) {
+        size_t length = strlen(m_searchText);
+        if (up)
+            return;
+        if (key == 13) {
+            m_searching = false;
+            searchSong(m_currSong + 1);
+        }
+        else if (key == 27)
+            m_searching = false;
+        else if ((key == 8 || key == 127) && length > 0)
+            m_searchText[length - 1] = '\0';
+        else if (key >= ' ' && key < 127 && length + 1 < sizeof(m_searchText)) {
+            m_searchText[length] = key;
+            m_searchText[length + 1] = '\0';
+        }
+        return;
+    }
+
     if (m_player->m_sid) {
         //synth mode
         static int v = 0;
@@ -1599,8 +1730,11 @@ void SIDPlayer::specialKeyEvent(int key, bool up, int modifiers)
 		case GLUT_KEY_RIGHT: m_paramSelectionX++; if (m_paramSelectionX >= m_paramGridWidths[m_paramSelectionY]) m_paramSelectionX = 0; break;
 		case GLUT_KEY_UP: m_paramSelectionY--; if (m_paramSelectionY < 0) m_paramSelectionY = m_paramGridHeight-1; break;
 		case GLUT_KEY_DOWN: m_paramSelectionY++; if (m_paramSelectionY >= m_paramGridHeight) m_paramSelectionY = 0; break;
-		case GLUT_KEY_F1: if (m_songMode) { playSong((m_currSong+m_numSongs-1)%m_numSongs); } else changeInstrument(m_currentInstrument-1); break;
-		case GLUT_KEY_F2: if (m_songMode) { playSong((m_currSong+1)%m_numSongs);  } else changeInstrument(m_currentInstrument+1); break;
+		case GLUT_KEY_F1: if (m_songMode) { playSong((m_currSong+getNumSongs()-1)%getNumSongs()); } else changeInstrument(m_currentInstrument-1); break;
+		case GLUT_KEY_F2: if (m_songMode) { playSong((m_currSong+1)%getNumSongs());  } else changeInstrument(m_currentInstrument+1); break;
+		// search the collection index, F3 to type the text, F4 for the next match
+		case GLUT_KEY_F3: if (m_songMode && m_collection.getCount() > 0) { m_searching = true; m_searchText[0] = '\0'; } break;
+		case GLUT_KEY_F4: if (m_songMode && m_collection.getCount() > 0) searchSong(m_currSong + 1); break;
         case GLUT_KEY_F7: if (!m_songMode) saveInstrument(); break;
         case GLUT_KEY_F9: if (!m_songMode) loadInstrument(); break;
 		default: break;
@@ -1649,6 +1783,7 @@ SIDPlayer::~SIDPlayer()
     m_audioCoreDriver->stopPlayback();
 	delete m_audioCoreDriver;
 	delete m_player;
+	delete m_tuneCache;
 	delete[] m_spectrum;
 }
 
@@ -1717,6 +1852,7 @@ void mainloop()
     glLineWidth(1.0f);
 	glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
 
+    s_sidplayer->acquireAudioFrame();
     s_sidplayer->drawColors(ivec2(800, 500));
 	s_sidplayer->drawWaveform(ivec2(10, 500), ivec2(780, 500));
 	s_sidplayer->drawFrequencySpectrum(ivec2(810, 750), ivec2(780, 500));
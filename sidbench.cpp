@@ -0,0 +1,566 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+// Benchmarks the hot paths of the engine: resid by voice count, waveform,
+// harmonics, SIDPLUS effect and sampling method, the filter, the event
+// scheduler and the 6510, and whole tunes played through libsidplay2.
+// Every result is a line "<name>\t<rate>\t<unit>", higher is faster, so
+// the output of one build can be kept and given to another with -c to
+// compare them, failing when a benchmark got slower than the threshold.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include "BatchRenderer.h"
+#include "NullAudioDriver.h"
+#include "mos6510/mos6510.h"
+
+
+static const int NUM_TRIALS = 3;
+
+
+// A fixed amount of work, run again and again until the trial time is up.
+class Benchmark
+{
+public:
+    virtual ~Benchmark() {}
+    virtual const char* unit() = 0;
+    // returns the units of work done
+    virtual double run() = 0;
+};
+
+
+// ----------------------------------------------------------------------------
+// resid
+// ----------------------------------------------------------------------------
+
+enum SidEffect { EFFECT_NONE, EFFECT_BASSBOOST, EFFECT_TREBLEBOOST, EFFECT_FUZZ, EFFECT_ALL };
+enum SidStereo { STEREO_OFF, STEREO_CENTER, STEREO_PANNED };
+
+class SidClockBenchmark : public Benchmark
+{
+public:
+    static const int CYCLES = 100000;
+
+    SidClockBenchmark(int numVoices, int waveform, bool harmonics, SidEffect effect, sampling_method method,
+                      SidStereo stereo = STEREO_OFF)
+        : interleave(stereo == STEREO_OFF ? 1 : 2)
+    {
+        sid.set_chip_model(MOS6581);
+        sid.set_sampling_parameters(985248, 44100);
+        sid.set_sampling_method(method);
+        sid.reset();
+
+        for (int v = 0; v < NUM_VOICES; v++) {
+            int base = SIDPLUS_EXT_VOICE_BASE + v * SIDPLUS_VOICE_NUM_REGS;
+            int freq = 0x1000 + v * 0x0345;
+            sid.write(base + SIDPLUS_VOICE_WAVE_FREQ_LO, freq & 0xff);
+            sid.write(base + SIDPLUS_VOICE_WAVE_FREQ_HI, freq >> 8);
+            sid.write(base + SIDPLUS_VOICE_WAVE_PW_LO, 0x00);
+            sid.write(base + SIDPLUS_VOICE_WAVE_PW_HI, 0x08);
+            sid.write(base + SIDPLUS_VOICE_ENV_ATTACK_DECAY, 0x00);
+            sid.write(base + SIDPLUS_VOICE_ENV_SUSTAIN_RELEASE, 0xf0);
+            for (int h = 0; h < NUM_HARMONICS; h++)
+                sid.write(base + SIDPLUS_VOICE_HVOL_0 + h, harmonics ? 0x80 >> h : 0);
+            sid.write(base + SIDPLUS_VOICE_FILT, 1);
+            sid.write(base + SIDPLUS_VOICE_CONTROL_REG, v < numVoices ? waveform | 0x01 : 0x00);
+            if (stereo == STEREO_PANNED)
+                sid.write(base + SIDPLUS_VOICE_PAN, (v * 254 / (NUM_VOICES - 1) - 127) & 0xff);
+        }
+        sid.set_stereo(stereo != STEREO_OFF);
+
+        sid.write(SID_FILTER_FC_LO, 0x00);
+        sid.write(SID_FILTER_FC_HI, 0x40);
+        sid.write(SID_FILTER_RES_FILT, 0x80);
+        sid.write(SID_FILTER_MODE_VOL, 0x1f);
+
+        if (effect == EFFECT_BASSBOOST || effect == EFFECT_ALL) {
+            sid.write(SIDPLUS_BASSBOOST_GAIN_LO, 0x00);
+            sid.write(SIDPLUS_BASSBOOST_GAIN_HI, 0x02);
+            sid.write(SIDPLUS_BASSBOOST_CUTOFF_LO, 0x00);
+            sid.write(SIDPLUS_BASSBOOST_CUTOFF_HI, 0x01);
+        }
+        if (effect == EFFECT_TREBLEBOOST || effect == EFFECT_ALL) {
+            sid.write(SIDPLUS_TREBLEBOOST_GAIN_LO, 0x00);
+            sid.write(SIDPLUS_TREBLEBOOST_GAIN_HI, 0x02);
+            sid.write(SIDPLUS_TREBLEBOOST_CUTOFF_LO, 0x00);
+            sid.write(SIDPLUS_TREBLEBOOST_CUTOFF_HI, 0x10);
+        }
+        if (effect == EFFECT_FUZZ || effect == EFFECT_ALL) {
+            sid.write(SIDPLUS_FUZZ_GAIN_LO, 0x00);
+            sid.write(SIDPLUS_FUZZ_GAIN_HI, 0x01);
+            sid.write(SIDPLUS_FUZZ_MULT_LO, 0x00);
+            sid.write(SIDPLUS_FUZZ_MULT_HI, 0x01);
+            sid.write(SIDPLUS_FUZZ_MIX, 0x80);
+        }
+    }
+
+    const char* unit() { return "cycles/s"; }
+
+    double run()
+    {
+        cycle_count delta_t = CYCLES;
+        while (delta_t > 0)
+            sid.clock(delta_t, buffer, sizeof(buffer) / sizeof(short) / interleave, interleave);
+        return CYCLES;
+    }
+
+private:
+    RESID::SID  sid;
+    short       buffer[4096];
+    int         interleave;
+};
+
+
+class FilterBenchmark : public Benchmark
+{
+public:
+    static const int CYCLES = 100000;
+
+    FilterBenchmark(bool distortion)
+    {
+        filter.set_chip_model(MOS6581);
+        if (distortion)
+            filter.set_distortion_properties(true, 1500, 300, -200000, 200000);
+        filter.writeFC_LO(0x00);
+        filter.writeFC_HI(0x40);
+        filter.writeRES_FILT(0x87);
+        filter.writeMODE_VOL(0x1f);
+
+        // a saw per voice, out of phase with each other
+        for (int i = 0; i < CYCLES; i++)
+            input[i % INPUT_LENGTH] = ((i * 37) & 0xfff) - 0x800;
+    }
+
+    const char* unit() { return "cycles/s"; }
+
+    double run()
+    {
+        sound_sample voices[NUM_VOICES];
+        for (int i = 0; i < CYCLES; i++) {
+            for (int v = 0; v < NUM_VOICES; v++)
+                voices[v] = input[(i + v * 97) % INPUT_LENGTH] * 0xff;
+            filter.clock(voices, 0);
+        }
+        return CYCLES;
+    }
+
+private:
+    static const int INPUT_LENGTH = 4096;
+
+    Filter          filter;
+    sound_sample    input[INPUT_LENGTH];
+};
+
+
+// ----------------------------------------------------------------------------
+// libsidplay2
+// ----------------------------------------------------------------------------
+
+// Reschedules itself every period cycles.
+class PeriodicEvent : public Event
+{
+public:
+    PeriodicEvent() : Event("Benchmark"), context(NULL), period(1), count(0) {}
+
+    void start(EventContext& inContext, event_clock_t inPeriod)
+    {
+        context = &inContext;
+        period = inPeriod;
+        schedule(*context, period, EVENT_CLOCK_PHI1);
+    }
+
+    void event()
+    {
+        count++;
+        schedule(*context, period, EVENT_CLOCK_PHI1);
+    }
+
+    EventContext*   context;
+    event_clock_t   period;
+    long long       count;
+};
+
+class SchedulerBenchmark : public Benchmark
+{
+public:
+    static const int DISPATCHES = 100000;
+    static const int MAX_EVENTS = 64;
+
+    SchedulerBenchmark(int inNumEvents) : scheduler("Benchmark Scheduler"), numEvents(inNumEvents)
+    {
+        scheduler.reset();
+        for (int i = 0; i < numEvents; i++)
+            events[i].start(scheduler, 3 + i * 7);
+    }
+
+    const char* unit() { return "events/s"; }
+
+    double run()
+    {
+        long long before = 0, after = 0;
+        for (int i = 0; i < numEvents; i++)
+            before += events[i].count;
+        for (int i = 0; i < DISPATCHES; i++)
+            scheduler.clock();
+        for (int i = 0; i < numEvents; i++)
+            after += events[i].count;
+        return (double)(after - before);
+    }
+
+private:
+    EventScheduler  scheduler;
+    PeriodicEvent   events[MAX_EVENTS];
+    int             numEvents;
+};
+
+
+// Flat 64K of RAM around the CPU, no I/O, interrupts or banking.
+class RamEnvironment : public C64Environment
+{
+public:
+    uint8_t ram[0x10000];
+
+protected:
+    void    envReset           (void) {}
+    uint8_t envReadMemByte     (uint_least16_t addr) { return ram[addr]; }
+    void    envWriteMemByte    (uint_least16_t addr, uint8_t data) { ram[addr] = data; }
+    void    envTriggerIRQ      (void) {}
+    void    envTriggerNMI      (void) {}
+    void    envTriggerRST      (void) {}
+    void    envClearIRQ        (void) {}
+    bool    envCheckBankJump   (uint_least16_t) { return true; }
+    uint8_t envReadMemDataByte (uint_least16_t addr) { return ram[addr]; }
+    void    envSleep           (void) {}
+    void    envLoadFile        (char *) {}
+};
+
+class CpuBenchmark : public Benchmark
+{
+public:
+    static const int CYCLES = 1000000;
+
+    CpuBenchmark() : scheduler("Benchmark Scheduler"), cpu(&scheduler)
+    {
+        // LDA $2000,X / CLC / ADC #1 / STA $2000,X / INX / JMP $1000,
+        // 6 instructions in 4+2+2+5+2+3 cycles
+        static const uint8_t program[] = {
+            0xbd, 0x00, 0x20, 0x18, 0x69, 0x01, 0x9d, 0x00, 0x20, 0xe8, 0x4c, 0x00, 0x10
+        };
+        memset(env.ram, 0, sizeof(env.ram));
+        memcpy(&env.ram[0x1000], program, sizeof(program));
+        env.ram[0xfffc] = 0x00;
+        env.ram[0xfffd] = 0x10;
+
+        cpu.setEnvironment(&env);
+        cpu.environment(sid2_envR);
+        scheduler.reset();
+        cpu.reset(0x1000, 0, 0, 0);
+    }
+
+    const char* unit() { return "instructions/s"; }
+
+    double run()
+    {
+        event_clock_t end = scheduler.getTime(EVENT_CLOCK_PHI1) + CYCLES;
+        while (scheduler.getTime(EVENT_CLOCK_PHI1) < end)
+            scheduler.clock();
+        return CYCLES * 6.0 / 18.0;
+    }
+
+private:
+    EventScheduler  scheduler;
+    RamEnvironment  env;
+    SID6510         cpu;
+};
+
+
+// A tune played from the start as the player does, through sidplay2::play
+// and resid; the rate is seconds of audio per second.
+class TuneBenchmark : public Benchmark
+{
+public:
+    static const int SECONDS = 5;
+
+    TuneBenchmark(const char* inPath, const PlaybackSettings& inSettings) : path(inPath), success(false), settings(inSettings)
+    {
+        driver.initialize(&player, settings.mFrequency, settings.mBits);
+        player.setAudioDriver(&driver);
+        success = driver.getIsInitialized() && player.loadTuneByPath(path, 0, &settings);
+    }
+
+    ~TuneBenchmark()
+    {
+        player.setAudioDriver(NULL);
+    }
+
+    bool isLoaded() { return success; }
+
+    const char* unit() { return "x real-time"; }
+
+    double run()
+    {
+        long long numSamples = (long long)SECONDS * driver.getSampleRate();
+        return (double)driver.render(numSamples) / driver.getSampleRate();
+    }
+
+private:
+    const char*         path;
+    bool                success;
+    PlaybackSettings    settings;
+    PlayerLibSidplay    player;
+    NullAudioDriver     driver;
+};
+
+
+// ----------------------------------------------------------------------------
+// Running and comparing
+// ----------------------------------------------------------------------------
+
+struct BenchRun
+{
+    BenchRun() : filter(NULL), emulation("exact"), trialSeconds(0.5), threshold(5.0), numRegressions(0) { settings.mPowerOnDelay = 0; }
+
+    const char*                     filter;
+    const char*                     emulation;      // of the tunes
+    PlaybackSettings                settings;
+    double                          trialSeconds;
+    double                          threshold;      // percent slower that fails
+    std::map<std::string, double>   baseline;
+    int                             numRegressions;
+};
+
+static bool selected(const BenchRun& bench, const char* name)
+{
+    return bench.filter == NULL || strstr(name, bench.filter) != NULL;
+}
+
+// Best rate of a few trials, the others are slowed by whatever else runs.
+static void measure(BenchRun& bench, const char* name, Benchmark& benchmark)
+{
+    double best = 0.0;
+
+    benchmark.run();
+
+    for (int trial = 0; trial < NUM_TRIALS; trial++) {
+        double units = 0.0;
+        double start = BatchRenderer::now();
+        double elapsed;
+
+        do {
+            units += benchmark.run();
+            elapsed = BatchRenderer::now() - start;
+        } while (elapsed < bench.trialSeconds);
+
+        if (units / elapsed > best)
+            best = units / elapsed;
+    }
+
+    std::map<std::string, double>::const_iterator it = bench.baseline.find(name);
+    if (it == bench.baseline.end() || it->second <= 0.0) {
+        printf("%s\t%.6g\t%s\n", name, best, benchmark.unit());
+    }
+    else {
+        double change = (best / it->second - 1.0) * 100.0;
+        bool regression = change < -bench.threshold;
+        printf("%s\t%.6g\t%s\t%.6g\t%+.1f%%%s\n", name, best, benchmark.unit(), it->second, change, regression ? "\tREGRESSION" : "");
+        if (regression)
+            bench.numRegressions++;
+    }
+    fflush(stdout);
+}
+
+static bool loadBaseline(BenchRun& bench, const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+        return false;
+
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        char* tab = strchr(line, '\t');
+        if (line[0] == '#' || tab == NULL)
+            continue;
+        *tab = '\0';
+        bench.baseline[line] = atof(tab + 1);
+    }
+
+    fclose(file);
+    return true;
+}
+
+static void usage(const char* name)
+{
+    printf("usage: %s [options] [<tune>...]\n", name);
+    printf("  -b <text>     run only the benchmarks whose name contains the text\n");
+    printf("  -t <seconds>  time of each of the %d trials of a benchmark (default 0.5)\n", NUM_TRIALS);
+    printf("  -c <file>     compare with the output of an earlier run, exit with 1 when\n");
+    printf("                a benchmark got slower by more than the threshold\n");
+    printf("  -r <percent>  regression threshold (default 5)\n");
+    printf("  -e <mode>     emulation of the tunes, exact, lazy or fast (default exact)\n");
+    printf("  -i <seconds>  keyframe interval of the tunes, 0 for none (default 0)\n");
+    printf("The tunes are played from the start of their default subtune, named with the\n");
+    printf("emulation unless it is exact.\n");
+}
+
+int main(int argc, char** argv)
+{
+    static const char* waveNames[] = { "triangle", "saw", "pulse", "noise", "combined" };
+    static const int waveforms[] = { 0x10, 0x20, 0x40, 0x80, 0x60 };
+    static const char* effectNames[] = { "none", "bassboost", "trebleboost", "fuzz", "all" };
+    static const char* stereoNames[] = { "off", "center", "panned" };
+    static const int voiceCounts[] = { 1, 3, NUM_VOICES };
+    static const int eventCounts[] = { 1, 4, 16, 64 };
+
+    BenchRun bench;
+    char name[256];
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (arg[1] == '\0' || arg[2] != '\0' || value == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+
+        switch (arg[1]) {
+            case 'b': bench.filter = value; break;
+            case 't': bench.trialSeconds = atof(value); break;
+            case 'r': bench.threshold = atof(value); break;
+            case 'e':
+                if (!bench.settings.setEmulation(value)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                bench.emulation = value;
+                break;
+            case 'i': bench.settings.mKeyframeInterval = atoi(value) > 0 ? atoi(value) : 0; break;
+            case 'c':
+                if (!loadBaseline(bench, value)) {
+                    printf("cannot read %s\n", value);
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    RESID::SID::set_user_fir_cache_directory();
+
+    printf("# name\trate\tunit%s\n", bench.baseline.empty() ? "" : "\tbaseline\tchange");
+
+    for (int v = 0; v < 3; v++) {
+        snprintf(name, sizeof(name), "sid.clock.voices.%d", voiceCounts[v]);
+        if (selected(bench, name)) {
+            SidClockBenchmark benchmark(voiceCounts[v], 0x20, false, EFFECT_NONE, SAMPLE_INTERPOLATE);
+            measure(bench, name, benchmark);
+        }
+    }
+
+    for (int w = 0; w < 5; w++) {
+        snprintf(name, sizeof(name), "sid.clock.wave.%s", waveNames[w]);
+        if (selected(bench, name)) {
+            SidClockBenchmark benchmark(NUM_VOICES, waveforms[w], false, EFFECT_NONE, SAMPLE_INTERPOLATE);
+            measure(bench, name, benchmark);
+        }
+    }
+
+    for (int h = 0; h < 2; h++) {
+        snprintf(name, sizeof(name), "sid.clock.harmonics.%s", h ? "on" : "off");
+        if (selected(bench, name)) {
+            SidClockBenchmark benchmark(NUM_VOICES, 0x20, h != 0, EFFECT_NONE, SAMPLE_INTERPOLATE);
+            measure(bench, name, benchmark);
+        }
+    }
+
+    for (int e = EFFECT_NONE; e <= EFFECT_ALL; e++) {
+        snprintf(name, sizeof(name), "sid.clock.effect.%s", effectNames[e]);
+        if (selected(bench, name)) {
+            SidClockBenchmark benchmark(NUM_VOICES, 0x20, false, (SidEffect)e, SAMPLE_INTERPOLATE);
+            measure(bench, name, benchmark);
+        }
+    }
+
+    for (int s = 0; s < 2; s++) {
+        snprintf(name, sizeof(name), "sid.sample.%s", s ? "resample_interpolate" : "interpolate");
+        if (selected(bench, name)) {
+            SidClockBenchmark benchmark(3, 0x20, false, EFFECT_NONE, s ? SAMPLE_RESAMPLE_INTERPOLATE : SAMPLE_INTERPOLATE);
+            measure(bench, name, benchmark);
+        }
+    }
+
+    for (int s = STEREO_OFF; s <= STEREO_PANNED; s++) {
+        snprintf(name, sizeof(name), "sid.stereo.%s", stereoNames[s]);
+        if (selected(bench, name)) {
+            SidClockBenchmark benchmark(NUM_VOICES, 0x20, false, EFFECT_ALL, SAMPLE_INTERPOLATE, (SidStereo)s);
+            measure(bench, name, benchmark);
+        }
+    }
+
+    for (int d = 0; d < 2; d++) {
+        snprintf(name, sizeof(name), "filter.clock.%s", d ? "distortion" : "plain");
+        if (selected(bench, name)) {
+            FilterBenchmark* benchmark = new FilterBenchmark(d != 0);
+            measure(bench, name, *benchmark);
+            delete benchmark;
+        }
+    }
+
+    for (int e = 0; e < 4; e++) {
+        snprintf(name, sizeof(name), "scheduler.events.%d", eventCounts[e]);
+        if (selected(bench, name)) {
+            SchedulerBenchmark benchmark(eventCounts[e]);
+            measure(bench, name, benchmark);
+        }
+    }
+
+    if (selected(bench, "cpu.6510")) {
+        CpuBenchmark* benchmark = new CpuBenchmark;
+        measure(bench, "cpu.6510", *benchmark);
+        delete benchmark;
+    }
+
+    for (; i < argc; i++) {
+        const char* base = strrchr(argv[i], '/');
+        if (strcmp(bench.emulation, "exact") == 0)
+            snprintf(name, sizeof(name), "play.%s", base ? base + 1 : argv[i]);
+        else
+            snprintf(name, sizeof(name), "play.%s.%s", bench.emulation, base ? base + 1 : argv[i]);
+        if (!selected(bench, name))
+            continue;
+
+        TuneBenchmark* benchmark = new TuneBenchmark(argv[i], bench.settings);
+        if (benchmark->isLoaded())
+            measure(bench, name, *benchmark);
+        else
+            fprintf(stderr, "%s: cannot load %s\n", name, argv[i]);
+        delete benchmark;
+    }
+
+    if (bench.numRegressions)
+        fprintf(stderr, "%d benchmarks slower by more than %g%%\n", bench.numRegressions, bench.threshold);
+
+    return bench.numRegressions ? 1 : 0;
+}
@@ -0,0 +1,747 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+// Regression check of the audio output: renders a fixed list of cases,
+// tunes and scripted synth notes, and compares them sample by sample with
+// golden renders made before a change.  Optimizations of resid and
+// libsidplay2 are meant to leave the output bit-exact; those that are not
+// can be given a tolerance, as a largest sample difference.  Without a
+// golden render a case is checked against the hash of the render stored
+// in the case list, which is bit-exact only.
+//
+// A case list has a case per line, "#" starts a comment:
+//
+//   <name> tune <file.sid> [subtune=<n>] [options]
+//   <name> synth [patch=<file>] [<instrument field>=<value>...]
+//                [note=<voice>:<freq>:<on>:<off>[:<velocity>]...] [options]
+//   <name> length <file.sid> after=<file.sid> [subtune=<n>] [options]
+//   <name> trace <file.sid> [subtune=<n>] [options]
+//
+// options: seconds=<s> (default 10), rate=<hz>, model=6581|8580,
+// clock=pal|ntsc, oversampling=<n>, tolerance=<largest difference>,
+// hash=<16 hex digits of the expected render, as printed>, and for
+// tunes seek=<s> to start the render there, emulation=lazy|fast to
+// check the speed ups against the exact emulation (see
+// PlaybackSettings::setEmulation) instead of a golden render or hash.
+// A length case finds how long a tune plays (SongLengthAnalyzer, up to
+// seconds=) on its own and on a player that analysed the after= tune
+// first, and passes when the two are the same.  A trace case records
+// the tune to a register trace as sidrender -w does and checks the replay
+// of the trace, which must be on the chip model the tune plays on.
+// Instrument fields (waveform=1 sustain=15 sid_filter_vol=15 ...) are set
+// as in a patch file, over the patch if there is one.  Times of notes are
+// in seconds, paths are relative to the case list.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "BatchRenderer.h"
+#include "SidTraceFile.h"
+#include "SongLengthAnalyzer.h"
+#include "WavFileAudioDriver.h"
+
+
+struct NoteEvent
+{
+    long long   sample;
+    int         voice;
+    int         freq;           // 0 releases the voice
+    int         velocity;
+
+    bool operator<(const NoteEvent& other) const { return sample < other.sample; }
+};
+
+struct CheckCase
+{
+    CheckCase() : synth(false), length(false), trace(false), subtune(BatchRenderer::SUBTUNE_DEFAULT), seconds(10.0), seek(0.0), emulated(false), tolerance(-1), hash(0), hasHash(false), line(0) { settings.mPowerOnDelay = 0; }
+
+    std::string             name;
+    bool                    synth;
+    bool                    length;
+    bool                    trace;
+    std::string             input;          // tune, or patch (may be empty)
+    std::string             after;          // tune analysed before the one of a length case
+    std::string             instrument;     // patch file lines set over the patch
+    int                     subtune;
+    double                  seconds;
+    double                  seek;           // seconds into the tune the render starts at
+    bool                    emulated;       // checked against the exact emulation
+    int                     tolerance;      // < 0 for the one given on the command line
+    unsigned long long      hash;           // of the expected render, when hasHash
+    bool                    hasHash;
+    int                     line;           // in the case list, from 1
+    PlaybackSettings        settings;
+    std::vector<NoteEvent>  events;
+};
+
+struct Difference
+{
+    Difference() : first(-1), numDiffering(0), largest(0), signalPower(0.0), errorPower(0.0) {}
+
+    long long   first;          // -1 when the samples they share are equal
+    long long   numDiffering;
+    int         largest;
+    double      signalPower;
+    double      errorPower;
+};
+
+
+// 64 bit FNV-1a of the samples as little endian bytes
+static unsigned long long hashSamples(const std::vector<short>& samples)
+{
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < samples.size(); i++) {
+        hash = (hash ^ (samples[i] & 0xff)) * 0x100000001b3ULL;
+        hash = (hash ^ ((samples[i] >> 8) & 0xff)) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static unsigned int getLittleEndian(const unsigned char* p, int bytes)
+{
+    unsigned int value = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        value = (value << 8) | p[i];
+    return value;
+}
+
+// Reads the 16 bit mono files WavFileAudioDriver writes.
+static bool readWav(const char* path, int& sampleRate, std::vector<short>& samples)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    unsigned char header[12];
+    unsigned char chunk[8];
+    bool success = fread(header, 1, 12, file) == 12 && memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0;
+    bool format = false;
+
+    while (success && fread(chunk, 1, 8, file) == 8) {
+        unsigned int size = getLittleEndian(chunk + 4, 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            unsigned char fmt[16];
+            success = fread(fmt, 1, 16, file) == 16 && fseek(file, size - 16 + (size & 1), SEEK_CUR) == 0;
+            // PCM, mono, 16 bits
+            format = success && getLittleEndian(fmt, 2) == 1 && getLittleEndian(fmt + 2, 2) == 1 && getLittleEndian(fmt + 14, 2) == 16;
+            sampleRate = getLittleEndian(fmt + 4, 4);
+            success = format;
+        }
+        else if (memcmp(chunk, "data", 4) == 0 && format) {
+            std::vector<unsigned char> data(size);
+            success = fread(&data[0], 1, size, file) == size;
+            samples.resize(size / 2);
+            for (size_t i = 0; success && i < samples.size(); i++)
+                samples[i] = (short)getLittleEndian(&data[i * 2], 2);
+            break;
+        }
+        else {
+            success = fseek(file, size + (size & 1), SEEK_CUR) == 0;
+        }
+    }
+
+    fclose(file);
+    return success && format;
+}
+
+static bool writeWav(const char* path, int sampleRate, const std::vector<short>& samples)
+{
+    WavFileAudioDriver driver(path);
+    driver.initialize(NULL, sampleRate, 16);
+    return driver.getIsInitialized() && driver.write(&samples[0], samples.size()) == (long long)samples.size();
+}
+
+// failing renders are written where they can be listened to, if anywhere
+static void keepRender(const char* directory, const CheckCase& check, int sampleRate, const std::vector<short>& samples)
+{
+    if (directory == NULL)
+        return;
+    std::string path = std::string(directory) + "/" + check.name + ".wav";
+    writeWav(path.c_str(), sampleRate, samples);
+}
+
+static Difference compare(const std::vector<short>& output, const std::vector<short>& golden)
+{
+    Difference difference;
+    size_t length = std::min(output.size(), golden.size());
+
+    for (size_t i = 0; i < length; i++) {
+        int delta = output[i] - golden[i];
+        difference.signalPower += (double)golden[i] * golden[i];
+        difference.errorPower += (double)delta * delta;
+        if (delta == 0)
+            continue;
+        if (difference.first < 0)
+            difference.first = i;
+        difference.numDiffering++;
+        difference.largest = std::max(difference.largest, abs(delta));
+    }
+
+    return difference;
+}
+
+
+// ----------------------------------------------------------------------------
+// Rendering
+// ----------------------------------------------------------------------------
+
+// Renders a case the way sidrender does, from a fresh player so no state
+// is carried from the case before.
+static bool render(const CheckCase& check, std::vector<short>& samples)
+{
+    PlayerLibSidplay* player = new PlayerLibSidplay;
+    PlaybackSettings settings = check.settings;
+    bool success = true;
+
+    player->setAudioDriver(NULL);
+
+    if (check.synth) {
+        if (!check.input.empty()) {
+            std::ifstream fi(check.input.c_str(), std::ios::in);
+            success = fi.is_open();
+            if (success)
+                player->getInstrument(0)->load(fi);
+        }
+        std::istringstream fields(check.instrument);
+        player->getInstrument(0)->load(fields);
+        player->setCurrentInstrument(0);
+        player->initSynthEngine(&settings);
+    }
+    else {
+        success = player->loadTuneByPath(check.input.c_str(), check.subtune, &settings);
+        if (success && check.seek > 0.0)
+            success = player->seekToSample((long long)(check.seek * settings.mFrequency));
+    }
+
+    long long numSamples = (long long)(check.seconds * settings.mFrequency);
+    long long position = 0;
+    size_t nextEvent = 0;
+
+    samples.assign(success ? numSamples : 0, 0);
+
+    while (success && position < numSamples) {
+        // notes start and end between buffers, at the sample they are due
+        while (nextEvent < check.events.size() && check.events[nextEvent].sample <= position) {
+            const NoteEvent& event = check.events[nextEvent++];
+            if (event.freq) {
+                player->m_keyPressed[event.voice] = event.voice + 1;
+                player->m_keyFreq[event.voice] = event.freq;
+                player->m_keyVelocity[event.voice] = event.velocity;
+            }
+            else {
+                player->m_keyReleased[event.voice] = 1;
+            }
+        }
+
+        long long end = std::min(numSamples, position + 4096);
+        if (nextEvent < check.events.size())
+            end = std::min(end, check.events[nextEvent].sample);
+
+        player->fillBuffer(&samples[position], (int)(end - position) * sizeof(short));
+        position = end;
+    }
+
+    delete player;
+    return success;
+}
+
+// The model of the SID the tune plays on, 0 for 6581, 1 for 8580.
+static int playedModel(const CheckCase& check)
+{
+    PlayerLibSidplay* player = new PlayerLibSidplay;
+    PlaybackSettings settings = check.settings;
+    int model = settings.mSidModel;
+
+    player->setAudioDriver(NULL);
+    if (!settings.mForceSidModel && player->loadTuneByPath(check.input.c_str(), check.subtune, &settings)) {
+        if (player->getCurrentChipModel() == PlayerLibSidplay::sChipModel8580)
+            model = 1;
+        else if (player->getCurrentChipModel() == PlayerLibSidplay::sChipModel6581)
+            model = 0;
+    }
+
+    delete player;
+    return model;
+}
+
+// Records a trace case through BatchRenderer to a file of its own and
+// replays it from the model and clock stored in the file.
+static bool renderTrace(const CheckCase& check, std::vector<short>& samples, int& sidModel)
+{
+    const char* directory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/sidcheck-%d-%s.sidtrace", directory, (int)getpid(), check.name.c_str());
+
+    RenderOptions options;
+    options.settings = check.settings;
+    options.output = path;
+    options.duration = check.seconds;
+    options.traces = true;
+
+    BatchRenderer* renderer = new BatchRenderer(options, 1);
+    renderer->add(check.input.c_str(), check.subtune, false);
+    renderer->run();
+    bool success = renderer->getTotals().failed == 0;
+    delete renderer;
+
+    SidTraceReplay replay;
+    success = success && replay.open(path) && replay.setup(check.settings.mFrequency);
+    sidModel = success ? replay.getHeader().sidModel : -1;
+
+    long long numSamples = (long long)(check.seconds * check.settings.mFrequency);
+    samples.assign(success ? numSamples : 0, 0);
+    for (long long position = 0; success && position < numSamples; ) {
+        int rendered = replay.render(&samples[position], (int)std::min(numSamples - position, 4096LL));
+        success = rendered > 0;
+        position += rendered;
+    }
+
+    replay.close();
+    unlink(path);
+    return success;
+}
+
+// Finds the length of the tune of a length case, on a player that
+// analysed the after= tune first if asked to.
+static bool analyzeLength(const CheckCase& check, bool after, SongLength& length)
+{
+    PlayerLibSidplay* player = new PlayerLibSidplay;
+    PlaybackSettings settings = check.settings;
+    SongLengthAnalyzer analyzer;
+    SongLength first;
+
+    player->setAudioDriver(NULL);
+
+    bool success = !after || (player->loadTuneByPath(check.after.c_str(), BatchRenderer::SUBTUNE_DEFAULT, &settings) &&
+                              analyzer.analyze(player, check.seconds, first));
+    success = success && player->loadTuneByPath(check.input.c_str(), check.subtune, &settings) &&
+              analyzer.analyze(player, check.seconds, length);
+
+    delete player;
+    return success;
+}
+
+// The same case with the exact emulation, in the environment the case
+// plays in.
+static CheckCase exactCase(const CheckCase& check)
+{
+    CheckCase exact = check;
+    exact.settings.mCpuEmulation = SID2_CPU_CYCLE;
+    exact.settings.mLazyRaster = false;
+    exact.settings.mLazyTimers = false;
+    exact.emulated = false;
+    return exact;
+}
+
+
+// ----------------------------------------------------------------------------
+// Case list
+// ----------------------------------------------------------------------------
+
+static bool parseOption(CheckCase& check, const char* token)
+{
+    const char* value = strchr(token, '=');
+    if (value == NULL)
+        return false;
+    std::string key(token, value - token);
+    value++;
+
+    if (key == "subtune")
+        check.subtune = atoi(value);
+    else if (key == "seconds")
+        check.seconds = atof(value);
+    else if (key == "rate")
+        check.settings.mFrequency = atoi(value);
+    else if (key == "model") {
+        if (strcmp(value, "6581") != 0 && strcmp(value, "8580") != 0)
+            return false;
+        check.settings.mSidModel = (strcmp(value, "8580") == 0) ? 1 : 0;
+        check.settings.mForceSidModel = true;
+    }
+    else if (key == "clock") {
+        if (strcmp(value, "pal") != 0 && strcmp(value, "ntsc") != 0)
+            return false;
+        check.settings.mClockSpeed = (strcmp(value, "ntsc") == 0) ? 1 : 0;
+    }
+    else if (key == "oversampling")
+        check.settings.mOversampling = atoi(value) > 0 ? atoi(value) : 1;
+    else if (key == "tolerance")
+        check.tolerance = atoi(value);
+    else if (key == "hash") {
+        char* end;
+        check.hash = strtoull(value, &end, 16);
+        check.hasHash = *value != '\0' && *end == '\0';
+        return check.hasHash;
+    }
+    else if (key == "seek" && !check.synth && !check.length && !check.trace)
+        check.seek = atof(value);
+    else if (key == "after" && check.length)
+        check.after = value;
+    else if (key == "emulation" && !check.synth && !check.trace) {
+        if (!check.settings.setEmulation(value))
+            return false;
+        check.emulated = strcmp(value, "exact") != 0;
+    }
+    else if (key == "patch" && check.synth)
+        check.input = value;
+    else if (key == "note" && check.synth) {
+        int voice, freq, velocity = 127;
+        double on, off;
+        if (sscanf(value, "%d:%d:%lf:%lf:%d", &voice, &freq, &on, &off, &velocity) < 4 ||
+            voice < 0 || voice >= NUM_VOICES || freq <= 0 || off < on)
+            return false;
+
+        NoteEvent event = { 0, voice, freq, velocity };
+        event.sample = (long long)(on * check.settings.mFrequency);
+        check.events.push_back(event);
+        event.sample = (long long)(off * check.settings.mFrequency);
+        event.freq = 0;
+        check.events.push_back(event);
+    }
+    else if (check.synth)
+        check.instrument += key + " = " + value + "\n";
+    else
+        return false;
+
+    return true;
+}
+
+static std::string resolvePath(const std::string& directory, const std::string& path)
+{
+    if (path.empty() || path[0] == '/')
+        return path;
+    return directory + path;
+}
+
+static bool readCases(const char* path, std::vector<CheckCase>& cases)
+{
+    std::ifstream fi(path, std::ios::in);
+    if (!fi.is_open()) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+
+    const char* slash = strrchr(path, '/');
+    std::string directory = slash ? std::string(path, slash - path + 1) : std::string();
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(fi, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+
+        std::vector<std::string> tokens;
+        char* saveptr;
+        std::vector<char> buffer(line.begin(), line.end());
+        buffer.push_back('\0');
+        for (char* token = strtok_r(&buffer[0], " \t\r", &saveptr); token; token = strtok_r(NULL, " \t\r", &saveptr))
+            tokens.push_back(token);
+        if (tokens.empty())
+            continue;
+
+        CheckCase check;
+        bool valid = tokens.size() >= 2;
+        size_t first = 2;
+
+        if (valid) {
+            check.name = tokens[0];
+            check.synth = tokens[1] == "synth";
+            check.length = tokens[1] == "length";
+            check.trace = tokens[1] == "trace";
+            valid = check.synth || ((tokens[1] == "tune" || check.length || check.trace) && tokens.size() >= 3);
+            if (valid && !check.synth)
+                check.input = tokens[first++];
+        }
+
+        // the rate first, note times depend on it
+        for (size_t i = first; valid && i < tokens.size(); i++) {
+            if (tokens[i].compare(0, 5, "rate=") == 0)
+                valid = parseOption(check, tokens[i].c_str());
+        }
+        for (size_t i = first; valid && i < tokens.size(); i++) {
+            if (tokens[i].compare(0, 5, "rate=") != 0)
+                valid = parseOption(check, tokens[i].c_str());
+        }
+
+        if (check.length && check.after.empty())
+            valid = false;
+
+        if (!valid) {
+            fprintf(stderr, "%s:%d: bad case\n", path, lineNumber);
+            return false;
+        }
+
+        check.line = lineNumber;
+        check.input = resolvePath(directory, check.input);
+        check.after = resolvePath(directory, check.after);
+        std::stable_sort(check.events.begin(), check.events.end());
+        cases.push_back(check);
+    }
+
+    return true;
+}
+
+// Sets the hash= option of the cases at their lines of the list to the
+// hashes given, the rest of the list is kept as it is.
+static bool writeHashes(const char* path, const std::vector<CheckCase>& cases, const std::vector<unsigned long long>& hashes)
+{
+    std::vector<std::string> lines;
+    std::ifstream fi(path, std::ios::in);
+    std::string line;
+    while (std::getline(fi, line))
+        lines.push_back(line);
+    if (!fi.eof())
+        return false;
+    fi.close();
+
+    for (size_t c = 0; c < cases.size(); c++) {
+        if (cases[c].line == 0)
+            continue;
+        std::string& text = lines[cases[c].line - 1];
+        size_t comment = std::min(text.find('#'), text.size());
+        std::string options = text.substr(0, comment);
+        std::string rest = text.substr(comment);
+
+        size_t start = options.find(" hash=");
+        if (start == std::string::npos)
+            start = options.find("\thash=");
+        if (start != std::string::npos) {
+            size_t end = options.find_first_of(" \t", start + 1);
+            options.erase(start, end == std::string::npos ? std::string::npos : end - start);
+        }
+        options.erase(options.find_last_not_of(" \t") + 1);
+
+        char hash[32];
+        snprintf(hash, sizeof(hash), " hash=%016llx", hashes[c]);
+        text = options + hash + (rest.empty() ? "" : " ") + rest;
+    }
+
+    std::string temp = std::string(path) + ".new";
+    std::ofstream fo(temp.c_str(), std::ios::out | std::ios::trunc);
+    for (size_t i = 0; i < lines.size(); i++)
+        fo << lines[i] << "\n";
+    fo.close();
+    return !fo.fail() && rename(temp.c_str(), path) == 0;
+}
+
+
+static void usage(const char* name)
+{
+    printf("usage: %s [options] <case list>\n", name);
+    printf("  -g <dir>      golden renders (default: golden/ next to the case list)\n");
+    printf("  -u            write the golden renders instead of checking against them\n");
+    printf("  -s            store the hashes of the renders in the case list instead of\n");
+    printf("                checking, for the cases that have no golden render\n");
+    printf("  -e <n>        largest sample difference still passing (default 0, bit-exact)\n");
+    printf("  -k <dir>      keep the renders of failing cases there, to listen to\n");
+    printf("  -b <text>     check only the cases whose name contains the text\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* goldenDirectory = NULL;
+    const char* keepDirectory = NULL;
+    const char* filter = NULL;
+    bool update = false;
+    bool storeHashes = false;
+    int tolerance = 0;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        bool hasValue = strchr("gekb", arg[1]) != NULL;
+
+        if (arg[1] == '\0' || arg[2] != '\0' || (hasValue && value == NULL)) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (hasValue)
+            i++;
+
+        switch (arg[1]) {
+            case 'g': goldenDirectory = value; break;
+            case 'u': update = true; break;
+            case 's': storeHashes = true; break;
+            case 'e': tolerance = atoi(value); break;
+            case 'k': keepDirectory = value; break;
+            case 'b': filter = value; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (i != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<CheckCase> cases;
+    if (!readCases(argv[i], cases))
+        return 1;
+
+    std::string golden;
+    if (goldenDirectory) {
+        golden = std::string(goldenDirectory) + "/";
+    }
+    else {
+        const char* slash = strrchr(argv[i], '/');
+        golden = (slash ? std::string(argv[i], slash - argv[i] + 1) : std::string()) + "golden/";
+    }
+
+    if (update)
+        mkdir(golden.c_str(), 0755);
+
+    RESID::SID::set_user_fir_cache_directory();
+
+    int numChecked = 0, numFailed = 0;
+    std::vector<CheckCase> hashed;
+    std::vector<unsigned long long> hashes;
+
+    for (size_t c = 0; c < cases.size(); c++) {
+        const CheckCase& check = cases[c];
+        if (filter && strstr(check.name.c_str(), filter) == NULL)
+            continue;
+
+        std::string goldenPath = golden + check.name + ".wav";
+        std::vector<short> output;
+        int rate = check.settings.mFrequency;
+        numChecked++;
+
+        if (check.length) {
+            SongLength alone, after;
+            bool analyzed = analyzeLength(check, false, alone) && analyzeLength(check, true, after);
+            bool passed = analyzed && alone.seconds == after.seconds && alone.end == after.end;
+
+            printf("%s\t%s", check.name.c_str(), passed ? "ok" : "FAIL");
+            if (!analyzed)
+                printf("\tcannot analyse %s", check.input.c_str());
+            else
+                printf("\t%s", SongLengthAnalyzer::formatLength(alone.seconds).c_str());
+            if (analyzed && !passed)
+                printf("\tafter %s %s", check.after.c_str(), SongLengthAnalyzer::formatLength(after.seconds).c_str());
+            printf("\n");
+            if (!passed)
+                numFailed++;
+            continue;
+        }
+
+        if (check.trace) {
+            int model;
+            bool rendered = renderTrace(check, output, model);
+            if (rendered && model != playedModel(check)) {
+                printf("%s\tFAIL\ttrace of %s recorded for the %s\n", check.name.c_str(), check.input.c_str(), model ? "8580" : "6581");
+                numFailed++;
+                continue;
+            }
+            if (!rendered) {
+                printf("%s\tFAIL\tcannot record or replay %s\n", check.name.c_str(), check.input.c_str());
+                numFailed++;
+                continue;
+            }
+        }
+        else if (!render(check, output)) {
+            printf("%s\tFAIL\tcannot render %s\n", check.name.c_str(), check.input.c_str());
+            numFailed++;
+            continue;
+        }
+
+        unsigned long long hash = hashSamples(output);
+
+        if (update && !check.emulated) {
+            bool written = writeWav(goldenPath.c_str(), rate, output);
+            printf("%s\t%s\t%016llx\t%s\n", check.name.c_str(), written ? "written" : "FAIL", hash, goldenPath.c_str());
+            if (!written)
+                numFailed++;
+            continue;
+        }
+
+        std::vector<short> expected;
+        int goldenRate = rate;
+        bool hasExpected = check.emulated ? render(exactCase(check), expected) : readWav(goldenPath.c_str(), goldenRate, expected);
+        if (!hasExpected && check.emulated) {
+            printf("%s\tFAIL\tcannot render %s with the exact emulation\n", check.name.c_str(), check.input.c_str());
+            numFailed++;
+            continue;
+        }
+        if (!hasExpected) {
+            if (storeHashes) {
+                printf("%s\tstored\t%016llx\n", check.name.c_str(), hash);
+                hashed.push_back(check);
+                hashes.push_back(hash);
+            }
+            else if (check.hasHash) {
+                bool passed = hash == check.hash;
+                printf("%s\t%s\t%016llx", check.name.c_str(), passed ? "ok" : "FAIL", hash);
+                if (!passed)
+                    printf("\texpected %016llx", check.hash);
+                printf("\n");
+                if (!passed) {
+                    numFailed++;
+                    keepRender(keepDirectory, check, rate, output);
+                }
+            }
+            else {
+                printf("%s\tFAIL\tno golden render %s nor hash\n", check.name.c_str(), goldenPath.c_str());
+                numFailed++;
+            }
+            continue;
+        }
+
+        Difference difference = compare(output, expected);
+        int allowed = check.tolerance >= 0 ? check.tolerance : tolerance;
+        bool sameLength = output.size() == expected.size() && goldenRate == rate;
+        bool passed = sameLength && difference.largest <= allowed;
+
+        printf("%s\t%s\t%016llx", check.name.c_str(), passed ? "ok" : "FAIL", hash);
+        if (!sameLength)
+            printf("\t%lu samples at %d Hz, golden %lu at %d Hz", (unsigned long)output.size(), rate, (unsigned long)expected.size(), goldenRate);
+        if (difference.first >= 0) {
+            long long first = difference.first;
+            double snr = difference.errorPower > 0.0 ? 10.0 * log10(difference.signalPower / difference.errorPower) : 0.0;
+            printf("\tfirst difference at sample %lld (%d:%06.3f): %d, golden %d\t%lld samples differ, by up to %d, SNR %.1f dB",
+                   first, (int)(first / rate / 60), fmod((double)first / rate, 60.0), output[first], expected[first],
+                   difference.numDiffering, difference.largest, snr);
+        }
+        printf("\n");
+
+        if (!passed) {
+            numFailed++;
+            keepRender(keepDirectory, check, rate, output);
+        }
+    }
+
+    if (!hashed.empty() && !writeHashes(argv[i], hashed, hashes)) {
+        fprintf(stderr, "cannot write %s\n", argv[i]);
+        numFailed++;
+    }
+
+    printf("total\t%d cases\t%d failed\n", numChecked, numFailed);
+
+    return numFailed ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+// Builds the index of a .sid collection, or lists/searches an index
+// without touching the tunes themselves.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "BatchRenderer.h"
+#include "SidCollectionIndex.h"
+
+
+static void usage(const char* name)
+{
+    printf("usage: %s [options] -o <index> <collection dir>\n", name);
+    printf("       %s -f <index> [<text>]\n", name);
+    printf("  -o <index>    index file to build from the .sid files under the directory\n");
+    printf("  -j <n>        parse on n threads, 0 for one per core (default 0)\n");
+    printf("  -f <index>    list the tunes of an index whose path, title or author\n");
+    printf("                contains the text (ignoring case)\n");
+}
+
+static void printEntry(SidCollectionIndex& index, int i)
+{
+    static const char* clocks[] = { "?", "PAL", "NTSC", "PAL/NTSC" };
+    static const char* models[] = { "?", "6581", "8580", "6581/8580" };
+    const SidIndexEntry& entry = index.getEntry(i);
+    char hash[33];
+
+    for (int b = 0; b < 16; b++)
+        snprintf(hash + b * 2, 3, "%02x", entry.hash[b]);
+
+    printf("%s\t%s\t%s\t%s\t%d/%d\t%s %s %s\t$%04x $%04x $%04x\t%s\n",
+           index.getString(entry.path), index.getString(entry.title), index.getString(entry.author),
+           index.getString(entry.released), entry.startSong, entry.songs, entry.rsid ? "RSID" : "PSID",
+           clocks[entry.clock & 3], models[entry.sidModel & 3], entry.loadAddr, entry.initAddr, entry.playAddr, hash);
+}
+
+int main(int argc, char** argv)
+{
+    const char* output = NULL;
+    const char* find = NULL;
+    int numThreads = 0;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (arg[1] == '\0' || arg[2] != '\0' || value == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+
+        switch (arg[1]) {
+            case 'o': output = value; break;
+            case 'j': numThreads = atoi(value); break;
+            case 'f': find = value; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (find) {
+        SidCollectionIndex index;
+        double start = BatchRenderer::now();
+
+        if (!index.open(find)) {
+            printf("%s: not an index\n", find);
+            return 1;
+        }
+
+        const char* text = i < argc ? argv[i] : "";
+        int found = 0;
+        for (int entry = index.search(text, 0); entry >= 0; entry = index.search(text, entry + 1)) {
+            printEntry(index, entry);
+            found++;
+        }
+
+        printf("total\t%d of %d tunes\t%.3fs wall\n", found, index.getCount(), BatchRenderer::now() - start);
+        return 0;
+    }
+
+    if (output == NULL || i + 1 != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (numThreads <= 0)
+        numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    double start = BatchRenderer::now();
+    int count = SidCollectionIndex::build(argv[i], output, numThreads);
+
+    if (count < 0) {
+        printf("%s: cannot write\n", output);
+        return 1;
+    }
+
+    printf("total\t%d tunes\t%.3fs wall\t%d threads\n", count, BatchRenderer::now() - start, numThreads);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Offline renderer: renders .sid subtunes or synth patches (instrument
+// files saved by the synth UI) to WAV/raw files, or to nothing, at full
+// CPU speed and reports the real-time factor of each job.  Register
+// traces (.sidtrace) are rendered by playing their writes back on resid.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "BatchRenderer.h"
+
+
+static const int SLICE_KEYFRAME_SECONDS = 10;
+
+static void usage(const char* name)
+{
+    printf("usage: %s [options] <file> [<file>...]\n", name);
+    printf("  -o <path>     output file, or directory when rendering several jobs\n");
+    printf("                (default: render to nothing, for measuring speed only)\n");
+    printf("  -r            write raw 16 bit little endian samples instead of WAV\n");
+    printf("  -w            write SID register traces (.sidtrace) instead of audio, inputs\n");
+    printf("                that are traces are rendered by replaying them on resid\n");
+    printf("  -s <n>        subtune (default: the tune's start song)\n");
+    printf("  -a            render all subtunes\n");
+    printf("  -t <time>     duration in seconds or m:ss (default 60, 10:00 with -l)\n");
+    printf("  -f <hz>       sample rate (default 44100)\n");
+    printf("  -m <model>    force SID model, 6581 or 8580\n");
+    printf("  -c <clock>    pal or ntsc (default pal)\n");
+    printf("  -x <n>        oversampling factor (default 1)\n");
+    printf("  -d <cycles>   power on delay, -1 for random (default 0)\n");
+    printf("  -e <mode>     emulation: exact, lazy (VIC and CIAs only wake for what the\n");
+    printf("                tune sees) or fast (lazy, PSIDs run an instruction at a time)\n");
+    printf("                (default exact, with lazy CIAs for -n, fast with -l)\n");
+    printf("  -i <seconds>  keyframe interval for seeking, 0 for none (default 0, %d for -n)\n", SLICE_KEYFRAME_SECONDS);
+    printf("  -j <n>        render on n threads, 0 for one per core (default 1)\n");
+    printf("  -n <n>        split each tune in n time slices rendered in parallel,\n");
+    printf("                up to one per thread (default 1, 0 for one per thread, slices\n");
+    printf("                are at least %gs)\n", BatchRenderer::MIN_SLICE_SECONDS);
+    printf("  -l <file>     find the length of all subtunes instead of rendering, by loops\n");
+    printf("                or trailing silence, and write a Songlengths.md5 database\n");
+    printf("  -p            inputs are synth patches instead of tunes\n");
+    printf("  -k <freq>     patch note, SID frequency register value (default 2000),\n");
+    printf("                repeat for chords (up to %d)\n", NUM_VOICES);
+    printf("  -g <time>     patch gate time before release (default half the duration)\n");
+}
+
+static double parseTime(const char* s)
+{
+    const char* colon = strchr(s, ':');
+    if (colon)
+        return atoi(s) * 60.0 + atof(colon + 1);
+    return atof(s);
+}
+
+int main(int argc, char** argv)
+{
+    RenderOptions options;
+    int subtune = BatchRenderer::SUBTUNE_DEFAULT;
+    int numThreads = 1;
+    bool durationSet = false;
+    const char* emulation = NULL;
+    int keyframeInterval = -1;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        bool hasValue = strchr("ostfmcxdeijnklg", arg[1]) != NULL;
+
+        if (arg[1] == '\0' || arg[2] != '\0' || (hasValue && value == NULL)) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (hasValue)
+            i++;
+
+        switch (arg[1]) {
+            case 'o': options.output = value; break;
+            case 'r': options.rawOutput = true; break;
+            case 'w': options.traces = true; break;
+            case 's': subtune = atoi(value); break;
+            case 'a': subtune = BatchRenderer::SUBTUNE_ALL; break;
+            case 't': options.duration = parseTime(value); durationSet = true; break;
+            case 'f': options.settings.mFrequency = atoi(value); break;
+            case 'm':
+                if (strcmp(value, "6581") != 0 && strcmp(value, "8580") != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                options.settings.mSidModel = (strcmp(value, "8580") == 0) ? 1 : 0;
+                options.settings.mForceSidModel = true;
+                break;
+            case 'c':
+                if (strcmp(value, "pal") != 0 && strcmp(value, "ntsc") != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                options.settings.mClockSpeed = (strcmp(value, "ntsc") == 0) ? 1 : 0;
+                break;
+            case 'x': options.settings.mOversampling = atoi(value) > 0 ? atoi(value) : 1; break;
+            case 'd': options.settings.mPowerOnDelay = atoi(value); break;
+            case 'e': emulation = value; break;
+            case 'i': keyframeInterval = atoi(value) > 0 ? atoi(value) : 0; break;
+            case 'j': numThreads = atoi(value); break;
+            case 'n': options.slices = atoi(value); break;
+            case 'l': options.lengths = value; break;
+            case 'p': options.patches = true; break;
+            case 'k':
+                if (options.numNotes < NUM_VOICES)
+                    options.notes[options.numNotes++] = atoi(value);
+                break;
+            case 'g': options.gate = parseTime(value); break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (i == argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (options.numNotes == 0)
+        options.notes[options.numNotes++] = 2000;
+
+    if (options.lengths && !durationSet)
+        options.duration = 600.0;
+
+    // finding lengths only needs what the tune sees, and the lazy CIA
+    // timers are cycle exact, so slices seek with them unless told
+    if (!options.settings.setEmulation(emulation ? emulation : (options.lengths ? "fast" : "exact"))) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (emulation == NULL && options.slices != 1)
+        options.settings.mLazyTimers = true;
+
+    // a worker seeking back to an earlier slice restores a keyframe
+    if (keyframeInterval < 0)
+        keyframeInterval = options.slices != 1 ? SLICE_KEYFRAME_SECONDS : 0;
+    options.settings.mKeyframeInterval = keyframeInterval;
+
+    if (numThreads <= 0)
+        numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    // a single job writes to the given file, otherwise it names a directory
+    bool batch = (argc - i > 1) || (subtune == BatchRenderer::SUBTUNE_ALL && !options.patches);
+
+    // every worker designs the same resampling filters, keep them between runs
+    RESID::SID::set_user_fir_cache_directory();
+
+    BatchRenderer renderer(options, numThreads);
+
+    for (; i < argc; i++)
+        renderer.add(argv[i], subtune, batch);
+
+    renderer.run();
+
+    const RenderTotals& totals = renderer.getTotals();
+    printf("total\t%d jobs\t%d failed\t%.2fs\t%.3fs wall\t%.1fx real-time\t%d threads\t%.1fx real-time per thread\n",
+           totals.jobs, totals.failed, totals.audioSeconds, totals.wallSeconds,
+           totals.wallSeconds > 0.0 ? totals.audioSeconds / totals.wallSeconds : 0.0, renderer.getNumWorkers(),
+           totals.renderSeconds > 0.0 ? totals.audioSeconds / totals.renderSeconds : 0.0);
+
+    return totals.failed ? 1 : 0;
+}